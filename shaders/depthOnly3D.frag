@@ -0,0 +1,5 @@
+#version 450
+
+// Depth is written by the fixed function stages, there is no color attachment output to produce
+void main() {
+}
\ No newline at end of file
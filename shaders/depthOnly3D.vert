@@ -0,0 +1,24 @@
+#version 450
+
+// Only the position stream of a SPLIT model is bound, see JCATModel3D::SplitVertex3D
+layout(location = 0) in vec3 position;
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+	mat4 projectionViewMatrix;
+	vec3 directionToLight;
+} ubo;
+
+layout(push_constant) uniform Push {
+	mat4 modelMatrix;
+	mat4 normalMatrix;
+	uint hasLighting;
+	uint hasTexture;
+	float fade;
+} push;
+
+// The main pass tests against this depth with LESS_OR_EQUAL, so both have to compute bit identical positions
+invariant gl_Position;
+
+void main() {
+	gl_Position = ubo.projectionViewMatrix * push.modelMatrix * vec4(position, 1.0);
+}
\ No newline at end of file
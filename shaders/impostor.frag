@@ -0,0 +1,50 @@
+#version 450
+
+layout (location = 0) in vec2 fragUV;
+layout (location = 1) flat in float fragFade;
+layout (location = 2) flat in uint fragHasLighting;
+layout (location = 3) flat in vec3 fragDirectionToLight;
+layout (location = 4) flat in mat3 fragNormalMatrix;
+
+layout (location = 0) out vec4 outColor;
+
+layout(set = 1, binding = 0) uniform sampler2D impostorColor;
+layout(set = 1, binding = 1) uniform sampler2D impostorNormal;
+
+const float AMBIENT = 0.05;
+
+// 4x4 ordered dither thresholds, the same pattern as simpleShader3DCrossFade.frag so a fading model and its impostor cover complementary pixels
+const float BAYER[16] = float[](
+	0.0, 8.0, 2.0, 10.0,
+	12.0, 4.0, 14.0, 6.0,
+	3.0, 11.0, 1.0, 9.0,
+	15.0, 7.0, 13.0, 5.0
+);
+
+float ditherThreshold() {
+	ivec2 pixel = ivec2(gl_FragCoord.xy) & 3;
+	return (BAYER[pixel.y * 4 + pixel.x] + 0.5) / 16.0;
+}
+
+void main() {
+	vec4 color = texture(impostorColor, fragUV);
+	if (color.a < 0.5 || ditherThreshold() >= fragFade) {
+		discard;
+	}
+
+	// Tiles are cleared to zero, so filtering and the smaller mip levels blend coverage in as premultiplied alpha
+	color.rgb /= color.a;
+
+	if (fragHasLighting != 0) {
+		vec4 encodedNormal = texture(impostorNormal, fragUV);
+		vec3 normal = encodedNormal.xyz / encodedNormal.a * 2.0 - 1.0;
+		vec3 normalWorldSpace = normalize(fragNormalMatrix * normal);
+
+		float lightIntensity = AMBIENT + max(dot(normalWorldSpace, fragDirectionToLight), 0);
+
+		outColor = vec4(lightIntensity * color.rgb, 1.0);
+	}
+	else {
+		outColor = vec4(color.rgb, 1.0);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#version 450
+
+// Per-instance attributes (binding 0, see ImpostorAtlas::Instance), the quad's corners come from the vertex index
+layout(location = 0) in vec4 tile;
+layout(location = 1) in vec3 center;
+layout(location = 2) in float fade;
+layout(location = 3) in vec3 right;
+layout(location = 4) in uint hasLighting;
+layout(location = 5) in vec3 up;
+layout(location = 6) in mat3 normalMatrix;
+
+layout(location = 0) out vec2 fragUV;
+layout(location = 1) flat out float fragFade;
+layout(location = 2) flat out uint fragHasLighting;
+layout(location = 3) flat out vec3 fragDirectionToLight;
+layout(location = 4) flat out mat3 fragNormalMatrix;
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+	mat4 projectionViewMatrix;
+	vec3 directionToLight;
+} ubo;
+
+// Two triangles, x along right and y along up
+const vec2 CORNERS[6] = vec2[](
+	vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0),
+	vec2(-1.0, -1.0), vec2(1.0, 1.0), vec2(-1.0, 1.0)
+);
+
+void main() {
+	vec2 corner = CORNERS[gl_VertexIndex];
+	gl_Position = ubo.projectionViewMatrix * vec4(center + corner.x * right + corner.y * up, 1.0);
+
+	// Tiles are stored top row first, with up pointing to the top of the tile
+	fragUV = tile.xy + vec2(corner.x * 0.5 + 0.5, 0.5 - corner.y * 0.5) * tile.zw;
+	fragFade = fade;
+	fragHasLighting = hasLighting;
+	// The global uniform buffer is only visible to the vertex stage
+	fragDirectionToLight = ubo.directionToLight;
+	fragNormalMatrix = normalMatrix;
+}
\ No newline at end of file
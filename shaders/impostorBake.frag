@@ -0,0 +1,21 @@
+#version 450
+
+layout (location = 0) in vec3 fragColor;
+layout (location = 1) in vec3 fragNormal;
+
+layout (location = 0) out vec4 outColor;
+
+layout(push_constant) uniform Push {
+	mat4 bakeMatrix;
+	uint bakeNormals;
+} push;
+
+// Alpha marks the model's coverage, the tile is cleared to zero around it
+void main() {
+	if (push.bakeNormals != 0) {
+		outColor = vec4(normalize(fragNormal) * 0.5 + 0.5, 1.0);
+	}
+	else {
+		outColor = vec4(fragColor, 1.0);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,23 @@
+#version 450
+
+// Vertex3D layout, SPLIT models bind the same locations from two streams
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+layout(location = 2) in vec3 normal;
+layout(location = 3) in vec2 uv;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragNormal;
+
+// The bake matrix maps the model's bounding sphere onto the tile being drawn, see ImpostorAtlas::getBakeMatrix
+layout(push_constant) uniform Push {
+	mat4 bakeMatrix;
+	uint bakeNormals;
+} push;
+
+void main() {
+	gl_Position = push.bakeMatrix * vec4(position, 1.0);
+
+	fragColor = color;
+	fragNormal = normal;
+}
\ No newline at end of file
@@ -0,0 +1,32 @@
+#version 450
+
+// CompactVertex3D: unorm16 position inside the model AABB, RGBA8 color, octahedral snorm16 normal, unorm16 uv
+layout(location = 0) in vec4 position;
+layout(location = 1) in vec4 color;
+layout(location = 2) in vec2 encodedNormal;
+layout(location = 3) in vec2 uv;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragNormal;
+
+layout(push_constant) uniform Push {
+	mat4 bakeMatrix;
+	uint bakeNormals;
+} push;
+
+// Inverse of CompactVertex3D::encode, unfolds the lower hemisphere back off the octahedron
+vec3 decodeOctahedral(vec2 encoded) {
+	vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+	float fold = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -fold : fold;
+	n.y += n.y >= 0.0 ? -fold : fold;
+	return normalize(n);
+}
+
+void main() {
+	// The bake matrix has the model's dequantize matrix folded in, so the unorm position goes straight through it
+	gl_Position = push.bakeMatrix * vec4(position.xyz, 1.0);
+
+	fragColor = color.rgb;
+	fragNormal = decodeOctahedral(encodedNormal);
+}
\ No newline at end of file
@@ -12,6 +12,7 @@ layout(push_constant) uniform Push {
 	mat4 normalMatrix;
 	uint hasLighting;
 	uint hasTexture;
+	float fade;
 } push;
 
 void main() {
@@ -18,10 +18,14 @@ layout(push_constant) uniform Push {
 	mat4 normalMatrix;
 	uint hasLighting;
 	uint hasTexture;
+	float fade;
 } push;
 
 const float AMBIENT = 0.05;
 
+// Must match depthOnly3D.vert exactly for SPLIT models drawn by the depth prepass
+invariant gl_Position;
+
 void main() {
 	gl_Position = ubo.projectionViewMatrix * push.modelMatrix * vec4(position, 1.0);
 
@@ -0,0 +1,54 @@
+#version 450
+
+// CompactVertex3D: unorm16 position inside the model AABB, RGBA8 color, octahedral snorm16 normal, unorm16 uv
+layout(location = 0) in vec4 position;
+layout(location = 1) in vec4 color;
+layout(location = 2) in vec2 encodedNormal;
+layout(location = 3) in vec2 uv;
+
+// Per-instance attributes (binding 2, see JCATModel3D::INSTANCE_BINDING)
+layout(location = 4) in mat4 instanceModelMatrix;
+layout(location = 8) in mat4 instanceNormalMatrix;
+layout(location = 12) in uvec2 instanceFlags;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragUV;
+layout(location = 2) flat out uint fragHasTexture;
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+	mat4 projectionViewMatrix;
+	vec3 directionToLight;
+} ubo;
+
+const float AMBIENT = 0.05;
+
+// Inverse of CompactVertex3D::encode, unfolds the lower hemisphere back off the octahedron
+vec3 decodeOctahedral(vec2 encoded) {
+	vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+	float fold = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -fold : fold;
+	n.y += n.y >= 0.0 ? -fold : fold;
+	return normalize(n);
+}
+
+// Declared like every other shader sharing the depth buffer with the prepass
+invariant gl_Position;
+
+void main() {
+	// The instance model matrix has the model's dequantize matrix folded in
+	gl_Position = ubo.projectionViewMatrix * instanceModelMatrix * vec4(position.xyz, 1.0);
+
+	if (instanceFlags.x != 0) {
+		vec3 normalWorldSpace = normalize(mat3(instanceNormalMatrix) * decodeOctahedral(encodedNormal));
+
+		float lightIntensity = AMBIENT + max(dot(normalWorldSpace, ubo.directionToLight), 0);
+
+		fragColor = lightIntensity * color.rgb;
+	}
+	else {
+		fragColor = color.rgb;
+	}
+
+	fragUV = uv;
+	fragHasTexture = instanceFlags.y;
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+#version 450
+
+// simpleShader3D.frag for objects cross-fading into their impostor. Kept apart since any discard turns off early depth testing
+
+layout (location = 0) in vec3 fragColor;
+layout (location = 1) in vec2 fragUV;
+
+layout (location = 0) out vec4 outColor;
+
+layout(set = 0, binding = 1) uniform sampler2D image;
+
+layout(push_constant) uniform Push {
+	mat4 modelMatrix;
+	mat4 normalMatrix;
+	uint hasLighting;
+	uint hasTexture;
+	float fade;
+} push;
+
+// 4x4 ordered dither thresholds, the same pattern as impostor.frag so a fading model and its impostor cover complementary pixels
+const float BAYER[16] = float[](
+	0.0, 8.0, 2.0, 10.0,
+	12.0, 4.0, 14.0, 6.0,
+	3.0, 11.0, 1.0, 9.0,
+	15.0, 7.0, 13.0, 5.0
+);
+
+float ditherThreshold() {
+	ivec2 pixel = ivec2(gl_FragCoord.xy) & 3;
+	return (BAYER[pixel.y * 4 + pixel.x] + 0.5) / 16.0;
+}
+
+void main() {
+	// Only bound for objects cross-fading into their impostor, which takes the pixels this leaves out
+	if (ditherThreshold() < 1.0 - push.fade) {
+		discard;
+	}
+
+	if (push.hasTexture != 0) {
+		vec3 imageColor = texture(image, fragUV).rgb;
+		outColor = vec4(fragColor * imageColor, 1.0);
+	}
+	else {
+		outColor = vec4(fragColor, 1.0);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,43 @@
+#version 450
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+layout(location = 2) in vec3 normal;
+layout(location = 3) in vec2 uv;
+
+// Per-instance attributes (binding 2, see JCATModel3D::INSTANCE_BINDING)
+layout(location = 4) in mat4 instanceModelMatrix;
+layout(location = 8) in mat4 instanceNormalMatrix;
+layout(location = 12) in uvec2 instanceFlags;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragUV;
+layout(location = 2) flat out uint fragHasTexture;
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+	mat4 projectionViewMatrix;
+	vec3 directionToLight;
+} ubo;
+
+const float AMBIENT = 0.05;
+
+// Must match depthOnly3D.vert exactly for SPLIT models drawn by the depth prepass
+invariant gl_Position;
+
+void main() {
+	gl_Position = ubo.projectionViewMatrix * instanceModelMatrix * vec4(position, 1.0);
+
+	if (instanceFlags.x != 0) {
+		vec3 normalWorldSpace = normalize(mat3(instanceNormalMatrix) * normal);
+
+		float lightIntensity = AMBIENT + max(dot(normalWorldSpace, ubo.directionToLight), 0);
+
+		fragColor = lightIntensity * color;
+	}
+	else {
+		fragColor = color;
+	}
+
+	fragUV = uv;
+	fragHasTexture = instanceFlags.y;
+}
\ No newline at end of file
@@ -46,6 +46,9 @@ namespace JCAT {
         
         // Process F key presses
         fullscreenFunctionality(window);
+
+        // Process F3 key presses
+        statsFunctionality(window);
     }
 
     void KeyboardController::moveObjectInPlaneXZ(GLFWwindow* window, float dt, GameObject& gameObject) {
@@ -101,6 +104,9 @@ namespace JCAT {
 
         // Process F key presses
         fullscreenFunctionality(window);
+
+        // Process F3 key presses
+        statsFunctionality(window);
     }
 
     void KeyboardController::escapeFunctionality(GLFWwindow* window){
@@ -147,4 +153,12 @@ namespace JCAT {
         }
         fKeyPressedLastFrame = isFKeyPressed;
     }
+
+    void KeyboardController::statsFunctionality(GLFWwindow* window){
+        bool isStatsKeyPressed = glfwGetKey(window, keysCommon.toggleStats) == GLFW_PRESS;
+        if (isStatsKeyPressed && !statsKeyPressedLastFrame) {
+            showStats = !showStats;
+        }
+        statsKeyPressedLastFrame = isStatsKeyPressed;
+    }
 };
\ No newline at end of file
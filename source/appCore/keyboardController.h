@@ -36,6 +36,7 @@ namespace JCAT {
             struct KeyMappingsCommon {
                 int escape = GLFW_KEY_ESCAPE;
                 int fullscreen = GLFW_KEY_F;
+                int toggleStats = GLFW_KEY_F3;
             };
 
             KeyboardController();
@@ -49,6 +50,7 @@ namespace JCAT {
 
             void escapeFunctionality(GLFWwindow* window);
             void fullscreenFunctionality(GLFWwindow* window);
+            void statsFunctionality(GLFWwindow* window);
 
             KeyMappings2D keys2D{};
             KeyMappings3D keys3D{};
@@ -59,6 +61,7 @@ namespace JCAT {
 
             int escapeCursor = 0;
             bool inFullscreen = false;
+            bool showStats = false; ///< Toggled with keysCommon.toggleStats, the app prints its per second rendering stats while set
 
             // Change these values to change the speed of the WASD movement and look sensitivity respectively
             float moveSpeed{ 3.f };
@@ -68,6 +71,7 @@ namespace JCAT {
             bool escapeKeyPressedLastFrame = false;
             bool leftMouseButtonPressedLastFrame = false;
             bool fKeyPressedLastFrame = false;
+            bool statsKeyPressedLastFrame = false;
     };
 };
 
@@ -6,6 +6,9 @@
 #include "./apps/default/3d/perlinNoise3D.h"
 #include "./engine/buffer.h"
 #include "./engine/texture.h"
+#include "./engine/3d/modelLoader.h"
+#include "./engine/3d/impostorAtlas.h"
+#include "./engine/3d/staticBatcher.h"
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -17,6 +20,7 @@
 #include <array>
 #include <cassert>
 #include <random>
+#include <algorithm>
 
 namespace JCAT {
     struct GlobalUbo {
@@ -57,13 +61,29 @@ namespace JCAT {
             .build();
 
         // For adding textures (We need to add the ability to add mutiple textures in the future)
-        Texture texture = Texture(device, resourceManager, "../textures/cobble.png");
-        Texture stone = Texture(device, resourceManager, "../textures/close-up-rock-with-lichen.jpg");
-        Texture stone2 = Texture(device, resourceManager, "../textures/cracked-plaster-wall.jpg");
-        Texture sand = Texture(device, resourceManager, "../textures/metallic-gold-paper-background.jpg");
-        Texture wood = Texture(device, resourceManager, "../textures/wood.jpg");
-        Texture moss = Texture(device, resourceManager, "../textures/moss.jpg");
-        Texture metal = Texture(device, resourceManager, "../textures/metal.jpg");
+        // Their copies, layout transitions and mip blits all share one submission
+        // All of them are albedo: the opaque photos fit BC1, the png keeps BC7 for its alpha and finer gradients
+        resourceManager.beginUploadBatch();
+        Texture texture = Texture(device, resourceManager, "../textures/cobble.png", TextureCompression::BC7);
+        Texture stone = Texture(device, resourceManager, "../textures/close-up-rock-with-lichen.jpg", TextureCompression::BC1);
+        Texture stone2 = Texture(device, resourceManager, "../textures/cracked-plaster-wall.jpg", TextureCompression::BC1);
+        Texture sand = Texture(device, resourceManager, "../textures/metallic-gold-paper-background.jpg", TextureCompression::BC1);
+        Texture wood = Texture(device, resourceManager, "../textures/wood.jpg", TextureCompression::BC1);
+        Texture moss = Texture(device, resourceManager, "../textures/moss.jpg", TextureCompression::BC1);
+        Texture metal = Texture(device, resourceManager, "../textures/metal.jpg", TextureCompression::BC1);
+        resourceManager.submitUploadBatch();
+
+        const UploadStats& uploadStats = resourceManager.getUploadStats();
+        std::cout << "Uploaded " << uploadStats.bytesUploaded / 1024 << " KiB of models and textures in " << uploadStats.submissions << " submissions, "
+                  << uploadStats.stagingStalls << " waits for staging space" << std::endl;
+
+        const MemoryStats memoryStats = resourceManager.getMemoryStats();
+        std::cout << "Device memory: " << memoryStats.bytesUsed / 1024 << " of " << memoryStats.bytesReserved / 1024 << " KiB used in "
+                  << memoryStats.deviceMemoryCount << " allocations" << std::endl;
+        for (const MemoryTypeStats& type : memoryStats.types) {
+            std::cout << "  Type " << type.memoryType << ": " << type.blockCount << " blocks, " << type.dedicatedCount << " dedicated, "
+                      << type.allocationCount << " allocations, " << static_cast<int>(type.fragmentation * 100.0f) << "% fragmented" << std::endl;
+        }
 
         // Bind texture to descriptor set
         VkDescriptorImageInfo imageInfo {};
@@ -80,12 +100,34 @@ namespace JCAT {
                 .build(globalDescriptorSets[i]);
         }
 
+        // Defragmentation may move the texture, each frame's set is rewritten once that frame's previous use has finished
+        std::vector<bool> descriptorSetStale(globalDescriptorSets.size(), false);
+        stone.setMoveCallback([&]() {
+            std::fill(descriptorSetStale.begin(), descriptorSetStale.end(), true);
+        });
+
         Application3DRenderer applicationRenderer{ 
             device,
             resourceManager,
             renderer.getSwapChainrenderPass(),
             globalSetLayout->getDescriptorSetLayout() 
         };
+
+        // Objects sharing a model are batched into one draw, the static batches each have a model of their own
+        applicationRenderer.setInstancedRendering(true);
+
+        // Only untextured objects can be replaced, textures are not baked into the atlas
+        std::vector<std::shared_ptr<JCATModel3D>> impostorModels;
+        for (const GameObject& obj : gameObjects) {
+            if (obj.model3D != nullptr && obj.hasTexture == 0 &&
+                std::find(impostorModels.begin(), impostorModels.end(), obj.model3D) == impostorModels.end()) {
+                impostorModels.push_back(obj.model3D);
+            }
+        }
+
+        ImpostorAtlas impostorAtlas{ device, resourceManager, impostorModels };
+        std::cout << "Baked " << impostorModels.size() << " models into a " << impostorAtlas.getWidth() << "x" << impostorAtlas.getHeight() << " impostor atlas" << std::endl;
+        applicationRenderer.setImpostors(&impostorAtlas, IMPOSTOR_DISTANCE, IMPOSTOR_FADE_RANGE);
     
         Camera3D camera{};
         camera.setViewTarget(glm::vec3(-1.f, -2.f, 2.f), glm::vec3(0.f, 0.f, 2.5f));
@@ -94,9 +136,11 @@ namespace JCAT {
         cameraController.inFullscreen = window.windowInFullscreen();
 
         std::chrono::time_point<std::chrono::high_resolution_clock> currentTime = std::chrono::high_resolution_clock::now();
+        float cullingReportTimer = 0.0f;
 
         while (!window.shouldWindowClose()) {
             glfwPollEvents();
+            resourceManager.collectCompletedUploads();
 
             std::chrono::time_point<std::chrono::high_resolution_clock> newTime = std::chrono::high_resolution_clock::now();
             float frameTime = std::chrono::duration<float, std::chrono::seconds::period>(newTime - currentTime).count();
@@ -108,10 +152,20 @@ namespace JCAT {
             float aspect = renderer.getAspectRatio();
             camera.setPerspectiveProjection(glm::radians(50.f), aspect, 0.1f, 100.f);
 
+            resourceManager.defragment(DEFRAGMENT_BUDGET);
+
             if (VkCommandBuffer commandBuffer = renderer.beginRecordingFrame()) {
 
                 // Create new FrameInfo object that stores relevant frame information
                 int frameIndex = renderer.getFrameIndex();
+
+                if (descriptorSetStale[frameIndex]) {
+                    imageInfo.imageView = stone.getImageView();
+                    JCATDescriptorWriter(*globalSetLayout, *globalPool)
+                        .writeImage(1, &imageInfo)
+                        .overwrite(globalDescriptorSets[frameIndex]);
+                    descriptorSetStale[frameIndex] = false;
+                }
                 FrameInfo frameInfo{
                     frameIndex,
                     frameTime,
@@ -132,13 +186,36 @@ namespace JCAT {
                 renderer.endSwapChainRenderPass(commandBuffer);
                 renderer.endRecordingFrame();
             }
+
+            // While toggled on (F3), report how many objects frustum culling removed, which levels of detail were drawn and what meshlet culling saved, once a second
+            cullingReportTimer += frameTime;
+            if (cameraController.showStats && cullingReportTimer >= 1.0f) {
+                const CullingStats& cullingStats = applicationRenderer.getCullingStats();
+                const LodStats& lodStats = applicationRenderer.getLodStats();
+                std::cout << "Visible objects: " << cullingStats.visible << " | Culled objects: " << cullingStats.culled << " | Objects per LOD:";
+                for (uint32_t count : lodStats.objectsPerLod) {
+                    std::cout << " " << count;
+                }
+                const ClusterStats& clusterStats = applicationRenderer.getClusterStats();
+                std::cout << " | Triangles: " << lodStats.trianglesDrawn << " | Meshlets culled: " << clusterStats.frustumCulled + clusterStats.backfaceCulled << "/" << clusterStats.tested
+                    << " (" << clusterStats.backfaceCulled << " backfacing, " << clusterStats.trianglesCulled << " triangles)";
+                const ImpostorStats& impostorStats = applicationRenderer.getImpostorStats();
+                std::cout << " | Impostors: " << impostorStats.impostors << " (" << impostorStats.crossFading << " fading)" << std::endl;
+
+                const DefragmentationStats& defragmentationStats = resourceManager.getDefragmentationStats();
+                if (defragmentationStats.moves > 0) {
+                    std::cout << "Defragmentation: " << defragmentationStats.moves << " moves, " << defragmentationStats.bytesMoved / 1024 << " KiB copied, "
+                              << defragmentationStats.bytesReclaimed / 1024 << " KiB in " << defragmentationStats.blocksReleased << " blocks reclaimed" << std::endl;
+                }
+                cullingReportTimer = 0.0f;
+            }
         }
 
         vkDeviceWaitIdle(device.device());
     }
 
     // Courtesy of tutorial for this:
-    std::unique_ptr<JCATModel3D> createCubeModel(DeviceSetup& device, ResourceManager& resourceManager, glm::vec3 offset) {
+    std::vector<JCATModel3D::Vertex3D> createCubeVertices(glm::vec3 offset) {
         std::vector<JCATModel3D::Vertex3D> vertices{
             // Left face (X = -0.5)
             {{-.5f, -.5f, -.5f}, {0.5f, 0.3f, 0.1f}, {-1.f, 0.f, 0.f}, {0.0f, 0.0f}},
@@ -193,10 +270,10 @@ namespace JCAT {
             v.position += offset;
         }
 
-        return std::make_unique<JCATModel3D>(device, resourceManager, vertices);
+        return vertices;
     }
 
-    std::unique_ptr<JCATModel3D> createWhiteCubeModel(DeviceSetup& device, ResourceManager& resourceManager, glm::vec3 offset) {
+    std::vector<JCATModel3D::Vertex3D> createWhiteCubeVertices(glm::vec3 offset) {
         std::vector<JCATModel3D::Vertex3D> vertices{
             // Left face (X = -0.5)
             {{-.5f, -.5f, -.5f}, {1.0f, 1.0f, 1.0f}, {-1.f, 0.f, 0.f}, {0.0f, 0.0f}},
@@ -253,28 +330,71 @@ namespace JCAT {
             v.color = {1.0f, 1.0f, 1.0f};  // Make sure every vertex is white
         }
     
-        return std::make_unique<JCATModel3D>(device, resourceManager, vertices);
+        return vertices;
     }
 
     void Application3D::loadGameObjects() {
-        std::shared_ptr<JCATModel3D> cubeModel = createCubeModel(device, resourceManager, { .0f, .0f, .0f });
-        std::shared_ptr<JCATModel3D> whiteCubeModel = createWhiteCubeModel(device, resourceManager, { .0f, .0f, .0f });
-        std::shared_ptr<JCATModel3D> betterCubeModel = JCATModel3D::createModelFromFile(device, resourceManager, "../models/cube.obj", true);
-        std::shared_ptr<JCATModel3D> vaseModel = JCATModel3D::createModelFromFile(device, resourceManager, "../models/smooth_vase.obj", true);
-        std::shared_ptr<JCATModel3D> donutModel = JCATModel3D::createModelFromFile(device, resourceManager, "../models/CM_Donut_Scrap.obj", true);
-        std::shared_ptr<JCATModel3D> bearModel = JCATModel3D::createModelFromFile(device, resourceManager, "../models/3legBear.obj", true);
-        std::shared_ptr<JCATModel3D> chairModel = JCATModel3D::createModelFromFile(device, resourceManager, "../models/adirondackChair.obj", true);
-        std::shared_ptr<JCATModel3D> cacomistleModel = JCATModel3D::createModelFromFile(device, resourceManager, "../models/cacomistle.obj", true);
-        std::shared_ptr<JCATModel3D> cupModel = JCATModel3D::createModelFromFile(device, resourceManager, "../models/cup.obj", true);
-        std::shared_ptr<JCATModel3D> deerModel = JCATModel3D::createModelFromFile(device, resourceManager, "../models/deer.obj", true);
-        std::shared_ptr<JCATModel3D> giraffeModel = JCATModel3D::createModelFromFile(device, resourceManager, "../models/giraffe.obj", true);
-        std::shared_ptr<JCATModel3D> mongolianGerbilModel = JCATModel3D::createModelFromFile(device, resourceManager, "../models/mongolianGerbil.obj", true);
-        std::shared_ptr<JCATModel3D> mudpuppyModel = JCATModel3D::createModelFromFile(device, resourceManager, "../models/mudpuppy.obj", true);
-        std::shared_ptr<JCATModel3D> osakaModel = JCATModel3D::createModelFromFile(device, resourceManager, "../models/osaka.obj", true);
-        std::shared_ptr<JCATModel3D> penguinModel = JCATModel3D::createModelFromFile(device, resourceManager, "../models/penguin.obj", true);
-        std::shared_ptr<JCATModel3D> pigModel = JCATModel3D::createModelFromFile(device, resourceManager, "../models/pizzaPig.obj", true);
-        std::shared_ptr<JCATModel3D> saltChairModel = JCATModel3D::createModelFromFile(device, resourceManager, "../models/saltChair.obj", true);
-        std::shared_ptr<JCATModel3D> seagullModel = JCATModel3D::createModelFromFile(device, resourceManager, "../models/seagull.obj", true);
+        // Every model upload below is recorded into one batch and submitted once they are all in
+        resourceManager.beginUploadBatch();
+
+        // Their vertices are kept for the StaticBatcher, models uploaded from files have no CPU copy left to merge
+        JCATModel3D::ModelBuilder cubeGeometry{};
+        cubeGeometry.vertices = createCubeVertices({ .0f, .0f, .0f });
+        JCATModel3D::ModelBuilder whiteCubeGeometry{};
+        whiteCubeGeometry.vertices = createWhiteCubeVertices({ .0f, .0f, .0f });
+
+        std::shared_ptr<JCATModel3D> cubeModel = std::make_shared<JCATModel3D>(device, resourceManager, cubeGeometry.vertices);
+        std::shared_ptr<JCATModel3D> whiteCubeModel = std::make_shared<JCATModel3D>(device, resourceManager, whiteCubeGeometry.vertices);
+
+        // Parse every model file on worker threads at once, then upload them as they finish.
+        // They are uploaded quantized (CompactVertex3D) unless their UVs or colors fall outside [0, 1],
+        // with a LOD chain so distant objects draw fewer triangles.
+        std::chrono::time_point<std::chrono::high_resolution_clock> loadStart = std::chrono::high_resolution_clock::now();
+        ModelLoader modelLoader{ device, resourceManager, assetRegistry };
+
+        ModelLoader::ModelHandle betterCubeHandle = modelLoader.requestModel("../models/cube.obj", true, true, JCATModel3D::VertexFormat::COMPACT, JCATModel3D::MAX_LODS);
+        ModelLoader::ModelHandle vaseHandle = modelLoader.requestModel("../models/smooth_vase.obj", true, true, JCATModel3D::VertexFormat::COMPACT, JCATModel3D::MAX_LODS);
+        ModelLoader::ModelHandle donutHandle = modelLoader.requestModel("../models/CM_Donut_Scrap.obj", true, true, JCATModel3D::VertexFormat::COMPACT, JCATModel3D::MAX_LODS);
+        ModelLoader::ModelHandle bearHandle = modelLoader.requestModel("../models/3legBear.obj", true, true, JCATModel3D::VertexFormat::COMPACT, JCATModel3D::MAX_LODS);
+        ModelLoader::ModelHandle chairHandle = modelLoader.requestModel("../models/adirondackChair.obj", true, true, JCATModel3D::VertexFormat::COMPACT, JCATModel3D::MAX_LODS);
+        ModelLoader::ModelHandle cacomistleHandle = modelLoader.requestModel("../models/cacomistle.obj", true, true, JCATModel3D::VertexFormat::COMPACT, JCATModel3D::MAX_LODS);
+        ModelLoader::ModelHandle cupHandle = modelLoader.requestModel("../models/cup.obj", true, true, JCATModel3D::VertexFormat::COMPACT, JCATModel3D::MAX_LODS);
+        ModelLoader::ModelHandle deerHandle = modelLoader.requestModel("../models/deer.obj", true, true, JCATModel3D::VertexFormat::COMPACT, JCATModel3D::MAX_LODS);
+        ModelLoader::ModelHandle giraffeHandle = modelLoader.requestModel("../models/giraffe.obj", true, true, JCATModel3D::VertexFormat::COMPACT, JCATModel3D::MAX_LODS);
+        ModelLoader::ModelHandle mongolianGerbilHandle = modelLoader.requestModel("../models/mongolianGerbil.obj", true, true, JCATModel3D::VertexFormat::COMPACT, JCATModel3D::MAX_LODS);
+        ModelLoader::ModelHandle mudpuppyHandle = modelLoader.requestModel("../models/mudpuppy.obj", true, true, JCATModel3D::VertexFormat::COMPACT, JCATModel3D::MAX_LODS);
+        ModelLoader::ModelHandle osakaHandle = modelLoader.requestModel("../models/osaka.obj", true, true, JCATModel3D::VertexFormat::COMPACT, JCATModel3D::MAX_LODS);
+        ModelLoader::ModelHandle penguinHandle = modelLoader.requestModel("../models/penguin.obj", true, true, JCATModel3D::VertexFormat::COMPACT, JCATModel3D::MAX_LODS);
+        ModelLoader::ModelHandle pigHandle = modelLoader.requestModel("../models/pizzaPig.obj", true, true, JCATModel3D::VertexFormat::COMPACT, JCATModel3D::MAX_LODS);
+        ModelLoader::ModelHandle saltChairHandle = modelLoader.requestModel("../models/saltChair.obj", true, true, JCATModel3D::VertexFormat::COMPACT, JCATModel3D::MAX_LODS);
+        ModelLoader::ModelHandle seagullHandle = modelLoader.requestModel("../models/seagull.obj", true, true, JCATModel3D::VertexFormat::COMPACT, JCATModel3D::MAX_LODS);
+
+        modelLoader.uploadAll();
+        resourceManager.submitUploadBatch();
+
+        std::shared_ptr<JCATModel3D> betterCubeModel = modelLoader.getModel(betterCubeHandle);
+        std::shared_ptr<JCATModel3D> vaseModel = modelLoader.getModel(vaseHandle);
+        std::shared_ptr<JCATModel3D> donutModel = modelLoader.getModel(donutHandle);
+        std::shared_ptr<JCATModel3D> bearModel = modelLoader.getModel(bearHandle);
+        std::shared_ptr<JCATModel3D> chairModel = modelLoader.getModel(chairHandle);
+        std::shared_ptr<JCATModel3D> cacomistleModel = modelLoader.getModel(cacomistleHandle);
+        std::shared_ptr<JCATModel3D> cupModel = modelLoader.getModel(cupHandle);
+        std::shared_ptr<JCATModel3D> deerModel = modelLoader.getModel(deerHandle);
+        std::shared_ptr<JCATModel3D> giraffeModel = modelLoader.getModel(giraffeHandle);
+        std::shared_ptr<JCATModel3D> mongolianGerbilModel = modelLoader.getModel(mongolianGerbilHandle);
+        std::shared_ptr<JCATModel3D> mudpuppyModel = modelLoader.getModel(mudpuppyHandle);
+        std::shared_ptr<JCATModel3D> osakaModel = modelLoader.getModel(osakaHandle);
+        std::shared_ptr<JCATModel3D> penguinModel = modelLoader.getModel(penguinHandle);
+        std::shared_ptr<JCATModel3D> pigModel = modelLoader.getModel(pigHandle);
+        std::shared_ptr<JCATModel3D> saltChairModel = modelLoader.getModel(saltChairHandle);
+        std::shared_ptr<JCATModel3D> seagullModel = modelLoader.getModel(seagullHandle);
+
+        float loadTime = std::chrono::duration<float, std::chrono::milliseconds::period>(std::chrono::high_resolution_clock::now() - loadStart).count();
+        std::cout << "Loaded " << modelLoader.getModelCount() << " models in " << loadTime << " ms using " << modelLoader.getThreadCount() << " threads" << std::endl;
+
+        const GeometryPoolStats poolStats = resourceManager.getGeometryPool().getStats();
+        std::cout << "Geometry pool: " << poolStats.vertexBytesUsed / 1024 << "/" << poolStats.vertexCapacity / 1024 << " KiB vertices, "
+                  << poolStats.indexBytesUsed / 1024 << "/" << poolStats.indexCapacity / 1024 << " KiB indices" << std::endl;
 	
         GameObject cube = GameObject::createGameObject();
         cube.model3D = cubeModel;
@@ -282,6 +402,7 @@ namespace JCAT {
         cube.transform.scale = { .5f, .5f, .5f };
         cube.hasLighting = 0;
         cube.hasTexture = 0;
+        cube.isStatic = true;
         gameObjects.push_back(std::move(cube));
 
         GameObject cube2 = GameObject::createGameObject();
@@ -290,6 +411,7 @@ namespace JCAT {
         cube2.transform.scale = { 1.0f, 1.0f, 1.0f };
         cube2.hasLighting = 0;
         cube2.hasTexture = 0;
+        cube2.isStatic = true;
         gameObjects.push_back(std::move(cube2));
 
         GameObject cube3 = GameObject::createGameObject();
@@ -298,6 +420,7 @@ namespace JCAT {
         cube3.transform.scale = { 1.0f, 0.5f, 1.0f };
         cube3.hasLighting = 0;
         cube3.hasTexture = 0;
+        cube3.isStatic = true;
         gameObjects.push_back(std::move(cube3));
 
         GameObject cube4 = GameObject::createGameObject();
@@ -306,6 +429,7 @@ namespace JCAT {
         cube4.transform.scale = { 1.0f, 0.5f, 1.5f };
         cube4.hasLighting = 0;
         cube4.hasTexture = 0;
+        cube4.isStatic = true;
         gameObjects.push_back(std::move(cube4));
 
         GameObject vase = GameObject::createGameObject();
@@ -454,9 +578,23 @@ namespace JCAT {
                     noiseCube.transform.scale = { 1.0f, 1.0f, 1.0f };
                     noiseCube.hasLighting = 1;
                     noiseCube.hasTexture = 1;
+                    noiseCube.isStatic = true;
                     gameObjects.push_back(std::move(noiseCube));
                 }
             }
         }
+
+        // Merge the static cubes into chunks, the terrain alone would otherwise be tens of thousands of objects to cull and draw
+        StaticBatcher staticBatcher{ device, resourceManager };
+        staticBatcher.addSourceGeometry(cubeModel.get(), cubeGeometry);
+        staticBatcher.addSourceGeometry(whiteCubeModel.get(), whiteCubeGeometry);
+
+        resourceManager.beginUploadBatch();
+        staticBatcher.bake(gameObjects, JCATModel3D::VertexFormat::COMPACT);
+        resourceManager.submitUploadBatch();
+
+        const StaticBatchStats& batchStats = staticBatcher.getStats();
+        std::cout << "Baked " << batchStats.objectsBaked << " static objects into " << batchStats.batches << " batches ("
+                  << batchStats.verticesBaked << " vertices, " << batchStats.trianglesBaked << " triangles)" << std::endl;
     }
 };
\ No newline at end of file
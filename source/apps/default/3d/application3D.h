@@ -10,12 +10,17 @@
 #include "./engine/3d/gameObject.h"
 #include "./engine/renderer.h"
 #include "./engine/descriptors.h"
+#include "./engine/assetRegistry.h"
 
 namespace JCAT {
     class Application3D {
         public:
             static constexpr int DEFAULT_WIDTH = 1280;
             static constexpr int DEFAULT_HEIGHT = 720;
+            static constexpr VkDeviceSize STAGING_RING_SIZE = 64ull << 20; ///< Host visible memory all uploads are staged through, see ResourceManager
+            static constexpr VkDeviceSize DEFRAGMENT_BUDGET = 8ull << 20; ///< Bytes of memory defragmentation may copy per frame
+            static constexpr float IMPOSTOR_DISTANCE = 40.0f; ///< Distance from the camera beyond which untextured objects start turning into impostors
+            static constexpr float IMPOSTOR_FADE_RANGE = 5.0f; ///< Distance over which an object cross-fades into its impostor
 
             Application3D();
             ~Application3D();
@@ -29,8 +34,9 @@ namespace JCAT {
 
             Window window{ DEFAULT_WIDTH, DEFAULT_HEIGHT, "JCAT Game Engine", false };
             DeviceSetup device{window};
-            ResourceManager resourceManager{device};
+            ResourceManager resourceManager{ device, STAGING_RING_SIZE };
             Renderer renderer{ window, device, resourceManager, "3D", false };
+            AssetRegistry assetRegistry{ device, resourceManager };
 
             std::unique_ptr<JCATDescriptorPool> globalPool{};
             std::vector<GameObject> gameObjects;
@@ -1,6 +1,9 @@
 #include <unordered_map>
+#include <algorithm>
+#include <limits>
 
 #include "./apps/default/3d/application3DRenderer.h"
+#include "./engine/swapChain.h"
 
 namespace JCAT {
     struct PushConstantData {
@@ -8,15 +11,49 @@ namespace JCAT {
         glm::mat4 normalMatrix { 1.0f };
         uint32_t hasLighting = 0;
         uint32_t hasTexture = 0;
+        float fade = 1.0f; ///< Share of the mesh's pixels drawn, below 1 while cross-fading into its impostor
     };
 
-    Application3DRenderer::Application3DRenderer(DeviceSetup& d, ResourceManager& r, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout) : device{d}, resourceManager{r} {
+    // Projected bounding sphere radius, as a fraction of half the screen height, below which each coarser level is used.
+    // Every level is simplified with twice the error of the one before, so halving the size keeps the error on screen about even.
+    static constexpr float LOD_SCREEN_SIZES[JCATModel3D::MAX_LODS - 1] = { 0.25f, 0.125f, 0.0625f };
+
+    // Each vertex format is read by its own pipeline
+    static GraphicsPipeline::PipelineType getObjectPipelineType(JCATModel3D::VertexFormat format, bool instanced) {
+        switch (format) {
+            case JCATModel3D::VertexFormat::COMPACT:
+                return instanced ? GraphicsPipeline::PipelineType::INSTANCED_COMPACT_OBJECT_PIPELINE : GraphicsPipeline::PipelineType::COMPACT_OBJECT_PIPELINE;
+            case JCATModel3D::VertexFormat::SPLIT:
+                return instanced ? GraphicsPipeline::PipelineType::INSTANCED_SPLIT_OBJECT_PIPELINE : GraphicsPipeline::PipelineType::SPLIT_OBJECT_PIPELINE;
+            default:
+                return instanced ? GraphicsPipeline::PipelineType::INSTANCED_OBJECT_PIPELINE : GraphicsPipeline::PipelineType::SOLID_OBJECT_PIPELINE;
+        }
+    }
+
+    static GraphicsPipeline::PipelineType getCrossFadePipelineType(JCATModel3D::VertexFormat format) {
+        switch (format) {
+            case JCATModel3D::VertexFormat::COMPACT:
+                return GraphicsPipeline::PipelineType::CROSS_FADE_COMPACT_OBJECT_PIPELINE;
+            case JCATModel3D::VertexFormat::SPLIT:
+                return GraphicsPipeline::PipelineType::CROSS_FADE_SPLIT_OBJECT_PIPELINE;
+            default:
+                return GraphicsPipeline::PipelineType::CROSS_FADE_OBJECT_PIPELINE;
+        }
+    }
+
+    Application3DRenderer::Application3DRenderer(DeviceSetup& d, ResourceManager& r, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout) : device{d}, resourceManager{r}, renderPass{renderPass}, globalSetLayout{globalSetLayout} {
         createPipelineLayout(globalSetLayout);
         createPipeline(renderPass);
+
+        instanceBuffers.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+        instanceCapacities.resize(SwapChain::MAX_FRAMES_IN_FLIGHT, 0);
+        impostorBuffers.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+        impostorCapacities.resize(SwapChain::MAX_FRAMES_IN_FLIGHT, 0);
     }
 
     Application3DRenderer::~Application3DRenderer() {
         vkDestroyPipelineLayout(device.device(), pipelineLayout, nullptr);
+        vkDestroyPipelineLayout(device.device(), impostorPipelineLayout, nullptr);
     }
 
     void Application3DRenderer::createPipelineLayout(VkDescriptorSetLayout globalSetLayout) {
@@ -50,28 +87,210 @@ namespace JCAT {
         pipelineConfigs[GraphicsPipeline::PipelineType::SOLID_OBJECT_PIPELINE].pipelineLayout = pipelineLayout;
 
         pipeline->createSolidObjectPipeline("../shaders/simpleShader3D.vert.spv", "../shaders/simpleShader3D.frag.spv", pipelineConfigs[GraphicsPipeline::PipelineType::SOLID_OBJECT_PIPELINE]);
+
+        // The instanced shaders ignore the push constant range, so both pipelines can share the same layout
+        pipelineConfigs[GraphicsPipeline::PipelineType::INSTANCED_OBJECT_PIPELINE].renderPass = renderPass;
+        pipelineConfigs[GraphicsPipeline::PipelineType::INSTANCED_OBJECT_PIPELINE].pipelineLayout = pipelineLayout;
+
+        pipeline->createInstancedObjectPipeline("../shaders/simpleShader3DInstanced.vert.spv", "../shaders/simpleShader3DInstanced.frag.spv", pipelineConfigs[GraphicsPipeline::PipelineType::INSTANCED_OBJECT_PIPELINE]);
+
+        // Models uploaded as CompactVertex3D only differ in their vertex shader, the fragment shaders are shared
+        pipelineConfigs[GraphicsPipeline::PipelineType::COMPACT_OBJECT_PIPELINE].renderPass = renderPass;
+        pipelineConfigs[GraphicsPipeline::PipelineType::COMPACT_OBJECT_PIPELINE].pipelineLayout = pipelineLayout;
+
+        pipeline->createCompactObjectPipeline("../shaders/simpleShader3DCompact.vert.spv", "../shaders/simpleShader3D.frag.spv", pipelineConfigs[GraphicsPipeline::PipelineType::COMPACT_OBJECT_PIPELINE]);
+
+        pipelineConfigs[GraphicsPipeline::PipelineType::INSTANCED_COMPACT_OBJECT_PIPELINE].renderPass = renderPass;
+        pipelineConfigs[GraphicsPipeline::PipelineType::INSTANCED_COMPACT_OBJECT_PIPELINE].pipelineLayout = pipelineLayout;
+
+        pipeline->createInstancedCompactObjectPipeline("../shaders/simpleShader3DCompactInstanced.vert.spv", "../shaders/simpleShader3DInstanced.frag.spv", pipelineConfigs[GraphicsPipeline::PipelineType::INSTANCED_COMPACT_OBJECT_PIPELINE]);
+
+        // SPLIT models read the same attributes at the same locations as STANDARD ones, just from two bindings, so they share its shaders
+        pipelineConfigs[GraphicsPipeline::PipelineType::SPLIT_OBJECT_PIPELINE].renderPass = renderPass;
+        pipelineConfigs[GraphicsPipeline::PipelineType::SPLIT_OBJECT_PIPELINE].pipelineLayout = pipelineLayout;
+
+        pipeline->createSplitObjectPipeline("../shaders/simpleShader3D.vert.spv", "../shaders/simpleShader3D.frag.spv", pipelineConfigs[GraphicsPipeline::PipelineType::SPLIT_OBJECT_PIPELINE]);
+
+        pipelineConfigs[GraphicsPipeline::PipelineType::INSTANCED_SPLIT_OBJECT_PIPELINE].renderPass = renderPass;
+        pipelineConfigs[GraphicsPipeline::PipelineType::INSTANCED_SPLIT_OBJECT_PIPELINE].pipelineLayout = pipelineLayout;
+
+        pipeline->createInstancedSplitObjectPipeline("../shaders/simpleShader3DInstanced.vert.spv", "../shaders/simpleShader3DInstanced.frag.spv", pipelineConfigs[GraphicsPipeline::PipelineType::INSTANCED_SPLIT_OBJECT_PIPELINE]);
+
+        // Objects fading into their impostor get the dithering fragment shader, so the pipelines above never discard
+        for (GraphicsPipeline::PipelineType type : { GraphicsPipeline::PipelineType::CROSS_FADE_OBJECT_PIPELINE,
+                                                     GraphicsPipeline::PipelineType::CROSS_FADE_COMPACT_OBJECT_PIPELINE,
+                                                     GraphicsPipeline::PipelineType::CROSS_FADE_SPLIT_OBJECT_PIPELINE }) {
+            pipelineConfigs[type].renderPass = renderPass;
+            pipelineConfigs[type].pipelineLayout = pipelineLayout;
+        }
+
+        pipeline->createCrossFadeObjectPipeline("../shaders/simpleShader3D.vert.spv", "../shaders/simpleShader3DCrossFade.frag.spv", pipelineConfigs[GraphicsPipeline::PipelineType::CROSS_FADE_OBJECT_PIPELINE]);
+        pipeline->createCrossFadeCompactObjectPipeline("../shaders/simpleShader3DCompact.vert.spv", "../shaders/simpleShader3DCrossFade.frag.spv", pipelineConfigs[GraphicsPipeline::PipelineType::CROSS_FADE_COMPACT_OBJECT_PIPELINE]);
+        pipeline->createCrossFadeSplitObjectPipeline("../shaders/simpleShader3D.vert.spv", "../shaders/simpleShader3DCrossFade.frag.spv", pipelineConfigs[GraphicsPipeline::PipelineType::CROSS_FADE_SPLIT_OBJECT_PIPELINE]);
+
+        // Writes depth from the position stream alone, see setDepthPrepass()
+        pipelineConfigs[GraphicsPipeline::PipelineType::DEPTH_ONLY_PIPELINE].renderPass = renderPass;
+        pipelineConfigs[GraphicsPipeline::PipelineType::DEPTH_ONLY_PIPELINE].pipelineLayout = pipelineLayout;
+
+        pipeline->createDepthOnlyPipeline("../shaders/depthOnly3D.vert.spv", "../shaders/depthOnly3D.frag.spv", pipelineConfigs[GraphicsPipeline::PipelineType::DEPTH_ONLY_PIPELINE]);
         
         std::cout << "Created Pipeline Successfully!" << std::endl;
     }
 
+    void Application3DRenderer::setImpostors(const ImpostorAtlas* atlas, float distance, float fadeRange) {
+        impostorAtlas = atlas;
+        impostorDistance = distance;
+        impostorFadeRange = fadeRange;
+        fadingIndices.clear();
+        impostorIndices.clear();
+
+        // Every atlas declares the same set layout, so the pipeline made for the first one works with any other
+        if (atlas != nullptr && impostorPipelineLayout == VK_NULL_HANDLE) {
+            createImpostorPipeline(atlas->getDescriptorSetLayout());
+        }
+    }
+
+    void Application3DRenderer::createImpostorPipeline(VkDescriptorSetLayout impostorSetLayout) {
+        // Set 0 matches pipelineLayout, so the global set stays valid when switching between the two
+        std::vector<VkDescriptorSetLayout> descriptorSetLayouts{ globalSetLayout, impostorSetLayout };
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
+        pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
+        pipelineLayoutInfo.pushConstantRangeCount = 0;
+
+        if (vkCreatePipelineLayout(device.device(), &pipelineLayoutInfo, nullptr, &impostorPipelineLayout) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create impostor pipeline layout!");
+        }
+
+        std::unordered_map<GraphicsPipeline::PipelineType, PipelineConfigInfo> pipelineConfigs = {};
+        pipeline->configurePipelines(pipelineConfigs);
+        pipelineConfigs[GraphicsPipeline::PipelineType::IMPOSTOR_PIPELINE].renderPass = renderPass;
+        pipelineConfigs[GraphicsPipeline::PipelineType::IMPOSTOR_PIPELINE].pipelineLayout = impostorPipelineLayout;
+
+        pipeline->createImpostorPipeline("../shaders/impostor.vert.spv", "../shaders/impostor.frag.spv", pipelineConfigs[GraphicsPipeline::PipelineType::IMPOSTOR_PIPELINE]);
+    }
+
+    const std::vector<uint32_t>& Application3DRenderer::cullGameObjects(FrameInfo &frameInfo, std::vector<GameObject>& gameObjects) {
+        culler.setFrustum(frameInfo.camera.getProjection() * frameInfo.camera.getView());
+        culler.beginFrame(gameObjects.size());
+        worldSpheres.resize(gameObjects.size());
+
+        for (size_t i = 0; i < gameObjects.size(); i++) {
+            GameObject& obj = gameObjects[i];
+            if (obj.model3D == nullptr) {
+                // Nothing to draw, an infinitely negative radius guarantees the object is always culled
+                culler.addSphere(glm::vec3{0.0f}, -std::numeric_limits<float>::infinity());
+                continue;
+            }
+
+            // Kept for LOD selection, which needs the same spheres for the objects that survive
+            worldSpheres[i] = obj.getWorldBoundingSphere();
+            culler.addSphere(worldSpheres[i].center, worldSpheres[i].radius);
+        }
+
+        return culler.cull();
+    }
+
+    void Application3DRenderer::selectLods(FrameInfo &frameInfo, std::vector<GameObject>& gameObjects, const std::vector<uint32_t>& visibleIndices) {
+        const glm::mat4& view = frameInfo.camera.getView();
+        const float projectionScale = frameInfo.camera.getProjection()[1][1];
+
+        for (uint32_t index : visibleIndices) {
+            JCATModel3D& model = *gameObjects[index].model3D;
+            const BoundingSphere& sphere = worldSpheres[index];
+            uint32_t lod = 0;
+
+            // The camera looks down +z in view space, an object the camera is inside of always gets full detail
+            const float depth = (view * glm::vec4{ sphere.center, 1.0f }).z;
+            if (lodSelection && model.getLodCount() > 1 && depth > sphere.radius) {
+                const float screenSize = sphere.radius * projectionScale / depth;
+                while (lod + 1 < model.getLodCount() && screenSize < LOD_SCREEN_SIZES[lod]) {
+                    lod++;
+                }
+            }
+
+            objectLods[index] = lod;
+            lodStats.objectsPerLod[lod]++;
+            lodStats.trianglesDrawn += model.getLodIndexCount(lod) / 3;
+        }
+    }
+
     void Application3DRenderer::renderGameObjects(FrameInfo &frameInfo, std::vector<GameObject>& gameObjects) {
-        pipeline->bindPipeline(frameInfo.commandBuffer, GraphicsPipeline::PipelineType::SOLID_OBJECT_PIPELINE);
+        const std::vector<uint32_t>& visibleIndices = cullGameObjects(frameInfo, gameObjects);
+        objectLods.resize(gameObjects.size());
+        lodStats = LodStats{};
+        clusterStats = ClusterStats{};
+        impostorStats = ImpostorStats{};
 
-        vkCmdBindDescriptorSets(
-            frameInfo.commandBuffer,
-            VK_PIPELINE_BIND_POINT_GRAPHICS,
-            pipelineLayout,
-            0, 1, 
-            &frameInfo.globalDescriptorSet,
-            0, nullptr
-        );
+        // Without impostors every visible object is drawn as a mesh, and nothing is fading
+        const std::vector<uint32_t>* drawnAsMesh = &visibleIndices;
+        if (impostorAtlas != nullptr) {
+            selectImpostors(frameInfo, gameObjects, visibleIndices);
+            drawnAsMesh = &meshIndices;
+        }
+
+        selectLods(frameInfo, gameObjects, *drawnAsMesh);
+        selectLods(frameInfo, gameObjects, fadingIndices);
+
+        // Fading objects are left out, their dithered pixels would be covered by depth the main pass then never shades
+        if (depthPrepass) {
+            renderDepthPrepass(frameInfo, gameObjects, *drawnAsMesh);
+        }
+
+        if (instancedRendering) {
+            renderGameObjectsInstanced(frameInfo, gameObjects, *drawnAsMesh);
+        }
+        else {
+            renderGameObjectsIndividually(frameInfo, gameObjects, *drawnAsMesh, false);
+        }
+
+        // Each fading object needs its own fade, so they never join an instanced batch
+        renderGameObjectsIndividually(frameInfo, gameObjects, fadingIndices, true);
+
+        if (impostorAtlas != nullptr) {
+            renderImpostors(frameInfo, gameObjects);
+        }
+    }
+
+    void Application3DRenderer::renderGameObjectsIndividually(FrameInfo &frameInfo, std::vector<GameObject>& gameObjects, const std::vector<uint32_t>& indices, bool crossFading) {
+        // Every pipeline shares the layout, so the descriptor set stays bound when switching between them
+        bool pipelineBound = false;
+        JCATModel3D::VertexFormat boundFormat = JCATModel3D::VertexFormat::STANDARD;
+        const JCATModel3D* boundModel = nullptr;
+
+        for (uint32_t index : indices) {
+            GameObject& obj = gameObjects[index];
+
+            const JCATModel3D::VertexFormat format = obj.model3D->getVertexFormat();
+            if (!pipelineBound || format != boundFormat) {
+                pipeline->bindPipeline(frameInfo.commandBuffer, crossFading ? getCrossFadePipelineType(format) : getObjectPipelineType(format, false));
+
+                if (!pipelineBound) {
+                    vkCmdBindDescriptorSets(
+                        frameInfo.commandBuffer,
+                        VK_PIPELINE_BIND_POINT_GRAPHICS,
+                        pipelineLayout,
+                        0, 1, 
+                        &frameInfo.globalDescriptorSet,
+                        0, nullptr
+                    );
+                }
+
+                pipelineBound = true;
+                boundFormat = format;
+            }
 
-        for (GameObject& obj : gameObjects) {
             PushConstantData push{};
             push.modelMatrix = obj.transform.modelMatrix();
+            if (obj.model3D->isCompact()) {
+                push.modelMatrix = push.modelMatrix * obj.model3D->getDequantizeMatrix();
+            }
             push.normalMatrix = obj.transform.normalMatrix();
             push.hasLighting = obj.hasLighting;
             push.hasTexture = obj.hasTexture;
+            push.fade = crossFading ? objectFades[index] : 1.0f;
 
             vkCmdPushConstants(frameInfo.commandBuffer, 
                                pipelineLayout, 
@@ -80,8 +299,295 @@ namespace JCAT {
                                sizeof(PushConstantData), 
                                &push);
 
-            obj.model3D->bind(frameInfo.commandBuffer);
-            obj.model3D->draw(frameInfo.commandBuffer);
+            obj.model3D->bind(frameInfo.commandBuffer, boundModel);
+            boundModel = obj.model3D.get();
+            if (canCullClusters(*obj.model3D, objectLods[index])) {
+                drawClusters(frameInfo, obj, 0);
+            }
+            else {
+                obj.model3D->draw(frameInfo.commandBuffer, 1, 0, objectLods[index]);
+            }
+        }
+    }
+
+    void Application3DRenderer::drawClusters(FrameInfo &frameInfo, GameObject& obj, uint32_t firstInstance) {
+        JCATModel3D& model = *obj.model3D;
+        const std::vector<JCATModel3D::Meshlet>& meshlets = model.getMeshlets();
+
+        // Meshlet bounds are in model space, so bring the frustum planes and the eye there instead of moving every meshlet.
+        // Both tests survive any affine model matrix this way, including the mirrored ones. The dequantize matrix is not
+        // part of it, the bounds were computed before quantization.
+        const glm::mat4 modelMatrix = obj.transform.modelMatrix();
+        clusterCuller.setFrustum(frameInfo.camera.getProjection() * frameInfo.camera.getView() * modelMatrix);
+        const glm::vec3 eye{ glm::inverse(modelMatrix) * glm::vec4{ frameInfo.camera.getPosition(), 1.0f } };
+
+        clusterCuller.beginFrame(meshlets.size());
+        for (const JCATModel3D::Meshlet& meshlet : meshlets) {
+            clusterCuller.addSphere(meshlet.center, meshlet.radius);
+        }
+
+        const std::vector<uint32_t>& visibleMeshlets = clusterCuller.cull();
+        clusterStats.tested += static_cast<uint32_t>(meshlets.size());
+        clusterStats.frustumCulled += clusterCuller.getStats().culled;
+
+        // Meshlets are stored in index order, so consecutive survivors usually merge into one draw
+        uint32_t rangeFirst = 0;
+        uint32_t rangeCount = 0;
+        uint32_t drawnIndices = 0;
+
+        for (uint32_t meshletIndex : visibleMeshlets) {
+            const JCATModel3D::Meshlet& meshlet = meshlets[meshletIndex];
+            if (meshlet.isBackfacing(eye)) {
+                clusterStats.backfaceCulled++;
+                continue;
+            }
+
+            drawnIndices += meshlet.indexCount;
+            if (rangeCount > 0 && rangeFirst + rangeCount == meshlet.firstIndex) {
+                rangeCount += meshlet.indexCount;
+                continue;
+            }
+
+            if (rangeCount > 0) {
+                model.drawIndexRange(frameInfo.commandBuffer, rangeFirst, rangeCount, 1, firstInstance);
+            }
+            rangeFirst = meshlet.firstIndex;
+            rangeCount = meshlet.indexCount;
+        }
+
+        if (rangeCount > 0) {
+            model.drawIndexRange(frameInfo.commandBuffer, rangeFirst, rangeCount, 1, firstInstance);
+        }
+
+        const uint64_t trianglesCulled = (model.getLodIndexCount(0) - drawnIndices) / 3;
+        clusterStats.trianglesCulled += trianglesCulled;
+        lodStats.trianglesDrawn -= trianglesCulled;
+    }
+
+    void Application3DRenderer::renderGameObjectsInstanced(FrameInfo &frameInfo, std::vector<GameObject>& gameObjects, const std::vector<uint32_t>& visibleIndices) {
+        // First pass: count how many visible objects share each model and LOD so every batch gets a contiguous range of instances
+        batchLookup.clear();
+        instanceBatches.clear();
+
+        for (uint32_t index : visibleIndices) {
+            GameObject& obj = gameObjects[index];
+            const BatchKey key{ obj.model3D.get(), objectLods[index] };
+
+            std::pair<std::unordered_map<BatchKey, uint32_t, BatchKeyHash>::iterator, bool> inserted = batchLookup.try_emplace(key, static_cast<uint32_t>(instanceBatches.size()));
+            if (inserted.second) {
+                instanceBatches.push_back({ key.model, key.lod, 0, 0, index });
+            }
+
+            instanceBatches[inserted.first->second].instanceCount++;
+            instanceBatches[inserted.first->second].objectIndex = index;
+        }
+
+        uint32_t totalInstances = 0;
+        for (InstanceBatch& batch : instanceBatches) {
+            batch.firstInstance = totalInstances;
+            totalInstances += batch.instanceCount;
+            batch.instanceCount = 0;
+        }
+
+        if (totalInstances == 0) {
+            return;
+        }
+
+        reserveFrameBuffer(instanceBuffers, instanceCapacities, frameInfo.frameIndex, totalInstances, sizeof(JCATModel3D::InstanceData3D));
+        JCATBuffer& instanceBuffer = *instanceBuffers[frameInfo.frameIndex];
+
+        // Second pass: write the instance data straight into the mapped buffer at each batch's offset
+        JCATModel3D::InstanceData3D* instances = static_cast<JCATModel3D::InstanceData3D*>(instanceBuffer.getMappedMemory());
+        for (uint32_t index : visibleIndices) {
+            GameObject& obj = gameObjects[index];
+
+            InstanceBatch& batch = instanceBatches[batchLookup[BatchKey{ obj.model3D.get(), objectLods[index] }]];
+
+            JCATModel3D::InstanceData3D& instance = instances[batch.firstInstance + batch.instanceCount++];
+            instance.modelMatrix = obj.transform.modelMatrix();
+            if (batch.model->isCompact()) {
+                instance.modelMatrix = instance.modelMatrix * batch.model->getDequantizeMatrix();
+            }
+            instance.normalMatrix = obj.transform.normalMatrix();
+            instance.hasLighting = obj.hasLighting;
+            instance.hasTexture = obj.hasTexture;
+        }
+
+        pipeline->bindPipeline(frameInfo.commandBuffer, GraphicsPipeline::PipelineType::INSTANCED_OBJECT_PIPELINE);
+        JCATModel3D::VertexFormat boundFormat = JCATModel3D::VertexFormat::STANDARD;
+
+        vkCmdBindDescriptorSets(
+            frameInfo.commandBuffer,
+            VK_PIPELINE_BIND_POINT_GRAPHICS,
+            pipelineLayout,
+            0, 1,
+            &frameInfo.globalDescriptorSet,
+            0, nullptr
+        );
+
+        // The instance binding stays bound for every batch. Models in the geometry pool share their vertex/index buffers too, so only
+        // a model that did not fit in the pool, a SPLIT model (or a switch between 16 and 32 bit indices) rebinds anything
+        VkBuffer buffers[] = { instanceBuffer.getBuffer() };
+        VkDeviceSize offsets[] = { 0 };
+        vkCmdBindVertexBuffers(frameInfo.commandBuffer, JCATModel3D::INSTANCE_BINDING, 1, buffers, offsets);
+
+        const JCATModel3D* boundModel = nullptr;
+        for (InstanceBatch& batch : instanceBatches) {
+            if (batch.model->getVertexFormat() != boundFormat) {
+                boundFormat = batch.model->getVertexFormat();
+                pipeline->bindPipeline(frameInfo.commandBuffer, getObjectPipelineType(boundFormat, true));
+            }
+
+            batch.model->bind(frameInfo.commandBuffer, boundModel);
+            boundModel = batch.model;
+
+            // Culling a batch's meshlets would need every instance's transform, so only lone objects get split
+            if (batch.instanceCount == 1 && canCullClusters(*batch.model, batch.lod)) {
+                drawClusters(frameInfo, gameObjects[batch.objectIndex], batch.firstInstance);
+            }
+            else {
+                batch.model->draw(frameInfo.commandBuffer, batch.instanceCount, batch.firstInstance, batch.lod);
+            }
+        }
+    }
+
+    void Application3DRenderer::renderDepthPrepass(FrameInfo &frameInfo, std::vector<GameObject>& gameObjects, const std::vector<uint32_t>& visibleIndices) {
+        bool pipelineBound = false;
+        const JCATModel3D* boundModel = nullptr;
+
+        // Only SPLIT models have a position stream to draw from, everything else is left to the main pass alone
+        for (uint32_t index : visibleIndices) {
+            GameObject& obj = gameObjects[index];
+            if (!obj.model3D->isSplit()) {
+                continue;
+            }
+
+            if (!pipelineBound) {
+                pipeline->bindPipeline(frameInfo.commandBuffer, GraphicsPipeline::PipelineType::DEPTH_ONLY_PIPELINE);
+                vkCmdBindDescriptorSets(
+                    frameInfo.commandBuffer,
+                    VK_PIPELINE_BIND_POINT_GRAPHICS,
+                    pipelineLayout,
+                    0, 1,
+                    &frameInfo.globalDescriptorSet,
+                    0, nullptr
+                );
+                pipelineBound = true;
+            }
+
+            PushConstantData push{};
+            push.modelMatrix = obj.transform.modelMatrix();
+
+            vkCmdPushConstants(frameInfo.commandBuffer,
+                               pipelineLayout,
+                               VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                               0,
+                               sizeof(PushConstantData),
+                               &push);
+
+            obj.model3D->bindPositions(frameInfo.commandBuffer, boundModel);
+            boundModel = obj.model3D.get();
+            obj.model3D->draw(frameInfo.commandBuffer, 1, 0, objectLods[index]);
+        }
+    }
+
+    void Application3DRenderer::selectImpostors(FrameInfo &frameInfo, std::vector<GameObject>& gameObjects, const std::vector<uint32_t>& visibleIndices) {
+        meshIndices.clear();
+        fadingIndices.clear();
+        impostorIndices.clear();
+        objectFades.resize(gameObjects.size());
+
+        const glm::vec3 eye = frameInfo.camera.getPosition();
+
+        for (uint32_t index : visibleIndices) {
+            GameObject& obj = gameObjects[index];
+            const float distance = glm::length(worldSpheres[index].center - eye);
+
+            // Textures are not baked into the atlas, textured objects always keep their mesh
+            if (distance <= impostorDistance || obj.hasTexture != 0 || !impostorAtlas->contains(obj.model3D.get())) {
+                meshIndices.push_back(index);
+                continue;
+            }
+
+            // 1 at impostorDistance, down to 0 at the end of the fade range
+            const float meshFade = impostorFadeRange > 0.0f ? 1.0f - (distance - impostorDistance) / impostorFadeRange : 0.0f;
+            if (meshFade > 0.0f) {
+                objectFades[index] = meshFade;
+                fadingIndices.push_back(index);
+            }
+            else {
+                impostorIndices.push_back(index);
+            }
+        }
+
+        impostorStats.impostors = static_cast<uint32_t>(impostorIndices.size());
+        impostorStats.crossFading = static_cast<uint32_t>(fadingIndices.size());
+    }
+
+    void Application3DRenderer::renderImpostors(FrameInfo &frameInfo, std::vector<GameObject>& gameObjects) {
+        const uint32_t totalInstances = static_cast<uint32_t>(fadingIndices.size() + impostorIndices.size());
+        if (totalInstances == 0) {
+            return;
         }
+
+        reserveFrameBuffer(impostorBuffers, impostorCapacities, frameInfo.frameIndex, totalInstances, sizeof(ImpostorAtlas::Instance));
+        JCATBuffer& impostorBuffer = *impostorBuffers[frameInfo.frameIndex];
+
+        // Every impostor shares the atlas, so all of them go into one instanced draw
+        ImpostorAtlas::Instance* instances = static_cast<ImpostorAtlas::Instance*>(impostorBuffer.getMappedMemory());
+        const glm::vec3 eye = frameInfo.camera.getPosition();
+        uint32_t instanceCount = 0;
+
+        for (const std::vector<uint32_t>* indices : { &fadingIndices, &impostorIndices }) {
+            const bool crossFading = indices == &fadingIndices;
+            for (uint32_t index : *indices) {
+                GameObject& obj = gameObjects[index];
+
+                ImpostorAtlas::Instance& instance = instances[instanceCount++];
+                impostorAtlas->fillInstance(*obj.model3D, obj.transform.modelMatrix(), obj.transform.normalMatrix(), eye, instance);
+                instance.fade = crossFading ? 1.0f - objectFades[index] : 1.0f;
+                instance.hasLighting = obj.hasLighting;
+            }
+        }
+
+        pipeline->bindPipeline(frameInfo.commandBuffer, GraphicsPipeline::PipelineType::IMPOSTOR_PIPELINE);
+
+        VkDescriptorSet descriptorSets[] = { frameInfo.globalDescriptorSet, impostorAtlas->getDescriptorSet() };
+        vkCmdBindDescriptorSets(
+            frameInfo.commandBuffer,
+            VK_PIPELINE_BIND_POINT_GRAPHICS,
+            impostorPipelineLayout,
+            0, 2,
+            descriptorSets,
+            0, nullptr
+        );
+
+        VkBuffer buffers[] = { impostorBuffer.getBuffer() };
+        VkDeviceSize offsets[] = { 0 };
+        vkCmdBindVertexBuffers(frameInfo.commandBuffer, 0, 1, buffers, offsets);
+
+        // Six vertices per quad, generated in the vertex shader
+        vkCmdDraw(frameInfo.commandBuffer, 6, instanceCount, 0, 0);
+    }
+
+    void Application3DRenderer::reserveFrameBuffer(std::vector<std::unique_ptr<JCATBuffer>>& buffers, std::vector<uint32_t>& capacities, int frameIndex, uint32_t count, VkDeviceSize elementSize) {
+        if (buffers[frameIndex] != nullptr && capacities[frameIndex] >= count) {
+            return;
+        }
+
+        // Grow geometrically so a slowly increasing object count does not recreate the buffer every frame.
+        // The fence for this frame index has already been waited on, so the old buffer is no longer in use.
+        uint32_t newCapacity = std::max(count, capacities[frameIndex] * 2);
+
+        buffers[frameIndex] = std::make_unique<JCATBuffer>(
+            device,
+            resourceManager,
+            elementSize,
+            newCapacity,
+            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+        );
+        buffers[frameIndex]->map();
+        capacities[frameIndex] = newCapacity;
     }
 };
\ No newline at end of file
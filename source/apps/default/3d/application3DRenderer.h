@@ -1,8 +1,10 @@
 #ifndef APPLICATION_3D_RENDERER
 #define APPLICATION_3D_RENDERER
 
+#include <array>
 #include <memory>
 #include <vector>
+#include <unordered_map>
 
 #include "./engine/3d/camera3D.h"
 #include "./engine/graphicsPipeline.h"
@@ -10,8 +12,32 @@
 #include "./engine/resourceManager.h"
 #include "./engine/3d/gameObject.h"
 #include "./engine/frameInfo.h"
+#include "./engine/buffer.h"
+#include "./engine/3d/frustumCuller.h"
+#include "./engine/3d/impostorAtlas.h"
+#include "./engine/utils.h"
 
 namespace JCAT {
+    // What level of detail selection did in the last frame, level 0 is full detail
+    struct LodStats {
+        std::array<uint32_t, JCATModel3D::MAX_LODS> objectsPerLod{};
+        uint64_t trianglesDrawn = 0;
+    };
+
+    // What per meshlet culling removed in the last frame, only models drawn at full detail are split into meshlets
+    struct ClusterStats {
+        uint32_t tested = 0;
+        uint32_t frustumCulled = 0;
+        uint32_t backfaceCulled = 0;
+        uint64_t trianglesCulled = 0;
+    };
+
+    // How many visible objects were drawn from the impostor atlas in the last frame
+    struct ImpostorStats {
+        uint32_t impostors = 0; ///< Drawn only as their impostor
+        uint32_t crossFading = 0; ///< Drawn as both while switching between the two
+    };
+
     class Application3DRenderer {
         public:
             Application3DRenderer(DeviceSetup& d, ResourceManager& r, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
@@ -21,15 +47,123 @@ namespace JCAT {
             Application3DRenderer& operator=(const Application3DRenderer&) = delete;
 
             void renderGameObjects(FrameInfo &frameInfo, std::vector<GameObject>& gameObjects);
+
+            // Groups objects by model and draws each group with a single instanced draw call
+            void setInstancedRendering(bool enabled) { instancedRendering = enabled; }
+            bool isInstancedRendering() const { return instancedRendering; }
+
+            // Objects whose bounding sphere lies outside the camera frustum are skipped before any commands are recorded
+            void setFrustumCulling(bool enabled) { culler.setEnabled(enabled); }
+            const CullingStats& getCullingStats() const { return culler.getStats(); }
+
+            // Draws models that have a LOD chain at the level matching how large their bounding sphere appears on screen
+            void setLodSelection(bool enabled) { lodSelection = enabled; }
+            const LodStats& getLodStats() const { return lodStats; }
+
+            // Draws only the meshlets of a full detail model that are inside the frustum and face the camera.
+            // Instanced batches are only split when they hold a single object, LodStats::trianglesDrawn excludes the culled triangles.
+            void setClusterCulling(bool enabled) { clusterCulling = enabled; }
+            const ClusterStats& getClusterStats() const { return clusterStats; }
+
+            // Lays down the depth of visible SPLIT models from their position stream first, so the main pass only shades the surfaces that end up on screen
+            void setDepthPrepass(bool enabled) { depthPrepass = enabled; }
+            bool isDepthPrepass() const { return depthPrepass; }
+
+            /**
+             * Draws untextured objects whose model is in the atlas as a camera facing quad once their bounding sphere's center
+             * is further than distance from the camera. Over the next fadeRange units both are drawn with complementary dither
+             * patterns, so the swap does not pop. Pass a null atlas to turn impostors off, the atlas has to outlive its use.
+             */
+            void setImpostors(const ImpostorAtlas* atlas, float distance, float fadeRange);
+            const ImpostorStats& getImpostorStats() const { return impostorStats; }
         private:
+            struct InstanceBatch {
+                JCATModel3D* model;
+                uint32_t lod;
+                uint32_t firstInstance;
+                uint32_t instanceCount;
+                uint32_t objectIndex; ///< The last object added, the whole batch when instanceCount is 1
+            };
+
+            // Objects share an instanced draw only if they use the same model at the same level of detail
+            struct BatchKey {
+                JCATModel3D* model;
+                uint32_t lod;
+
+                bool operator==(const BatchKey& other) const { return model == other.model && lod == other.lod; }
+            };
+
+            struct BatchKeyHash {
+                size_t operator()(const BatchKey& key) const {
+                    size_t seed = 0;
+                    hashCombine(seed, key.model, key.lod);
+                    return seed;
+                }
+            };
+
             void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
             void createPipeline(VkRenderPass renderPass);
 
+            const std::vector<uint32_t>& cullGameObjects(FrameInfo &frameInfo, std::vector<GameObject>& gameObjects);
+            void selectLods(FrameInfo &frameInfo, std::vector<GameObject>& gameObjects, const std::vector<uint32_t>& visibleIndices);
+            void renderGameObjectsInstanced(FrameInfo &frameInfo, std::vector<GameObject>& gameObjects, const std::vector<uint32_t>& visibleIndices);
+            void renderDepthPrepass(FrameInfo &frameInfo, std::vector<GameObject>& gameObjects, const std::vector<uint32_t>& visibleIndices);
+            // Draws every object with its own push constants, crossFading objects through the CROSS_FADE pipelines dithered by their objectFades entry
+            void renderGameObjectsIndividually(FrameInfo &frameInfo, std::vector<GameObject>& gameObjects, const std::vector<uint32_t>& indices, bool crossFading);
+
+            // Splits the visible objects into meshIndices, fadingIndices and impostorIndices, see setImpostors()
+            void selectImpostors(FrameInfo &frameInfo, std::vector<GameObject>& gameObjects, const std::vector<uint32_t>& visibleIndices);
+            void renderImpostors(FrameInfo &frameInfo, std::vector<GameObject>& gameObjects);
+            void createImpostorPipeline(VkDescriptorSetLayout impostorSetLayout);
+
+            // Whether drawClusters() applies to an object drawn at this level of detail
+            bool canCullClusters(const JCATModel3D& model, uint32_t lod) const { return clusterCulling && lod == 0 && !model.getMeshlets().empty(); }
+            // Culls the model's meshlets in model space and draws the survivors, merging neighbouring index ranges
+            void drawClusters(FrameInfo &frameInfo, GameObject& obj, uint32_t firstInstance);
+            // Makes sure buffers[frameIndex] holds at least count elements of elementSize bytes
+            void reserveFrameBuffer(std::vector<std::unique_ptr<JCATBuffer>>& buffers, std::vector<uint32_t>& capacities, int frameIndex, uint32_t count, VkDeviceSize elementSize);
+
             DeviceSetup& device;
             ResourceManager& resourceManager;
 
             std::unique_ptr<GraphicsPipeline> pipeline;
             VkPipelineLayout pipelineLayout;
+            VkRenderPass renderPass;
+            VkDescriptorSetLayout globalSetLayout;
+
+            bool instancedRendering = false;
+            FrustumCuller culler;
+
+            bool lodSelection = true;
+            LodStats lodStats{};
+            std::vector<BoundingSphere> worldSpheres; ///< Filled while culling, indexed like gameObjects
+            std::vector<uint32_t> objectLods; ///< Indexed like gameObjects, only set for visible objects
+
+            bool depthPrepass = false;
+
+            const ImpostorAtlas* impostorAtlas = nullptr;
+            float impostorDistance = 0.0f;
+            float impostorFadeRange = 0.0f;
+            VkPipelineLayout impostorPipelineLayout = VK_NULL_HANDLE; ///< The global set plus the atlas as set 1
+            ImpostorStats impostorStats{};
+            std::vector<uint32_t> meshIndices; ///< Visible objects drawn only as meshes
+            std::vector<uint32_t> fadingIndices; ///< Visible objects drawn as both
+            std::vector<uint32_t> impostorIndices; ///< Visible objects drawn only as impostors
+            std::vector<float> objectFades; ///< Indexed like gameObjects, how much of a fading object's mesh is still drawn
+            std::vector<std::unique_ptr<JCATBuffer>> impostorBuffers;
+            std::vector<uint32_t> impostorCapacities;
+
+            bool clusterCulling = true;
+            ClusterStats clusterStats{};
+            FrustumCuller clusterCuller; ///< Reset for every object, its planes are moved into that object's model space
+
+            // One host visible instance buffer per frame in flight so we never write to one the GPU is still reading
+            std::vector<std::unique_ptr<JCATBuffer>> instanceBuffers;
+            std::vector<uint32_t> instanceCapacities;
+
+            // Reused every frame to avoid reallocating while grouping
+            std::unordered_map<BatchKey, uint32_t, BatchKeyHash> batchLookup;
+            std::vector<InstanceBatch> instanceBatches;
     };
 };
 
@@ -46,12 +46,12 @@ namespace JCAT {
             DeviceSetup& device;
             ResourceManager& resourceManager;
             VkBuffer vertexBuffer;
-            VkDeviceMemory vertexBufferMemory;
+            MemoryAllocation vertexBufferMemory;
             uint32_t vertexCount;
 
             bool hasIndexBuffer;
-            VkBuffer indexBuffer;
-            VkDeviceMemory indexBufferMemory;
+            VkBuffer indexBuffer = VK_NULL_HANDLE;
+            MemoryAllocation indexBufferMemory;
             uint32_t indexCount;
 
             bool useStagingBuffers = false;
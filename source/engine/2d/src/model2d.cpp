@@ -70,8 +70,11 @@ namespace JCAT {
     }
 
     JCATModel2D::~JCATModel2D() {
-        vkDestroyBuffer(device.device(), vertexBuffer, nullptr);
-        vkFreeMemory(device.device(), vertexBufferMemory, nullptr);
+        resourceManager.destroyBuffer(vertexBuffer, vertexBufferMemory);
+
+        if (indexBuffer != VK_NULL_HANDLE) {
+            resourceManager.destroyBuffer(indexBuffer, indexBufferMemory);
+        }
     }
 
     void JCATModel2D::createVertexBuffers(const std::vector<Vertex2D>& vertices) {
@@ -91,28 +94,9 @@ namespace JCAT {
                 vertexBufferMemory
             );
 
-            void* modelData;
-            vkMapMemory(device.device(), vertexBufferMemory, 0, bufferSize, 0, &modelData);
-            memcpy(modelData, vertices.data(), static_cast<size_t>(bufferSize));
-            vkUnmapMemory(device.device(), vertexBufferMemory);
+            memcpy(vertexBufferMemory.mapped, vertices.data(), static_cast<size_t>(bufferSize));
         }
         else {
-            VkBuffer stagingBuffer;
-            VkDeviceMemory stagingBufferMemory;
-
-            resourceManager.createBuffer(
-                bufferSize,
-                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                stagingBuffer,
-                stagingBufferMemory
-            );
-
-            void* modelData;
-            vkMapMemory(device.device(), stagingBufferMemory, 0, bufferSize, 0, &modelData);
-            memcpy(modelData, vertices.data(), static_cast<size_t>(bufferSize));
-            vkUnmapMemory(device.device(), stagingBufferMemory);
-
             resourceManager.createBuffer(
                 bufferSize,
                 VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
@@ -121,10 +105,7 @@ namespace JCAT {
                 vertexBufferMemory
             );
 
-            resourceManager.copyBuffer(stagingBuffer, vertexBuffer, bufferSize);
-        
-            vkDestroyBuffer(device.device(), stagingBuffer, nullptr);
-            vkFreeMemory(device.device(), stagingBufferMemory, nullptr);
+            resourceManager.uploadBuffer(vertexBuffer, 0, vertices.data(), bufferSize);
         }
     }
 
@@ -147,27 +128,9 @@ namespace JCAT {
                 indexBufferMemory
             );
 
-            void* modelData;
-            vkMapMemory(device.device(), indexBufferMemory, 0, bufferSize, 0, &modelData);
-            memcpy(modelData, indices.data(), static_cast<size_t>(bufferSize));
-            vkUnmapMemory(device.device(), indexBufferMemory);
+            memcpy(indexBufferMemory.mapped, indices.data(), static_cast<size_t>(bufferSize));
         }
         else {
-            VkBuffer stagingBuffer;
-            VkDeviceMemory stagingBufferMemory;
-            resourceManager.createBuffer(
-                bufferSize,
-                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                stagingBuffer,
-                stagingBufferMemory
-            );
-
-            void* modelData;
-            vkMapMemory(device.device(), stagingBufferMemory, 0, bufferSize, 0, &modelData);
-            memcpy(modelData, indices.data(), static_cast<size_t>(bufferSize));
-            vkUnmapMemory(device.device(), stagingBufferMemory);
-
             resourceManager.createBuffer(
                 bufferSize,
                 VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
@@ -176,10 +139,7 @@ namespace JCAT {
                 indexBufferMemory
             );
 
-            resourceManager.copyBuffer(stagingBuffer, indexBuffer, bufferSize);
-
-            vkDestroyBuffer(device.device(), stagingBuffer, nullptr);
-            vkFreeMemory(device.device(), stagingBufferMemory, nullptr);
+            resourceManager.uploadBuffer(indexBuffer, 0, indices.data(), bufferSize);
         }
     }
 
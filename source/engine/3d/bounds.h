@@ -0,0 +1,73 @@
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <limits>
+#include <cstddef>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm.hpp>
+
+namespace JCAT {
+    // Axis aligned bounding box. Defaults to an empty (inverted) box so the first expand() sets both corners.
+    struct AABB {
+        glm::vec3 min{ std::numeric_limits<float>::max() };
+        glm::vec3 max{ -std::numeric_limits<float>::max() };
+
+        void expand(const glm::vec3& point) {
+            min = glm::min(min, point);
+            max = glm::max(max, point);
+        }
+
+        bool isValid() const { return min.x <= max.x && min.y <= max.y && min.z <= max.z; }
+        glm::vec3 center() const { return (min + max) * 0.5f; }
+        glm::vec3 extents() const { return (max - min) * 0.5f; }
+    };
+
+    struct BoundingSphere {
+        glm::vec3 center{ 0.0f };
+        float radius = 0.0f;
+    };
+
+    /**
+     * @brief Computes the box and sphere enclosing every vertex position.
+     *
+     * The sphere is centered on the box with a radius reaching the furthest vertex,
+     * which is tighter than the box's half diagonal. Works with any vertex type that has a position member.
+     */
+    template <typename Vertex>
+    void computeBounds(const Vertex* vertices, size_t vertexCount, AABB& box, BoundingSphere& sphere) {
+        box = AABB{};
+        for (size_t i = 0; i < vertexCount; i++) {
+            box.expand(vertices[i].position);
+        }
+
+        const glm::vec3 center = box.center();
+        float radiusSquared = 0.0f;
+        for (size_t i = 0; i < vertexCount; i++) {
+            glm::vec3 offset = vertices[i].position - center;
+            radiusSquared = glm::max(radiusSquared, glm::dot(offset, offset));
+        }
+
+        sphere.center = center;
+        sphere.radius = glm::sqrt(radiusSquared);
+    }
+
+    /**
+     * @brief Transforms a local space AABB by an affine matrix and returns the world space box enclosing it.
+     *
+     * Uses Arvo's method: the new half extents are |M| * extents, so only the 3x3 part and the
+     * translation are touched instead of transforming all eight corners.
+     */
+    AABB transformAABB(const AABB& localBox, const glm::mat4& modelMatrix);
+
+    /**
+     * @brief Transforms a local space sphere by an affine matrix.
+     *
+     * The radius is scaled by the longest basis vector of the matrix, which stays conservative
+     * under non uniform scale.
+     */
+    BoundingSphere transformSphere(const BoundingSphere& localSphere, const glm::mat4& modelMatrix);
+};
+
+#endif
\ No newline at end of file
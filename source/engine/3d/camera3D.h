@@ -20,6 +20,9 @@ namespace JCAT {
 
             const glm::mat4& getProjection() const;
             const glm::mat4& getView() const;
+
+            // World space eye position, recovered from the view matrix
+            glm::vec3 getPosition() const;
         private:
             glm::mat4 projectionMatrix{ 1.0f };
             glm::mat4 viewMatrix{ 1.0f };
@@ -29,11 +29,18 @@ namespace JCAT {
 
             id_t getObjectId();
 
+            // World space bounds of model3D under this object's transform. Pass the model matrix if it has already been computed this frame.
+            AABB getWorldAABB();
+            AABB getWorldAABB(const glm::mat4& modelMatrix);
+            BoundingSphere getWorldBoundingSphere();
+            BoundingSphere getWorldBoundingSphere(const glm::mat4& modelMatrix);
+
             std::shared_ptr<JCATModel3D> model3D;
             glm::vec3 color{};
             TransformObject transform{};
             uint32_t hasLighting;
             uint32_t hasTexture;
+            bool isStatic = false; ///< Never moves once placed, so StaticBatcher may merge it into a batch
         private:
             GameObject(id_t objId);
 
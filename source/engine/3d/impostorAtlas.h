@@ -0,0 +1,119 @@
+#ifndef IMPOSTOR_ATLAS_H
+#define IMPOSTOR_ATLAS_H
+
+#include <memory>
+#include <vector>
+#include <unordered_map>
+
+#include "./engine/deviceSetup.h"
+#include "./engine/resourceManager.h"
+#include "./engine/descriptors.h"
+#include "./engine/3d/model3d.h"
+
+namespace JCAT {
+    /**
+     * @class ImpostorAtlas
+     * @brief Pictures of models taken from a fixed set of directions, drawn as a single quad in place of a distant model
+     *
+     * Every model gets a block of YAW_VIEWS x PITCH_VIEWS tiles. Each tile is an orthographic view of the model's bounding
+     * sphere, rendered once when the atlas is created through the same GraphicsPipeline machinery as the main pass.
+     * Two images are baked: the unlit vertex color with coverage in alpha, and the model space normal, so an impostor is
+     * lit like its model under any transform.
+     *
+     * Both atlases carry a short mip chain, impostors only cover a few pixels on screen. Every tile keeps an empty margin
+     * around the bounding sphere that is still one texel wide in the smallest level, so tiles never filter into each other.
+     *
+     * Textures are not baked, models drawn with a texture should not be replaced by their impostor.
+     */
+    class ImpostorAtlas {
+        public:
+            static constexpr uint32_t YAW_VIEWS = 8; ///< Views around the model's y axis
+            static constexpr uint32_t PITCH_VIEWS = 3; ///< Rows of views at PITCH_ANGLES above and below the model's horizon
+            static constexpr float PITCH_ANGLES[PITCH_VIEWS] = { -0.7853982f, 0.0f, 0.7853982f };
+            static constexpr uint32_t MAX_MIP_LEVELS = 4; ///< Levels of each atlas, fewer if the tile size cannot be halved that often
+
+            /**
+             * One impostor quad, read per instance at binding 0 by impostor.vert. The quad spans center +- right +- up,
+             * its corners are generated in the shader.
+             */
+            struct Instance {
+                glm::vec4 tile; ///< Atlas uv of the top left corner of the tile's area inside its margin in xy, its size in zw
+                glm::vec3 center;
+                float fade; ///< Share of the pixels the impostor covers while cross-fading with its model, 1 once it replaced the model
+                glm::vec3 right;
+                uint32_t hasLighting;
+                glm::vec3 up;
+                glm::mat3 normalMatrix; ///< The object's normal matrix, baked normals are in model space
+
+                static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
+                static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+            };
+
+            /**
+             * Bakes every model into a new atlas. Waits for pending uploads first, the models' buffers have to be filled.
+             * @param tileSize Width and height of one view in pixels, margin included
+             * @throws std::runtime_error if the models do not fit in the largest image the device supports, or tileSize leaves no room inside the margin
+             */
+            ImpostorAtlas(DeviceSetup& d, ResourceManager& r, const std::vector<std::shared_ptr<JCATModel3D>>& models, uint32_t tileSize = 128);
+            ~ImpostorAtlas();
+
+            ImpostorAtlas(const ImpostorAtlas&) = delete;
+            ImpostorAtlas& operator=(const ImpostorAtlas&) = delete;
+
+            bool contains(const JCATModel3D* model) const { return modelBlocks.count(model) > 0; }
+
+            /**
+             * Fills in everything but fade and hasLighting for drawing model under modelMatrix as seen from eye: the tile of
+             * the baked view closest to the eye's direction, and a camera facing quad as large as that view.
+             */
+            void fillInstance(const JCATModel3D& model, const glm::mat4& modelMatrix, const glm::mat3& normalMatrix, const glm::vec3& eye, Instance& instance) const;
+
+            // Set 1 of the impostor pipeline, the color atlas at binding 0 and the normal atlas at binding 1
+            VkDescriptorSetLayout getDescriptorSetLayout() const { return descriptorSetLayout->getDescriptorSetLayout(); }
+            VkDescriptorSet getDescriptorSet() const { return descriptorSet; }
+
+            uint32_t getWidth() const { return width; }
+            uint32_t getHeight() const { return height; }
+
+        private:
+            // The bake vertex shaders only read a transform and which image is being written
+            struct BakePushConstantData {
+                glm::mat4 bakeMatrix{ 1.0f };
+                uint32_t bakeNormals = 0;
+            };
+
+            void layOutTiles(const std::vector<std::shared_ptr<JCATModel3D>>& models);
+            void createAtlasImages();
+            void createDescriptors();
+            void bake(const std::vector<std::shared_ptr<JCATModel3D>>& models);
+            // Fills levels 1 and up of both atlases from level 0, which the bake left as a transfer source
+            void generateMipmaps(VkCommandBuffer commandBuffer);
+
+            // Unit vector from the model's center towards the eye of view (yaw, pitch), and the tile's right and up axes
+            static void getViewBasis(uint32_t yaw, uint32_t pitch, glm::vec3& direction, glm::vec3& right, glm::vec3& up);
+            // Maps model space (dequantized) positions inside the sphere onto the tile inside its margin, nearest to the eye at depth 0
+            glm::mat4 getBakeMatrix(const BoundingSphere& sphere, uint32_t yaw, uint32_t pitch) const;
+
+            DeviceSetup& device;
+            ResourceManager& resourceManager;
+
+            uint32_t tileSize;
+            uint32_t mipLevels = 1;
+            uint32_t tileMargin = 1; ///< Empty texels around the bounding sphere on every side of a tile, in level 0
+            uint32_t width = 0;
+            uint32_t height = 0;
+            std::unordered_map<const JCATModel3D*, glm::uvec2> modelBlocks; ///< Top left tile of each model's block, in tiles
+
+            // Index 0 is the color atlas, index 1 the normal atlas
+            VkImage images[2] = { VK_NULL_HANDLE, VK_NULL_HANDLE };
+            MemoryAllocation imageMemories[2];
+            VkImageView imageViews[2] = { VK_NULL_HANDLE, VK_NULL_HANDLE }; ///< Whole mip chain, the bake renders through views of level 0
+            VkSampler sampler = VK_NULL_HANDLE;
+
+            std::unique_ptr<JCATDescriptorSetLayout> descriptorSetLayout;
+            std::unique_ptr<JCATDescriptorPool> descriptorPool;
+            VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+    };
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,179 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "./engine/3d/model3d.h"
+#include "./engine/3d/bounds.h"
+#include "./engine/mappedFile.h"
+
+namespace JCAT {
+    /**
+     * On disk layout of a .jmesh file (native little endian, written next to the source .obj):
+     *
+     *   MeshCacheHeader
+     *   MeshCacheSection[sectionCount]
+     *   section payloads, each starting on a MeshCache::SECTION_ALIGNMENT boundary
+     *
+     * Sections are looked up by type, so new data can be appended without breaking older readers.
+     * Any change to the meaning of an existing section must bump MeshCache::VERSION instead.
+     *
+     * A .jmz file is the compressed form meant for shipping: the same header and section table under its own magic,
+     * with ENCODED_VERTICES/ENCODED_INDICES (see MeshCodec) instead of the raw arrays. Unlike a .jmesh it is not
+     * written by the engine, jcat-meshc --compress produces it.
+     */
+    struct MeshCacheHeader {
+        char magic[4];
+        uint32_t version;
+
+        // Invalidation key: cheap stamp first, content hash as a fallback when only the mtime changed
+        uint64_t sourceModifiedTime;
+        uint64_t sourceSize;
+        uint64_t sourceHash;
+
+        uint32_t vertexStride; ///< sizeof(Vertex3D) when written, guards against vertex layout changes.
+        uint32_t flags;        ///< MeshCacheFlags the mesh was built with.
+        uint32_t vertexCount;
+        uint32_t indexCount;
+
+        float boundsMin[3];
+        float boundsMax[3];
+        float sphereCenter[3];
+        float sphereRadius;
+
+        uint32_t sectionCount;
+        uint32_t reserved;
+    };
+
+    struct MeshCacheSection {
+        uint32_t type;        ///< MeshSectionType
+        uint32_t elementSize;
+        uint64_t offset;      ///< Byte offset from the start of the file.
+        uint64_t size;        ///< Size in bytes.
+    };
+
+    enum class MeshSectionType : uint32_t {
+        VERTICES = 1,
+        INDICES = 2,
+        LODS = 3, ///< JCATModel3D::LodRange per level, ranges into the INDICES section.
+        MESHLETS = 4, ///< JCATModel3D::Meshlet per cluster of the full detail level, ranges into the INDICES section.
+        ENCODED_VERTICES = 5, ///< .jmz only, MeshCodec vertex stream in place of VERTICES.
+        ENCODED_INDICES = 6 ///< .jmz only, MeshCodec index stream in place of INDICES.
+    };
+
+    enum MeshCacheFlags : uint32_t {
+        MESH_CACHE_INDEXED = 1 << 0,
+        MESH_CACHE_OPTIMIZED = 1 << 1, ///< Indices and vertices were reordered by MeshOptimizer.
+        MESH_CACHE_MESHLETS = 1 << 2, ///< The full detail level was ordered into meshlets by ModelBuilder::buildMeshlets.
+        MESH_CACHE_LOD_LEVELS_SHIFT = 8,
+        MESH_CACHE_LOD_LEVELS_MASK = 0xFu << MESH_CACHE_LOD_LEVELS_SHIFT ///< LOD level count asked of ModelBuilder::generateLods, 0 for none.
+    };
+
+    /**
+     * @class MeshCache
+     * @brief Reads and writes the binary .jmesh cache that lets models skip OBJ parsing on warm starts, and its compressed .jmz form.
+     */
+    class MeshCache {
+        public:
+            static constexpr uint32_t VERSION = 2;
+            static constexpr uint64_t SECTION_ALIGNMENT = 16;
+
+            /**
+             * A validated, memory mapped cache file. The pointers reference the mapping (or the decoded arrays of a .jmz)
+             * and stay valid for as long as this object is alive, moving it keeps them valid.
+             */
+            struct CachedMesh {
+                MappedFile file;
+
+                const JCATModel3D::Vertex3D* vertices = nullptr;
+                uint32_t vertexCount = 0;
+                const uint32_t* indices = nullptr;
+                uint32_t indexCount = 0;
+                const JCATModel3D::LodRange* lods = nullptr; ///< Null unless the mesh was cached with a LOD chain
+                uint32_t lodCount = 0;
+                const JCATModel3D::Meshlet* meshlets = nullptr; ///< Null unless the mesh was cached with meshlets
+                uint32_t meshletCount = 0;
+
+                AABB bounds{};
+                BoundingSphere boundingSphere{};
+
+                // Only filled by loadCompressed(), vertices and indices point into these instead of the mapping
+                std::vector<JCATModel3D::Vertex3D> decodedVertices;
+                std::vector<uint32_t> decodedIndices;
+            };
+
+            // models/cube.obj -> models/cube.jmesh
+            static std::string getCachePath(const std::string& sourcePath);
+
+            // models/cube.obj -> models/cube.jmz
+            static std::string getCompressedPath(const std::string& sourcePath);
+
+            // The MeshCacheFlags a mesh prepared with these options is cached under, optimizing and LODs only apply to indexed meshes.
+            // Optimized meshes are also split into meshlets, since that reorder is the last step of optimizing.
+            static uint32_t makeFlags(bool hasIndexBuffer, bool optimizeMesh, uint32_t lodLevels);
+
+            /**
+             * Maps the cache for the given source file if it exists and is still up to date
+             * @param sourcePath Path to the source .obj file
+             * @param flags MeshCacheFlags the mesh is wanted with, must match the ones the cache was written with
+             * @param mesh Receives the mapped mesh on success
+             * @return false on a cache miss (missing, stale, corrupt, or built with different options)
+             */
+            static bool load(const std::string& sourcePath, uint32_t flags, CachedMesh& mesh);
+
+            /**
+             * Writes the builder's vertices/indices to the cache for the given source file
+             * @param flags MeshCacheFlags describing how the builder's contents were produced
+             * @return false if the file could not be written, the cache is an optimization so callers may ignore this
+             */
+            static bool write(const std::string& sourcePath, uint32_t flags, const JCATModel3D::ModelBuilder& builder);
+
+            /**
+             * Maps and decodes the .jmz for the given source file, with the same rules as load()
+             * @return false if there is no usable .jmz (missing, stale, corrupt, or built with different options)
+             */
+            static bool loadCompressed(const std::string& sourcePath, uint32_t flags, CachedMesh& mesh);
+
+            /**
+             * Encodes the builder's vertices/indices into a .jmz for the given source file
+             * The bounds written are those of the decoded (quantized) positions, so they enclose what loadCompressed() returns
+             * @return false if the file could not be written
+             */
+            static bool writeCompressed(const std::string& sourcePath, uint32_t flags, const JCATModel3D::ModelBuilder& builder);
+
+        private:
+            struct SourceStamp {
+                uint64_t modifiedTime = 0;
+                uint64_t size = 0;
+            };
+
+            struct SectionData {
+                MeshSectionType type;
+                uint32_t elementSize;
+                const void* data;
+                uint64_t size;
+            };
+
+            static bool getSourceStamp(const std::string& sourcePath, SourceStamp& stamp);
+            static bool hashSourceFile(const std::string& sourcePath, uint64_t& hash);
+
+            // Patches the stamp in the header of the cache at path, in place
+            static bool writeSourceStamp(const std::string& path, const SourceStamp& stamp);
+
+            static const MeshCacheSection* findSection(const MappedFile& file, const MeshCacheHeader& header, MeshSectionType type);
+
+            // Maps path and checks its header against the magic, the wanted flags and the source file's stamp
+            static bool mapFile(const std::string& path, const char* magic, const std::string& sourcePath, uint32_t flags, MappedFile& file, MeshCacheHeader& header);
+
+            // Validates mesh's indices, then the LOD and meshlet sections against them, and copies the bounds out of the header
+            static bool loadRanges(const MappedFile& file, const MeshCacheHeader& header, uint32_t flags, CachedMesh& mesh);
+
+            static bool makeHeader(const std::string& sourcePath, const char* magic, uint32_t flags, const JCATModel3D::Vertex3D* vertices, size_t vertexCount, size_t indexCount, MeshCacheHeader& header);
+            static void addRangeSections(uint32_t flags, const JCATModel3D::ModelBuilder& builder, std::vector<SectionData>& sections);
+            static bool writeFile(const std::string& cachePath, MeshCacheHeader header, const std::vector<SectionData>& sections);
+    };
+};
+
+#endif
\ No newline at end of file
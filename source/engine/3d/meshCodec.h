@@ -0,0 +1,62 @@
+#ifndef MESH_CODEC_H
+#define MESH_CODEC_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "./engine/3d/model3d.h"
+
+namespace JCAT {
+    /**
+     * @class MeshCodec
+     * @brief Lossy vertex and lossless index compression for shipped meshes, built to decode faster than the disk reads
+     *
+     * Vertices become 10 16 bit channels: position, uv and color quantized within the mesh's own range of each
+     * component, and the normal as an octahedral snorm pair. Each channel is delta encoded against the previous vertex
+     * and zigzagged, so neighbouring vertices (which MeshOptimizer's fetch order produces) give small numbers. Every
+     * block of BLOCK_VERTICES vertices stores, per channel, a 2 bit width (zero, 4, 8 or 16 bits per delta) followed
+     * by the packed deltas. The decoder widens, prefix sums and converts 8 values at a time with SSE2.
+     *
+     * Indices are delta encoded against the previous index, zigzagged and written as LEB128 varints, one to five bytes each.
+     *
+     * Decoding writes straight into caller memory, which may be a mapped staging buffer.
+     */
+    class MeshCodec {
+        public:
+            static constexpr uint32_t BLOCK_VERTICES = 16;
+            static constexpr uint32_t CHANNEL_COUNT = 10;
+
+            // Worst case precision of a decoded position component, as a fraction of the mesh's extent on that axis
+            static constexpr float POSITION_PRECISION = 1.0f / 65535.0f;
+
+            static void encodeVertices(const JCATModel3D::Vertex3D* vertices, size_t vertexCount, std::vector<uint8_t>& encoded);
+            static void encodeIndices(const uint32_t* indices, size_t indexCount, std::vector<uint8_t>& encoded);
+
+            /**
+             * Decodes exactly vertexCount vertices
+             * @return false if the stream is truncated or was encoded with a different vertex count
+             */
+            static bool decodeVertices(const uint8_t* encoded, size_t encodedSize, JCATModel3D::Vertex3D* vertices, size_t vertexCount);
+
+            /**
+             * Decodes exactly indexCount indices
+             * @return false if the stream is truncated or malformed, decoded indices are not range checked
+             */
+            static bool decodeIndices(const uint8_t* encoded, size_t encodedSize, uint32_t* indices, size_t indexCount);
+
+        private:
+            // Start of an encoded vertex stream, the dequantization parameters of every channel
+            struct VertexStreamHeader {
+                uint32_t vertexCount;
+                uint32_t reserved;
+                float offset[CHANNEL_COUNT]; ///< Decoded value = offset + quantized * scale, normals are handled separately.
+                float scale[CHANNEL_COUNT];
+            };
+
+            static void decodeBlock(const uint8_t*& data, uint16_t (&lanes)[CHANNEL_COUNT][BLOCK_VERTICES], uint16_t (&previous)[CHANNEL_COUNT]);
+            static void dequantizeBlock(const VertexStreamHeader& header, const uint16_t (&lanes)[CHANNEL_COUNT][BLOCK_VERTICES], JCATModel3D::Vertex3D* vertices, size_t count);
+    };
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,73 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "./engine/3d/model3d.h"
+
+namespace JCAT {
+    /**
+     * Post transform vertex cache efficiency of an index buffer, simulated with a FIFO cache.
+     * ACMR (average cache miss ratio) is misses per triangle, 0.5 is the ideal for large regular meshes and 3 the worst.
+     * ATVR (average transformed vertex ratio) is misses per referenced vertex, 1 means every vertex is shaded once.
+     */
+    struct VertexCacheStats {
+        float acmr = 0.0f;
+        float atvr = 0.0f;
+    };
+
+    struct MeshOptimizationReport {
+        VertexCacheStats before{};
+        VertexCacheStats after{};
+        size_t clusterCount = 0;
+    };
+
+    /**
+     * @class MeshOptimizer
+     * @brief Reorders a mesh's triangles and vertices for faster rendering without changing what is drawn
+     *
+     * optimize() runs the three passes in order:
+     *  1. Vertex cache: Tipsify (Sander, Nehab, Barczak 2007) fans triangles around recently used vertices.
+     *  2. Overdraw: the result is cut into clusters wherever the cache would be cold anyway, and clusters
+     *     facing away from the mesh center (likely occluders) are moved to the front.
+     *  3. Vertex fetch: vertices are renumbered in first use order so fetches walk memory linearly.
+     */
+    class MeshOptimizer {
+        public:
+            static constexpr uint32_t DEFAULT_CACHE_SIZE = 16;
+            static constexpr uint32_t MIN_CLUSTER_SIZE_FACTOR = 8; ///< Overdraw clusters hold at least this many cache sizes worth of triangles.
+
+            /**
+             * Runs every pass on an indexed builder, does nothing if the builder has no indices.
+             * A builder with LODs has each level reordered separately and its vertices renumbered once for all of them.
+             * @param overdrawThreshold How much worse than the Tipsify ACMR a cluster may be, 1.05 allows 5%
+             * @return ACMR/ATVR before and after, of the full detail level when there are LODs
+             */
+            static MeshOptimizationReport optimize(JCATModel3D::ModelBuilder& builder, uint32_t cacheSize = DEFAULT_CACHE_SIZE, float overdrawThreshold = 1.05f);
+
+            // The vertex cache and overdraw passes on one triangle list, keeping the input order if they would make it worse
+            static MeshOptimizationReport optimizeTriangleOrder(std::vector<uint32_t>& indices, const std::vector<JCATModel3D::Vertex3D>& vertices, uint32_t cacheSize = DEFAULT_CACHE_SIZE, float overdrawThreshold = 1.05f);
+
+            static VertexCacheStats analyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+
+            /**
+             * Tipsify triangle reorder
+             * @param clusterStarts If not null, receives the first triangle of every point where the walk had to jump to a cold vertex
+             */
+            static void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize = DEFAULT_CACHE_SIZE, std::vector<uint32_t>* clusterStarts = nullptr);
+
+            /**
+             * Reorders clusters so outward facing ones draw first, splitting clusters further where their ACMR
+             * stays within threshold of the whole mesh's
+             * @return The number of clusters that were sorted
+             */
+            static size_t optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<JCATModel3D::Vertex3D>& vertices, const std::vector<uint32_t>& clusterStarts, uint32_t cacheSize, float threshold);
+
+            // Renumbers vertices in the order the index buffer first references them, dropping unreferenced ones
+            static void optimizeVertexFetch(std::vector<JCATModel3D::Vertex3D>& vertices, std::vector<uint32_t>& indices);
+    };
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,68 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "./engine/3d/model3d.h"
+
+namespace JCAT {
+    /**
+     * @class MeshSimplifier
+     * @brief Quadric error edge collapse (Garland, Heckbert 1997) for building LOD index buffers
+     *
+     * Every collapse moves one vertex onto a neighbour that already exists, so the simplified indices keep
+     * referencing the original vertex array and all levels of a LOD chain can share a single vertex buffer.
+     * Vertices on an open border only slide along it, and the two vertices on either side of a UV or normal seam
+     * slide along the seam together, so silhouettes, texture mapping and hard edges survive the reduction.
+     */
+    class MeshSimplifier {
+        public:
+            static constexpr float DEFAULT_MAX_ERROR = 0.02f; ///< As a fraction of the mesh's largest extent
+            static constexpr float BORDER_WEIGHT = 10.0f; ///< How strongly borders and seams resist being moved sideways
+
+            /**
+             * Collapses edges until at most targetIndexCount indices remain or every remaining collapse would exceed maxError
+             * @param maxError Largest allowed distance from the original surface, as a fraction of the mesh's largest extent
+             * @param resultError If not null, receives the largest error of any collapse that was made, on the same scale
+             * @return Triangle list indexing into vertices
+             */
+            static std::vector<uint32_t> simplify(const std::vector<JCATModel3D::Vertex3D>& vertices, const std::vector<uint32_t>& indices, size_t targetIndexCount, float maxError = DEFAULT_MAX_ERROR, float* resultError = nullptr);
+
+        private:
+            // Symmetric 4x4 matrix summing the squared distances to a set of (weighted) planes
+            struct Quadric {
+                double a2 = 0.0, b2 = 0.0, c2 = 0.0, ab = 0.0, ac = 0.0, bc = 0.0, ad = 0.0, bd = 0.0, cd = 0.0, d2 = 0.0;
+                double weight = 0.0;
+
+                void addPlane(const glm::vec3& normal, float distance, float planeWeight);
+                void add(const Quadric& other);
+
+                // Weighted mean squared distance of point to the planes
+                double error(const glm::vec3& point) const;
+            };
+
+            enum VertexKind : uint8_t {
+                VERTEX_MANIFOLD, ///< Interior vertex, may collapse onto any neighbour
+                VERTEX_BORDER, ///< On exactly one open border loop, may only collapse along it
+                VERTEX_SEAM, ///< One of exactly two vertices at a position, split by a single seam line, collapses along it with its twin
+                VERTEX_LOCKED ///< Seam crossing, border corner or non manifold vertex, never moves
+            };
+
+            struct Collapse {
+                uint32_t from;
+                uint32_t to;
+                float cost;
+            };
+
+            /**
+             * Recomputes every vertex's kind from the current triangles
+             * @param wedgeNext Circular list through the vertices sharing each position
+             * @param openNext/openPrevious Receive the neighbour along the open (border or seam) edge leaving/entering each vertex
+             */
+            static void classifyVertices(const std::vector<uint32_t>& indices, const std::vector<uint32_t>& positionIds, const std::vector<uint32_t>& wedgeNext, std::vector<VertexKind>& kinds, std::vector<uint32_t>& openNext, std::vector<uint32_t>& openPrevious);
+    };
+};
+
+#endif
\ No newline at end of file
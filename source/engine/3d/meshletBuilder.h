@@ -0,0 +1,50 @@
+#ifndef MESHLET_BUILDER_H
+#define MESHLET_BUILDER_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "./engine/3d/model3d.h"
+
+namespace JCAT {
+    /**
+     * @class MeshletBuilder
+     * @brief Greedily partitions a triangle list into meshlets for per cluster culling
+     *
+     * Each meshlet starts at the first unassigned triangle and grows through shared positions, preferring triangles
+     * that add the fewest new vertices and face the same way as the meshlet so far. Few vertices keep the bounding
+     * sphere tight for frustum culling, a common facing keeps the normal cone narrow enough for backface culling.
+     * Meshlets of curved, low poly meshes end up well below the limits, which costs little since the renderer
+     * merges the index ranges of neighbouring meshlets that survive culling into one draw.
+     *
+     * Backfacing meshlets are only invisible when the mesh is closed, since the solid pipeline draws both sides of a
+     * triangle. Meshlets of a mesh with open borders get a disabled cone and are only ever frustum culled.
+     */
+    class MeshletBuilder {
+        public:
+            static constexpr uint32_t MAX_VERTICES = 64;
+            static constexpr uint32_t MAX_TRIANGLES = 124; ///< 124 rather than 128 so a meshlet's local indices fit 372 bytes, a multiple of 4
+            static constexpr float CONE_WEIGHT = 0.5f; ///< How many extra vertices a triangle facing 90 degrees off the meshlet is worth
+            static constexpr float MIN_CONE_DOT = 0.5f; ///< Triangles facing over 60 degrees away from the meshlet start a new one, so cones stay narrow enough to cull
+
+            /**
+             * Reorders indices[firstIndex, firstIndex + indexCount) so every meshlet is a contiguous range of it,
+             * triangles keep their relative order within a meshlet so an earlier vertex cache optimization mostly survives
+             * @return The meshlets in index order, their ranges index into the whole indices vector
+             */
+            static std::vector<JCATModel3D::Meshlet> build(const std::vector<JCATModel3D::Vertex3D>& vertices, std::vector<uint32_t>& indices, uint32_t firstIndex, uint32_t indexCount);
+
+        private:
+            // Vertices with bitwise equal positions share an id
+            static std::vector<uint32_t> computePositionIds(const std::vector<JCATModel3D::Vertex3D>& vertices);
+
+            // True if every edge between two positions has a matching edge running the other way, i.e. the surface has no holes
+            static bool isClosed(const std::vector<uint32_t>& positionIds, const uint32_t* indices, size_t indexCount);
+
+            static void computeBounds(JCATModel3D::Meshlet& meshlet, const std::vector<JCATModel3D::Vertex3D>& vertices, const std::vector<uint32_t>& meshletVertices,
+                                      const std::vector<glm::vec3>& triangleNormals, const std::vector<uint32_t>& meshletTriangles, bool allowCone);
+    };
+};
+
+#endif
\ No newline at end of file
@@ -12,7 +12,9 @@
 #include "./engine/deviceSetup.h"
 #include "./engine/buffer.h"
 #include "./engine/resourceManager.h"
+#include "./engine/geometryPool.h"
 #include "./engine/utils.h"
+#include "./engine/3d/bounds.h"
 
 namespace JCAT {
     class JCATModel3D {
@@ -23,51 +25,232 @@ namespace JCAT {
                 glm::vec3 normal;
                 glm::vec2 uv;
 
-                static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
-                static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
+                // When instanced is true, an additional per-instance binding (INSTANCE_BINDING) sourcing InstanceData3D is appended
+                static std::vector<VkVertexInputBindingDescription> getBindingDescriptions(bool instanced = false);
+                static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions(bool instanced = false);
 
                 bool operator==(const Vertex3D& other) const;
             };
 
+            // Which vertex layout a model's vertex buffer was uploaded in, each needs its own pipeline
+            enum class VertexFormat {
+                STANDARD, ///< Vertex3D, 44 bytes of float32
+                COMPACT, ///< CompactVertex3D, 20 bytes quantized
+                SPLIT ///< Vertex3D split into a position stream (binding 0) and SplitVertex3D::Attributes (binding 1), see SplitVertex3D
+            };
+
+            // Binding the per-instance data is read from, after both streams of a SPLIT model so every format can use the same one
+            static constexpr uint32_t INSTANCE_BINDING = 2;
+
+            /**
+             * Quantized alternative to Vertex3D, less than half the size for the same attributes.
+             * Positions are unorm16 inside the model's AABB and are mapped back by getDequantizeMatrix(),
+             * which the renderer folds into the model matrix. Normals are octahedral encoded.
+             */
+            struct CompactVertex3D {
+                uint16_t position[4]; ///< xyz relative to the AABB, w is padding since 3 component 16 bit vertex formats are rarely supported
+                int16_t normal[2]; ///< Octahedral encoded unit normal
+                uint16_t uv[2];
+                uint8_t color[4]; ///< RGB plus an unused alpha of 255
+
+                static std::vector<VkVertexInputBindingDescription> getBindingDescriptions(bool instanced = false);
+                static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions(bool instanced = false);
+
+                // UVs and colors must lie in [0, 1] to survive unorm quantization, tiling UVs keep the standard format
+                static bool canEncode(const Vertex3D* vertices, size_t count);
+                static CompactVertex3D encode(const Vertex3D& vertex, const AABB& bounds);
+            };
+
+            /**
+             * The same attributes as Vertex3D, stored as two streams. Positions are tightly packed on their own, so depth-only
+             * passes (shadow maps, a depth prepass) fetch 12 bytes per vertex through binding 0 instead of all 44.
+             * The full pipelines read the rest from binding 1 at the same locations as Vertex3D, so they share its shaders.
+             */
+            struct SplitVertex3D {
+                struct Attributes {
+                    glm::vec3 color;
+                    glm::vec3 normal;
+                    glm::vec2 uv;
+                };
+
+                static std::vector<VkVertexInputBindingDescription> getBindingDescriptions(bool instanced = false);
+                static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions(bool instanced = false);
+
+                // Just the position stream, for depth-only pipelines
+                static std::vector<VkVertexInputBindingDescription> getPositionBindingDescriptions(bool instanced = false);
+                static std::vector<VkVertexInputAttributeDescription> getPositionAttributeDescriptions(bool instanced = false);
+            };
+
+            // Per-instance data read by the instanced pipeline, mirrors the push constant block of simpleShader3D
+            struct InstanceData3D {
+                glm::mat4 modelMatrix{1.0f};
+                glm::mat4 normalMatrix{1.0f};
+                uint32_t hasLighting = 0;
+                uint32_t hasTexture = 0;
+            };
+
+            // A range of the index buffer drawn with its own base vertex, so meshes over 65535 vertices can still use 16 bit indices
+            struct SubMesh {
+                uint32_t firstIndex;
+                uint32_t indexCount;
+                int32_t vertexOffset;
+            };
+
+            static constexpr uint32_t MAX_LODS = 4;
+
+            // One level of detail inside the shared index buffer, every level indexes the same vertices
+            struct LodRange {
+                uint32_t firstIndex;
+                uint32_t indexCount;
+            };
+
+            /**
+             * A small cluster of the full detail level's triangles (see MeshletBuilder), culled on its own so a mesh
+             * that is only partly on screen, or seen from one side, skips the triangles that cannot be visible
+             */
+            struct Meshlet {
+                glm::vec3 center; ///< Model space bounding sphere of the meshlet's vertices
+                float radius;
+                glm::vec3 coneAxis; ///< Average facing of the meshlet's triangles, zero if they face too many ways to ever cull
+                float coneCutoff; ///< Sine of the widest angle between coneAxis and a triangle normal, 1 when coneAxis is zero
+                uint32_t firstIndex;
+                uint32_t indexCount;
+
+                // True if no triangle of the meshlet can face a viewer at eye (in the same space as center)
+                bool isBackfacing(const glm::vec3& eye) const;
+            };
+
             struct ModelBuilder {
                 std::vector<Vertex3D> vertices{};
                 std::vector<uint32_t> indices{};
+                std::vector<LodRange> lods{}; ///< Empty unless generateLods() ran, lods[0] is then the full mesh
+                std::vector<Meshlet> meshlets{}; ///< Empty unless buildMeshlets() ran, covers the full detail level only
 
                 void loadModel(const std::string& filepath, bool hasIndexBuffer);
+
+                /**
+                 * Appends up to levelCount - 1 simplified copies of the mesh to indices (see MeshSimplifier), each aiming
+                 * for reductionPerLevel of the previous level's triangles. Stops early once a level barely shrinks.
+                 */
+                void generateLods(uint32_t levelCount = MAX_LODS, float reductionPerLevel = 0.5f);
+
+                /**
+                 * Partitions the full detail level into meshlets, reordering its triangles so each meshlet is one contiguous index range.
+                 * Run it after MeshOptimizer, which would otherwise scatter the meshlets again.
+                 */
+                void buildMeshlets();
             };
 
-            JCATModel3D(DeviceSetup& d, ResourceManager& r, const std::vector<Vertex3D> &objectVertices);
-            JCATModel3D(DeviceSetup& d, ResourceManager& r, const JCATModel3D::ModelBuilder &builder);
+            // preferredFormat COMPACT quantizes the vertices on upload, falling back to STANDARD if CompactVertex3D::canEncode() fails
+            JCATModel3D(DeviceSetup& d, ResourceManager& r, const std::vector<Vertex3D> &objectVertices, VertexFormat preferredFormat = VertexFormat::STANDARD);
+            JCATModel3D(DeviceSetup& d, ResourceManager& r, const JCATModel3D::ModelBuilder &builder, VertexFormat preferredFormat = VertexFormat::STANDARD);
+            // Builds from already prepared geometry (e.g. a mapped .jmesh cache), bounds are taken as given instead of recomputed
+            JCATModel3D(DeviceSetup& d, ResourceManager& r, const Vertex3D* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, const AABB& bounds, const BoundingSphere& boundingSphere,
+                        const LodRange* lods = nullptr, uint32_t lodCount = 0, const Meshlet* meshlets = nullptr, uint32_t meshletCount = 0, VertexFormat preferredFormat = VertexFormat::STANDARD);
             ~JCATModel3D();
 
             JCATModel3D(const JCATModel3D&) = delete;
             JCATModel3D& operator=(const JCATModel3D&) = delete;
 
-            static std::unique_ptr<JCATModel3D> createModelFromFile(DeviceSetup& device, ResourceManager& resourceManager, const std::string& filepath, bool hasIndexBuffers);
+            // Loads from the .jmesh cache next to the file when it is up to date, otherwise parses (and optionally optimizes) the file and refreshes the cache.
+            // Every call uploads a new copy, load through an AssetRegistry to share one model between its users.
+            static std::unique_ptr<JCATModel3D> createModelFromFile(DeviceSetup& device, ResourceManager& resourceManager, const std::string& filepath, bool hasIndexBuffers, bool optimizeMesh = true, VertexFormat preferredFormat = VertexFormat::STANDARD, uint32_t lodLevels = 1);
 
             void bind(VkCommandBuffer commandBuffer);
-            void draw(VkCommandBuffer commandBuffer);
+            // Only binds the buffers previous (the last model bound into commandBuffer, may be null) did not already bind
+            void bind(VkCommandBuffer commandBuffer, const JCATModel3D* previous);
+            // Binds the position stream and the index buffer for a depth-only pipeline, SPLIT models only
+            void bindPositions(VkCommandBuffer commandBuffer, const JCATModel3D* previous = nullptr);
+            // lod past the coarsest level draws the coarsest level
+            void draw(VkCommandBuffer commandBuffer, uint32_t instanceCount = 1, uint32_t firstInstance = 0, uint32_t lod = 0);
+
+            // Draws part of the full detail level, e.g. the meshlets that survived culling. Indexed models only.
+            void drawIndexRange(VkCommandBuffer commandBuffer, uint32_t firstIndex, uint32_t indexCount, uint32_t instanceCount = 1, uint32_t firstInstance = 0);
+
+            // 1 unless the model was built with a LOD chain
+            uint32_t getLodCount() const { return lodCount; }
+            // Indices (vertices for non indexed models) drawn by draw() at the given level
+            uint32_t getLodIndexCount(uint32_t lod) const;
+
+            // Local space bounds enclosing every vertex, computed once when the vertex buffer is created
+            const AABB& getLocalAABB() const { return localAABB; }
+            const BoundingSphere& getLocalBoundingSphere() const { return localBoundingSphere; }
+
+            // World space bounds for a given model matrix (usually TransformObject::modelMatrix())
+            AABB getWorldAABB(const glm::mat4& modelMatrix) const { return transformAABB(localAABB, modelMatrix); }
+            BoundingSphere getWorldBoundingSphere(const glm::mat4& modelMatrix) const { return transformSphere(localBoundingSphere, modelMatrix); }
+
+            // Selects the pipeline to draw with, COMPACT models must be drawn by the compact shaders
+            VertexFormat getVertexFormat() const { return vertexFormat; }
+            bool isCompact() const { return vertexFormat == VertexFormat::COMPACT; }
+            bool isSplit() const { return vertexFormat == VertexFormat::SPLIT; }
+
+            // UINT16 whenever every sub-mesh spans fewer than 65536 vertices, bind() uses it for the index buffer
+            VkIndexType getIndexType() const { return indexType; }
+            const std::vector<SubMesh>& getSubMeshes() const { return subMeshes; }
+
+            // The geometry pool's buffers unless the pool was full when the model was uploaded
+            VkBuffer getVertexBuffer() const;
+            VkBuffer getIndexBuffer() const;
+            bool isInGeometryPool() const { return vertexRange.size > 0; }
+
+            // Empty unless the model was built with meshlets, their index ranges are drawn with drawIndexRange()
+            const std::vector<Meshlet>& getMeshlets() const { return meshlets; }
+
+            // Maps unorm positions back into model space, multiply the model matrix by this when drawing a COMPACT model (identity otherwise)
+            const glm::mat4& getDequantizeMatrix() const { return dequantizeMatrix; }
 
         private:
-            void createVertexBuffers(const std::vector<Vertex3D>& vertices);
-            void createIndexBuffers(const std::vector<uint32_t>& indices);
+            void createVertexBuffers(const Vertex3D* vertices, uint32_t count, VertexFormat preferredFormat);
+            void uploadVertexData(const void* vertices, uint32_t vertexSize, uint32_t count);
+            void createIndexedBuffers(const Vertex3D* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, const LodRange* lods, uint32_t lodCount, VertexFormat preferredFormat);
+            void createIndexBuffers(const uint32_t* indices, uint32_t count, const LodRange* lods, uint32_t lodCount);
+            void uploadIndexData(const void* indices, uint32_t indexSize, uint32_t count);
+            void setMeshlets(const Meshlet* meshlets, uint32_t count);
+            void bindIndexBuffer(VkCommandBuffer commandBuffer, const JCATModel3D* previous);
+
+            // Where the position stream of a SPLIT model starts in getVertexBuffer(), its attribute stream follows it
+            VkDeviceSize getPositionStreamOffset() const { return vertexRange.size > 0 ? vertexRange.offset : 0; }
+
+            /**
+             * Cuts the triangle list into runs of at most 65535 unique vertices, each given its own contiguous copy of
+             * the vertices it uses so its indices fit in 16 bits. Vertices shared across a cut are duplicated.
+             * @return false if that would grow the vertex count by more than 1/8, in which case 32 bit indices are cheaper
+             */
+            static bool splitSubMeshes(const Vertex3D* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount,
+                                       std::vector<Vertex3D>& splitVertices, std::vector<uint16_t>& splitIndices, std::vector<SubMesh>& subMeshes);
 
             DeviceSetup& device;
             ResourceManager& resourceManager;
 
-            VkBuffer vertexBufferOld;
-            VkDeviceMemory vertexBufferOldMemory;
+            VkBuffer vertexBufferOld = VK_NULL_HANDLE;
+            MemoryAllocation vertexBufferOldMemory;
             std::unique_ptr<JCATBuffer> vertexBuffer;
             uint32_t vertexCount;
+            GeometryRange vertexRange{}; ///< Where the vertices live in the geometry pool, size 0 if they got vertexBuffer instead
+            int32_t baseVertex = 0; ///< vertexRange.offset in vertices, added to every draw's vertex offset. 0 for SPLIT models, whose streams are bound at their offsets instead
 
             bool hasIndexBuffer;
 
-            VkBuffer indexBufferOld;
-            VkDeviceMemory indexBufferOldMemory;
+            VkBuffer indexBufferOld = VK_NULL_HANDLE;
+            MemoryAllocation indexBufferOldMemory;
             std::unique_ptr<JCATBuffer> indexBuffer;
             uint32_t indexCount;
+            GeometryRange indexRange{};
+            uint32_t baseIndex = 0; ///< indexRange.offset in indices, added to every draw's first index
+            VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+            std::vector<SubMesh> subMeshes;
+            std::vector<uint32_t> lodSubMeshes; ///< subMeshes[lodSubMeshes[lod], lodSubMeshes[lod + 1]) draw each level
+            uint32_t lodCount = 1;
+            std::vector<Meshlet> meshlets;
 
             bool useStagingBuffers = true;
+
+            AABB localAABB{};
+            BoundingSphere localBoundingSphere{};
+
+            VertexFormat vertexFormat = VertexFormat::STANDARD;
+            glm::mat4 dequantizeMatrix{1.0f};
     };
 };
 
@@ -0,0 +1,113 @@
+#ifndef MODEL_LOADER_H
+#define MODEL_LOADER_H
+
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "./engine/deviceSetup.h"
+#include "./engine/resourceManager.h"
+#include "./engine/threadPool.h"
+#include "./engine/3d/model3d.h"
+#include "./engine/3d/meshCache.h"
+
+namespace JCAT {
+    class AssetRegistry;
+
+    /**
+     * CPU side result of loading a model file: either a mapped .jmesh cache (or decoded .jmz) or a freshly parsed builder.
+     * Producing one touches no Vulkan state, so it is safe on any thread.
+     */
+    struct PreparedModel {
+        bool fromCache = false;
+        MeshCache::CachedMesh cached{};
+        JCATModel3D::ModelBuilder builder{};
+    };
+
+    /**
+     * @class ModelLoader
+     * @brief Loads model files in parallel and uploads them to the GPU from a single thread
+     *
+     * requestModel() queues the parse (or cache lookup) on a worker thread and returns right away.
+     * The finished meshes are uploaded on the thread calling uploadAll()/getModel(), since buffer
+     * copies go through the ResourceManager's single graphics queue and command pool.
+     *
+     * Usage: request every model up front, then uploadAll() and getModel() for each handle.
+     * Given an AssetRegistry, models it already holds are not loaded again and new uploads are registered in it.
+     */
+    class ModelLoader {
+        public:
+            using ModelHandle = uint32_t;
+
+            /**
+             * Constructs a ModelLoader object
+             * @param device Reference to the device used to create the model buffers
+             * @param resourceManager Reference to the resource manager used to upload the model buffers
+             * @param threadCount Number of worker threads, 0 picks one per hardware thread
+             */
+            ModelLoader(DeviceSetup& device, ResourceManager& resourceManager, size_t threadCount = 0);
+            ModelLoader(DeviceSetup& device, ResourceManager& resourceManager, AssetRegistry& registry, size_t threadCount = 0);
+
+            ModelLoader(const ModelLoader&) = delete;
+            ModelLoader& operator=(const ModelLoader&) = delete;
+
+            /**
+             * Starts loading a model on a worker thread, requesting the same file twice returns the same handle
+             * @param filepath Path to the .obj file
+             * @param hasIndexBuffer Whether to deduplicate vertices into an index buffer
+             * @param optimizeMesh Whether to run MeshOptimizer on indexed meshes (the result is cached, so this is paid once)
+             * @param vertexFormat Vertex layout to upload in, COMPACT falls back to STANDARD for models it cannot represent
+             * @param lodLevels Up to how many levels of detail to generate for indexed meshes (also cached), 1 for none
+             * @return Handle used to retrieve the model once it is loaded
+             */
+            ModelHandle requestModel(const std::string& filepath, bool hasIndexBuffer, bool optimizeMesh = true, JCATModel3D::VertexFormat vertexFormat = JCATModel3D::VertexFormat::STANDARD, uint32_t lodLevels = 1);
+
+            /**
+             * Uploads every requested model, in the order they finish loading so uploads overlap with parsing
+             * All of them are recorded into one upload batch, the open one if the ResourceManager has one
+             * @throws std::runtime_error if any model failed to load
+             */
+            void uploadAll();
+
+            /**
+             * Returns the model for a handle, waiting for it to load and uploading it if needed
+             * @throws std::runtime_error if the model failed to load
+             */
+            std::shared_ptr<JCATModel3D> getModel(ModelHandle handle);
+
+            size_t getModelCount() const { return requests.size(); }
+            size_t getThreadCount() const { return threadPool.getThreadCount(); }
+
+            // The two halves of JCATModel3D::createModelFromFile, usable separately so the CPU work can run elsewhere
+            static PreparedModel prepareModel(const std::string& filepath, bool hasIndexBuffer, bool optimizeMesh = true, uint32_t lodLevels = 1);
+            static std::unique_ptr<JCATModel3D> uploadModel(DeviceSetup& device, ResourceManager& resourceManager, PreparedModel& prepared, JCATModel3D::VertexFormat vertexFormat = JCATModel3D::VertexFormat::STANDARD);
+
+        private:
+            struct ModelRequest {
+                std::string filepath;
+                std::string key;
+                JCATModel3D::VertexFormat vertexFormat = JCATModel3D::VertexFormat::STANDARD;
+                std::future<PreparedModel> pending;
+                std::shared_ptr<JCATModel3D> model;
+            };
+
+            void upload(ModelRequest& request);
+
+            // Uploads requests as they finish parsing until none are left
+            void uploadReady();
+
+            DeviceSetup& device;
+            ResourceManager& resourceManager;
+            AssetRegistry* registry = nullptr;
+
+            std::vector<ModelRequest> requests;
+            std::unordered_map<std::string, ModelHandle> requestLookup;
+
+            // Declared last so it is destroyed first, its destructor waits for any task still writing into a request
+            ThreadPool threadPool;
+    };
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,40 @@
+#ifndef OBJ_PARSER_H
+#define OBJ_PARSER_H
+
+#include <string>
+#include <cstddef>
+
+#include "./engine/3d/model3d.h"
+
+namespace JCAT {
+    /**
+     * @class ObjParser
+     * @brief Streaming Wavefront OBJ reader that writes straight into a ModelBuilder
+     *
+     * The file is memory mapped and read line by line: v (with optional vertex colors), vn, vt
+     * and f (any polygon, fan triangulated) are understood, everything else is skipped.
+     * Face corners are deduplicated on their index triplet as they are read, so no intermediate
+     * copy of the mesh is built. Files above Options::parallelThreshold are split into line
+     * aligned chunks that are tokenized on separate threads and then merged in order.
+     */
+    class ObjParser {
+        public:
+            struct Options {
+                bool allowParallel = true;
+                size_t parallelThreshold = 16 * 1024 * 1024; ///< Files smaller than this are always parsed on the calling thread.
+                size_t maxThreads = 0;                        ///< 0 picks one per hardware thread.
+            };
+
+            /**
+             * Parses an OBJ file into the builder's vertex (and index) vectors, replacing their contents
+             * @param filepath Path to the .obj file
+             * @param hasIndexBuffer Deduplicate vertices and fill builder.indices, otherwise emit one vertex per corner
+             * @param builder Receives the vertices and indices
+             * @throws std::runtime_error if the file cannot be opened or references an element that does not exist
+             */
+            static void parse(const std::string& filepath, bool hasIndexBuffer, JCATModel3D::ModelBuilder& builder, const Options& options);
+            static void parse(const std::string& filepath, bool hasIndexBuffer, JCATModel3D::ModelBuilder& builder) { parse(filepath, hasIndexBuffer, builder, Options{}); }
+    };
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,47 @@
+#include "./engine/3d/bounds.h"
+
+namespace JCAT {
+    AABB transformAABB(const AABB& localBox, const glm::mat4& modelMatrix) {
+        const glm::vec3 localCenter = localBox.center();
+        const glm::vec3 localExtents = localBox.extents();
+
+        glm::vec3 worldCenter{ modelMatrix[3][0], modelMatrix[3][1], modelMatrix[3][2] };
+        glm::vec3 worldExtents{ 0.0f };
+
+        // glm is column major: modelMatrix[column][row]
+        for (int row = 0; row < 3; row++) {
+            for (int column = 0; column < 3; column++) {
+                worldCenter[row] += modelMatrix[column][row] * localCenter[column];
+                worldExtents[row] += glm::abs(modelMatrix[column][row]) * localExtents[column];
+            }
+        }
+
+        AABB worldBox{};
+        worldBox.min = worldCenter - worldExtents;
+        worldBox.max = worldCenter + worldExtents;
+
+        return worldBox;
+    }
+
+    BoundingSphere transformSphere(const BoundingSphere& localSphere, const glm::mat4& modelMatrix) {
+        const glm::vec3& c = localSphere.center;
+
+        BoundingSphere worldSphere{};
+        worldSphere.center = glm::vec3{
+            modelMatrix[0][0] * c.x + modelMatrix[1][0] * c.y + modelMatrix[2][0] * c.z + modelMatrix[3][0],
+            modelMatrix[0][1] * c.x + modelMatrix[1][1] * c.y + modelMatrix[2][1] * c.z + modelMatrix[3][1],
+            modelMatrix[0][2] * c.x + modelMatrix[1][2] * c.y + modelMatrix[2][2] * c.z + modelMatrix[3][2]
+        };
+
+        // Compare squared column lengths so only one square root is needed
+        float maxScaleSquared = 0.0f;
+        for (int column = 0; column < 3; column++) {
+            glm::vec3 axis{ modelMatrix[column][0], modelMatrix[column][1], modelMatrix[column][2] };
+            maxScaleSquared = glm::max(maxScaleSquared, glm::dot(axis, axis));
+        }
+
+        worldSphere.radius = localSphere.radius * glm::sqrt(maxScaleSquared);
+
+        return worldSphere;
+    }
+};
\ No newline at end of file
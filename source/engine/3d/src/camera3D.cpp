@@ -93,4 +93,12 @@ namespace JCAT {
     const glm::mat4& Camera3D::getView() const {
         return viewMatrix;
     }
+
+    glm::vec3 Camera3D::getPosition() const {
+        // The rotation rows u, v, w are orthonormal and the translation is -(u, v, w) . position, so transpose it back
+        const glm::vec3 translation{ viewMatrix[3] };
+        return -(glm::vec3{ viewMatrix[0][0], viewMatrix[1][0], viewMatrix[2][0] } * translation.x +
+                 glm::vec3{ viewMatrix[0][1], viewMatrix[1][1], viewMatrix[2][1] } * translation.y +
+                 glm::vec3{ viewMatrix[0][2], viewMatrix[1][2], viewMatrix[2][2] } * translation.z);
+    }
 };
\ No newline at end of file
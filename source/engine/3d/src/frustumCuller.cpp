@@ -0,0 +1,221 @@
+#include "./engine/3d/frustumCuller.h"
+
+// The AVX path is compiled for that one function only and picked at runtime, the rest of the engine keeps the x64 baseline
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #include <immintrin.h>
+    #define JCAT_CULL_AVX
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+        #define JCAT_AVX_TARGET
+    #else
+        #define JCAT_AVX_TARGET __attribute__((target("avx")))
+    #endif
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define JCAT_CULL_SSE
+#endif
+
+namespace JCAT {
+    // Appends base + bit for every set bit of an 8 bit visibility mask without branching on the mask
+    static inline uint32_t appendVisible(uint32_t* output, uint32_t visibleCount, uint32_t base, int mask) {
+        for (uint32_t bit = 0; bit < FrustumCuller::BATCH_SIZE; bit++) {
+            output[visibleCount] = base + bit;
+            visibleCount += (mask >> bit) & 1;
+        }
+
+        return visibleCount;
+    }
+
+#if defined(JCAT_CULL_AVX)
+    // The CPU has to report AVX and the OS has to save the upper halves of the YMM registers
+    static bool cpuSupportsAvx() {
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid(info, 1);
+        const bool osSavesYmm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+        return osSavesYmm && (info[2] & (1 << 28)) != 0;
+#else
+        return __builtin_cpu_supports("avx");
+#endif
+    }
+
+    // Tests 8 spheres per iteration from index i on, leaving i at the first sphere of the incomplete last batch
+    JCAT_AVX_TARGET static uint32_t cullBatchesAvx(const std::array<glm::vec4, 6>& planes, const float* centersX, const float* centersY, const float* centersZ,
+                                                   const float* radii, size_t& i, size_t count, uint32_t* output, uint32_t visibleCount) {
+        __m256 planeX[6], planeY[6], planeZ[6], planeW[6];
+        for (int p = 0; p < 6; p++) {
+            planeX[p] = _mm256_set1_ps(planes[p].x);
+            planeY[p] = _mm256_set1_ps(planes[p].y);
+            planeZ[p] = _mm256_set1_ps(planes[p].z);
+            planeW[p] = _mm256_set1_ps(planes[p].w);
+        }
+
+        const __m256 zero = _mm256_setzero_ps();
+
+        for (; i + FrustumCuller::BATCH_SIZE <= count; i += FrustumCuller::BATCH_SIZE) {
+            __m256 x = _mm256_loadu_ps(&centersX[i]);
+            __m256 y = _mm256_loadu_ps(&centersY[i]);
+            __m256 z = _mm256_loadu_ps(&centersZ[i]);
+            __m256 negativeRadius = _mm256_sub_ps(zero, _mm256_loadu_ps(&radii[i]));
+
+            // A sphere is outside as soon as its center is further than its radius behind any plane
+            __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for (int p = 0; p < 6; p++) {
+                __m256 distance = _mm256_add_ps(
+                    _mm256_add_ps(_mm256_mul_ps(planeX[p], x), _mm256_mul_ps(planeY[p], y)),
+                    _mm256_add_ps(_mm256_mul_ps(planeZ[p], z), planeW[p])
+                );
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+            }
+
+            visibleCount = appendVisible(output, visibleCount, static_cast<uint32_t>(i), _mm256_movemask_ps(inside));
+        }
+
+        return visibleCount;
+    }
+#endif
+
+#if defined(JCAT_CULL_SSE)
+    // Same 8 wide batches as the AVX path, processed as two 4 wide halves
+    static uint32_t cullBatchesSse(const std::array<glm::vec4, 6>& planes, const float* centersX, const float* centersY, const float* centersZ,
+                                   const float* radii, size_t& i, size_t count, uint32_t* output, uint32_t visibleCount) {
+        __m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+        for (int p = 0; p < 6; p++) {
+            planeX[p] = _mm_set1_ps(planes[p].x);
+            planeY[p] = _mm_set1_ps(planes[p].y);
+            planeZ[p] = _mm_set1_ps(planes[p].z);
+            planeW[p] = _mm_set1_ps(planes[p].w);
+        }
+
+        const __m128 zero = _mm_setzero_ps();
+
+        for (; i + FrustumCuller::BATCH_SIZE <= count; i += FrustumCuller::BATCH_SIZE) {
+            int mask = 0;
+
+            for (size_t half = 0; half < 2; half++) {
+                const size_t offset = i + half * 4;
+
+                __m128 x = _mm_loadu_ps(&centersX[offset]);
+                __m128 y = _mm_loadu_ps(&centersY[offset]);
+                __m128 z = _mm_loadu_ps(&centersZ[offset]);
+                __m128 negativeRadius = _mm_sub_ps(zero, _mm_loadu_ps(&radii[offset]));
+
+                __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+                for (int p = 0; p < 6; p++) {
+                    __m128 distance = _mm_add_ps(
+                        _mm_add_ps(_mm_mul_ps(planeX[p], x), _mm_mul_ps(planeY[p], y)),
+                        _mm_add_ps(_mm_mul_ps(planeZ[p], z), planeW[p])
+                    );
+                    inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+                }
+
+                mask |= _mm_movemask_ps(inside) << (half * 4);
+            }
+
+            visibleCount = appendVisible(output, visibleCount, static_cast<uint32_t>(i), mask);
+        }
+
+        return visibleCount;
+    }
+#endif
+
+    void FrustumCuller::setFrustum(const glm::mat4& projectionView) {
+        // Gribb & Hartmann: each plane is a sum/difference of rows of the clip matrix.
+        // glm is column major, so row i is (m[0][i], m[1][i], m[2][i], m[3][i]).
+        glm::vec4 row0{ projectionView[0][0], projectionView[1][0], projectionView[2][0], projectionView[3][0] };
+        glm::vec4 row1{ projectionView[0][1], projectionView[1][1], projectionView[2][1], projectionView[3][1] };
+        glm::vec4 row2{ projectionView[0][2], projectionView[1][2], projectionView[2][2], projectionView[3][2] };
+        glm::vec4 row3{ projectionView[0][3], projectionView[1][3], projectionView[2][3], projectionView[3][3] };
+
+        planes[0] = row3 + row0; // Left
+        planes[1] = row3 - row0; // Right
+        planes[2] = row3 + row1; // Top (Vulkan clip space has Y pointing down)
+        planes[3] = row3 - row1; // Bottom
+        planes[4] = row2;        // Near (depth range is 0..1, so z >= 0 rather than z >= -w)
+        planes[5] = row3 - row2; // Far
+
+        // Normalize so that the plane equation returns a true signed distance to compare against the radius
+        for (glm::vec4& plane : planes) {
+            float length = glm::length(glm::vec3{ plane.x, plane.y, plane.z });
+            plane = plane / length;
+        }
+    }
+
+    void FrustumCuller::beginFrame(size_t expectedCount) {
+        centersX.clear();
+        centersY.clear();
+        centersZ.clear();
+        radii.clear();
+
+        centersX.reserve(expectedCount);
+        centersY.reserve(expectedCount);
+        centersZ.reserve(expectedCount);
+        radii.reserve(expectedCount);
+    }
+
+    void FrustumCuller::addSphere(const glm::vec3& center, float radius) {
+        centersX.push_back(center.x);
+        centersY.push_back(center.y);
+        centersZ.push_back(center.z);
+        radii.push_back(radius);
+    }
+
+    const std::vector<uint32_t>& FrustumCuller::cull() {
+        const size_t count = radii.size();
+
+        // Leave room for a full batch so appendVisible can always write 8 entries past the current count
+        visibleIndices.resize(count + BATCH_SIZE);
+
+        if (!cullingEnabled) {
+            for (size_t i = 0; i < count; i++) {
+                visibleIndices[i] = static_cast<uint32_t>(i);
+            }
+
+            visibleIndices.resize(count);
+            stats.visible = static_cast<uint32_t>(count);
+            stats.culled = 0;
+            return visibleIndices;
+        }
+
+        uint32_t visibleCount = 0;
+        size_t i = 0;
+
+#if defined(JCAT_CULL_AVX)
+        static const bool avxSupported = cpuSupportsAvx();
+        if (avxSupported) {
+            visibleCount = cullBatchesAvx(planes, centersX.data(), centersY.data(), centersZ.data(), radii.data(), i, count, visibleIndices.data(), visibleCount);
+        }
+#endif
+#if defined(JCAT_CULL_SSE)
+        // Does nothing when the AVX path already took every full batch
+        visibleCount = cullBatchesSse(planes, centersX.data(), centersY.data(), centersZ.data(), radii.data(), i, count, visibleIndices.data(), visibleCount);
+#endif
+
+        // Remainder (or everything when no SIMD path is available)
+        visibleCount = cullScalar(i, count, visibleCount);
+
+        visibleIndices.resize(visibleCount);
+        stats.visible = visibleCount;
+        stats.culled = static_cast<uint32_t>(count) - visibleCount;
+
+        return visibleIndices;
+    }
+
+    uint32_t FrustumCuller::cullScalar(size_t begin, size_t end, uint32_t visibleCount) {
+        for (size_t i = begin; i < end; i++) {
+            bool inside = true;
+
+            for (const glm::vec4& plane : planes) {
+                float distance = plane.x * centersX[i] + plane.y * centersY[i] + plane.z * centersZ[i] + plane.w;
+                inside = inside && (distance >= -radii[i]);
+            }
+
+            visibleIndices[visibleCount] = static_cast<uint32_t>(i);
+            visibleCount += inside ? 1 : 0;
+        }
+
+        return visibleCount;
+    }
+};
\ No newline at end of file
@@ -1,3 +1,5 @@
+#include <cassert>
+
 #include "./engine/3D/gameObject.h"
 
 namespace JCAT {
@@ -78,4 +80,22 @@ namespace JCAT {
     id_t GameObject::getObjectId() {
         return id;
     }
+
+    AABB GameObject::getWorldAABB() {
+        return getWorldAABB(transform.modelMatrix());
+    }
+
+    AABB GameObject::getWorldAABB(const glm::mat4& modelMatrix) {
+        assert(model3D != nullptr && "Cannot get bounds of a game object without a model");
+        return model3D->getWorldAABB(modelMatrix);
+    }
+
+    BoundingSphere GameObject::getWorldBoundingSphere() {
+        return getWorldBoundingSphere(transform.modelMatrix());
+    }
+
+    BoundingSphere GameObject::getWorldBoundingSphere(const glm::mat4& modelMatrix) {
+        assert(model3D != nullptr && "Cannot get bounds of a game object without a model");
+        return model3D->getWorldBoundingSphere(modelMatrix);
+    }
 };
\ No newline at end of file
@@ -0,0 +1,587 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <stdexcept>
+#include <unordered_set>
+
+#include "./engine/3d/impostorAtlas.h"
+#include "./engine/graphicsPipeline.h"
+
+#include <gtc/constants.hpp>
+
+namespace JCAT {
+    static constexpr VkFormat ATLAS_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+
+    // Each vertex format needs its own bake pipeline, like the main pass
+    static GraphicsPipeline::PipelineType getBakePipelineType(JCATModel3D::VertexFormat format) {
+        switch (format) {
+            case JCATModel3D::VertexFormat::COMPACT:
+                return GraphicsPipeline::PipelineType::IMPOSTOR_BAKE_COMPACT_PIPELINE;
+            case JCATModel3D::VertexFormat::SPLIT:
+                return GraphicsPipeline::PipelineType::IMPOSTOR_BAKE_SPLIT_PIPELINE;
+            default:
+                return GraphicsPipeline::PipelineType::IMPOSTOR_BAKE_PIPELINE;
+        }
+    }
+
+    std::vector<VkVertexInputBindingDescription> ImpostorAtlas::Instance::getBindingDescriptions() {
+        std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+
+        bindingDescriptions[0].binding = 0;
+        bindingDescriptions[0].stride = sizeof(Instance);
+        bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+        return bindingDescriptions;
+    }
+
+    std::vector<VkVertexInputAttributeDescription> ImpostorAtlas::Instance::getAttributeDescriptions() {
+        std::vector<VkVertexInputAttributeDescription> attributeDescriptions{
+            { 0, 0, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(Instance, tile) },
+            { 1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Instance, center) },
+            { 2, 0, VK_FORMAT_R32_SFLOAT, offsetof(Instance, fade) },
+            { 3, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Instance, right) },
+            { 4, 0, VK_FORMAT_R32_UINT, offsetof(Instance, hasLighting) },
+            { 5, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Instance, up) }
+        };
+
+        // A mat3 attribute occupies three consecutive locations, one vec3 column each
+        for (uint32_t column = 0; column < 3; column++) {
+            attributeDescriptions.push_back({ 6 + column, 0, VK_FORMAT_R32G32B32_SFLOAT, static_cast<uint32_t>(offsetof(Instance, normalMatrix) + column * sizeof(glm::vec3)) });
+        }
+
+        return attributeDescriptions;
+    }
+
+    ImpostorAtlas::ImpostorAtlas(DeviceSetup& d, ResourceManager& r, const std::vector<std::shared_ptr<JCATModel3D>>& models, uint32_t tileSize) : device{d}, resourceManager{r}, tileSize{tileSize} {
+        layOutTiles(models);
+        createAtlasImages();
+        createDescriptors();
+        bake(models);
+    }
+
+    ImpostorAtlas::~ImpostorAtlas() {
+        vkDestroySampler(device.device(), sampler, nullptr);
+
+        for (int i = 0; i < 2; i++) {
+            vkDestroyImageView(device.device(), imageViews[i], nullptr);
+            resourceManager.destroyImage(images[i], imageMemories[i]);
+        }
+    }
+
+    void ImpostorAtlas::layOutTiles(const std::vector<std::shared_ptr<JCATModel3D>>& models) {
+        const uint32_t blockWidth = YAW_VIEWS * tileSize;
+        const uint32_t blockHeight = PITCH_VIEWS * tileSize;
+        const uint32_t maxDimension = device.properties.limits.maxImageDimension2D;
+
+        std::vector<const JCATModel3D*> uniqueModels;
+        for (const std::shared_ptr<JCATModel3D>& model : models) {
+            if (model != nullptr && std::find(uniqueModels.begin(), uniqueModels.end(), model.get()) == uniqueModels.end()) {
+                uniqueModels.push_back(model.get());
+            }
+        }
+
+        if (uniqueModels.empty() || blockWidth > maxDimension) {
+            throw std::runtime_error("Cannot lay out an impostor atlas without models or with tiles this large!");
+        }
+
+        // Each level has to hold whole tiles, and the margin has to cover one texel of the last one. Levels that would
+        // take more than a quarter of the tile for the margin are not worth it
+        mipLevels = 1;
+        while (mipLevels < MAX_MIP_LEVELS && ((tileSize >> mipLevels) << mipLevels) == tileSize && tileSize > 8 * (1u << mipLevels)) {
+            mipLevels++;
+        }
+        tileMargin = 1u << (mipLevels - 1);
+
+        if (tileSize <= 2 * tileMargin) {
+            throw std::runtime_error("Impostor tiles have to be larger than their margin!");
+        }
+
+        // Blocks are wider than tall, so put enough of them side by side to keep the atlas roughly square
+        const float count = static_cast<float>(uniqueModels.size());
+        uint32_t blocksPerRow = static_cast<uint32_t>(std::ceil(std::sqrt(count * blockHeight / blockWidth)));
+        blocksPerRow = std::clamp(blocksPerRow, 1u, std::min(static_cast<uint32_t>(uniqueModels.size()), maxDimension / blockWidth));
+        const uint32_t rows = (static_cast<uint32_t>(uniqueModels.size()) + blocksPerRow - 1) / blocksPerRow;
+
+        width = blocksPerRow * blockWidth;
+        height = rows * blockHeight;
+        if (height > maxDimension) {
+            throw std::runtime_error("Too many models for one impostor atlas!");
+        }
+
+        for (uint32_t i = 0; i < uniqueModels.size(); i++) {
+            modelBlocks[uniqueModels[i]] = glm::uvec2{ (i % blocksPerRow) * YAW_VIEWS, (i / blocksPerRow) * PITCH_VIEWS };
+        }
+    }
+
+    void ImpostorAtlas::createAtlasImages() {
+        for (int i = 0; i < 2; i++) {
+            VkImageCreateInfo imageInfo{};
+            imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            imageInfo.imageType = VK_IMAGE_TYPE_2D;
+            imageInfo.format = ATLAS_FORMAT;
+            imageInfo.extent = { width, height, 1 };
+            imageInfo.mipLevels = mipLevels;
+            imageInfo.arrayLayers = 1;
+            imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+            imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+            imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
+            resourceManager.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, images[i], imageMemories[i]);
+
+            VkImageViewCreateInfo viewInfo{};
+            viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            viewInfo.image = images[i];
+            viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            viewInfo.format = ATLAS_FORMAT;
+            viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            viewInfo.subresourceRange.baseMipLevel = 0;
+            viewInfo.subresourceRange.levelCount = mipLevels;
+            viewInfo.subresourceRange.baseArrayLayer = 0;
+            viewInfo.subresourceRange.layerCount = 1;
+
+            if (vkCreateImageView(device.device(), &viewInfo, nullptr, &imageViews[i]) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create impostor atlas image view!");
+            }
+        }
+
+        // Linear filtering blends neighbouring texels only, so the empty tile margin keeps other tiles from bleeding in at every level
+        VkSamplerCreateInfo samplerInfo{};
+        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.magFilter = VK_FILTER_LINEAR;
+        samplerInfo.minFilter = VK_FILTER_LINEAR;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.compareOp = VK_COMPARE_OP_NEVER;
+        samplerInfo.minLod = 0.0f;
+        samplerInfo.maxLod = static_cast<float>(mipLevels - 1);
+        samplerInfo.anisotropyEnable = VK_FALSE;
+        samplerInfo.maxAnisotropy = 1.0f;
+        samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK;
+
+        if (vkCreateSampler(device.device(), &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create impostor atlas sampler!");
+        }
+    }
+
+    void ImpostorAtlas::createDescriptors() {
+        descriptorSetLayout = JCATDescriptorSetLayout::Builder(device)
+            .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+            .addBinding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
+            .build();
+
+        descriptorPool = JCATDescriptorPool::Builder(device)
+            .setMaxSets(1)
+            .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2)
+            .build();
+
+        VkDescriptorImageInfo colorInfo{ sampler, imageViews[0], VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+        VkDescriptorImageInfo normalInfo{ sampler, imageViews[1], VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+
+        if (!JCATDescriptorWriter(*descriptorSetLayout, *descriptorPool).writeImage(0, &colorInfo).writeImage(1, &normalInfo).build(descriptorSet)) {
+            throw std::runtime_error("Failed to allocate impostor atlas descriptor set!");
+        }
+    }
+
+    void ImpostorAtlas::bake(const std::vector<std::shared_ptr<JCATModel3D>>& models) {
+        // Vertex and index data may still be in flight from the upload batch that created the models
+        resourceManager.waitForUploads();
+
+        // Depth only matters within a tile, one buffer is shared by both atlases
+        const VkFormat depthFormat = device.findSupportedDepthFormat({ VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT },
+                                                                     VK_IMAGE_TILING_OPTIMAL,
+                                                                     VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+
+        VkImageCreateInfo depthInfo{};
+        depthInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        depthInfo.imageType = VK_IMAGE_TYPE_2D;
+        depthInfo.format = depthFormat;
+        depthInfo.extent = { width, height, 1 };
+        depthInfo.mipLevels = 1;
+        depthInfo.arrayLayers = 1;
+        depthInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        depthInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        depthInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        depthInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        depthInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+
+        VkImage depthImage;
+        MemoryAllocation depthMemory;
+        resourceManager.createImageWithInfo(depthInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, depthImage, depthMemory);
+
+        VkImageViewCreateInfo depthViewInfo{};
+        depthViewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        depthViewInfo.image = depthImage;
+        depthViewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        depthViewInfo.format = depthFormat;
+        depthViewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+        depthViewInfo.subresourceRange.levelCount = 1;
+        depthViewInfo.subresourceRange.layerCount = 1;
+
+        VkImageView depthImageView;
+        if (vkCreateImageView(device.device(), &depthViewInfo, nullptr, &depthImageView) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create impostor depth image view!");
+        }
+
+        // Both atlases are written by the same pass, each leaves level 0 ready to be blitted into the smaller levels
+        VkAttachmentDescription colorAttachment{};
+        colorAttachment.format = ATLAS_FORMAT;
+        colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+        VkAttachmentDescription depthAttachment{};
+        depthAttachment.format = depthFormat;
+        depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+        depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+        VkAttachmentReference colorAttachmentRef{ 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+        VkAttachmentReference depthAttachmentRef{ 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+
+        VkSubpassDescription subpass{};
+        subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpass.colorAttachmentCount = 1;
+        subpass.pColorAttachments = &colorAttachmentRef;
+        subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+        // The second pass clears the depth the first one wrote, and the mip chain is blitted from the atlases once the pass is over
+        std::array<VkSubpassDependency, 2> dependencies{};
+        dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[0].dstSubpass = 0;
+        dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        dependencies[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+        dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+        dependencies[1].srcSubpass = 0;
+        dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+        std::array<VkAttachmentDescription, 2> attachments = { colorAttachment, depthAttachment };
+
+        VkRenderPassCreateInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+        renderPassInfo.pAttachments = attachments.data();
+        renderPassInfo.subpassCount = 1;
+        renderPassInfo.pSubpasses = &subpass;
+        renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+        renderPassInfo.pDependencies = dependencies.data();
+
+        VkRenderPass renderPass;
+        if (vkCreateRenderPass(device.device(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create impostor render pass!");
+        }
+
+        // Framebuffer attachments can only have a single level
+        VkImageView levelViews[2];
+        VkFramebuffer framebuffers[2];
+        for (int i = 0; i < 2; i++) {
+            VkImageViewCreateInfo levelViewInfo{};
+            levelViewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            levelViewInfo.image = images[i];
+            levelViewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            levelViewInfo.format = ATLAS_FORMAT;
+            levelViewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            levelViewInfo.subresourceRange.levelCount = 1;
+            levelViewInfo.subresourceRange.layerCount = 1;
+
+            if (vkCreateImageView(device.device(), &levelViewInfo, nullptr, &levelViews[i]) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create impostor atlas image view!");
+            }
+
+            std::array<VkImageView, 2> framebufferAttachments = { levelViews[i], depthImageView };
+
+            VkFramebufferCreateInfo framebufferInfo{};
+            framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+            framebufferInfo.renderPass = renderPass;
+            framebufferInfo.attachmentCount = static_cast<uint32_t>(framebufferAttachments.size());
+            framebufferInfo.pAttachments = framebufferAttachments.data();
+            framebufferInfo.width = width;
+            framebufferInfo.height = height;
+            framebufferInfo.layers = 1;
+
+            if (vkCreateFramebuffer(device.device(), &framebufferInfo, nullptr, &framebuffers[i]) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create impostor framebuffer!");
+            }
+        }
+
+        VkPushConstantRange pushConstantRange{};
+        pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+        pushConstantRange.offset = 0;
+        pushConstantRange.size = sizeof(BakePushConstantData);
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = 0;
+        pipelineLayoutInfo.pushConstantRangeCount = 1;
+        pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+        VkPipelineLayout pipelineLayout;
+        if (vkCreatePipelineLayout(device.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create impostor pipeline layout!");
+        }
+
+        {
+            GraphicsPipeline pipeline{ device, resourceManager, "../shaders/impostorBake.vert.spv", "../shaders/impostorBake.frag.spv" };
+
+            std::unordered_map<GraphicsPipeline::PipelineType, PipelineConfigInfo> pipelineConfigs = {};
+            pipeline.configurePipelines(pipelineConfigs);
+            for (GraphicsPipeline::PipelineType type : { GraphicsPipeline::PipelineType::IMPOSTOR_BAKE_PIPELINE,
+                                                         GraphicsPipeline::PipelineType::IMPOSTOR_BAKE_COMPACT_PIPELINE,
+                                                         GraphicsPipeline::PipelineType::IMPOSTOR_BAKE_SPLIT_PIPELINE }) {
+                pipelineConfigs[type].renderPass = renderPass;
+                pipelineConfigs[type].pipelineLayout = pipelineLayout;
+            }
+
+            // SPLIT models read the same attributes at the same locations as STANDARD ones, so they share the shaders
+            pipeline.createImpostorBakePipeline("../shaders/impostorBake.vert.spv", "../shaders/impostorBake.frag.spv", pipelineConfigs[GraphicsPipeline::PipelineType::IMPOSTOR_BAKE_PIPELINE]);
+            pipeline.createImpostorBakeCompactPipeline("../shaders/impostorBakeCompact.vert.spv", "../shaders/impostorBake.frag.spv", pipelineConfigs[GraphicsPipeline::PipelineType::IMPOSTOR_BAKE_COMPACT_PIPELINE]);
+            pipeline.createImpostorBakeSplitPipeline("../shaders/impostorBake.vert.spv", "../shaders/impostorBake.frag.spv", pipelineConfigs[GraphicsPipeline::PipelineType::IMPOSTOR_BAKE_SPLIT_PIPELINE]);
+
+            VkCommandBuffer commandBuffer = resourceManager.beginSingleTimeCommands();
+
+            for (uint32_t image = 0; image < 2; image++) {
+                std::array<VkClearValue, 2> clearValues{};
+                clearValues[0].color = { 0.0f, 0.0f, 0.0f, 0.0f };
+                clearValues[1].depthStencil = { 1.0f, 0 };
+
+                VkRenderPassBeginInfo beginInfo{};
+                beginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+                beginInfo.renderPass = renderPass;
+                beginInfo.framebuffer = framebuffers[image];
+                beginInfo.renderArea = { { 0, 0 }, { width, height } };
+                beginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+                beginInfo.pClearValues = clearValues.data();
+
+                vkCmdBeginRenderPass(commandBuffer, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+                const JCATModel3D* boundModel = nullptr;
+                std::unordered_set<const JCATModel3D*> bakedModels;
+                for (const std::shared_ptr<JCATModel3D>& model : models) {
+                    // Repeated models share one block, it is filled the first time they come up
+                    if (model == nullptr || !bakedModels.insert(model.get()).second) {
+                        continue;
+                    }
+
+                    pipeline.bindPipeline(commandBuffer, getBakePipelineType(model->getVertexFormat()));
+                    model->bind(commandBuffer, boundModel);
+                    boundModel = model.get();
+
+                    const glm::uvec2 block = modelBlocks.at(model.get());
+                    for (uint32_t pitch = 0; pitch < PITCH_VIEWS; pitch++) {
+                        for (uint32_t yaw = 0; yaw < YAW_VIEWS; yaw++) {
+                            VkViewport viewport{};
+                            viewport.x = static_cast<float>((block.x + yaw) * tileSize);
+                            viewport.y = static_cast<float>((block.y + pitch) * tileSize);
+                            viewport.width = static_cast<float>(tileSize);
+                            viewport.height = static_cast<float>(tileSize);
+                            viewport.minDepth = 0.0f;
+                            viewport.maxDepth = 1.0f;
+
+                            VkRect2D scissor{ { static_cast<int32_t>(viewport.x), static_cast<int32_t>(viewport.y) }, { tileSize, tileSize } };
+                            vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+                            vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+                            BakePushConstantData push{};
+                            push.bakeMatrix = getBakeMatrix(model->getLocalBoundingSphere(), yaw, pitch);
+                            if (model->isCompact()) {
+                                push.bakeMatrix = push.bakeMatrix * model->getDequantizeMatrix();
+                            }
+                            push.bakeNormals = image;
+
+                            vkCmdPushConstants(commandBuffer,
+                                               pipelineLayout,
+                                               VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+                                               0,
+                                               sizeof(BakePushConstantData),
+                                               &push);
+
+                            model->draw(commandBuffer);
+                        }
+                    }
+                }
+
+                vkCmdEndRenderPass(commandBuffer);
+            }
+
+            generateMipmaps(commandBuffer);
+
+            // Waits for the bake to finish, nothing below is in use afterwards
+            resourceManager.endSingleTimeCommands(commandBuffer);
+        }
+
+        vkDestroyPipelineLayout(device.device(), pipelineLayout, nullptr);
+        for (VkFramebuffer framebuffer : framebuffers) {
+            vkDestroyFramebuffer(device.device(), framebuffer, nullptr);
+        }
+        for (VkImageView levelView : levelViews) {
+            vkDestroyImageView(device.device(), levelView, nullptr);
+        }
+        vkDestroyRenderPass(device.device(), renderPass, nullptr);
+        vkDestroyImageView(device.device(), depthImageView, nullptr);
+        resourceManager.destroyImage(depthImage, depthMemory);
+    }
+
+    void ImpostorAtlas::generateMipmaps(VkCommandBuffer commandBuffer) {
+        // Blitting with linear filtering is mandatory for ATLAS_FORMAT, so unlike UploadBatch::generateMipmaps nothing is checked
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = 1;
+
+        for (int i = 0; i < 2; i++) {
+            barrier.image = images[i];
+
+            int32_t mipWidth = static_cast<int32_t>(width);
+            int32_t mipHeight = static_cast<int32_t>(height);
+
+            for (uint32_t level = 1; level < mipLevels; level++) {
+                barrier.subresourceRange.baseMipLevel = level;
+                barrier.subresourceRange.levelCount = 1;
+                barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+                barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+                barrier.srcAccessMask = 0;
+                barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+                vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+                // Width and height are multiples of the tile size, which halves evenly down to the last level, so every
+                // texel averages 2x2 texels of a single tile
+                VkImageBlit blit{};
+                blit.srcOffsets[0] = { 0, 0, 0 };
+                blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
+                blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+                blit.srcSubresource.mipLevel = level - 1;
+                blit.srcSubresource.baseArrayLayer = 0;
+                blit.srcSubresource.layerCount = 1;
+                blit.dstOffsets[0] = { 0, 0, 0 };
+                blit.dstOffsets[1] = { mipWidth / 2, mipHeight / 2, 1 };
+                blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+                blit.dstSubresource.mipLevel = level;
+                blit.dstSubresource.baseArrayLayer = 0;
+                blit.dstSubresource.layerCount = 1;
+
+                vkCmdBlitImage(commandBuffer, images[i], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, images[i], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+                // The next level is blitted from this one
+                barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+                barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+                barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+                vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+                mipWidth /= 2;
+                mipHeight /= 2;
+            }
+
+            // Every level is a transfer source by now, level 0 since the bake's render pass
+            barrier.subresourceRange.baseMipLevel = 0;
+            barrier.subresourceRange.levelCount = mipLevels;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+        }
+    }
+
+    void ImpostorAtlas::getViewBasis(uint32_t yaw, uint32_t pitch, glm::vec3& direction, glm::vec3& right, glm::vec3& up) {
+        const float yawAngle = glm::two_pi<float>() * static_cast<float>(yaw) / static_cast<float>(YAW_VIEWS);
+        const float pitchAngle = PITCH_ANGLES[pitch];
+
+        direction = glm::vec3{ std::cos(pitchAngle) * std::sin(yawAngle), std::sin(pitchAngle), std::cos(pitchAngle) * std::cos(yawAngle) };
+
+        // No pitch reaches the poles, so the model's y axis is never parallel to the direction
+        right = glm::normalize(glm::cross(glm::vec3{ 0.0f, 1.0f, 0.0f }, direction));
+        up = glm::cross(direction, right);
+    }
+
+    glm::mat4 ImpostorAtlas::getBakeMatrix(const BoundingSphere& sphere, uint32_t yaw, uint32_t pitch) const {
+        glm::vec3 direction, right, up;
+        getViewBasis(yaw, pitch, direction, right, up);
+
+        const float inverseRadius = sphere.radius > 0.0f ? 1.0f / sphere.radius : 1.0f;
+        // The sphere covers the tile minus tileMargin texels on each side, fillInstance() samples the same inner square
+        const float inverseExtent = inverseRadius * static_cast<float>(tileSize - 2 * tileMargin) / static_cast<float>(tileSize);
+
+        // Written as rows: x along right, y along up (flipped, Vulkan's y points down), depth 0 at the sphere's side facing the eye, 1 at the far side
+        const glm::mat4 rows{
+            glm::vec4{ right * inverseExtent, -glm::dot(right, sphere.center) * inverseExtent },
+            glm::vec4{ -up * inverseExtent, glm::dot(up, sphere.center) * inverseExtent },
+            glm::vec4{ -direction * 0.5f * inverseRadius, 0.5f + glm::dot(direction, sphere.center) * 0.5f * inverseRadius },
+            glm::vec4{ 0.0f, 0.0f, 0.0f, 1.0f }
+        };
+
+        return glm::transpose(rows);
+    }
+
+    void ImpostorAtlas::fillInstance(const JCATModel3D& model, const glm::mat4& modelMatrix, const glm::mat3& normalMatrix, const glm::vec3& eye, Instance& instance) const {
+        const glm::uvec2 block = modelBlocks.at(&model);
+        const BoundingSphere& sphere = model.getLocalBoundingSphere();
+
+        // Pick the baked view whose direction is closest to the eye's, in the model's own space so any rotation or mirroring is accounted for
+        glm::vec3 toEye = glm::vec3{ glm::inverse(modelMatrix) * glm::vec4{ eye, 1.0f } } - sphere.center;
+        const float distance = glm::length(toEye);
+        toEye = distance > 0.0f ? toEye / distance : glm::vec3{ 0.0f, 0.0f, 1.0f };
+
+        const float yawStep = glm::two_pi<float>() / static_cast<float>(YAW_VIEWS);
+        const int yawIndex = static_cast<int>(std::round(std::atan2(toEye.x, toEye.z) / yawStep));
+        const uint32_t yaw = static_cast<uint32_t>((yawIndex % static_cast<int>(YAW_VIEWS) + static_cast<int>(YAW_VIEWS)) % static_cast<int>(YAW_VIEWS));
+
+        const float pitchAngle = std::asin(glm::clamp(toEye.y, -1.0f, 1.0f));
+        uint32_t pitch = 0;
+        for (uint32_t i = 1; i < PITCH_VIEWS; i++) {
+            if (std::abs(PITCH_ANGLES[i] - pitchAngle) < std::abs(PITCH_ANGLES[pitch] - pitchAngle)) {
+                pitch = i;
+            }
+        }
+
+        glm::vec3 direction, right, up;
+        getViewBasis(yaw, pitch, direction, right, up);
+
+        const glm::mat3 linear{ modelMatrix };
+        instance.center = glm::vec3{ modelMatrix * glm::vec4{ sphere.center, 1.0f } };
+        instance.right = linear * right * sphere.radius;
+        instance.up = linear * up * sphere.radius;
+
+        // Turn the quad to face the camera, each axis keeps its length so the picture keeps its size
+        const glm::vec3 toCamera = eye - instance.center;
+        if (glm::dot(toCamera, toCamera) > 0.0f) {
+            const glm::vec3 forward = glm::normalize(toCamera);
+            for (glm::vec3* axis : { &instance.right, &instance.up }) {
+                const glm::vec3 facing = *axis - glm::dot(*axis, forward) * forward;
+                const float facingLength = glm::length(facing);
+                if (facingLength > 1e-6f) {
+                    *axis = facing * (glm::length(*axis) / facingLength);
+                }
+            }
+        }
+
+        // The quad spans the bounding sphere, which was baked inside the tile's margin
+        const glm::vec2 atlasSize{ static_cast<float>(width), static_cast<float>(height) };
+        const glm::vec2 tileCorner = glm::vec2{ static_cast<float>((block.x + yaw) * tileSize), static_cast<float>((block.y + pitch) * tileSize) } + static_cast<float>(tileMargin);
+        instance.tile = glm::vec4{ tileCorner / atlasSize, glm::vec2{ static_cast<float>(tileSize - 2 * tileMargin) } / atlasSize };
+        instance.normalMatrix = normalMatrix;
+    }
+};
\ No newline at end of file
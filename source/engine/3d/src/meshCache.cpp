@@ -0,0 +1,439 @@
+#include "./engine/3d/meshCache.h"
+#include "./engine/3d/meshCodec.h"
+#include "./engine/utils.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+#include <iostream>
+
+namespace JCAT {
+    static constexpr char MESH_CACHE_MAGIC[4] = { 'J', 'M', 'S', 'H' };
+    static constexpr char COMPRESSED_MAGIC[4] = { 'J', 'M', 'Z', '0' };
+
+    std::string MeshCache::getCachePath(const std::string& sourcePath) {
+        return std::filesystem::path(sourcePath).replace_extension(".jmesh").string();
+    }
+
+    std::string MeshCache::getCompressedPath(const std::string& sourcePath) {
+        return std::filesystem::path(sourcePath).replace_extension(".jmz").string();
+    }
+
+    uint32_t MeshCache::makeFlags(bool hasIndexBuffer, bool optimizeMesh, uint32_t lodLevels) {
+        if (!hasIndexBuffer) {
+            return 0;
+        }
+
+        uint32_t flags = MESH_CACHE_INDEXED | (optimizeMesh ? MESH_CACHE_OPTIMIZED | MESH_CACHE_MESHLETS : 0);
+        if (lodLevels > 1) {
+            flags |= (std::min(lodLevels, JCATModel3D::MAX_LODS) << MESH_CACHE_LOD_LEVELS_SHIFT) & MESH_CACHE_LOD_LEVELS_MASK;
+        }
+
+        return flags;
+    }
+
+    bool MeshCache::getSourceStamp(const std::string& sourcePath, SourceStamp& stamp) {
+        std::error_code error;
+
+        std::filesystem::file_time_type modifiedTime = std::filesystem::last_write_time(sourcePath, error);
+        if (error) {
+            return false;
+        }
+
+        uintmax_t size = std::filesystem::file_size(sourcePath, error);
+        if (error) {
+            return false;
+        }
+
+        // Only compared for equality against a previous run, so the clock's epoch does not matter
+        stamp.modifiedTime = static_cast<uint64_t>(modifiedTime.time_since_epoch().count());
+        stamp.size = static_cast<uint64_t>(size);
+
+        return true;
+    }
+
+    bool MeshCache::hashSourceFile(const std::string& sourcePath, uint64_t& hash) {
+        MappedFile source;
+        if (!source.open(sourcePath)) {
+            return false;
+        }
+
+        hash = hashBytes(source.data(), source.size());
+        return true;
+    }
+
+    const MeshCacheSection* MeshCache::findSection(const MappedFile& file, const MeshCacheHeader& header, MeshSectionType type) {
+        const MeshCacheSection* sections = reinterpret_cast<const MeshCacheSection*>(file.data() + sizeof(MeshCacheHeader));
+
+        for (uint32_t i = 0; i < header.sectionCount; i++) {
+            if (sections[i].type != static_cast<uint32_t>(type)) {
+                continue;
+            }
+
+            // Reject sections that point outside the file or are misaligned for their element type
+            if (sections[i].offset > file.size() || sections[i].size > file.size() - sections[i].offset || sections[i].offset % SECTION_ALIGNMENT != 0) {
+                return nullptr;
+            }
+
+            return &sections[i];
+        }
+
+        return nullptr;
+    }
+
+    bool MeshCache::mapFile(const std::string& path, const char* magic, const std::string& sourcePath, uint32_t flags, MappedFile& file, MeshCacheHeader& header) {
+        if (!file.open(path)) {
+            return false;
+        }
+
+        if (file.size() < sizeof(MeshCacheHeader)) {
+            return false;
+        }
+
+        std::memcpy(&header, file.data(), sizeof(MeshCacheHeader));
+
+        if (std::memcmp(header.magic, magic, sizeof(header.magic)) != 0 ||
+            header.version != VERSION ||
+            header.vertexStride != sizeof(JCATModel3D::Vertex3D) ||
+            header.flags != flags ||
+            header.sectionCount > (file.size() - sizeof(MeshCacheHeader)) / sizeof(MeshCacheSection)) {
+            return false;
+        }
+
+        // A missing source is fine (pre-baked caches can ship without the .obj), otherwise it must match what we built from
+        SourceStamp stamp;
+        if (getSourceStamp(sourcePath, stamp) && (stamp.modifiedTime != header.sourceModifiedTime || stamp.size != header.sourceSize)) {
+            uint64_t sourceHash = 0;
+            if (stamp.size != header.sourceSize || !hashSourceFile(sourcePath, sourceHash) || sourceHash != header.sourceHash) {
+                return false;
+            }
+
+            // Same content under a new stamp (a touch or a checkout). Recording it lets later launches skip the hash again.
+            // The read only mapping (which on Windows keeps writers out) is dropped around the patch, then mapped again
+            file.close();
+            writeSourceStamp(path, stamp);
+
+            MeshCacheHeader expected = header;
+            if (!file.open(path) || file.size() < sizeof(MeshCacheHeader)) {
+                return false;
+            }
+            std::memcpy(&header, file.data(), sizeof(MeshCacheHeader));
+
+            // Another writer may have replaced the cache in between, anything but the stamp changing is a miss
+            expected.sourceModifiedTime = header.sourceModifiedTime;
+            if (std::memcmp(&expected, &header, sizeof(MeshCacheHeader)) != 0) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    bool MeshCache::writeSourceStamp(const std::string& path, const SourceStamp& stamp) {
+        // The size already matches, so only the modification time changes
+        std::fstream output(path, std::ios::binary | std::ios::in | std::ios::out);
+        if (!output) {
+            return false;
+        }
+
+        output.seekp(static_cast<std::streamoff>(offsetof(MeshCacheHeader, sourceModifiedTime)));
+        output.write(reinterpret_cast<const char*>(&stamp.modifiedTime), sizeof(stamp.modifiedTime));
+
+        return static_cast<bool>(output);
+    }
+
+    bool MeshCache::loadRanges(const MappedFile& file, const MeshCacheHeader& header, uint32_t flags, CachedMesh& mesh) {
+        mesh.lods = nullptr;
+        mesh.lodCount = 0;
+        mesh.meshlets = nullptr;
+        mesh.meshletCount = 0;
+
+        // An out of range index would read past the vertex buffer on the GPU, so never trust it blindly
+        for (uint32_t i = 0; i < mesh.indexCount; i++) {
+            if (mesh.indices[i] >= mesh.vertexCount) {
+                return false;
+            }
+        }
+
+        if (flags & MESH_CACHE_INDEXED) {
+            // A mesh may end up with fewer levels than requested, but never without its full detail level
+            if (flags & MESH_CACHE_LOD_LEVELS_MASK) {
+                const MeshCacheSection* lodSection = findSection(file, header, MeshSectionType::LODS);
+                if (lodSection == nullptr || lodSection->elementSize != sizeof(JCATModel3D::LodRange) ||
+                    lodSection->size % sizeof(JCATModel3D::LodRange) != 0 || lodSection->size == 0 ||
+                    lodSection->size / sizeof(JCATModel3D::LodRange) > JCATModel3D::MAX_LODS) {
+                    return false;
+                }
+
+                mesh.lods = reinterpret_cast<const JCATModel3D::LodRange*>(file.data() + lodSection->offset);
+                mesh.lodCount = static_cast<uint32_t>(lodSection->size / sizeof(JCATModel3D::LodRange));
+
+                for (uint32_t lod = 0; lod < mesh.lodCount; lod++) {
+                    if (mesh.lods[lod].firstIndex > mesh.indexCount || mesh.lods[lod].indexCount > mesh.indexCount - mesh.lods[lod].firstIndex) {
+                        return false;
+                    }
+                }
+            }
+
+            if (flags & MESH_CACHE_MESHLETS) {
+                const MeshCacheSection* meshletSection = findSection(file, header, MeshSectionType::MESHLETS);
+                if (meshletSection == nullptr || meshletSection->elementSize != sizeof(JCATModel3D::Meshlet) ||
+                    meshletSection->size % sizeof(JCATModel3D::Meshlet) != 0) {
+                    return false;
+                }
+
+                mesh.meshlets = reinterpret_cast<const JCATModel3D::Meshlet*>(file.data() + meshletSection->offset);
+                mesh.meshletCount = static_cast<uint32_t>(meshletSection->size / sizeof(JCATModel3D::Meshlet));
+
+                const uint32_t fullDetailCount = mesh.lodCount > 0 ? mesh.lods[0].indexCount : mesh.indexCount;
+                for (uint32_t i = 0; i < mesh.meshletCount; i++) {
+                    if (mesh.meshlets[i].firstIndex > fullDetailCount || mesh.meshlets[i].indexCount > fullDetailCount - mesh.meshlets[i].firstIndex) {
+                        return false;
+                    }
+                }
+            }
+        }
+
+        mesh.bounds.min = glm::vec3{ header.boundsMin[0], header.boundsMin[1], header.boundsMin[2] };
+        mesh.bounds.max = glm::vec3{ header.boundsMax[0], header.boundsMax[1], header.boundsMax[2] };
+        mesh.boundingSphere.center = glm::vec3{ header.sphereCenter[0], header.sphereCenter[1], header.sphereCenter[2] };
+        mesh.boundingSphere.radius = header.sphereRadius;
+
+        return true;
+    }
+
+    bool MeshCache::load(const std::string& sourcePath, uint32_t flags, CachedMesh& mesh) {
+        MappedFile file;
+        MeshCacheHeader header;
+        if (!mapFile(getCachePath(sourcePath), MESH_CACHE_MAGIC, sourcePath, flags, file, header)) {
+            return false;
+        }
+
+        const MeshCacheSection* vertexSection = findSection(file, header, MeshSectionType::VERTICES);
+        if (vertexSection == nullptr || vertexSection->elementSize != sizeof(JCATModel3D::Vertex3D) ||
+            vertexSection->size != static_cast<uint64_t>(header.vertexCount) * sizeof(JCATModel3D::Vertex3D)) {
+            return false;
+        }
+
+        mesh.vertices = reinterpret_cast<const JCATModel3D::Vertex3D*>(file.data() + vertexSection->offset);
+        mesh.vertexCount = header.vertexCount;
+        mesh.indices = nullptr;
+        mesh.indexCount = 0;
+
+        if (flags & MESH_CACHE_INDEXED) {
+            const MeshCacheSection* indexSection = findSection(file, header, MeshSectionType::INDICES);
+            if (indexSection == nullptr || indexSection->elementSize != sizeof(uint32_t) ||
+                indexSection->size != static_cast<uint64_t>(header.indexCount) * sizeof(uint32_t)) {
+                return false;
+            }
+
+            mesh.indices = reinterpret_cast<const uint32_t*>(file.data() + indexSection->offset);
+            mesh.indexCount = header.indexCount;
+        }
+
+        if (!loadRanges(file, header, flags, mesh)) {
+            return false;
+        }
+
+        mesh.file = std::move(file);
+
+        return true;
+    }
+
+    bool MeshCache::loadCompressed(const std::string& sourcePath, uint32_t flags, CachedMesh& mesh) {
+        MappedFile file;
+        MeshCacheHeader header;
+        if (!mapFile(getCompressedPath(sourcePath), COMPRESSED_MAGIC, sourcePath, flags, file, header)) {
+            return false;
+        }
+
+        // Every block of vertices takes at least a byte, which bounds the allocation a corrupt count can ask for
+        const MeshCacheSection* vertexSection = findSection(file, header, MeshSectionType::ENCODED_VERTICES);
+        if (vertexSection == nullptr || vertexSection->size < header.vertexCount / MeshCodec::BLOCK_VERTICES) {
+            return false;
+        }
+
+        mesh.decodedVertices.resize(header.vertexCount);
+        if (!MeshCodec::decodeVertices(file.data() + vertexSection->offset, vertexSection->size, mesh.decodedVertices.data(), header.vertexCount)) {
+            return false;
+        }
+
+        mesh.vertices = mesh.decodedVertices.data();
+        mesh.vertexCount = header.vertexCount;
+        mesh.indices = nullptr;
+        mesh.indexCount = 0;
+        mesh.decodedIndices.clear();
+
+        if (flags & MESH_CACHE_INDEXED) {
+            const MeshCacheSection* indexSection = findSection(file, header, MeshSectionType::ENCODED_INDICES);
+
+            // Every index takes at least a byte, which bounds the allocation a corrupt count can ask for
+            if (indexSection == nullptr || indexSection->size < header.indexCount) {
+                return false;
+            }
+
+            mesh.decodedIndices.resize(header.indexCount);
+            if (!MeshCodec::decodeIndices(file.data() + indexSection->offset, indexSection->size, mesh.decodedIndices.data(), header.indexCount)) {
+                return false;
+            }
+
+            mesh.indices = mesh.decodedIndices.data();
+            mesh.indexCount = header.indexCount;
+        }
+
+        if (!loadRanges(file, header, flags, mesh)) {
+            return false;
+        }
+
+        // Still needed after decoding, the LOD and meshlet ranges point into the mapping
+        mesh.file = std::move(file);
+
+        return true;
+    }
+
+    bool MeshCache::makeHeader(const std::string& sourcePath, const char* magic, uint32_t flags, const JCATModel3D::Vertex3D* vertices, size_t vertexCount, size_t indexCount, MeshCacheHeader& header) {
+        SourceStamp stamp;
+        uint64_t sourceHash = 0;
+        if (!getSourceStamp(sourcePath, stamp) || !hashSourceFile(sourcePath, sourceHash)) {
+            return false;
+        }
+
+        AABB bounds{};
+        BoundingSphere boundingSphere{};
+        computeBounds(vertices, vertexCount, bounds, boundingSphere);
+
+        header = MeshCacheHeader{};
+        std::memcpy(header.magic, magic, sizeof(header.magic));
+        header.version = VERSION;
+        header.sourceModifiedTime = stamp.modifiedTime;
+        header.sourceSize = stamp.size;
+        header.sourceHash = sourceHash;
+        header.vertexStride = sizeof(JCATModel3D::Vertex3D);
+        header.flags = flags;
+        header.vertexCount = static_cast<uint32_t>(vertexCount);
+        header.indexCount = static_cast<uint32_t>(indexCount);
+
+        for (int i = 0; i < 3; i++) {
+            header.boundsMin[i] = bounds.min[i];
+            header.boundsMax[i] = bounds.max[i];
+            header.sphereCenter[i] = boundingSphere.center[i];
+        }
+        header.sphereRadius = boundingSphere.radius;
+
+        return true;
+    }
+
+    void MeshCache::addRangeSections(uint32_t flags, const JCATModel3D::ModelBuilder& builder, std::vector<SectionData>& sections) {
+        if ((flags & MESH_CACHE_LOD_LEVELS_MASK) && !builder.lods.empty()) {
+            sections.push_back({ MeshSectionType::LODS, sizeof(JCATModel3D::LodRange), builder.lods.data(), builder.lods.size() * sizeof(JCATModel3D::LodRange) });
+        }
+
+        // Written even when empty, a mesh with no triangles has no meshlets but was still built with them asked for
+        if (flags & MESH_CACHE_MESHLETS) {
+            sections.push_back({ MeshSectionType::MESHLETS, sizeof(JCATModel3D::Meshlet), builder.meshlets.data(), builder.meshlets.size() * sizeof(JCATModel3D::Meshlet) });
+        }
+    }
+
+    bool MeshCache::write(const std::string& sourcePath, uint32_t flags, const JCATModel3D::ModelBuilder& builder) {
+        MeshCacheHeader header;
+        if (!makeHeader(sourcePath, MESH_CACHE_MAGIC, flags, builder.vertices.data(), builder.vertices.size(), builder.indices.size(), header)) {
+            return false;
+        }
+
+        std::vector<SectionData> sections;
+        sections.push_back({ MeshSectionType::VERTICES, sizeof(JCATModel3D::Vertex3D), builder.vertices.data(), builder.vertices.size() * sizeof(JCATModel3D::Vertex3D) });
+        if (flags & MESH_CACHE_INDEXED) {
+            sections.push_back({ MeshSectionType::INDICES, sizeof(uint32_t), builder.indices.data(), builder.indices.size() * sizeof(uint32_t) });
+        }
+        addRangeSections(flags, builder, sections);
+
+        return writeFile(getCachePath(sourcePath), header, sections);
+    }
+
+    bool MeshCache::writeCompressed(const std::string& sourcePath, uint32_t flags, const JCATModel3D::ModelBuilder& builder) {
+        std::vector<uint8_t> encodedVertices;
+        MeshCodec::encodeVertices(builder.vertices.data(), builder.vertices.size(), encodedVertices);
+
+        // Quantizing moves positions by up to half a step, so the bounds have to come from what the loader will see
+        std::vector<JCATModel3D::Vertex3D> decoded(builder.vertices.size());
+        if (!MeshCodec::decodeVertices(encodedVertices.data(), encodedVertices.size(), decoded.data(), decoded.size())) {
+            return false;
+        }
+
+        MeshCacheHeader header;
+        if (!makeHeader(sourcePath, COMPRESSED_MAGIC, flags, decoded.data(), decoded.size(), builder.indices.size(), header)) {
+            return false;
+        }
+
+        std::vector<SectionData> sections;
+        sections.push_back({ MeshSectionType::ENCODED_VERTICES, 0, encodedVertices.data(), encodedVertices.size() });
+
+        std::vector<uint8_t> encodedIndices;
+        if (flags & MESH_CACHE_INDEXED) {
+            MeshCodec::encodeIndices(builder.indices.data(), builder.indices.size(), encodedIndices);
+            sections.push_back({ MeshSectionType::ENCODED_INDICES, 0, encodedIndices.data(), encodedIndices.size() });
+        }
+        addRangeSections(flags, builder, sections);
+
+        return writeFile(getCompressedPath(sourcePath), header, sections);
+    }
+
+    bool MeshCache::writeFile(const std::string& cachePath, MeshCacheHeader header, const std::vector<SectionData>& sections) {
+        header.sectionCount = static_cast<uint32_t>(sections.size());
+
+        // Lay out the payloads after the section table, each on an aligned boundary
+        std::vector<MeshCacheSection> table(sections.size());
+        uint64_t offset = sizeof(MeshCacheHeader) + sizeof(MeshCacheSection) * sections.size();
+        for (size_t i = 0; i < sections.size(); i++) {
+            offset = (offset + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1);
+
+            table[i].type = static_cast<uint32_t>(sections[i].type);
+            table[i].elementSize = sections[i].elementSize;
+            table[i].offset = offset;
+            table[i].size = sections[i].size;
+
+            offset += sections[i].size;
+        }
+
+        // Write to a temporary file and rename it into place so a crash or a concurrent reader never sees a partial cache.
+        // Each writer gets its own, two loads of the same model with different flags may write it at the same time
+        const std::string temporaryPath = makeTemporaryPath(cachePath);
+        {
+            std::ofstream output(temporaryPath, std::ios::binary | std::ios::trunc);
+            if (!output) {
+                return false;
+            }
+
+            output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            output.write(reinterpret_cast<const char*>(table.data()), static_cast<std::streamsize>(sizeof(MeshCacheSection) * table.size()));
+
+            const char padding[SECTION_ALIGNMENT] = {};
+            uint64_t written = sizeof(MeshCacheHeader) + sizeof(MeshCacheSection) * table.size();
+            for (size_t i = 0; i < sections.size(); i++) {
+                output.write(padding, static_cast<std::streamsize>(table[i].offset - written));
+                output.write(static_cast<const char*>(sections[i].data), static_cast<std::streamsize>(sections[i].size));
+                written = table[i].offset + table[i].size;
+            }
+
+            // Closing flushes, so a full disk may only show up here. A failed write leaves nothing behind, every attempt
+            // gets a new temporary name and would otherwise pile up next to the source
+            output.close();
+            if (!output) {
+                std::error_code error;
+                std::filesystem::remove(temporaryPath, error);
+                return false;
+            }
+        }
+
+        std::error_code error;
+        std::filesystem::rename(temporaryPath, cachePath, error);
+        if (error) {
+            std::filesystem::remove(temporaryPath, error);
+            return false;
+        }
+
+        return true;
+    }
+};
\ No newline at end of file
@@ -0,0 +1,376 @@
+#include "./engine/3d/meshCodec.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define JCAT_CODEC_SSE
+#endif
+
+namespace JCAT {
+    using Vertex3D = JCATModel3D::Vertex3D;
+
+    // Channel order of the vertex stream
+    enum VertexChannel : uint32_t {
+        CHANNEL_POSITION = 0,
+        CHANNEL_NORMAL = 3,
+        CHANNEL_UV = 5,
+        CHANNEL_COLOR = 7
+    };
+
+    // VertexStreamHeader::reserved bits
+    static constexpr uint32_t STREAM_ZERO_NORMALS = 1 << 0; ///< Every normal was zero (a model without any), decoded as zero instead of a unit vector
+
+    static constexpr uint32_t MODE_BYTES = 3; ///< 2 bits for each of the 10 channels
+    static constexpr size_t MODE_PAYLOAD_SIZE[4] = { 0, MeshCodec::BLOCK_VERTICES / 2, MeshCodec::BLOCK_VERTICES, MeshCodec::BLOCK_VERTICES * 2 };
+
+    static uint16_t zigzag16(uint16_t delta) {
+        return static_cast<uint16_t>((delta << 1) ^ static_cast<uint16_t>(static_cast<int16_t>(delta) >> 15));
+    }
+
+#if !defined(JCAT_CODEC_SSE)
+    static uint16_t unzigzag16(uint16_t value) {
+        return static_cast<uint16_t>((value >> 1) ^ static_cast<uint16_t>(-(value & 1)));
+    }
+#endif
+
+    static uint32_t zigzag32(uint32_t delta) {
+        return (delta << 1) ^ static_cast<uint32_t>(static_cast<int32_t>(delta) >> 31);
+    }
+
+    // Maps a unit vector onto the octahedron and unfolds the lower half over the upper one, both components in [-1, 1]
+    static glm::vec2 encodeOctahedral(const glm::vec3& normal) {
+        const float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+        if (length == 0.0f) {
+            return glm::vec2{ 0.0f };
+        }
+
+        glm::vec2 result{ normal.x / length, normal.y / length };
+        if (normal.z < 0.0f) {
+            result = glm::vec2{ (1.0f - std::abs(result.y)) * (result.x >= 0.0f ? 1.0f : -1.0f), (1.0f - std::abs(result.x)) * (result.y >= 0.0f ? 1.0f : -1.0f) };
+        }
+
+        return result;
+    }
+
+    void MeshCodec::encodeVertices(const Vertex3D* vertices, size_t vertexCount, std::vector<uint8_t>& encoded) {
+        // Every channel as floats first, so the range and quantization loops below treat them the same
+        std::vector<float> channels(CHANNEL_COUNT * vertexCount);
+        bool zeroNormals = true;
+
+        for (size_t i = 0; i < vertexCount; i++) {
+            const Vertex3D& vertex = vertices[i];
+            const glm::vec2 octahedral = encodeOctahedral(vertex.normal);
+            zeroNormals = zeroNormals && vertex.normal == glm::vec3{ 0.0f };
+
+            const float values[CHANNEL_COUNT] = { vertex.position.x, vertex.position.y, vertex.position.z, octahedral.x, octahedral.y,
+                                                  vertex.uv.x, vertex.uv.y, vertex.color.x, vertex.color.y, vertex.color.z };
+            for (uint32_t c = 0; c < CHANNEL_COUNT; c++) {
+                channels[c * vertexCount + i] = values[c];
+            }
+        }
+
+        VertexStreamHeader header{};
+        header.vertexCount = static_cast<uint32_t>(vertexCount);
+        header.reserved = zeroNormals ? STREAM_ZERO_NORMALS : 0;
+
+        std::vector<uint16_t> quantized(CHANNEL_COUNT * vertexCount);
+        for (uint32_t c = 0; c < CHANNEL_COUNT; c++) {
+            const float* values = channels.data() + c * vertexCount;
+
+            // Normals always span the whole octahedron, the other channels only the range the mesh uses
+            float minimum = -1.0f;
+            float maximum = 1.0f;
+            if (c != CHANNEL_NORMAL && c != CHANNEL_NORMAL + 1 && vertexCount > 0) {
+                std::pair<const float*, const float*> range = std::minmax_element(values, values + vertexCount);
+                minimum = *range.first;
+                maximum = *range.second;
+            }
+
+            const float extent = maximum - minimum;
+            header.offset[c] = minimum;
+            header.scale[c] = extent / 65535.0f;
+
+            const float toQuantized = extent > 0.0f ? 65535.0f / extent : 0.0f;
+            for (size_t i = 0; i < vertexCount; i++) {
+                const float scaled = (values[i] - minimum) * toQuantized + 0.5f;
+                quantized[c * vertexCount + i] = static_cast<uint16_t>(std::min(std::max(scaled, 0.0f), 65535.0f));
+            }
+        }
+
+        encoded.resize(sizeof(VertexStreamHeader));
+        std::memcpy(encoded.data(), &header, sizeof(VertexStreamHeader));
+
+        // Deltas run across blocks, the first vertex of a block is relative to the last one of the previous block
+        uint16_t previous[CHANNEL_COUNT] = {};
+
+        for (size_t first = 0; first < vertexCount; first += BLOCK_VERTICES) {
+            const size_t count = std::min<size_t>(BLOCK_VERTICES, vertexCount - first);
+
+            // A partial last block is padded with zero deltas, which the decoder skips after prefix summing
+            uint16_t deltas[CHANNEL_COUNT][BLOCK_VERTICES] = {};
+            uint32_t modes = 0;
+
+            for (uint32_t c = 0; c < CHANNEL_COUNT; c++) {
+                uint16_t largest = 0;
+                for (size_t i = 0; i < count; i++) {
+                    const uint16_t value = quantized[c * vertexCount + first + i];
+                    deltas[c][i] = zigzag16(static_cast<uint16_t>(value - previous[c]));
+                    previous[c] = value;
+                    largest = std::max(largest, deltas[c][i]);
+                }
+
+                const uint32_t mode = largest == 0 ? 0 : largest < 16 ? 1 : largest < 256 ? 2 : 3;
+                modes |= mode << (2 * c);
+            }
+
+            for (uint32_t b = 0; b < MODE_BYTES; b++) {
+                encoded.push_back(static_cast<uint8_t>(modes >> (8 * b)));
+            }
+
+            for (uint32_t c = 0; c < CHANNEL_COUNT; c++) {
+                switch ((modes >> (2 * c)) & 3) {
+                    case 1:
+                        for (uint32_t i = 0; i < BLOCK_VERTICES; i += 2) {
+                            encoded.push_back(static_cast<uint8_t>(deltas[c][i] | (deltas[c][i + 1] << 4)));
+                        }
+                        break;
+                    case 2:
+                        for (uint32_t i = 0; i < BLOCK_VERTICES; i++) {
+                            encoded.push_back(static_cast<uint8_t>(deltas[c][i]));
+                        }
+                        break;
+                    case 3:
+                        for (uint32_t i = 0; i < BLOCK_VERTICES; i++) {
+                            encoded.push_back(static_cast<uint8_t>(deltas[c][i]));
+                            encoded.push_back(static_cast<uint8_t>(deltas[c][i] >> 8));
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    void MeshCodec::encodeIndices(const uint32_t* indices, size_t indexCount, std::vector<uint8_t>& encoded) {
+        encoded.clear();
+        encoded.reserve(indexCount * 2);
+
+        uint32_t previous = 0;
+        for (size_t i = 0; i < indexCount; i++) {
+            uint32_t value = zigzag32(indices[i] - previous);
+            previous = indices[i];
+
+            while (value >= 0x80) {
+                encoded.push_back(static_cast<uint8_t>(value | 0x80));
+                value >>= 7;
+            }
+            encoded.push_back(static_cast<uint8_t>(value));
+        }
+    }
+
+    void MeshCodec::decodeBlock(const uint8_t*& data, uint16_t (&lanes)[CHANNEL_COUNT][BLOCK_VERTICES], uint16_t (&previous)[CHANNEL_COUNT]) {
+        const uint32_t modes = data[0] | (data[1] << 8) | (data[2] << 16);
+        data += MODE_BYTES;
+
+        for (uint32_t c = 0; c < CHANNEL_COUNT; c++) {
+            const uint32_t mode = (modes >> (2 * c)) & 3;
+
+#if defined(JCAT_CODEC_SSE)
+            const __m128i zero = _mm_setzero_si128();
+            __m128i low = zero;
+            __m128i high = zero;
+
+            if (mode == 1) {
+                // Low nibble first: interleaving the two nibble vectors puts them back in vertex order
+                const __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(data));
+                const __m128i nibbleMask = _mm_set1_epi8(0x0F);
+                const __m128i nibbles = _mm_unpacklo_epi8(_mm_and_si128(bytes, nibbleMask), _mm_and_si128(_mm_srli_epi16(bytes, 4), nibbleMask));
+                low = _mm_unpacklo_epi8(nibbles, zero);
+                high = _mm_unpackhi_epi8(nibbles, zero);
+            }
+            else if (mode == 2) {
+                const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+                low = _mm_unpacklo_epi8(bytes, zero);
+                high = _mm_unpackhi_epi8(bytes, zero);
+            }
+            else if (mode == 3) {
+                low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+                high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16));
+            }
+            data += MODE_PAYLOAD_SIZE[mode];
+
+            // Undo the zigzag, then an inclusive prefix sum in three shifted adds, carrying in the previous vertex's value
+            const __m128i one = _mm_set1_epi16(1);
+            __m128i* halves[2] = { &low, &high };
+            for (__m128i* half : halves) {
+                __m128i value = _mm_xor_si128(_mm_srli_epi16(*half, 1), _mm_sub_epi16(zero, _mm_and_si128(*half, one)));
+                value = _mm_add_epi16(value, _mm_slli_si128(value, 2));
+                value = _mm_add_epi16(value, _mm_slli_si128(value, 4));
+                value = _mm_add_epi16(value, _mm_slli_si128(value, 8));
+                value = _mm_add_epi16(value, _mm_set1_epi16(static_cast<short>(previous[c])));
+                previous[c] = static_cast<uint16_t>(_mm_extract_epi16(value, 7));
+                *half = value;
+            }
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&lanes[c][0]), low);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&lanes[c][8]), high);
+#else
+            uint16_t deltas[BLOCK_VERTICES] = {};
+            for (uint32_t i = 0; i < BLOCK_VERTICES; i++) {
+                if (mode == 1) {
+                    deltas[i] = (data[i / 2] >> (4 * (i & 1))) & 0x0F;
+                }
+                else if (mode == 2) {
+                    deltas[i] = data[i];
+                }
+                else if (mode == 3) {
+                    deltas[i] = static_cast<uint16_t>(data[2 * i] | (data[2 * i + 1] << 8));
+                }
+            }
+            data += MODE_PAYLOAD_SIZE[mode];
+
+            for (uint32_t i = 0; i < BLOCK_VERTICES; i++) {
+                previous[c] = static_cast<uint16_t>(previous[c] + unzigzag16(deltas[i]));
+                lanes[c][i] = previous[c];
+            }
+#endif
+        }
+    }
+
+    void MeshCodec::dequantizeBlock(const VertexStreamHeader& header, const uint16_t (&lanes)[CHANNEL_COUNT][BLOCK_VERTICES], Vertex3D* vertices, size_t count) {
+        alignas(16) float values[CHANNEL_COUNT][BLOCK_VERTICES];
+        alignas(16) float normalZ[BLOCK_VERTICES];
+        const bool zeroNormals = (header.reserved & STREAM_ZERO_NORMALS) != 0;
+
+#if defined(JCAT_CODEC_SSE)
+        const __m128i zero = _mm_setzero_si128();
+        for (uint32_t c = 0; c < CHANNEL_COUNT; c++) {
+            const __m128 offset = _mm_set1_ps(header.offset[c]);
+            const __m128 scale = _mm_set1_ps(header.scale[c]);
+
+            for (uint32_t i = 0; i < BLOCK_VERTICES; i += 8) {
+                const __m128i quantized = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&lanes[c][i]));
+                const __m128 low = _mm_cvtepi32_ps(_mm_unpacklo_epi16(quantized, zero));
+                const __m128 high = _mm_cvtepi32_ps(_mm_unpackhi_epi16(quantized, zero));
+                _mm_store_ps(&values[c][i], _mm_add_ps(offset, _mm_mul_ps(low, scale)));
+                _mm_store_ps(&values[c][i + 4], _mm_add_ps(offset, _mm_mul_ps(high, scale)));
+            }
+        }
+
+        // Octahedral unfold: z = 1 - |x| - |y|, where z < 0 x and y move towards the edge by -z, then normalize
+        const __m128 signMask = _mm_set1_ps(-0.0f);
+        for (uint32_t i = 0; i < BLOCK_VERTICES && !zeroNormals; i += 4) {
+            __m128 x = _mm_load_ps(&values[CHANNEL_NORMAL][i]);
+            __m128 y = _mm_load_ps(&values[CHANNEL_NORMAL + 1][i]);
+            const __m128 z = _mm_sub_ps(_mm_sub_ps(_mm_set1_ps(1.0f), _mm_andnot_ps(signMask, x)), _mm_andnot_ps(signMask, y));
+            const __m128 fold = _mm_max_ps(_mm_sub_ps(_mm_setzero_ps(), z), _mm_setzero_ps());
+            x = _mm_sub_ps(x, _mm_or_ps(fold, _mm_and_ps(x, signMask)));
+            y = _mm_sub_ps(y, _mm_or_ps(fold, _mm_and_ps(y, signMask)));
+
+            const __m128 inverseLength = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z))));
+            _mm_store_ps(&values[CHANNEL_NORMAL][i], _mm_mul_ps(x, inverseLength));
+            _mm_store_ps(&values[CHANNEL_NORMAL + 1][i], _mm_mul_ps(y, inverseLength));
+            _mm_store_ps(&normalZ[i], _mm_mul_ps(z, inverseLength));
+        }
+#else
+        for (uint32_t c = 0; c < CHANNEL_COUNT; c++) {
+            for (uint32_t i = 0; i < BLOCK_VERTICES; i++) {
+                values[c][i] = header.offset[c] + static_cast<float>(lanes[c][i]) * header.scale[c];
+            }
+        }
+
+        for (uint32_t i = 0; i < BLOCK_VERTICES && !zeroNormals; i++) {
+            float x = values[CHANNEL_NORMAL][i];
+            float y = values[CHANNEL_NORMAL + 1][i];
+            const float z = 1.0f - std::abs(x) - std::abs(y);
+            const float fold = std::max(-z, 0.0f);
+            x -= std::copysign(fold, x);
+            y -= std::copysign(fold, y);
+
+            const float inverseLength = 1.0f / std::sqrt(x * x + y * y + z * z);
+            values[CHANNEL_NORMAL][i] = x * inverseLength;
+            values[CHANNEL_NORMAL + 1][i] = y * inverseLength;
+            normalZ[i] = z * inverseLength;
+        }
+#endif
+
+        for (size_t i = 0; i < count; i++) {
+            Vertex3D& vertex = vertices[i];
+            vertex.position = glm::vec3{ values[CHANNEL_POSITION][i], values[CHANNEL_POSITION + 1][i], values[CHANNEL_POSITION + 2][i] };
+            vertex.color = glm::vec3{ values[CHANNEL_COLOR][i], values[CHANNEL_COLOR + 1][i], values[CHANNEL_COLOR + 2][i] };
+            vertex.normal = zeroNormals ? glm::vec3{ 0.0f } : glm::vec3{ values[CHANNEL_NORMAL][i], values[CHANNEL_NORMAL + 1][i], normalZ[i] };
+            vertex.uv = glm::vec2{ values[CHANNEL_UV][i], values[CHANNEL_UV + 1][i] };
+        }
+    }
+
+    bool MeshCodec::decodeVertices(const uint8_t* encoded, size_t encodedSize, Vertex3D* vertices, size_t vertexCount) {
+        if (encodedSize < sizeof(VertexStreamHeader)) {
+            return false;
+        }
+
+        VertexStreamHeader header;
+        std::memcpy(&header, encoded, sizeof(VertexStreamHeader));
+        if (header.vertexCount != vertexCount) {
+            return false;
+        }
+
+        const uint8_t* data = encoded + sizeof(VertexStreamHeader);
+        const uint8_t* end = encoded + encodedSize;
+
+        alignas(16) uint16_t lanes[CHANNEL_COUNT][BLOCK_VERTICES];
+        uint16_t previous[CHANNEL_COUNT] = {};
+
+        for (size_t first = 0; first < vertexCount; first += BLOCK_VERTICES) {
+            // The whole block has to be in bounds before decodeBlock reads any of it
+            if (static_cast<size_t>(end - data) < MODE_BYTES) {
+                return false;
+            }
+
+            const uint32_t modes = data[0] | (data[1] << 8) | (data[2] << 16);
+            size_t blockSize = MODE_BYTES;
+            for (uint32_t c = 0; c < CHANNEL_COUNT; c++) {
+                blockSize += MODE_PAYLOAD_SIZE[(modes >> (2 * c)) & 3];
+            }
+
+            if (static_cast<size_t>(end - data) < blockSize) {
+                return false;
+            }
+
+            decodeBlock(data, lanes, previous);
+            dequantizeBlock(header, lanes, vertices + first, std::min<size_t>(BLOCK_VERTICES, vertexCount - first));
+        }
+
+        return data == end;
+    }
+
+    bool MeshCodec::decodeIndices(const uint8_t* encoded, size_t encodedSize, uint32_t* indices, size_t indexCount) {
+        const uint8_t* data = encoded;
+        const uint8_t* end = encoded + encodedSize;
+        uint32_t previous = 0;
+
+        for (size_t i = 0; i < indexCount; i++) {
+            uint32_t value = 0;
+            uint32_t shift = 0;
+            uint8_t byte = 0;
+
+            do {
+                if (data == end || shift > 28) {
+                    return false;
+                }
+
+                byte = *data++;
+                value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+                shift += 7;
+            } while (byte & 0x80);
+
+            previous += (value >> 1) ^ static_cast<uint32_t>(-static_cast<int32_t>(value & 1));
+            indices[i] = previous;
+        }
+
+        return data == end;
+    }
+};
\ No newline at end of file
@@ -0,0 +1,344 @@
+#include "./engine/3d/meshOptimizer.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace JCAT {
+    VertexCacheStats MeshOptimizer::analyzeVertexCache(const uint32_t* indices, size_t indexCount, size_t vertexCount, uint32_t cacheSize) {
+        VertexCacheStats stats{};
+        if (indexCount < 3) {
+            return stats;
+        }
+
+        // A vertex is still cached while fewer than cacheSize misses have happened since it was inserted
+        std::vector<uint32_t> cacheTime(vertexCount, 0);
+        std::vector<bool> referenced(vertexCount, false);
+        uint32_t time = cacheSize + 1;
+        size_t misses = 0;
+        size_t referencedCount = 0;
+
+        for (size_t i = 0; i < indexCount; i++) {
+            uint32_t vertex = indices[i];
+
+            if (time - cacheTime[vertex] > cacheSize) {
+                cacheTime[vertex] = time++;
+                misses++;
+            }
+
+            if (!referenced[vertex]) {
+                referenced[vertex] = true;
+                referencedCount++;
+            }
+        }
+
+        stats.acmr = static_cast<float>(misses) / static_cast<float>(indexCount / 3);
+        stats.atvr = static_cast<float>(misses) / static_cast<float>(referencedCount);
+
+        return stats;
+    }
+
+    void MeshOptimizer::optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize, std::vector<uint32_t>* clusterStarts) {
+        const size_t triangleCount = indices.size() / 3;
+        if (clusterStarts != nullptr) {
+            clusterStarts->clear();
+        }
+
+        if (triangleCount == 0) {
+            return;
+        }
+
+        // Vertex -> triangle adjacency in one flat array, liveCounts tracks how many unemitted triangles use each vertex
+        std::vector<uint32_t> liveCounts(vertexCount, 0);
+        for (uint32_t vertex : indices) {
+            liveCounts[vertex]++;
+        }
+
+        std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+        for (size_t vertex = 0; vertex < vertexCount; vertex++) {
+            adjacencyOffsets[vertex + 1] = adjacencyOffsets[vertex] + liveCounts[vertex];
+        }
+
+        std::vector<uint32_t> adjacency(indices.size());
+        std::vector<uint32_t> fillCursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); i++) {
+            adjacency[fillCursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        std::vector<uint32_t> cacheTime(vertexCount, 0);
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<uint32_t> deadEndStack;
+        std::vector<uint32_t> candidates;
+        std::vector<uint32_t> output;
+        output.reserve(indices.size());
+
+        uint32_t time = cacheSize + 1;
+        size_t scanCursor = 0;
+
+        // When the walk runs out of warm candidates: try recently used vertices, then the next unfinished vertex in order
+        auto skipDeadEnd = [&]() -> int64_t {
+            while (!deadEndStack.empty()) {
+                uint32_t vertex = deadEndStack.back();
+                deadEndStack.pop_back();
+
+                if (liveCounts[vertex] > 0) {
+                    return vertex;
+                }
+            }
+
+            while (scanCursor < vertexCount) {
+                if (liveCounts[scanCursor] > 0) {
+                    return static_cast<int64_t>(scanCursor);
+                }
+
+                scanCursor++;
+            }
+
+            return -1;
+        };
+
+        int64_t fanningVertex = skipDeadEnd();
+        if (clusterStarts != nullptr) {
+            clusterStarts->push_back(0);
+        }
+
+        while (fanningVertex >= 0) {
+            candidates.clear();
+
+            // Emit every remaining triangle around the fanning vertex
+            for (uint32_t a = adjacencyOffsets[fanningVertex]; a < adjacencyOffsets[fanningVertex + 1]; a++) {
+                uint32_t triangle = adjacency[a];
+                if (emitted[triangle]) {
+                    continue;
+                }
+
+                for (uint32_t corner = 0; corner < 3; corner++) {
+                    uint32_t vertex = indices[triangle * 3 + corner];
+
+                    output.push_back(vertex);
+                    deadEndStack.push_back(vertex);
+                    candidates.push_back(vertex);
+                    liveCounts[vertex]--;
+
+                    if (time - cacheTime[vertex] > cacheSize) {
+                        cacheTime[vertex] = time++;
+                    }
+                }
+
+                emitted[triangle] = true;
+            }
+
+            // Prefer the candidate that has been in the cache longest but will still be there after fanning it
+            int64_t nextVertex = -1;
+            int64_t bestPriority = -1;
+            for (uint32_t vertex : candidates) {
+                if (liveCounts[vertex] == 0) {
+                    continue;
+                }
+
+                int64_t priority = 0;
+                if (time - cacheTime[vertex] + 2 * liveCounts[vertex] <= cacheSize) {
+                    priority = time - cacheTime[vertex];
+                }
+
+                if (priority > bestPriority) {
+                    bestPriority = priority;
+                    nextVertex = vertex;
+                }
+            }
+
+            if (nextVertex < 0) {
+                nextVertex = skipDeadEnd();
+
+                // Jumping to a vertex that has already left the cache means the walk starts over cold,
+                // which is where overdraw clusters may be cut without costing extra misses
+                const bool coldJump = nextVertex >= 0 && time - cacheTime[nextVertex] > cacheSize;
+                if (coldJump && clusterStarts != nullptr && clusterStarts->back() != output.size() / 3) {
+                    clusterStarts->push_back(static_cast<uint32_t>(output.size() / 3));
+                }
+            }
+
+            fanningVertex = nextVertex;
+        }
+
+        indices.swap(output);
+    }
+
+    size_t MeshOptimizer::optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<JCATModel3D::Vertex3D>& vertices, const std::vector<uint32_t>& clusterStarts, uint32_t cacheSize, float threshold) {
+        const size_t triangleCount = indices.size() / 3;
+        if (triangleCount == 0 || clusterStarts.empty()) {
+            return 0;
+        }
+
+        // Cut where Tipsify jumped to a cold vertex, or where a cluster started from a cold cache has already
+        // reached the target ACMR (Sander et al.'s soft boundaries). Clusters are kept at a minimum size so
+        // the misses paid when a reordered cluster starts cold stay small next to its triangle count.
+        const float targetAcmr = analyzeVertexCache(indices.data(), indices.size(), vertices.size(), cacheSize).acmr * threshold;
+        const uint32_t minClusterTriangles = cacheSize * MIN_CLUSTER_SIZE_FACTOR;
+
+        std::vector<uint32_t> softStarts{ 0 };
+        std::vector<uint32_t> cacheTime(vertices.size(), 0);
+        uint32_t time = cacheSize + 1;
+        size_t clusterMisses = 0;
+        size_t nextHard = 1;
+
+        for (uint32_t triangle = 0; triangle < triangleCount; triangle++) {
+            const uint32_t clusterTriangles = triangle - softStarts.back();
+            const bool hardBoundary = nextHard < clusterStarts.size() && clusterStarts[nextHard] == triangle;
+            if (hardBoundary) {
+                nextHard++;
+            }
+
+            const bool softBoundary = clusterTriangles > 0 && static_cast<float>(clusterMisses) / clusterTriangles <= targetAcmr;
+            if ((hardBoundary || softBoundary) && clusterTriangles >= minClusterTriangles && triangleCount - triangle >= minClusterTriangles) {
+                softStarts.push_back(triangle);
+                clusterMisses = 0;
+                time += cacheSize + 1; // Flush, the next cluster may be drawn after any other
+            }
+
+            for (uint32_t corner = 0; corner < 3; corner++) {
+                uint32_t vertex = indices[triangle * 3 + corner];
+                if (time - cacheTime[vertex] > cacheSize) {
+                    cacheTime[vertex] = time++;
+                    clusterMisses++;
+                }
+            }
+        }
+
+        // Area weighted centroid of the whole mesh, the reference point for "facing outwards"
+        glm::vec3 meshCentroid{ 0.0f };
+        float meshArea = 0.0f;
+
+        const size_t clusterCount = softStarts.size();
+        std::vector<glm::vec3> clusterCentroids(clusterCount, glm::vec3{ 0.0f });
+        std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3{ 0.0f });
+
+        for (size_t cluster = 0; cluster < clusterCount; cluster++) {
+            const uint32_t end = (cluster + 1 < clusterCount) ? softStarts[cluster + 1] : static_cast<uint32_t>(triangleCount);
+            float clusterArea = 0.0f;
+
+            for (uint32_t triangle = softStarts[cluster]; triangle < end; triangle++) {
+                const glm::vec3& a = vertices[indices[triangle * 3 + 0]].position;
+                const glm::vec3& b = vertices[indices[triangle * 3 + 1]].position;
+                const glm::vec3& c = vertices[indices[triangle * 3 + 2]].position;
+
+                // The cross product's length is twice the area, so summing it area weights the normal for free
+                glm::vec3 normal = glm::cross(b - a, c - a);
+                float area = glm::length(normal) * 0.5f;
+                glm::vec3 centroid = (a + b + c) / 3.0f;
+
+                clusterNormals[cluster] += normal;
+                clusterCentroids[cluster] += centroid * area;
+                clusterArea += area;
+
+                meshCentroid += centroid * area;
+                meshArea += area;
+            }
+
+            if (clusterArea > 0.0f) {
+                clusterCentroids[cluster] /= clusterArea;
+            }
+        }
+
+        if (meshArea > 0.0f) {
+            meshCentroid /= meshArea;
+        }
+
+        // Occlusion potential: clusters far out along their own normal tend to hide the rest of the mesh
+        std::vector<float> sortKeys(clusterCount, 0.0f);
+        for (size_t cluster = 0; cluster < clusterCount; cluster++) {
+            float normalLength = glm::length(clusterNormals[cluster]);
+            if (normalLength > 0.0f) {
+                sortKeys[cluster] = glm::dot(clusterCentroids[cluster] - meshCentroid, clusterNormals[cluster] / normalLength);
+            }
+        }
+
+        std::vector<uint32_t> order(clusterCount);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+        std::vector<uint32_t> output;
+        output.reserve(indices.size());
+        for (uint32_t cluster : order) {
+            const uint32_t end = (cluster + 1 < clusterCount) ? softStarts[cluster + 1] : static_cast<uint32_t>(triangleCount);
+            output.insert(output.end(), indices.begin() + softStarts[cluster] * 3, indices.begin() + end * 3);
+        }
+
+        indices.swap(output);
+        return clusterCount;
+    }
+
+    void MeshOptimizer::optimizeVertexFetch(std::vector<JCATModel3D::Vertex3D>& vertices, std::vector<uint32_t>& indices) {
+        std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+        std::vector<JCATModel3D::Vertex3D> output;
+        output.reserve(vertices.size());
+
+        for (uint32_t& index : indices) {
+            if (remap[index] == UINT32_MAX) {
+                remap[index] = static_cast<uint32_t>(output.size());
+                output.push_back(vertices[index]);
+            }
+
+            index = remap[index];
+        }
+
+        vertices.swap(output);
+    }
+
+    MeshOptimizationReport MeshOptimizer::optimizeTriangleOrder(std::vector<uint32_t>& indices, const std::vector<JCATModel3D::Vertex3D>& vertices, uint32_t cacheSize, float overdrawThreshold) {
+        MeshOptimizationReport report{};
+        report.before = analyzeVertexCache(indices.data(), indices.size(), vertices.size(), cacheSize);
+
+        // Some exporters already emit cache friendly strips, keep their order if Tipsify cannot beat it.
+        // The overdraw pass is then skipped too, since its cluster cuts come from the Tipsify walk.
+        std::vector<uint32_t> clusterStarts;
+        std::vector<uint32_t> reordered = indices;
+        optimizeVertexCache(reordered, vertices.size(), cacheSize, &clusterStarts);
+
+        const float reorderedAcmr = analyzeVertexCache(reordered.data(), reordered.size(), vertices.size(), cacheSize).acmr;
+        if (reorderedAcmr < report.before.acmr) {
+            indices = reordered;
+            report.clusterCount = optimizeOverdraw(indices, vertices, clusterStarts, cacheSize, overdrawThreshold);
+
+            // Cluster cuts only approximate cold caches, so check the sorted result and never end up worse than the input
+            const float sortedAcmr = analyzeVertexCache(indices.data(), indices.size(), vertices.size(), cacheSize).acmr;
+            if (sortedAcmr > reorderedAcmr * overdrawThreshold || sortedAcmr > report.before.acmr) {
+                indices.swap(reordered);
+                report.clusterCount = 0;
+            }
+        }
+
+        report.after = analyzeVertexCache(indices.data(), indices.size(), vertices.size(), cacheSize);
+
+        return report;
+    }
+
+    MeshOptimizationReport MeshOptimizer::optimize(JCATModel3D::ModelBuilder& builder, uint32_t cacheSize, float overdrawThreshold) {
+        MeshOptimizationReport report{};
+        if (builder.indices.size() < 3) {
+            return report;
+        }
+
+        if (builder.lods.empty()) {
+            report = optimizeTriangleOrder(builder.indices, builder.vertices, cacheSize, overdrawThreshold);
+        }
+        else {
+            // Every level is drawn on its own, so each gets its own triangle order
+            for (size_t lod = 0; lod < builder.lods.size(); lod++) {
+                const JCATModel3D::LodRange& range = builder.lods[lod];
+                std::vector<uint32_t> levelIndices(builder.indices.begin() + range.firstIndex, builder.indices.begin() + range.firstIndex + range.indexCount);
+
+                MeshOptimizationReport levelReport = optimizeTriangleOrder(levelIndices, builder.vertices, cacheSize, overdrawThreshold);
+                std::copy(levelIndices.begin(), levelIndices.end(), builder.indices.begin() + range.firstIndex);
+
+                if (lod == 0) {
+                    report = levelReport;
+                }
+            }
+        }
+
+        // Renumbering keeps every cache hit, so the report stays valid. With LODs the full detail level decides the order.
+        optimizeVertexFetch(builder.vertices, builder.indices);
+
+        return report;
+    }
+};
\ No newline at end of file
@@ -0,0 +1,466 @@
+#include "./engine/3d/meshSimplifier.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <numeric>
+#include <unordered_map>
+
+namespace JCAT {
+    static inline uint64_t edgeKey(uint32_t from, uint32_t to) {
+        return (static_cast<uint64_t>(from) << 32) | to;
+    }
+
+    void MeshSimplifier::Quadric::addPlane(const glm::vec3& normal, float distance, float planeWeight) {
+        const double x = normal.x, y = normal.y, z = normal.z, d = distance, w = planeWeight;
+
+        a2 += w * x * x;
+        b2 += w * y * y;
+        c2 += w * z * z;
+        ab += w * x * y;
+        ac += w * x * z;
+        bc += w * y * z;
+        ad += w * x * d;
+        bd += w * y * d;
+        cd += w * z * d;
+        d2 += w * d * d;
+        weight += w;
+    }
+
+    void MeshSimplifier::Quadric::add(const Quadric& other) {
+        a2 += other.a2;
+        b2 += other.b2;
+        c2 += other.c2;
+        ab += other.ab;
+        ac += other.ac;
+        bc += other.bc;
+        ad += other.ad;
+        bd += other.bd;
+        cd += other.cd;
+        d2 += other.d2;
+        weight += other.weight;
+    }
+
+    double MeshSimplifier::Quadric::error(const glm::vec3& point) const {
+        if (weight <= 0.0) {
+            return 0.0;
+        }
+
+        const double x = point.x, y = point.y, z = point.z;
+        const double sum = a2 * x * x + b2 * y * y + c2 * z * z + 2.0 * (ab * x * y + ac * x * z + bc * y * z + ad * x + bd * y + cd * z) + d2;
+
+        // Rounding can take an exact fit slightly below zero
+        return std::max(sum, 0.0) / weight;
+    }
+
+    void MeshSimplifier::classifyVertices(const std::vector<uint32_t>& indices, const std::vector<uint32_t>& positionIds, const std::vector<uint32_t>& wedgeNext, std::vector<VertexKind>& kinds, std::vector<uint32_t>& openNext, std::vector<uint32_t>& openPrevious) {
+        const size_t vertexCount = positionIds.size();
+        kinds.assign(vertexCount, VERTEX_LOCKED);
+        openNext.assign(vertexCount, UINT32_MAX);
+        openPrevious.assign(vertexCount, UINT32_MAX);
+
+        for (size_t vertex = 0; vertex < vertexCount; vertex++) {
+            if (wedgeNext[vertex] == vertex) {
+                kinds[vertex] = VERTEX_MANIFOLD;
+            }
+            else if (wedgeNext[wedgeNext[vertex]] == vertex) {
+                kinds[vertex] = VERTEX_SEAM;
+            }
+        }
+
+        // Directed edges between positions tell borders apart, edges between vertices additionally find seams
+        std::unordered_map<uint64_t, uint32_t> positionEdges;
+        std::unordered_map<uint64_t, uint32_t> vertexEdges;
+        positionEdges.reserve(indices.size());
+        vertexEdges.reserve(indices.size());
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            for (uint32_t corner = 0; corner < 3; corner++) {
+                const uint32_t a = indices[i + corner];
+                const uint32_t b = indices[i + (corner + 1) % 3];
+                positionEdges[edgeKey(positionIds[a], positionIds[b])]++;
+                vertexEdges[edgeKey(a, b)]++;
+            }
+        }
+
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            for (uint32_t corner = 0; corner < 3; corner++) {
+                const uint32_t a = indices[i + corner];
+                const uint32_t b = indices[i + (corner + 1) % 3];
+
+                // The same directed edge twice means a non manifold fan or inconsistent winding, leave it alone
+                if (positionEdges[edgeKey(positionIds[a], positionIds[b])] > 1) {
+                    kinds[a] = VERTEX_LOCKED;
+                    kinds[b] = VERTEX_LOCKED;
+                    continue;
+                }
+
+                if (vertexEdges.find(edgeKey(b, a)) != vertexEdges.end()) {
+                    continue;
+                }
+
+                // Open between vertices, it is a border if it is open between positions too and a seam otherwise
+                const bool border = positionEdges.find(edgeKey(positionIds[b], positionIds[a])) == positionEdges.end();
+                const VertexKind expected = border ? VERTEX_BORDER : VERTEX_SEAM;
+
+                for (uint32_t vertex : { a, b }) {
+                    if (kinds[vertex] == VERTEX_MANIFOLD && border) {
+                        kinds[vertex] = VERTEX_BORDER;
+                    }
+                    else if (kinds[vertex] != expected) {
+                        kinds[vertex] = VERTEX_LOCKED;
+                    }
+                }
+
+                // A vertex where several open edges meet is a corner and stays put
+                if (openNext[a] != UINT32_MAX) {
+                    kinds[a] = VERTEX_LOCKED;
+                }
+
+                if (openPrevious[b] != UINT32_MAX) {
+                    kinds[b] = VERTEX_LOCKED;
+                }
+
+                openNext[a] = b;
+                openPrevious[b] = a;
+            }
+        }
+
+        // A seam vertex has to lie on the seam line from both sides, not just end it
+        for (size_t vertex = 0; vertex < vertexCount; vertex++) {
+            if (kinds[vertex] == VERTEX_SEAM && (openNext[vertex] == UINT32_MAX || openPrevious[vertex] == UINT32_MAX)) {
+                kinds[vertex] = VERTEX_LOCKED;
+            }
+        }
+    }
+
+    std::vector<uint32_t> MeshSimplifier::simplify(const std::vector<JCATModel3D::Vertex3D>& vertices, const std::vector<uint32_t>& indices, size_t targetIndexCount, float maxError, float* resultError) {
+        const size_t vertexCount = vertices.size();
+        if (resultError != nullptr) {
+            *resultError = 0.0f;
+        }
+
+        // Work in a unit sized box so maxError and the quadrics do not depend on the model's scale
+        glm::vec3 minimum{ FLT_MAX };
+        glm::vec3 maximum{ -FLT_MAX };
+        for (const JCATModel3D::Vertex3D& vertex : vertices) {
+            minimum = glm::min(minimum, vertex.position);
+            maximum = glm::max(maximum, vertex.position);
+        }
+
+        const glm::vec3 size = maximum - minimum;
+        const float extent = std::max(size.x, std::max(size.y, size.z));
+        const float scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+
+        std::vector<glm::vec3> positions(vertexCount);
+        for (size_t vertex = 0; vertex < vertexCount; vertex++) {
+            positions[vertex] = (vertices[vertex].position - minimum) * scale;
+        }
+
+        // Vertices split only by UV or normal share one position id, the first vertex found at that position
+        std::vector<uint32_t> order(vertexCount);
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            const glm::vec3& pa = vertices[a].position;
+            const glm::vec3& pb = vertices[b].position;
+            if (pa.x != pb.x) return pa.x < pb.x;
+            if (pa.y != pb.y) return pa.y < pb.y;
+            return pa.z < pb.z;
+        });
+
+        std::vector<uint32_t> positionIds(vertexCount);
+        std::vector<uint32_t> wedgeNext(vertexCount);
+        for (size_t first = 0; first < vertexCount;) {
+            size_t last = first + 1;
+            while (last < vertexCount && vertices[order[last]].position == vertices[order[first]].position) {
+                last++;
+            }
+
+            for (size_t i = first; i < last; i++) {
+                positionIds[order[i]] = order[first];
+                wedgeNext[order[i]] = order[i + 1 < last ? i + 1 : first];
+            }
+
+            first = last;
+        }
+
+        std::vector<uint32_t> result;
+        result.reserve(indices.size());
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            const uint32_t a = positionIds[indices[i + 0]];
+            const uint32_t b = positionIds[indices[i + 1]];
+            const uint32_t c = positionIds[indices[i + 2]];
+
+            if (a != b && b != c && a != c) {
+                result.insert(result.end(), indices.begin() + i, indices.begin() + i + 3);
+            }
+        }
+
+        std::vector<VertexKind> kinds;
+        std::vector<uint32_t> openNext;
+        std::vector<uint32_t> openPrevious;
+        classifyVertices(result, positionIds, wedgeNext, kinds, openNext, openPrevious);
+
+        // One quadric per position: the area weighted planes of every triangle touching it
+        std::vector<Quadric> quadrics(vertexCount);
+        for (size_t i = 0; i < result.size(); i += 3) {
+            const glm::vec3& p0 = positions[result[i + 0]];
+            const glm::vec3& p1 = positions[result[i + 1]];
+            const glm::vec3& p2 = positions[result[i + 2]];
+
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            const float length = glm::length(normal);
+            if (length <= 0.0f) {
+                continue;
+            }
+
+            normal /= length;
+            const float distance = -glm::dot(normal, p0);
+            for (uint32_t corner = 0; corner < 3; corner++) {
+                quadrics[positionIds[result[i + corner]]].addPlane(normal, distance, length * 0.5f);
+            }
+
+            // Border and seam edges also get a plane through the edge, perpendicular to the triangle, so the line cannot move sideways
+            for (uint32_t corner = 0; corner < 3; corner++) {
+                const uint32_t a = result[i + corner];
+                const uint32_t b = result[i + (corner + 1) % 3];
+                if (openNext[a] != b) {
+                    continue;
+                }
+
+                const glm::vec3 edge = positions[b] - positions[a];
+                glm::vec3 borderNormal = glm::cross(edge, normal);
+                const float borderLength = glm::length(borderNormal);
+                if (borderLength <= 0.0f) {
+                    continue;
+                }
+
+                borderNormal /= borderLength;
+                const float borderDistance = -glm::dot(borderNormal, positions[a]);
+                const float borderWeight = glm::dot(edge, edge) * BORDER_WEIGHT;
+                quadrics[positionIds[a]].addPlane(borderNormal, borderDistance, borderWeight);
+                quadrics[positionIds[b]].addPlane(borderNormal, borderDistance, borderWeight);
+            }
+        }
+
+        const double maxErrorSquared = static_cast<double>(maxError) * maxError;
+        double worstError = 0.0;
+
+        std::vector<uint32_t> adjacencyOffsets;
+        std::vector<uint32_t> adjacency;
+        std::vector<Collapse> collapses;
+        std::vector<uint32_t> collapseTargets(vertexCount);
+        std::vector<bool> touched;
+        std::vector<uint32_t> fromRing;
+        std::vector<uint32_t> toRing;
+
+        // Every position adjacent to vertex's position, through all of the vertices that share it
+        auto gatherRing = [&](uint32_t vertex, std::vector<uint32_t>& ring) {
+            ring.clear();
+            uint32_t wedge = vertex;
+            do {
+                for (uint32_t a = adjacencyOffsets[wedge]; a < adjacencyOffsets[wedge + 1]; a++) {
+                    for (uint32_t corner = 0; corner < 3; corner++) {
+                        const uint32_t neighbour = positionIds[result[adjacency[a] * 3 + corner]];
+                        if (neighbour != positionIds[vertex]) {
+                            ring.push_back(neighbour);
+                        }
+                    }
+                }
+
+                wedge = wedgeNext[wedge];
+            } while (wedge != vertex);
+
+            std::sort(ring.begin(), ring.end());
+            ring.erase(std::unique(ring.begin(), ring.end()), ring.end());
+        };
+
+        // No triangle around from may flip or fold over when from moves onto to
+        auto keepsOrientation = [&](uint32_t from, uint32_t to) {
+            for (uint32_t a = adjacencyOffsets[from]; a < adjacencyOffsets[from + 1]; a++) {
+                const uint32_t* triangle = &result[adjacency[a] * 3];
+                glm::vec3 before[3];
+                glm::vec3 after[3];
+                bool removed = false;
+
+                for (uint32_t corner = 0; corner < 3; corner++) {
+                    removed = removed || positionIds[triangle[corner]] == positionIds[to];
+                    before[corner] = positions[triangle[corner]];
+                    after[corner] = triangle[corner] == from ? positions[to] : before[corner];
+                }
+
+                if (removed) {
+                    continue;
+                }
+
+                const glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+                const glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+                if (glm::dot(normalBefore, normalAfter) <= 0.25f * glm::length(normalBefore) * glm::length(normalAfter)) {
+                    return false;
+                }
+            }
+
+            return true;
+        };
+
+        // Link condition: the edge's endpoints may only share the apexes of the triangles on the edge
+        auto keepsManifold = [&](const Collapse& collapse) {
+            gatherRing(collapse.from, fromRing);
+            gatherRing(collapse.to, toRing);
+
+            size_t sharedNeighbours = 0;
+            for (size_t f = 0, t = 0; f < fromRing.size() && t < toRing.size();) {
+                if (fromRing[f] < toRing[t]) {
+                    f++;
+                }
+                else if (toRing[t] < fromRing[f]) {
+                    t++;
+                }
+                else {
+                    sharedNeighbours++;
+                    f++;
+                    t++;
+                }
+            }
+
+            return sharedNeighbours <= (kinds[collapse.from] == VERTEX_BORDER ? 1u : 2u);
+        };
+
+        // The vertex on the other side of a seam has to follow along the same seam edge
+        auto findSeamTwin = [&](const Collapse& collapse, uint32_t& twinFrom, uint32_t& twinTo) {
+            twinFrom = wedgeNext[collapse.from];
+            if (kinds[twinFrom] != VERTEX_SEAM) {
+                return false;
+            }
+
+            for (uint32_t candidate : { openNext[twinFrom], openPrevious[twinFrom] }) {
+                if (positionIds[candidate] == positionIds[collapse.to]) {
+                    twinTo = candidate;
+                    return true;
+                }
+            }
+
+            return false;
+        };
+
+        // Each pass collapses the cheapest edges whose neighbourhoods do not overlap, then rebuilds the topology
+        while (result.size() > targetIndexCount) {
+            adjacencyOffsets.assign(vertexCount + 1, 0);
+            for (uint32_t vertex : result) {
+                adjacencyOffsets[vertex + 1]++;
+            }
+
+            for (size_t vertex = 0; vertex < vertexCount; vertex++) {
+                adjacencyOffsets[vertex + 1] += adjacencyOffsets[vertex];
+            }
+
+            adjacency.resize(result.size());
+            std::vector<uint32_t> fillCursor(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (size_t i = 0; i < result.size(); i++) {
+                adjacency[fillCursor[result[i]]++] = static_cast<uint32_t>(i / 3);
+            }
+
+            collapses.clear();
+            auto addCollapse = [&](uint32_t from, uint32_t to) {
+                if (kinds[from] == VERTEX_LOCKED) {
+                    return;
+                }
+
+                // Border and seam vertices only slide along their own line
+                if (kinds[from] != VERTEX_MANIFOLD && to != openNext[from] && to != openPrevious[from]) {
+                    return;
+                }
+
+                collapses.push_back({ from, to, static_cast<float>(quadrics[positionIds[from]].error(positions[to])) });
+            };
+
+            for (size_t i = 0; i < result.size(); i += 3) {
+                for (uint32_t corner = 0; corner < 3; corner++) {
+                    const uint32_t a = result[i + corner];
+                    const uint32_t b = result[i + (corner + 1) % 3];
+                    addCollapse(a, b);
+                    addCollapse(b, a);
+                }
+            }
+
+            std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) { return a.cost < b.cost; });
+
+            // A border collapse removes one triangle and any other two, stop once the target should be reached
+            const size_t trianglesToRemove = (result.size() - targetIndexCount + 2) / 3;
+            size_t trianglesRemoved = 0;
+            size_t collapseCount = 0;
+
+            std::iota(collapseTargets.begin(), collapseTargets.end(), 0);
+            touched.assign(vertexCount, false);
+
+            for (const Collapse& collapse : collapses) {
+                if (collapse.cost > maxErrorSquared || trianglesRemoved >= trianglesToRemove) {
+                    break;
+                }
+
+                if (touched[positionIds[collapse.from]] || touched[positionIds[collapse.to]]) {
+                    continue;
+                }
+
+                uint32_t twinFrom = UINT32_MAX;
+                uint32_t twinTo = UINT32_MAX;
+                if (kinds[collapse.from] == VERTEX_SEAM && !findSeamTwin(collapse, twinFrom, twinTo)) {
+                    continue;
+                }
+
+                if (!keepsManifold(collapse) || !keepsOrientation(collapse.from, collapse.to) || (twinFrom != UINT32_MAX && !keepsOrientation(twinFrom, twinTo))) {
+                    continue;
+                }
+
+                collapseTargets[collapse.from] = collapse.to;
+                if (twinFrom != UINT32_MAX) {
+                    collapseTargets[twinFrom] = twinTo;
+                }
+
+                quadrics[positionIds[collapse.to]].add(quadrics[positionIds[collapse.from]]);
+
+                // Freeze the whole one ring so later collapses in this pass see the triangles that were just checked
+                touched[positionIds[collapse.to]] = true;
+                uint32_t wedge = collapse.from;
+                do {
+                    for (uint32_t a = adjacencyOffsets[wedge]; a < adjacencyOffsets[wedge + 1]; a++) {
+                        for (uint32_t corner = 0; corner < 3; corner++) {
+                            touched[positionIds[result[adjacency[a] * 3 + corner]]] = true;
+                        }
+                    }
+
+                    wedge = wedgeNext[wedge];
+                } while (wedge != collapse.from);
+
+                trianglesRemoved += kinds[collapse.from] == VERTEX_BORDER ? 1 : 2;
+                worstError = std::max(worstError, static_cast<double>(collapse.cost));
+                collapseCount++;
+            }
+
+            if (collapseCount == 0) {
+                break;
+            }
+
+            size_t writeCursor = 0;
+            for (size_t i = 0; i < result.size(); i += 3) {
+                const uint32_t a = collapseTargets[result[i + 0]];
+                const uint32_t b = collapseTargets[result[i + 1]];
+                const uint32_t c = collapseTargets[result[i + 2]];
+
+                if (positionIds[a] != positionIds[b] && positionIds[b] != positionIds[c] && positionIds[a] != positionIds[c]) {
+                    result[writeCursor++] = a;
+                    result[writeCursor++] = b;
+                    result[writeCursor++] = c;
+                }
+            }
+
+            result.resize(writeCursor);
+            classifyVertices(result, positionIds, wedgeNext, kinds, openNext, openPrevious);
+        }
+
+        if (resultError != nullptr) {
+            *resultError = static_cast<float>(std::sqrt(worstError));
+        }
+
+        return result;
+    }
+};
\ No newline at end of file
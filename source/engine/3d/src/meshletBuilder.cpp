@@ -0,0 +1,276 @@
+#include "./engine/3d/meshletBuilder.h"
+#include "./engine/3d/bounds.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <numeric>
+
+namespace JCAT {
+    static inline bool positionLess(const glm::vec3& a, const glm::vec3& b) {
+        if (a.x != b.x) {
+            return a.x < b.x;
+        }
+        if (a.y != b.y) {
+            return a.y < b.y;
+        }
+        return a.z < b.z;
+    }
+
+    std::vector<uint32_t> MeshletBuilder::computePositionIds(const std::vector<JCATModel3D::Vertex3D>& vertices) {
+        std::vector<uint32_t> sortedVertices(vertices.size());
+        std::iota(sortedVertices.begin(), sortedVertices.end(), 0);
+        std::sort(sortedVertices.begin(), sortedVertices.end(), [&vertices](uint32_t a, uint32_t b) { return positionLess(vertices[a].position, vertices[b].position); });
+
+        std::vector<uint32_t> positionIds(vertices.size());
+        uint32_t positionId = 0;
+        for (size_t i = 0; i < sortedVertices.size(); i++) {
+            if (i > 0 && positionLess(vertices[sortedVertices[i - 1]].position, vertices[sortedVertices[i]].position)) {
+                positionId++;
+            }
+            positionIds[sortedVertices[i]] = positionId;
+        }
+
+        return positionIds;
+    }
+
+    bool MeshletBuilder::isClosed(const std::vector<uint32_t>& positionIds, const uint32_t* indices, size_t indexCount) {
+        std::vector<uint64_t> edges;
+        edges.reserve(indexCount);
+        for (size_t i = 0; i + 2 < indexCount; i += 3) {
+            for (uint32_t corner = 0; corner < 3; corner++) {
+                const uint32_t from = positionIds[indices[i + corner]];
+                const uint32_t to = positionIds[indices[i + (corner + 1) % 3]];
+                if (from != to) {
+                    edges.push_back((static_cast<uint64_t>(from) << 32) | to);
+                }
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+
+        for (uint64_t edge : edges) {
+            const uint64_t reverse = (edge << 32) | (edge >> 32);
+            if (!std::binary_search(edges.begin(), edges.end(), reverse)) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    void MeshletBuilder::computeBounds(JCATModel3D::Meshlet& meshlet, const std::vector<JCATModel3D::Vertex3D>& vertices, const std::vector<uint32_t>& meshletVertices,
+                                       const std::vector<glm::vec3>& triangleNormals, const std::vector<uint32_t>& meshletTriangles, bool allowCone) {
+        // Same sphere as JCAT::computeBounds(), centered on the box and reaching the furthest vertex
+        AABB box{};
+        for (uint32_t vertex : meshletVertices) {
+            box.expand(vertices[vertex].position);
+        }
+
+        float radiusSquared = 0.0f;
+        for (uint32_t vertex : meshletVertices) {
+            const glm::vec3 offset = vertices[vertex].position - box.center();
+            radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+        }
+
+        meshlet.center = box.center();
+        meshlet.radius = std::sqrt(radiusSquared);
+        meshlet.coneAxis = glm::vec3{ 0.0f };
+        meshlet.coneCutoff = 1.0f;
+
+        if (!allowCone) {
+            return;
+        }
+
+        glm::vec3 axis{ 0.0f };
+        for (uint32_t triangle : meshletTriangles) {
+            axis += triangleNormals[triangle];
+        }
+
+        const float axisLength = glm::length(axis);
+        if (axisLength < 1e-6f) {
+            return;
+        }
+        axis /= axisLength;
+
+        // Degenerate triangles have no normal and are never visible, so they do not widen the cone
+        float minDot = 1.0f;
+        for (uint32_t triangle : meshletTriangles) {
+            const glm::vec3& normal = triangleNormals[triangle];
+            if (normal != glm::vec3{ 0.0f }) {
+                minDot = std::min(minDot, glm::dot(normal, axis));
+            }
+        }
+
+        // Normals spread over a whole hemisphere or more, some triangle faces the viewer from every direction
+        if (minDot <= 0.0f) {
+            return;
+        }
+
+        meshlet.coneAxis = axis;
+        meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+    }
+
+    std::vector<JCATModel3D::Meshlet> MeshletBuilder::build(const std::vector<JCATModel3D::Vertex3D>& vertices, std::vector<uint32_t>& indices, uint32_t firstIndex, uint32_t indexCount) {
+        static_assert(MAX_VERTICES < UINT8_MAX, "local vertex slots are stored in a uint8_t");
+
+        std::vector<JCATModel3D::Meshlet> meshlets;
+        const uint32_t triangleCount = indexCount / 3;
+        if (triangleCount == 0) {
+            return meshlets;
+        }
+
+        const uint32_t* source = indices.data() + firstIndex;
+        const size_t vertexCount = vertices.size();
+
+        // Unit face normals, plus the signed volume the triangles enclose to find out which way they are wound
+        std::vector<glm::vec3> triangleNormals(triangleCount);
+        double signedVolume = 0.0;
+        for (uint32_t triangle = 0; triangle < triangleCount; triangle++) {
+            const glm::vec3& a = vertices[source[triangle * 3 + 0]].position;
+            const glm::vec3& b = vertices[source[triangle * 3 + 1]].position;
+            const glm::vec3& c = vertices[source[triangle * 3 + 2]].position;
+
+            const glm::vec3 normal = glm::cross(b - a, c - a);
+            const float length = glm::length(normal);
+            triangleNormals[triangle] = length > 0.0f ? normal / length : glm::vec3{ 0.0f };
+            signedVolume += glm::dot(a, glm::cross(b, c));
+        }
+
+        // Vertices split by a UV or normal seam (every vertex, on a flat shaded mesh) are still neighbours through their position
+        const std::vector<uint32_t> positionIds = computePositionIds(vertices);
+
+        // Cones have to point out of the mesh, a closed mesh wound the other way round encloses a negative volume
+        const bool allowCone = isClosed(positionIds, source, indexCount);
+        if (allowCone && signedVolume < 0.0) {
+            for (glm::vec3& normal : triangleNormals) {
+                normal = -normal;
+            }
+        }
+
+        // Triangles around each position, as ranges of one flat list
+        std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+        for (uint32_t i = 0; i < indexCount; i++) {
+            adjacencyOffsets[positionIds[source[i]] + 1]++;
+        }
+        std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+
+        std::vector<uint32_t> adjacency(indexCount);
+        std::vector<uint32_t> adjacencyFill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (uint32_t i = 0; i < indexCount; i++) {
+            adjacency[adjacencyFill[positionIds[source[i]]]++] = i / 3;
+        }
+
+        std::vector<bool> assigned(triangleCount, false);
+        std::vector<uint8_t> localVertex(vertexCount, UINT8_MAX);
+        std::vector<uint32_t> meshletVertices;
+        std::vector<uint32_t> meshletTriangles;
+        std::vector<uint32_t> candidates;
+        std::vector<uint32_t> triangleOrder;
+        triangleOrder.reserve(triangleCount);
+        uint32_t seed = 0;
+
+        while (triangleOrder.size() < triangleCount) {
+            // Seeding in index order keeps the meshlets roughly in the order the optimizer left the triangles
+            while (assigned[seed]) {
+                seed++;
+            }
+
+            glm::vec3 normalSum{ 0.0f };
+            uint32_t next = seed;
+
+            while (next != UINT32_MAX) {
+                assigned[next] = true;
+                meshletTriangles.push_back(next);
+                normalSum += triangleNormals[next];
+
+                for (uint32_t corner = 0; corner < 3; corner++) {
+                    const uint32_t vertex = source[next * 3 + corner];
+                    if (localVertex[vertex] != UINT8_MAX) {
+                        continue;
+                    }
+
+                    localVertex[vertex] = static_cast<uint8_t>(meshletVertices.size());
+                    meshletVertices.push_back(vertex);
+
+                    const uint32_t position = positionIds[vertex];
+                    candidates.insert(candidates.end(), adjacency.begin() + adjacencyOffsets[position], adjacency.begin() + adjacencyOffsets[position + 1]);
+                }
+
+                if (meshletTriangles.size() == MAX_TRIANGLES) {
+                    break;
+                }
+
+                const float normalLength = glm::length(normalSum);
+                const glm::vec3 axis = normalLength > 0.0f ? normalSum / normalLength : glm::vec3{ 0.0f };
+
+                // Pick the neighbouring triangle adding the fewest vertices, dropping assigned ones from the list on the way
+                next = UINT32_MAX;
+                float bestScore = FLT_MAX;
+                size_t kept = 0;
+
+                for (size_t i = 0; i < candidates.size(); i++) {
+                    const uint32_t triangle = candidates[i];
+                    if (assigned[triangle]) {
+                        continue;
+                    }
+                    candidates[kept++] = triangle;
+
+                    uint32_t newVertices = 0;
+                    for (uint32_t corner = 0; corner < 3; corner++) {
+                        newVertices += localVertex[source[triangle * 3 + corner]] == UINT8_MAX ? 1 : 0;
+                    }
+
+                    if (meshletVertices.size() + newVertices > MAX_VERTICES) {
+                        continue;
+                    }
+
+                    // Without a cone there is no facing to keep together, only the vertex count matters
+                    const glm::vec3& normal = triangleNormals[triangle];
+                    float facing = 1.0f;
+                    if (allowCone && normal != glm::vec3{ 0.0f } && normalLength > 0.0f) {
+                        facing = glm::dot(normal, axis);
+                        if (facing < MIN_CONE_DOT) {
+                            continue;
+                        }
+                    }
+
+                    const float score = static_cast<float>(newVertices) + CONE_WEIGHT * (1.0f - facing);
+                    if (score < bestScore) {
+                        bestScore = score;
+                        next = triangle;
+                    }
+                }
+
+                candidates.resize(kept);
+            }
+
+            // Back in their original relative order, which is what the vertex cache optimization tuned
+            std::sort(meshletTriangles.begin(), meshletTriangles.end());
+
+            JCATModel3D::Meshlet meshlet{};
+            meshlet.firstIndex = firstIndex + static_cast<uint32_t>(triangleOrder.size()) * 3;
+            meshlet.indexCount = static_cast<uint32_t>(meshletTriangles.size()) * 3;
+            computeBounds(meshlet, vertices, meshletVertices, triangleNormals, meshletTriangles, allowCone);
+            meshlets.push_back(meshlet);
+
+            triangleOrder.insert(triangleOrder.end(), meshletTriangles.begin(), meshletTriangles.end());
+
+            for (uint32_t vertex : meshletVertices) {
+                localVertex[vertex] = UINT8_MAX;
+            }
+            meshletVertices.clear();
+            meshletTriangles.clear();
+            candidates.clear();
+        }
+
+        std::vector<uint32_t> reordered(static_cast<size_t>(triangleCount) * 3);
+        for (size_t i = 0; i < triangleOrder.size(); i++) {
+            for (uint32_t corner = 0; corner < 3; corner++) {
+                reordered[i * 3 + corner] = source[triangleOrder[i] * 3 + corner];
+            }
+        }
+        std::copy(reordered.begin(), reordered.end(), indices.begin() + firstIndex);
+
+        return meshlets;
+    }
+};
\ No newline at end of file
@@ -1,34 +1,53 @@
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+
 #include "./engine/3D/model3d.h"
+#include "./engine/3d/modelLoader.h"
 
-#define TINYOBJLOADER_IMPLEMENTATION
-#include <tiny_obj_loader.h>
+namespace JCAT {
+    static_assert(sizeof(JCATModel3D::CompactVertex3D) == 20, "CompactVertex3D must stay tightly packed, the attribute offsets assume it");
+    static_assert(sizeof(glm::vec3) + sizeof(JCATModel3D::SplitVertex3D::Attributes) == sizeof(JCATModel3D::Vertex3D), "A SPLIT model's two streams take the space of one Vertex3D array");
+
+    // Every vertex format shares the per-instance binding, so the instanced shader variants use the same locations
+    static void appendInstanceBindingDescription(std::vector<VkVertexInputBindingDescription>& bindingDescriptions) {
+        VkVertexInputBindingDescription instanceBinding{};
+        instanceBinding.binding = JCATModel3D::INSTANCE_BINDING;
+        instanceBinding.stride = sizeof(JCATModel3D::InstanceData3D);
+        instanceBinding.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+        bindingDescriptions.push_back(instanceBinding);
+    }
 
-#define GLM_ENABLE_EXPERIMENTAL
-#include <gtx/hash.hpp>
+    static void appendInstanceAttributeDescriptions(std::vector<VkVertexInputAttributeDescription>& attributeDescriptions) {
+        // A mat4 attribute occupies four consecutive locations, one vec4 column each
+        for (uint32_t column = 0; column < 4; column++) {
+            attributeDescriptions.push_back({ 4 + column, JCATModel3D::INSTANCE_BINDING, VK_FORMAT_R32G32B32A32_SFLOAT, static_cast<uint32_t>(offsetof(JCATModel3D::InstanceData3D, modelMatrix) + column * sizeof(glm::vec4)) });
+        }
 
-namespace std {
-	template <>
-	struct hash<JCAT::JCATModel3D::Vertex3D> {
-		size_t operator()(JCAT::JCATModel3D::Vertex3D const& vertex) const {
-			size_t seed = 0;
-			JCAT::hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
-			return seed;
-		}
-	};
-}
+        for (uint32_t column = 0; column < 4; column++) {
+            attributeDescriptions.push_back({ 8 + column, JCATModel3D::INSTANCE_BINDING, VK_FORMAT_R32G32B32A32_SFLOAT, static_cast<uint32_t>(offsetof(JCATModel3D::InstanceData3D, normalMatrix) + column * sizeof(glm::vec4)) });
+        }
 
-namespace JCAT {
-    std::vector<VkVertexInputBindingDescription> JCATModel3D::Vertex3D::getBindingDescriptions() {
+        // hasLighting and hasTexture are packed together into a single uvec2
+        attributeDescriptions.push_back({ 12, JCATModel3D::INSTANCE_BINDING, VK_FORMAT_R32G32_UINT, offsetof(JCATModel3D::InstanceData3D, hasLighting) });
+    }
+
+    std::vector<VkVertexInputBindingDescription> JCATModel3D::Vertex3D::getBindingDescriptions(bool instanced) {
         std::vector<VkVertexInputBindingDescription> objectBindingDescriptions(1);
 
         objectBindingDescriptions[0].binding = 0;
         objectBindingDescriptions[0].stride = sizeof(Vertex3D);
         objectBindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
+        if (instanced) {
+            appendInstanceBindingDescription(objectBindingDescriptions);
+        }
+
         return objectBindingDescriptions;
     }
 
-    std::vector<VkVertexInputAttributeDescription> JCATModel3D::Vertex3D::getAttributeDescriptions() {
+    std::vector<VkVertexInputAttributeDescription> JCATModel3D::Vertex3D::getAttributeDescriptions(bool instanced) {
         // We need 2 attribute descriptions: one for color and one for vertices
         std::vector<VkVertexInputAttributeDescription> objectAttributeDescriptions{};
 
@@ -37,110 +56,268 @@ namespace JCAT {
         objectAttributeDescriptions.push_back({ 2, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex3D, normal) });
         objectAttributeDescriptions.push_back({ 3, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex3D, uv) });
 
+        if (instanced) {
+            appendInstanceAttributeDescriptions(objectAttributeDescriptions);
+        }
+
         return objectAttributeDescriptions;
     }
 
-    bool JCATModel3D::Vertex3D::operator==(const Vertex3D& other) const {
-        return position == other.position && color == other.color && normal == other.normal && uv == other.uv;
-    }
-
-    void JCATModel3D::ModelBuilder::loadModel(const std::string& filepath, bool hasIndexBuffer) {
-        tinyobj::attrib_t attrib;
-        std::vector<tinyobj::shape_t> shapes;
-        std::vector<tinyobj::material_t> materials;
-        std::string warning;
-        std::string error;
-
-        if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warning, &error, filepath.c_str())) {
-            throw std::runtime_error(warning + error);
-        }
-
-        vertices.clear();
-        indices.clear();
-
-        std::unordered_map<Vertex3D, uint32_t> uniqueVertices{};
-        for (const tinyobj::shape_t& shape : shapes) {
-            for (const tinyobj::index_t& index : shape.mesh.indices) {
-                Vertex3D vertex{};
-
-                if (index.vertex_index >= 0) {
-                    vertex.position = {
-                        attrib.vertices[3 * index.vertex_index + 0],
-                        attrib.vertices[3 * index.vertex_index + 1],
-                        attrib.vertices[3 * index.vertex_index + 2]
-                    };
-                    
-                    int colorIndex = 3 * index.vertex_index + 2;
-                    if (colorIndex < attrib.colors.size()) {
-                        vertex.color = {
-                            attrib.colors[colorIndex - 2],
-                            attrib.colors[colorIndex - 1],
-                            attrib.colors[colorIndex - 0],
-                        };
-                    }
-                    else {
-                        vertex.color = { 1.f, 1.f, 1.f };
-                    }
-                }
+    std::vector<VkVertexInputBindingDescription> JCATModel3D::CompactVertex3D::getBindingDescriptions(bool instanced) {
+        std::vector<VkVertexInputBindingDescription> objectBindingDescriptions(1);
 
-                if (index.normal_index >= 0) {
-                    vertex.normal = {
-                        attrib.normals[3 * index.normal_index + 0],
-                        attrib.normals[3 * index.normal_index + 1],
-                        attrib.normals[3 * index.normal_index + 2],
-                    };
-                }
+        objectBindingDescriptions[0].binding = 0;
+        objectBindingDescriptions[0].stride = sizeof(CompactVertex3D);
+        objectBindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
 
-                if (index.texcoord_index >= 0) {
-                    vertex.uv = {
-                        attrib.texcoords[2 * index.texcoord_index + 0],
-                        attrib.texcoords[2 * index.texcoord_index + 1]
-                    };
-                }
+        if (instanced) {
+            appendInstanceBindingDescription(objectBindingDescriptions);
+        }
 
-                if (!hasIndexBuffer) {
-                    vertices.push_back(vertex);
-                }
-                else {
-                    if (uniqueVertices.count(vertex) == 0) {
-                        uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-                        vertices.push_back(vertex);
-                    }
-                    
-                    indices.push_back(uniqueVertices[vertex]);
-                }
+        return objectBindingDescriptions;
+    }
+
+    std::vector<VkVertexInputAttributeDescription> JCATModel3D::CompactVertex3D::getAttributeDescriptions(bool instanced) {
+        // Same locations as Vertex3D, the normalized formats hand the shader floats so only the normal needs decoding
+        std::vector<VkVertexInputAttributeDescription> objectAttributeDescriptions{};
+
+        objectAttributeDescriptions.push_back({ 0, 0, VK_FORMAT_R16G16B16A16_UNORM, offsetof(CompactVertex3D, position) });
+        objectAttributeDescriptions.push_back({ 1, 0, VK_FORMAT_R8G8B8A8_UNORM, offsetof(CompactVertex3D, color) });
+        objectAttributeDescriptions.push_back({ 2, 0, VK_FORMAT_R16G16_SNORM, offsetof(CompactVertex3D, normal) });
+        objectAttributeDescriptions.push_back({ 3, 0, VK_FORMAT_R16G16_UNORM, offsetof(CompactVertex3D, uv) });
+
+        if (instanced) {
+            appendInstanceAttributeDescriptions(objectAttributeDescriptions);
+        }
+
+        return objectAttributeDescriptions;
+    }
+
+    std::vector<VkVertexInputBindingDescription> JCATModel3D::SplitVertex3D::getBindingDescriptions(bool instanced) {
+        std::vector<VkVertexInputBindingDescription> objectBindingDescriptions = getPositionBindingDescriptions(false);
+
+        VkVertexInputBindingDescription attributeBinding{};
+        attributeBinding.binding = 1;
+        attributeBinding.stride = sizeof(Attributes);
+        attributeBinding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+        objectBindingDescriptions.push_back(attributeBinding);
+
+        if (instanced) {
+            appendInstanceBindingDescription(objectBindingDescriptions);
+        }
+
+        return objectBindingDescriptions;
+    }
+
+    std::vector<VkVertexInputAttributeDescription> JCATModel3D::SplitVertex3D::getAttributeDescriptions(bool instanced) {
+        // Same locations as Vertex3D, only the bindings differ
+        std::vector<VkVertexInputAttributeDescription> objectAttributeDescriptions = getPositionAttributeDescriptions(false);
+
+        objectAttributeDescriptions.push_back({ 1, 1, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Attributes, color) });
+        objectAttributeDescriptions.push_back({ 2, 1, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Attributes, normal) });
+        objectAttributeDescriptions.push_back({ 3, 1, VK_FORMAT_R32G32_SFLOAT, offsetof(Attributes, uv) });
+
+        if (instanced) {
+            appendInstanceAttributeDescriptions(objectAttributeDescriptions);
+        }
+
+        return objectAttributeDescriptions;
+    }
+
+    std::vector<VkVertexInputBindingDescription> JCATModel3D::SplitVertex3D::getPositionBindingDescriptions(bool instanced) {
+        std::vector<VkVertexInputBindingDescription> objectBindingDescriptions(1);
+
+        objectBindingDescriptions[0].binding = 0;
+        objectBindingDescriptions[0].stride = sizeof(glm::vec3);
+        objectBindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+        if (instanced) {
+            appendInstanceBindingDescription(objectBindingDescriptions);
+        }
+
+        return objectBindingDescriptions;
+    }
+
+    std::vector<VkVertexInputAttributeDescription> JCATModel3D::SplitVertex3D::getPositionAttributeDescriptions(bool instanced) {
+        std::vector<VkVertexInputAttributeDescription> objectAttributeDescriptions{};
+
+        objectAttributeDescriptions.push_back({ 0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0 });
+
+        if (instanced) {
+            appendInstanceAttributeDescriptions(objectAttributeDescriptions);
+        }
+
+        return objectAttributeDescriptions;
+    }
+
+    static bool isUnitRange(float value) {
+        return value >= 0.0f && value <= 1.0f;
+    }
+
+    static uint16_t quantizeUnorm16(float value) {
+        return static_cast<uint16_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 65535.0f));
+    }
+
+    static int16_t quantizeSnorm16(float value) {
+        return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+    }
+
+    static uint8_t quantizeUnorm8(float value) {
+        return static_cast<uint8_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+    }
+
+    bool JCATModel3D::CompactVertex3D::canEncode(const Vertex3D* vertices, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            const Vertex3D& vertex = vertices[i];
+
+            if (!isUnitRange(vertex.uv.x) || !isUnitRange(vertex.uv.y) ||
+                !isUnitRange(vertex.color.x) || !isUnitRange(vertex.color.y) || !isUnitRange(vertex.color.z)) {
+                return false;
             }
         }
+
+        return true;
     }
 
-    JCATModel3D::JCATModel3D(DeviceSetup& d, ResourceManager& r, const std::vector<Vertex3D>& objectVertices) : device{d}, resourceManager{r} {
+    JCATModel3D::CompactVertex3D JCATModel3D::CompactVertex3D::encode(const Vertex3D& vertex, const AABB& bounds) {
+        CompactVertex3D compact{};
+
+        const glm::vec3 size = bounds.max - bounds.min;
+        for (int axis = 0; axis < 3; axis++) {
+            // A flat axis has nothing to quantize, every vertex sits at the minimum
+            float relative = size[axis] > 0.0f ? (vertex.position[axis] - bounds.min[axis]) / size[axis] : 0.0f;
+            compact.position[axis] = quantizeUnorm16(relative);
+        }
+        compact.position[3] = 0;
+
+        // Project onto the octahedron |x| + |y| + |z| = 1, then fold the lower half over the diagonals into the unit square
+        glm::vec3 normal = vertex.normal;
+        float manhattanLength = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+        glm::vec2 octahedral{ 0.0f };
+
+        if (manhattanLength > 0.0f) {
+            normal /= manhattanLength;
+            octahedral = glm::vec2{ normal.x, normal.y };
+
+            if (normal.z < 0.0f) {
+                octahedral.x = (1.0f - std::abs(normal.y)) * (normal.x >= 0.0f ? 1.0f : -1.0f);
+                octahedral.y = (1.0f - std::abs(normal.x)) * (normal.y >= 0.0f ? 1.0f : -1.0f);
+            }
+        }
+
+        compact.normal[0] = quantizeSnorm16(octahedral.x);
+        compact.normal[1] = quantizeSnorm16(octahedral.y);
+
+        compact.uv[0] = quantizeUnorm16(vertex.uv.x);
+        compact.uv[1] = quantizeUnorm16(vertex.uv.y);
+
+        compact.color[0] = quantizeUnorm8(vertex.color.x);
+        compact.color[1] = quantizeUnorm8(vertex.color.y);
+        compact.color[2] = quantizeUnorm8(vertex.color.z);
+        compact.color[3] = 255;
+
+        return compact;
+    }
+
+    bool JCATModel3D::Meshlet::isBackfacing(const glm::vec3& eye) const {
+        // Every triangle faces away once the view direction lies within the cone's complement, widened by the sphere
+        // so it holds from every point of the meshlet. A disabled cone (zero axis, cutoff 1) never passes.
+        const glm::vec3 toCenter = center - eye;
+        return glm::dot(toCenter, coneAxis) >= coneCutoff * glm::length(toCenter) + radius;
+    }
+
+    JCATModel3D::JCATModel3D(DeviceSetup& d, ResourceManager& r, const std::vector<Vertex3D>& objectVertices, VertexFormat preferredFormat) : device{d}, resourceManager{r} {
         hasIndexBuffer = false;
-        createVertexBuffers(objectVertices);
+        computeBounds(objectVertices.data(), objectVertices.size(), localAABB, localBoundingSphere);
+        createVertexBuffers(objectVertices.data(), static_cast<uint32_t>(objectVertices.size()), preferredFormat);
     }
 
-    JCATModel3D::JCATModel3D(DeviceSetup& d, ResourceManager& r, const JCATModel3D::ModelBuilder &builder) : device{d}, resourceManager{r} {
+    JCATModel3D::JCATModel3D(DeviceSetup& d, ResourceManager& r, const JCATModel3D::ModelBuilder &builder, VertexFormat preferredFormat) : device{d}, resourceManager{r} {
         hasIndexBuffer = true;
-        createVertexBuffers(builder.vertices);
-        createIndexBuffers(builder.indices);
+        computeBounds(builder.vertices.data(), builder.vertices.size(), localAABB, localBoundingSphere);
+        createIndexedBuffers(builder.vertices.data(), static_cast<uint32_t>(builder.vertices.size()), builder.indices.data(), static_cast<uint32_t>(builder.indices.size()),
+                             builder.lods.data(), static_cast<uint32_t>(builder.lods.size()), preferredFormat);
+        setMeshlets(builder.meshlets.data(), static_cast<uint32_t>(builder.meshlets.size()));
     }
 
-    JCATModel3D::~JCATModel3D() {}
+    JCATModel3D::JCATModel3D(DeviceSetup& d, ResourceManager& r, const Vertex3D* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, const AABB& bounds, const BoundingSphere& boundingSphere,
+                             const LodRange* lods, uint32_t lodCount, const Meshlet* meshlets, uint32_t meshletCount, VertexFormat preferredFormat) : device{d}, resourceManager{r} {
+        hasIndexBuffer = true;
+        localAABB = bounds;
+        localBoundingSphere = boundingSphere;
+        createIndexedBuffers(vertices, vertexCount, indices, indexCount, lods, lodCount, preferredFormat);
+        setMeshlets(meshlets, meshletCount);
+    }
 
-    std::unique_ptr<JCATModel3D> JCATModel3D::createModelFromFile(DeviceSetup& device, ResourceManager& resourceManager, const std::string& filepath, bool hasIndexBuffers) {
-        ModelBuilder builder{};
-        builder.loadModel(filepath, hasIndexBuffers);
+    JCATModel3D::~JCATModel3D() {
+        if (vertexRange.size > 0 || indexRange.size > 0) {
+            GeometryPool& pool = resourceManager.getGeometryPool();
+            pool.freeVertices(vertexRange);
+            pool.freeIndices(indexRange);
+        }
+
+        if (vertexBufferOld != VK_NULL_HANDLE) {
+            resourceManager.destroyBuffer(vertexBufferOld, vertexBufferOldMemory);
+        }
+        if (indexBufferOld != VK_NULL_HANDLE) {
+            resourceManager.destroyBuffer(indexBufferOld, indexBufferOldMemory);
+        }
+    }
 
-        return std::make_unique<JCATModel3D>(device, resourceManager, builder);
+    std::unique_ptr<JCATModel3D> JCATModel3D::createModelFromFile(DeviceSetup& device, ResourceManager& resourceManager, const std::string& filepath, bool hasIndexBuffers, bool optimizeMesh, VertexFormat preferredFormat, uint32_t lodLevels) {
+        PreparedModel prepared = ModelLoader::prepareModel(filepath, hasIndexBuffers, optimizeMesh, lodLevels);
+        return ModelLoader::uploadModel(device, resourceManager, prepared, preferredFormat);
     }
 
-    void JCATModel3D::createVertexBuffers(const std::vector<Vertex3D>& vertices) {
-        vertexCount = static_cast<uint32_t>(vertices.size());
+    void JCATModel3D::createVertexBuffers(const Vertex3D* vertices, uint32_t count, VertexFormat preferredFormat) {
+        if (preferredFormat == VertexFormat::COMPACT && CompactVertex3D::canEncode(vertices, count)) {
+            std::vector<CompactVertex3D> compactVertices(count);
+            for (uint32_t i = 0; i < count; i++) {
+                compactVertices[i] = CompactVertex3D::encode(vertices[i], localAABB);
+            }
+
+            // Unorm positions come out in [0, 1], scale by the box size and offset by its minimum to get back to model space
+            const glm::vec3 size = localAABB.max - localAABB.min;
+            dequantizeMatrix = glm::mat4{ 1.0f };
+            dequantizeMatrix[0][0] = size.x;
+            dequantizeMatrix[1][1] = size.y;
+            dequantizeMatrix[2][2] = size.z;
+            dequantizeMatrix[3] = glm::vec4{ localAABB.min, 1.0f };
+
+            vertexFormat = VertexFormat::COMPACT;
+            uploadVertexData(compactVertices.data(), sizeof(CompactVertex3D), count);
+            return;
+        }
+
+        if (preferredFormat == VertexFormat::SPLIT) {
+            // Both streams go into one allocation, the positions first, so the model still holds a single vertex range
+            std::vector<char> streams(static_cast<size_t>(count) * sizeof(Vertex3D));
+            glm::vec3* positions = reinterpret_cast<glm::vec3*>(streams.data());
+            SplitVertex3D::Attributes* attributes = reinterpret_cast<SplitVertex3D::Attributes*>(streams.data() + static_cast<size_t>(count) * sizeof(glm::vec3));
+
+            for (uint32_t i = 0; i < count; i++) {
+                positions[i] = vertices[i].position;
+                attributes[i] = SplitVertex3D::Attributes{ vertices[i].color, vertices[i].normal, vertices[i].uv };
+            }
+
+            vertexFormat = VertexFormat::SPLIT;
+            dequantizeMatrix = glm::mat4{ 1.0f };
+            uploadVertexData(streams.data(), sizeof(Vertex3D), count);
+            return;
+        }
+
+        vertexFormat = VertexFormat::STANDARD;
+        dequantizeMatrix = glm::mat4{ 1.0f };
+        uploadVertexData(vertices, sizeof(Vertex3D), count);
+    }
+
+    void JCATModel3D::uploadVertexData(const void* vertices, uint32_t vertexSize, uint32_t count) {
+        vertexCount = count;
 
         // We need to have at least 3 vertices to form a visable shape (like a 2D triange)
         assert(vertexCount >= 3 && "Vertex count must be at least 3!");
 
-        VkDeviceSize bufferSize = sizeof(vertices[0]) * vertexCount;
-        uint32_t vertexSize = sizeof(vertices[0]);
+        VkDeviceSize bufferSize = static_cast<VkDeviceSize>(vertexSize) * vertexCount;
 
         if (useStagingBuffers == false) {
             resourceManager.createBuffer(
@@ -151,48 +328,156 @@ namespace JCAT {
                 vertexBufferOldMemory
             );
 
-            void* modelData;
-            vkMapMemory(device.device(), vertexBufferOldMemory, 0, bufferSize, 0, &modelData);
-            memcpy(modelData, vertices.data(), static_cast<size_t>(bufferSize));
-            vkUnmapMemory(device.device(), vertexBufferOldMemory);
+            memcpy(vertexBufferOldMemory.mapped, vertices, static_cast<size_t>(bufferSize));
         }
         else {
-            // Create new staging Buffer in place of a vertex buffer
-            JCATBuffer stagingBuffer{
-                device,
-                resourceManager,
-                vertexSize,
-                vertexCount,
-                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-            };
-
-            stagingBuffer.map();
-            stagingBuffer.writeToBuffer((void *)vertices.data());
+            // Aligned to whole vertices so the offset can be passed as the draws' vertex offset
+            GeometryPool& pool = resourceManager.getGeometryPool();
+            if (pool.allocateVertices(bufferSize, vertexSize, vertexRange)) {
+                // A SPLIT model's streams are bound at their offsets, a base vertex would be added to both
+                baseVertex = vertexFormat == VertexFormat::SPLIT ? 0 : static_cast<int32_t>(vertexRange.offset / vertexSize);
+                resourceManager.uploadBuffer(pool.getVertexBuffer(), vertexRange.offset, vertices, bufferSize);
+                return;
+            }
 
-            // Define the vertex buffer
+            // The pool is full, fall back to a buffer of its own
             vertexBuffer = std::make_unique<JCATBuffer>(
                 device,
                 resourceManager,
                 vertexSize,
                 vertexCount,
-                VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
             );
+            vertexBuffer->setMovable();
 
-            resourceManager.copyBuffer(stagingBuffer.getBuffer(), vertexBuffer->getBuffer(), bufferSize);
+            resourceManager.uploadBuffer(vertexBuffer->getBuffer(), 0, vertices, bufferSize);
         }
     }
 
-    void JCATModel3D::createIndexBuffers(const std::vector<uint32_t>& indices) {
-        indexCount = static_cast<uint32_t>(indices.size());
+    bool JCATModel3D::splitSubMeshes(const Vertex3D* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount,
+                                     std::vector<Vertex3D>& splitVertices, std::vector<uint16_t>& splitIndices, std::vector<SubMesh>& subMeshes) {
+        // 0xFFFF is left unused so the buffers stay valid if primitive restart is ever enabled
+        const uint32_t maxSubMeshVertices = 0xFFFF;
+        const size_t maxSplitVertices = static_cast<size_t>(vertexCount) + vertexCount / 8;
+
+        splitVertices.clear();
+        splitIndices.clear();
+        subMeshes.clear();
+        splitVertices.reserve(vertexCount);
+        splitIndices.reserve(indexCount);
+
+        // Local index of each source vertex within the current sub-mesh, reset through usedVertices when a new one starts
+        std::vector<uint32_t> localIndex(vertexCount, UINT32_MAX);
+        std::vector<uint32_t> usedVertices;
+        SubMesh current{ 0, 0, 0 };
+
+        for (uint32_t i = 0; i + 2 < indexCount; i += 3) {
+            uint32_t newVertices = 0;
+            for (uint32_t corner = 0; corner < 3; corner++) {
+                newVertices += localIndex[indices[i + corner]] == UINT32_MAX ? 1 : 0;
+            }
+
+            if (usedVertices.size() + newVertices > maxSubMeshVertices) {
+                subMeshes.push_back(current);
+                current = SubMesh{ i, 0, static_cast<int32_t>(splitVertices.size()) };
+
+                for (uint32_t vertex : usedVertices) {
+                    localIndex[vertex] = UINT32_MAX;
+                }
+                usedVertices.clear();
+            }
+
+            for (uint32_t corner = 0; corner < 3; corner++) {
+                uint32_t vertex = indices[i + corner];
+
+                if (localIndex[vertex] == UINT32_MAX) {
+                    localIndex[vertex] = static_cast<uint32_t>(usedVertices.size());
+                    usedVertices.push_back(vertex);
+                    splitVertices.push_back(vertices[vertex]);
+                }
+
+                splitIndices.push_back(static_cast<uint16_t>(localIndex[vertex]));
+            }
+
+            current.indexCount += 3;
+
+            if (splitVertices.size() > maxSplitVertices) {
+                return false;
+            }
+        }
+
+        if (current.indexCount > 0) {
+            subMeshes.push_back(current);
+        }
+
+        return true;
+    }
+
+    void JCATModel3D::createIndexedBuffers(const Vertex3D* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, const LodRange* lods, uint32_t lodCount, VertexFormat preferredFormat) {
+        // Small meshes narrow their indices in createIndexBuffers, only larger ones need splitting first.
+        // LOD chains are not split, cutting every level separately would copy the shared vertices once per level.
+        if (vertexCount > 0xFFFF && indexCount > 0 && lodCount <= 1) {
+            std::vector<Vertex3D> splitVertices;
+            std::vector<uint16_t> splitIndices;
+
+            if (splitSubMeshes(vertices, vertexCount, indices, indexCount, splitVertices, splitIndices, subMeshes)) {
+                createVertexBuffers(splitVertices.data(), static_cast<uint32_t>(splitVertices.size()), preferredFormat);
+
+                this->indexCount = indexCount;
+                hasIndexBuffer = true;
+                lodSubMeshes = { 0, static_cast<uint32_t>(subMeshes.size()) };
+                indexType = VK_INDEX_TYPE_UINT16;
+                uploadIndexData(splitIndices.data(), sizeof(uint16_t), indexCount);
+                return;
+            }
+        }
+
+        createVertexBuffers(vertices, vertexCount, preferredFormat);
+        createIndexBuffers(indices, indexCount, lods, lodCount);
+    }
+
+    void JCATModel3D::createIndexBuffers(const uint32_t* indices, uint32_t count, const LodRange* lods, uint32_t lodCount) {
+        indexCount = count;
         hasIndexBuffer = indexCount > 0;
 
         if (!hasIndexBuffer) {
             return;
         }
 
-        VkDeviceSize bufferSize = sizeof(indices[0]) * indexCount;
+        // One sub-mesh per level, all drawn from vertex 0 since the levels share the vertex buffer
+        subMeshes.clear();
+        for (uint32_t lod = 0; lod < lodCount && lod < MAX_LODS; lod++) {
+            if (lods[lod].firstIndex > count || lods[lod].indexCount > count - lods[lod].firstIndex) {
+                throw std::runtime_error("LOD index range lies outside the index buffer");
+            }
+
+            subMeshes.push_back(SubMesh{ lods[lod].firstIndex, lods[lod].indexCount, 0 });
+        }
+
+        if (subMeshes.empty()) {
+            subMeshes.push_back(SubMesh{ 0, count, 0 });
+        }
+
+        this->lodCount = static_cast<uint32_t>(subMeshes.size());
+        lodSubMeshes.resize(subMeshes.size() + 1);
+        std::iota(lodSubMeshes.begin(), lodSubMeshes.end(), 0);
+
+        if (vertexCount <= 0xFFFF) {
+            std::vector<uint16_t> narrowIndices(indices, indices + count);
+
+            indexType = VK_INDEX_TYPE_UINT16;
+            uploadIndexData(narrowIndices.data(), sizeof(uint16_t), count);
+            return;
+        }
+
+        // Only reached when splitting would duplicate too many vertices
+        indexType = VK_INDEX_TYPE_UINT32;
+        uploadIndexData(indices, sizeof(uint32_t), count);
+    }
+
+    void JCATModel3D::uploadIndexData(const void* indices, uint32_t indexSize, uint32_t count) {
+        VkDeviceSize bufferSize = static_cast<VkDeviceSize>(indexSize) * count;
         
         if (useStagingBuffers == false) {
             resourceManager.createBuffer(
@@ -203,58 +488,145 @@ namespace JCAT {
                 indexBufferOldMemory
             );
 
-            void* modelData;
-            vkMapMemory(device.device(), indexBufferOldMemory, 0, bufferSize, 0, &modelData);
-            memcpy(modelData, indices.data(), static_cast<size_t>(bufferSize));
-            vkUnmapMemory(device.device(), indexBufferOldMemory);
+            memcpy(indexBufferOldMemory.mapped, indices, static_cast<size_t>(bufferSize));
         }
         else {
+            // Staged through the open upload batch if there is one, see ResourceManager::beginUploadBatch()
+            GeometryPool& pool = resourceManager.getGeometryPool();
+            if (pool.allocateIndices(bufferSize, indexSize, indexRange)) {
+                baseIndex = static_cast<uint32_t>(indexRange.offset / indexSize);
+                resourceManager.uploadBuffer(pool.getIndexBuffer(), indexRange.offset, indices, bufferSize);
+                return;
+            }
 
-            uint32_t indexSize = sizeof(indices[0]);
-
-            // Create new staging Buffer in place of index buffer
-            JCATBuffer stagingBuffer{
-                device,
-                resourceManager,
-                indexSize,
-                indexCount,
-                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-            };
-
-            stagingBuffer.map();
-            stagingBuffer.writeToBuffer((void*) indices.data());
-
-            // Define index Buffer
+            // The pool is full, fall back to a buffer of its own
             indexBuffer = std::make_unique<JCATBuffer>(
                 device,
                 resourceManager,
                 indexSize,
-                indexCount,
-                VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                count,
+                VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
             );
+            indexBuffer->setMovable();
+
+            resourceManager.uploadBuffer(indexBuffer->getBuffer(), 0, indices, bufferSize);
+        }
+    }
+
+    void JCATModel3D::setMeshlets(const Meshlet* source, uint32_t count) {
+        meshlets.clear();
+        if (count == 0 || !hasIndexBuffer) {
+            return;
+        }
 
-            resourceManager.copyBuffer(stagingBuffer.getBuffer(), indexBuffer->getBuffer(), bufferSize);
+        const uint32_t fullDetailCount = getLodIndexCount(0);
+        for (uint32_t i = 0; i < count; i++) {
+            if (source[i].firstIndex > fullDetailCount || source[i].indexCount > fullDetailCount - source[i].firstIndex) {
+                throw std::runtime_error("meshlet index range lies outside the full detail level");
+            }
         }
+
+        meshlets.assign(source, source + count);
+    }
+
+    VkBuffer JCATModel3D::getVertexBuffer() const {
+        return vertexRange.size > 0 ? resourceManager.getGeometryPool().getVertexBuffer() : vertexBuffer->getBuffer();
+    }
+
+    VkBuffer JCATModel3D::getIndexBuffer() const {
+        if (!hasIndexBuffer) {
+            return VK_NULL_HANDLE;
+        }
+
+        return indexRange.size > 0 ? resourceManager.getGeometryPool().getIndexBuffer() : indexBuffer->getBuffer();
     }
 
     void JCATModel3D::bind(VkCommandBuffer commandBuffer) {
-        VkBuffer buffers[] = { vertexBuffer->getBuffer() };
-        VkDeviceSize offsets[] = { 0 };
-        vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
-    
+        bind(commandBuffer, nullptr);
+    }
+
+    void JCATModel3D::bind(VkCommandBuffer commandBuffer, const JCATModel3D* previous) {
+        const VkBuffer vertices = getVertexBuffer();
+        if (vertexFormat == VertexFormat::SPLIT) {
+            // The streams are bound at this model's own offsets, so nothing short of the same model can be reused
+            if (previous != this) {
+                VkBuffer buffers[] = { vertices, vertices };
+                VkDeviceSize offsets[] = { getPositionStreamOffset(), getPositionStreamOffset() + static_cast<VkDeviceSize>(vertexCount) * sizeof(glm::vec3) };
+                vkCmdBindVertexBuffers(commandBuffer, 0, 2, buffers, offsets);
+            }
+        }
+        else if (previous == nullptr || previous->isSplit() || previous->getVertexBuffer() != vertices) {
+            VkBuffer buffers[] = { vertices };
+            VkDeviceSize offsets[] = { 0 };
+            vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+        }
+
+        bindIndexBuffer(commandBuffer, previous);
+    }
+
+    void JCATModel3D::bindPositions(VkCommandBuffer commandBuffer, const JCATModel3D* previous) {
+        assert(vertexFormat == VertexFormat::SPLIT && "Only SPLIT models have a position stream of their own");
+
+        if (previous != this) {
+            VkBuffer buffers[] = { getVertexBuffer() };
+            VkDeviceSize offsets[] = { getPositionStreamOffset() };
+            vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+        }
+
+        bindIndexBuffer(commandBuffer, previous);
+    }
+
+    void JCATModel3D::bindIndexBuffer(VkCommandBuffer commandBuffer, const JCATModel3D* previous) {
+        // A non indexed previous model leaves whatever was bound before it, so it cannot vouch for the index buffer
         if (hasIndexBuffer) {
-            vkCmdBindIndexBuffer(commandBuffer, indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+            const VkBuffer indices = getIndexBuffer();
+            if (previous == nullptr || previous->getIndexBuffer() != indices || previous->getIndexType() != indexType) {
+                vkCmdBindIndexBuffer(commandBuffer, indices, 0, indexType);
+            }
         }
     }
 
-    void JCATModel3D::draw(VkCommandBuffer commandBuffer) {
+    uint32_t JCATModel3D::getLodIndexCount(uint32_t lod) const {
+        if (!hasIndexBuffer) {
+            return vertexCount;
+        }
+
+        const uint32_t level = std::min(lod, lodCount - 1);
+        uint32_t count = 0;
+        for (uint32_t i = lodSubMeshes[level]; i < lodSubMeshes[level + 1]; i++) {
+            count += subMeshes[i].indexCount;
+        }
+
+        return count;
+    }
+
+    void JCATModel3D::draw(VkCommandBuffer commandBuffer, uint32_t instanceCount, uint32_t firstInstance, uint32_t lod) {
         if (hasIndexBuffer) {
-            vkCmdDrawIndexed(commandBuffer, indexCount, 1, 0, 0, 0);
+            const uint32_t level = std::min(lod, lodCount - 1);
+            for (uint32_t i = lodSubMeshes[level]; i < lodSubMeshes[level + 1]; i++) {
+                const SubMesh& subMesh = subMeshes[i];
+                vkCmdDrawIndexed(commandBuffer, subMesh.indexCount, instanceCount, baseIndex + subMesh.firstIndex, baseVertex + subMesh.vertexOffset, firstInstance);
+            }
         }
         else {
-            vkCmdDraw(commandBuffer, vertexCount, 1, 0, 0);
+            vkCmdDraw(commandBuffer, vertexCount, instanceCount, static_cast<uint32_t>(baseVertex), firstInstance);
+        }
+    }
+
+    void JCATModel3D::drawIndexRange(VkCommandBuffer commandBuffer, uint32_t firstIndex, uint32_t indexCount, uint32_t instanceCount, uint32_t firstInstance) {
+        assert(hasIndexBuffer && "drawIndexRange needs an index buffer");
+
+        // The full detail level may be split into sub-meshes with their own base vertex, so clip the range against each
+        const uint32_t endIndex = firstIndex + indexCount;
+        for (uint32_t i = lodSubMeshes[0]; i < lodSubMeshes[1]; i++) {
+            const SubMesh& subMesh = subMeshes[i];
+            const uint32_t first = std::max(firstIndex, subMesh.firstIndex);
+            const uint32_t end = std::min(endIndex, subMesh.firstIndex + subMesh.indexCount);
+
+            if (first < end) {
+                vkCmdDrawIndexed(commandBuffer, end - first, instanceCount, baseIndex + first, baseVertex + subMesh.vertexOffset, firstInstance);
+            }
         }
     }
 }
\ No newline at end of file
@@ -0,0 +1,60 @@
+#include "./engine/3d/model3d.h"
+#include "./engine/3d/objParser.h"
+#include "./engine/3d/meshSimplifier.h"
+#include "./engine/3d/meshletBuilder.h"
+#include "./engine/3d/meshOptimizer.h"
+
+#include <algorithm>
+
+namespace JCAT {
+    bool JCATModel3D::Vertex3D::operator==(const Vertex3D& other) const {
+        return position == other.position && color == other.color && normal == other.normal && uv == other.uv;
+    }
+
+    void JCATModel3D::ModelBuilder::loadModel(const std::string& filepath, bool hasIndexBuffer) {
+        ObjParser::parse(filepath, hasIndexBuffer, *this);
+    }
+
+    void JCATModel3D::ModelBuilder::generateLods(uint32_t levelCount, float reductionPerLevel) {
+        lods.clear();
+        if (indices.empty()) {
+            return;
+        }
+
+        lods.push_back(LodRange{ 0, static_cast<uint32_t>(indices.size()) });
+
+        // Each level is simplified from the one before it, and is drawn at about half the on screen size, so may be twice as far off
+        std::vector<uint32_t> previous = indices;
+        float maxError = MeshSimplifier::DEFAULT_MAX_ERROR;
+
+        for (uint32_t level = 1; level < std::min(levelCount, MAX_LODS); level++) {
+            const size_t targetIndexCount = static_cast<size_t>(static_cast<float>(previous.size() / 3) * reductionPerLevel) * 3;
+            std::vector<uint32_t> simplified = MeshSimplifier::simplify(vertices, previous, targetIndexCount, maxError);
+
+            // A level that saves less than a tenth of the triangles is not worth its index memory
+            if (simplified.empty() || simplified.size() * 10 > previous.size() * 9) {
+                break;
+            }
+
+            lods.push_back(LodRange{ static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(simplified.size()) });
+            indices.insert(indices.end(), simplified.begin(), simplified.end());
+
+            previous.swap(simplified);
+            maxError *= 2.0f;
+        }
+    }
+
+    void JCATModel3D::ModelBuilder::buildMeshlets() {
+        // Coarser levels are only drawn far away, where the whole object is on screen and culling its clusters would not pay off
+        const uint32_t indexCount = lods.empty() ? static_cast<uint32_t>(indices.size()) : lods[0].indexCount;
+        meshlets = MeshletBuilder::build(vertices, indices, 0, indexCount);
+
+        // Gathering the meshlets breaks up the optimizer's triangle order at their seams, so redo it within each one
+        std::vector<uint32_t> meshletIndices;
+        for (const Meshlet& meshlet : meshlets) {
+            meshletIndices.assign(indices.begin() + meshlet.firstIndex, indices.begin() + meshlet.firstIndex + meshlet.indexCount);
+            MeshOptimizer::optimizeTriangleOrder(meshletIndices, vertices);
+            std::copy(meshletIndices.begin(), meshletIndices.end(), indices.begin() + meshlet.firstIndex);
+        }
+    }
+};
\ No newline at end of file
@@ -0,0 +1,175 @@
+#include "./engine/3d/modelLoader.h"
+#include "./engine/3d/meshOptimizer.h"
+#include "./engine/assetRegistry.h"
+
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+
+namespace JCAT {
+    ModelLoader::ModelLoader(DeviceSetup& d, ResourceManager& r, size_t threadCount) : device{d}, resourceManager{r}, threadPool{threadCount} {}
+
+    ModelLoader::ModelLoader(DeviceSetup& d, ResourceManager& r, AssetRegistry& a, size_t threadCount) : device{d}, resourceManager{r}, registry{&a}, threadPool{threadCount} {}
+
+    PreparedModel ModelLoader::prepareModel(const std::string& filepath, bool hasIndexBuffer, bool optimizeMesh, uint32_t lodLevels) {
+        PreparedModel prepared{};
+
+        // Optimizing and LODs only apply to indexed meshes, so a non indexed one is cached the same either way
+        const uint32_t cacheFlags = MeshCache::makeFlags(hasIndexBuffer, optimizeMesh, lodLevels);
+
+        if (MeshCache::load(filepath, cacheFlags, prepared.cached)) {
+            prepared.fromCache = true;
+            return prepared;
+        }
+
+        // A shipped .jmz decodes faster than parsing, and is not turned into a .jmesh since decoding it again is about as cheap as mapping one
+        if (MeshCache::loadCompressed(filepath, cacheFlags, prepared.cached)) {
+            prepared.fromCache = true;
+            return prepared;
+        }
+
+        prepared.builder.loadModel(filepath, hasIndexBuffer);
+
+        // Before optimizing, so every level gets its own triangle order and they all share one vertex order
+        if (cacheFlags & MESH_CACHE_LOD_LEVELS_MASK) {
+            prepared.builder.generateLods(lodLevels);
+        }
+
+        if (cacheFlags & MESH_CACHE_OPTIMIZED) {
+            MeshOptimizer::optimize(prepared.builder);
+        }
+
+        // Last, the meshlet order has to survive until the indices are uploaded
+        if (cacheFlags & MESH_CACHE_MESHLETS) {
+            prepared.builder.buildMeshlets();
+        }
+
+        if (!MeshCache::write(filepath, cacheFlags, prepared.builder)) {
+            std::cerr << "Warning: could not write mesh cache " << MeshCache::getCachePath(filepath) << std::endl;
+        }
+
+        return prepared;
+    }
+
+    std::unique_ptr<JCATModel3D> ModelLoader::uploadModel(DeviceSetup& device, ResourceManager& resourceManager, PreparedModel& prepared, JCATModel3D::VertexFormat vertexFormat) {
+        if (prepared.fromCache) {
+            // The mapping only has to outlive the staging copy made by the constructor
+            const MeshCache::CachedMesh& cached = prepared.cached;
+            return std::make_unique<JCATModel3D>(device, resourceManager, cached.vertices, cached.vertexCount, cached.indices, cached.indexCount, cached.bounds, cached.boundingSphere,
+                                                 cached.lods, cached.lodCount, cached.meshlets, cached.meshletCount, vertexFormat);
+        }
+
+        return std::make_unique<JCATModel3D>(device, resourceManager, prepared.builder, vertexFormat);
+    }
+
+    ModelLoader::ModelHandle ModelLoader::requestModel(const std::string& filepath, bool hasIndexBuffer, bool optimizeMesh, JCATModel3D::VertexFormat vertexFormat, uint32_t lodLevels) {
+        const std::string key = AssetRegistry::makeModelKey(filepath, hasIndexBuffer, optimizeMesh, vertexFormat, lodLevels);
+
+        std::unordered_map<std::string, ModelHandle>::iterator existing = requestLookup.find(key);
+        if (existing != requestLookup.end()) {
+            return existing->second;
+        }
+
+        ModelRequest request{};
+        request.filepath = filepath;
+        request.key = key;
+        request.vertexFormat = vertexFormat;
+
+        // Already uploaded through the registry, the request is born finished and never touches a worker
+        if (registry != nullptr) {
+            request.model = registry->findModel(key);
+        }
+
+        if (request.model == nullptr) {
+            request.pending = threadPool.submit([filepath, hasIndexBuffer, optimizeMesh, lodLevels]() { return prepareModel(filepath, hasIndexBuffer, optimizeMesh, lodLevels); });
+        }
+
+        ModelHandle handle = static_cast<ModelHandle>(requests.size());
+        requests.push_back(std::move(request));
+        requestLookup[key] = handle;
+
+        return handle;
+    }
+
+    void ModelLoader::upload(ModelRequest& request) {
+        PreparedModel prepared{};
+
+        try {
+            prepared = request.pending.get();
+        }
+        catch (const std::exception& e) {
+            throw std::runtime_error("failed to load model " + request.filepath + ": " + e.what());
+        }
+
+        request.model = uploadModel(device, resourceManager, prepared, request.vertexFormat);
+        if (registry != nullptr) {
+            request.model = registry->registerModel(request.key, request.filepath, request.model);
+        }
+    }
+
+    void ModelLoader::uploadAll() {
+        // Every model goes into one upload batch (the caller's, if one is open) instead of a submission per buffer
+        const bool ownsBatch = resourceManager.getUploadBatch() == nullptr;
+        if (ownsBatch) {
+            resourceManager.beginUploadBatch();
+        }
+
+        try {
+            uploadReady();
+        }
+        catch (...) {
+            if (ownsBatch) {
+                resourceManager.submitUploadBatch();
+            }
+            throw;
+        }
+
+        if (ownsBatch) {
+            resourceManager.submitUploadBatch();
+        }
+    }
+
+    void ModelLoader::uploadReady() {
+        while (true) {
+            bool anyPending = false;
+            ModelRequest* firstPending = nullptr;
+
+            // Upload whatever has finished so far instead of waiting on the requests in order
+            for (ModelRequest& request : requests) {
+                if (!request.pending.valid()) {
+                    continue;
+                }
+
+                if (request.pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+                    upload(request);
+                    continue;
+                }
+
+                anyPending = true;
+                if (firstPending == nullptr) {
+                    firstPending = &request;
+                }
+            }
+
+            if (!anyPending) {
+                return;
+            }
+
+            // Nothing ready, block on one of the outstanding requests rather than spinning
+            firstPending->pending.wait();
+        }
+    }
+
+    std::shared_ptr<JCATModel3D> ModelLoader::getModel(ModelHandle handle) {
+        if (handle >= requests.size()) {
+            throw std::runtime_error("invalid model handle");
+        }
+
+        ModelRequest& request = requests[handle];
+        if (request.pending.valid()) {
+            upload(request);
+        }
+
+        return request.model;
+    }
+};
\ No newline at end of file
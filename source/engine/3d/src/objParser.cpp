@@ -0,0 +1,433 @@
+#include "./engine/3d/objParser.h"
+#include "./engine/3d/vertexDedup.h"
+#include "./engine/mappedFile.h"
+
+#include <algorithm>
+#include <charconv>
+#include <exception>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace JCAT {
+    namespace {
+        // Raw attribute streams in file order, colors always hold one rgb triple per position
+        struct ObjAttributes {
+            std::vector<float> positions;
+            std::vector<float> colors;
+            std::vector<float> normals;
+            std::vector<float> texcoords;
+
+            size_t positionCount() const { return positions.size() / 3; }
+            size_t normalCount() const { return normals.size() / 3; }
+            size_t texcoordCount() const { return texcoords.size() / 2; }
+        };
+
+        // An element a face corner does not give (v or v//n without a texture coordinate, v/t without a normal). Kept apart
+        // from every value a relative index can resolve to, so one reaching before the start of the file is still caught
+        constexpr int32_t ABSENT_INDEX = std::numeric_limits<int32_t>::min();
+
+        // Set on a corner when an index was negative (relative) and so only resolved against its own chunk
+        enum RelativeIndexFlags : uint8_t {
+            RELATIVE_VERTEX = 1 << 0,
+            RELATIVE_TEXCOORD = 1 << 1,
+            RELATIVE_NORMAL = 1 << 2
+        };
+
+        // One line aligned slice of the file for parallel parsing
+        struct ObjChunk {
+            const char* begin = nullptr;
+            const char* end = nullptr;
+
+            ObjAttributes attributes;
+            std::vector<ObjIndexKey> corners; // Triangulated, three per triangle
+            std::vector<uint8_t> relativeFlags;
+
+            std::exception_ptr error;
+        };
+
+        inline const char* skipBlanks(const char* p, const char* end) {
+            while (p < end && (*p == ' ' || *p == '\t')) {
+                p++;
+            }
+
+            return p;
+        }
+
+        inline const char* skipLine(const char* p, const char* end) {
+            while (p < end && *p != '\n') {
+                p++;
+            }
+
+            return p < end ? p + 1 : end;
+        }
+
+        inline bool parseFloat(const char*& p, const char* end, float& value) {
+            p = skipBlanks(p, end);
+
+            // from_chars does not accept an explicit plus sign
+            if (p < end && *p == '+') {
+                p++;
+            }
+
+            std::from_chars_result result = std::from_chars(p, end, value);
+            if (result.ec == std::errc::result_out_of_range) {
+                // Denormals and the like, close enough to zero for mesh data
+                value = 0.0f;
+            }
+            else if (result.ec != std::errc{}) {
+                return false;
+            }
+
+            p = result.ptr;
+            return true;
+        }
+
+        inline bool parseInt(const char*& p, const char* end, int& value) {
+            std::from_chars_result result = std::from_chars(p, end, value);
+            if (result.ec != std::errc{}) {
+                return false;
+            }
+
+            p = result.ptr;
+            return true;
+        }
+
+        // Reads "v", "v/t", "v//n" or "v/t/n", leaving 0 for anything not given
+        inline bool parseCorner(const char*& p, const char* end, int& vertex, int& texcoord, int& normal) {
+            vertex = texcoord = normal = 0;
+
+            if (!parseInt(p, end, vertex)) {
+                return false;
+            }
+
+            if (p < end && *p == '/') {
+                p++;
+
+                if (p < end && *p != '/' && !parseInt(p, end, texcoord)) {
+                    return false;
+                }
+
+                if (p < end && *p == '/') {
+                    p++;
+
+                    if (!parseInt(p, end, normal)) {
+                        return false;
+                    }
+                }
+            }
+
+            return true;
+        }
+
+        // OBJ indices are 1 based, negative ones count back from the latest element, 0 means absent (ABSENT_INDEX here)
+        inline int32_t resolveIndex(int value, size_t count, uint8_t relativeBit, uint8_t& flags) {
+            if (value > 0) {
+                return value - 1;
+            }
+
+            if (value < 0) {
+                flags |= relativeBit;
+
+                // Out of range results stay negative but never collide with ABSENT_INDEX
+                const int64_t resolved = static_cast<int64_t>(count) + value;
+                return static_cast<int32_t>(std::max<int64_t>(resolved, static_cast<int64_t>(ABSENT_INDEX) + 1));
+            }
+
+            return ABSENT_INDEX;
+        }
+
+        /**
+         * Tokenizes the lines in [p, end), appending attributes and calling emit(key, relativeFlags)
+         * for every triangulated face corner. Relative indices are resolved against the attributes
+         * parsed so far in this range.
+         */
+        template <typename CornerSink>
+        void parseLines(const char* p, const char* end, ObjAttributes& attributes, CornerSink&& emit) {
+            std::vector<ObjIndexKey> polygon;
+            std::vector<uint8_t> polygonFlags;
+
+            while (p < end) {
+                p = skipBlanks(p, end);
+                if (p >= end) {
+                    break;
+                }
+
+                const char* lineStart = p;
+
+                if (p[0] == 'v' && p + 1 < end) {
+                    if (p[1] == ' ' || p[1] == '\t') {
+                        p += 1;
+
+                        float values[6];
+                        int valueCount = 0;
+                        while (valueCount < 6 && parseFloat(p, end, values[valueCount])) {
+                            valueCount++;
+                        }
+
+                        if (valueCount < 3) {
+                            throw std::runtime_error("malformed vertex position: " + std::string(lineStart, skipLine(lineStart, end)));
+                        }
+
+                        attributes.positions.insert(attributes.positions.end(), values, values + 3);
+
+                        // "v x y z r g b" carries a vertex color, "v x y z [w]" does not
+                        if (valueCount == 6) {
+                            attributes.colors.insert(attributes.colors.end(), values + 3, values + 6);
+                        }
+                        else {
+                            attributes.colors.insert(attributes.colors.end(), { 1.0f, 1.0f, 1.0f });
+                        }
+                    }
+                    else if (p[1] == 'n') {
+                        p += 2;
+
+                        float normal[3];
+                        if (!parseFloat(p, end, normal[0]) || !parseFloat(p, end, normal[1]) || !parseFloat(p, end, normal[2])) {
+                            throw std::runtime_error("malformed vertex normal: " + std::string(lineStart, skipLine(lineStart, end)));
+                        }
+
+                        attributes.normals.insert(attributes.normals.end(), normal, normal + 3);
+                    }
+                    else if (p[1] == 't') {
+                        p += 2;
+
+                        // A third (w) coordinate may follow, it is not used
+                        float texcoord[2];
+                        if (!parseFloat(p, end, texcoord[0])) {
+                            throw std::runtime_error("malformed texture coordinate: " + std::string(lineStart, skipLine(lineStart, end)));
+                        }
+                        if (!parseFloat(p, end, texcoord[1])) {
+                            texcoord[1] = 0.0f;
+                        }
+
+                        attributes.texcoords.insert(attributes.texcoords.end(), texcoord, texcoord + 2);
+                    }
+                }
+                else if (p[0] == 'f' && p + 1 < end && (p[1] == ' ' || p[1] == '\t')) {
+                    p += 1;
+                    polygon.clear();
+                    polygonFlags.clear();
+
+                    while (true) {
+                        p = skipBlanks(p, end);
+                        if (p >= end || *p == '\n' || *p == '\r' || *p == '#') {
+                            break;
+                        }
+
+                        int vertex, texcoord, normal;
+                        if (!parseCorner(p, end, vertex, texcoord, normal)) {
+                            throw std::runtime_error("malformed face: " + std::string(lineStart, skipLine(lineStart, end)));
+                        }
+
+                        uint8_t flags = 0;
+                        ObjIndexKey key{};
+                        key.vertex = resolveIndex(vertex, attributes.positionCount(), RELATIVE_VERTEX, flags);
+                        key.texcoord = resolveIndex(texcoord, attributes.texcoordCount(), RELATIVE_TEXCOORD, flags);
+                        key.normal = resolveIndex(normal, attributes.normalCount(), RELATIVE_NORMAL, flags);
+
+                        polygon.push_back(key);
+                        polygonFlags.push_back(flags);
+                    }
+
+                    // Fan triangulation, polygons in OBJ files are expected to be convex
+                    for (size_t i = 1; i + 1 < polygon.size(); i++) {
+                        emit(polygon[0], polygonFlags[0]);
+                        emit(polygon[i], polygonFlags[i]);
+                        emit(polygon[i + 1], polygonFlags[i + 1]);
+                    }
+                }
+
+                // Comments, groups, materials, smoothing groups and anything left on the line
+                p = skipLine(p, end);
+            }
+        }
+
+        // Anything below zero other than ABSENT_INDEX is a relative index reaching past the start of the file
+        void checkIndex(int32_t index, size_t count, bool required, const char* element) {
+            if (index == ABSENT_INDEX ? required : (index < 0 || static_cast<size_t>(index) >= count)) {
+                throw std::runtime_error(std::string("face references a missing ") + element);
+            }
+        }
+
+        JCATModel3D::Vertex3D buildVertex(const ObjAttributes& attributes, const ObjIndexKey& key) {
+            checkIndex(key.vertex, attributes.positionCount(), true, "vertex");
+            checkIndex(key.normal, attributes.normalCount(), false, "normal");
+            checkIndex(key.texcoord, attributes.texcoordCount(), false, "texture coordinate");
+
+            JCATModel3D::Vertex3D vertex{};
+
+            const float* position = &attributes.positions[3 * key.vertex];
+            const float* color = &attributes.colors[3 * key.vertex];
+            vertex.position = { position[0], position[1], position[2] };
+            vertex.color = { color[0], color[1], color[2] };
+
+            if (key.normal != ABSENT_INDEX) {
+                const float* normal = &attributes.normals[3 * key.normal];
+                vertex.normal = { normal[0], normal[1], normal[2] };
+            }
+
+            if (key.texcoord != ABSENT_INDEX) {
+                const float* texcoord = &attributes.texcoords[2 * key.texcoord];
+                vertex.uv = { texcoord[0], texcoord[1] };
+            }
+
+            return vertex;
+        }
+
+        // Appends one face corner to the builder, reusing the existing vertex when the triplet was seen before
+        inline void emitCorner(const ObjAttributes& attributes, const ObjIndexKey& key, bool hasIndexBuffer, VertexDedupTable& uniqueVertices, JCATModel3D::ModelBuilder& builder) {
+            if (hasIndexBuffer) {
+                bool inserted = false;
+                uint32_t vertexIndex = uniqueVertices.findOrInsert(key, static_cast<uint32_t>(builder.vertices.size()), inserted);
+                builder.indices.push_back(vertexIndex);
+
+                if (!inserted) {
+                    return;
+                }
+            }
+
+            builder.vertices.push_back(buildVertex(attributes, key));
+        }
+
+        void parseSerial(const char* begin, const char* end, bool hasIndexBuffer, VertexDedupTable& uniqueVertices, JCATModel3D::ModelBuilder& builder) {
+            ObjAttributes attributes{};
+
+            // Everything is resolved against the whole file so far, so relative flags need no fix up
+            parseLines(begin, end, attributes, [&](const ObjIndexKey& key, uint8_t) {
+                emitCorner(attributes, key, hasIndexBuffer, uniqueVertices, builder);
+            });
+        }
+
+        void parseParallel(const char* begin, const char* end, size_t chunkCount, bool hasIndexBuffer, VertexDedupTable& uniqueVertices, JCATModel3D::ModelBuilder& builder) {
+            // Split on line boundaries so no line straddles two chunks
+            std::vector<ObjChunk> chunks(chunkCount);
+            const size_t chunkSize = static_cast<size_t>(end - begin) / chunkCount;
+            const char* chunkBegin = begin;
+            for (size_t i = 0; i < chunkCount; i++) {
+                const char* chunkEnd = (i + 1 == chunkCount) ? end : skipLine(std::max(chunkBegin, begin + chunkSize * (i + 1)), end);
+                chunks[i].begin = chunkBegin;
+                chunks[i].end = chunkEnd;
+                chunkBegin = chunkEnd;
+            }
+
+            std::vector<std::thread> workers;
+            workers.reserve(chunkCount);
+            for (ObjChunk& chunk : chunks) {
+                workers.emplace_back([&chunk]() {
+                    try {
+                        parseLines(chunk.begin, chunk.end, chunk.attributes, [&chunk](const ObjIndexKey& key, uint8_t flags) {
+                            chunk.corners.push_back(key);
+                            chunk.relativeFlags.push_back(flags);
+                        });
+                    }
+                    catch (...) {
+                        chunk.error = std::current_exception();
+                    }
+                });
+            }
+
+            for (std::thread& worker : workers) {
+                worker.join();
+            }
+
+            for (ObjChunk& chunk : chunks) {
+                if (chunk.error) {
+                    std::rethrow_exception(chunk.error);
+                }
+            }
+
+            // Concatenate the attribute streams in file order
+            ObjAttributes attributes{};
+            size_t positionFloats = 0, normalFloats = 0, texcoordFloats = 0, cornerCount = 0;
+            for (const ObjChunk& chunk : chunks) {
+                positionFloats += chunk.attributes.positions.size();
+                normalFloats += chunk.attributes.normals.size();
+                texcoordFloats += chunk.attributes.texcoords.size();
+                cornerCount += chunk.corners.size();
+            }
+
+            attributes.positions.reserve(positionFloats);
+            attributes.colors.reserve(positionFloats);
+            attributes.normals.reserve(normalFloats);
+            attributes.texcoords.reserve(texcoordFloats);
+
+            if (hasIndexBuffer) {
+                uniqueVertices.reserve(cornerCount);
+                builder.indices.reserve(cornerCount);
+            }
+            else {
+                builder.vertices.reserve(cornerCount);
+            }
+
+            for (ObjChunk& chunk : chunks) {
+                const int32_t vertexOffset = static_cast<int32_t>(attributes.positionCount());
+                const int32_t normalOffset = static_cast<int32_t>(attributes.normalCount());
+                const int32_t texcoordOffset = static_cast<int32_t>(attributes.texcoordCount());
+
+                attributes.positions.insert(attributes.positions.end(), chunk.attributes.positions.begin(), chunk.attributes.positions.end());
+                attributes.colors.insert(attributes.colors.end(), chunk.attributes.colors.begin(), chunk.attributes.colors.end());
+                attributes.normals.insert(attributes.normals.end(), chunk.attributes.normals.begin(), chunk.attributes.normals.end());
+                attributes.texcoords.insert(attributes.texcoords.end(), chunk.attributes.texcoords.begin(), chunk.attributes.texcoords.end());
+
+                // Relative indices were resolved inside the chunk, shift them by everything parsed before it
+                for (size_t i = 0; i < chunk.corners.size(); i++) {
+                    ObjIndexKey key = chunk.corners[i];
+                    const uint8_t flags = chunk.relativeFlags[i];
+
+                    key.vertex += (flags & RELATIVE_VERTEX) ? vertexOffset : 0;
+                    key.normal += (flags & RELATIVE_NORMAL) ? normalOffset : 0;
+                    key.texcoord += (flags & RELATIVE_TEXCOORD) ? texcoordOffset : 0;
+
+                    emitCorner(attributes, key, hasIndexBuffer, uniqueVertices, builder);
+                }
+
+                // Release each chunk as soon as it is merged to keep peak memory down
+                chunk.attributes = ObjAttributes{};
+                chunk.corners = std::vector<ObjIndexKey>{};
+                chunk.relativeFlags = std::vector<uint8_t>{};
+            }
+        }
+    }
+
+    void ObjParser::parse(const std::string& filepath, bool hasIndexBuffer, JCATModel3D::ModelBuilder& builder, const Options& options) {
+        MappedFile file;
+        if (!file.open(filepath)) {
+            throw std::runtime_error("failed to open model file: " + filepath);
+        }
+
+        builder.vertices.clear();
+        builder.indices.clear();
+
+        const char* begin = reinterpret_cast<const char*>(file.data());
+        const char* end = begin + file.size();
+
+        size_t chunkCount = 1;
+        if (options.allowParallel && file.size() >= options.parallelThreshold) {
+            size_t threadCount = options.maxThreads != 0 ? options.maxThreads : std::max<size_t>(1, std::thread::hardware_concurrency());
+
+            // Keep chunks at least 1MB so thread start up stays small next to the parsing
+            chunkCount = std::max<size_t>(1, std::min(threadCount, file.size() / (1024 * 1024)));
+        }
+
+        VertexDedupTable uniqueVertices{};
+
+        try {
+            if (chunkCount > 1) {
+                parseParallel(begin, end, chunkCount, hasIndexBuffer, uniqueVertices, builder);
+            }
+            else {
+                // Roughly one unique vertex per 64 bytes of text in typical exports, the table grows if that is short
+                if (hasIndexBuffer) {
+                    uniqueVertices.reserve(file.size() / 64);
+                }
+
+                parseSerial(begin, end, hasIndexBuffer, uniqueVertices, builder);
+            }
+        }
+        catch (const std::exception& e) {
+            throw std::runtime_error(filepath + ": " + e.what());
+        }
+    }
+};
\ No newline at end of file
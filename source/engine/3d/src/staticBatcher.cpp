@@ -0,0 +1,158 @@
+#include <cmath>
+
+#include "./engine/3d/staticBatcher.h"
+#include "./engine/utils.h"
+
+namespace JCAT {
+    // Vertex3D is 11 floats without padding, so hashing its bytes is consistent with its operator==
+    struct Vertex3DHash {
+        size_t operator()(const JCATModel3D::Vertex3D& vertex) const {
+            return static_cast<size_t>(hashBytes(&vertex, sizeof(vertex)));
+        }
+    };
+
+    size_t StaticBatcher::BatchKeyHash::operator()(const BatchKey& key) const {
+        size_t seed = 0;
+        hashCombine(seed, key.cell.x, key.cell.y, key.cell.z, key.hasLighting, key.hasTexture);
+        return seed;
+    }
+
+    StaticBatcher::StaticBatcher(DeviceSetup& d, ResourceManager& r, float chunkSize) : device{d}, resourceManager{r}, chunkSize{chunkSize} {}
+
+    void StaticBatcher::addSourceGeometry(const JCATModel3D* model, const JCATModel3D::ModelBuilder& geometry) {
+        SourceGeometry& source = sources[model];
+        source.vertices.clear();
+        source.indices.clear();
+
+        if (!geometry.indices.empty()) {
+            const uint32_t firstIndex = geometry.lods.empty() ? 0 : geometry.lods[0].firstIndex;
+            const uint32_t indexCount = geometry.lods.empty() ? static_cast<uint32_t>(geometry.indices.size()) : geometry.lods[0].indexCount;
+
+            source.vertices = geometry.vertices;
+            source.indices.assign(geometry.indices.begin() + firstIndex, geometry.indices.begin() + firstIndex + indexCount);
+            return;
+        }
+
+        // A triangle list repeats every shared corner, merging them keeps the batches from growing by half again
+        std::unordered_map<JCATModel3D::Vertex3D, uint32_t, Vertex3DHash> vertexLookup;
+        vertexLookup.reserve(geometry.vertices.size());
+        source.indices.reserve(geometry.vertices.size());
+
+        for (const JCATModel3D::Vertex3D& vertex : geometry.vertices) {
+            auto [entry, inserted] = vertexLookup.try_emplace(vertex, static_cast<uint32_t>(source.vertices.size()));
+            if (inserted) {
+                source.vertices.push_back(vertex);
+            }
+            source.indices.push_back(entry->second);
+        }
+    }
+
+    void StaticBatcher::bake(std::vector<GameObject>& gameObjects, JCATModel3D::VertexFormat preferredFormat) {
+        std::unordered_map<BatchKey, uint32_t, BatchKeyHash> batchLookup;
+        std::vector<std::vector<uint32_t>> batches;
+        std::vector<bool> baked(gameObjects.size(), false);
+
+        for (uint32_t i = 0; i < gameObjects.size(); i++) {
+            GameObject& obj = gameObjects[i];
+            if (!obj.isStatic || obj.model3D == nullptr || sources.count(obj.model3D.get()) == 0) {
+                continue;
+            }
+
+            const glm::vec3 center = obj.getWorldBoundingSphere().center / chunkSize;
+            const BatchKey key{
+                glm::ivec3{ static_cast<int>(std::floor(center.x)), static_cast<int>(std::floor(center.y)), static_cast<int>(std::floor(center.z)) },
+                obj.hasLighting,
+                obj.hasTexture
+            };
+
+            auto [entry, inserted] = batchLookup.try_emplace(key, static_cast<uint32_t>(batches.size()));
+            if (inserted) {
+                batches.emplace_back();
+            }
+            batches[entry->second].push_back(i);
+            baked[i] = true;
+        }
+
+        if (batches.empty()) {
+            return;
+        }
+
+        std::vector<GameObject> batchObjects;
+        batchObjects.reserve(batches.size());
+
+        for (const std::vector<uint32_t>& objectIndices : batches) {
+            const GameObject& first = gameObjects[objectIndices[0]];
+
+            // The vertices are already in world space, so the batch keeps the default identity transform
+            GameObject batch = GameObject::createGameObject();
+            batch.model3D = mergeObjects(gameObjects, objectIndices, preferredFormat);
+            batch.isStatic = true;
+            batch.hasLighting = first.hasLighting;
+            batch.hasTexture = first.hasTexture;
+            batchObjects.push_back(std::move(batch));
+
+            stats.objectsBaked += static_cast<uint32_t>(objectIndices.size());
+        }
+        stats.batches += static_cast<uint32_t>(batches.size());
+
+        // Close the gaps the baked objects leave, then append their batches
+        size_t kept = 0;
+        for (size_t i = 0; i < gameObjects.size(); i++) {
+            if (!baked[i]) {
+                if (kept != i) {
+                    gameObjects[kept] = std::move(gameObjects[i]);
+                }
+                kept++;
+            }
+        }
+        gameObjects.erase(gameObjects.begin() + kept, gameObjects.end());
+
+        for (GameObject& batch : batchObjects) {
+            gameObjects.push_back(std::move(batch));
+        }
+    }
+
+    std::shared_ptr<JCATModel3D> StaticBatcher::mergeObjects(std::vector<GameObject>& gameObjects, const std::vector<uint32_t>& objectIndices, JCATModel3D::VertexFormat preferredFormat) {
+        size_t vertexCount = 0;
+        size_t indexCount = 0;
+        for (uint32_t index : objectIndices) {
+            const SourceGeometry& source = sources.at(gameObjects[index].model3D.get());
+            vertexCount += source.vertices.size();
+            indexCount += source.indices.size();
+        }
+
+        JCATModel3D::ModelBuilder merged{};
+        merged.vertices.reserve(vertexCount);
+        merged.indices.reserve(indexCount);
+
+        for (uint32_t index : objectIndices) {
+            GameObject& obj = gameObjects[index];
+            const SourceGeometry& source = sources.at(obj.model3D.get());
+
+            const glm::mat4 modelMatrix = obj.transform.modelMatrix();
+            const glm::mat3 normalMatrix = obj.transform.normalMatrix();
+            const uint32_t baseVertex = static_cast<uint32_t>(merged.vertices.size());
+
+            for (const JCATModel3D::Vertex3D& vertex : source.vertices) {
+                JCATModel3D::Vertex3D world = vertex;
+                world.position = glm::vec3{ modelMatrix * glm::vec4{ vertex.position, 1.0f } };
+
+                // The normal matrix keeps the inverse scale, renormalize so quantized formats still get unit normals
+                const glm::vec3 normal = normalMatrix * vertex.normal;
+                const float length = glm::length(normal);
+                world.normal = length > 0.0f ? normal / length : normal;
+
+                merged.vertices.push_back(world);
+            }
+
+            for (uint32_t sourceIndex : source.indices) {
+                merged.indices.push_back(baseVertex + sourceIndex);
+            }
+        }
+
+        stats.verticesBaked += merged.vertices.size();
+        stats.trianglesBaked += merged.indices.size() / 3;
+
+        return std::make_shared<JCATModel3D>(device, resourceManager, merged, preferredFormat);
+    }
+};
\ No newline at end of file
@@ -0,0 +1,91 @@
+#ifndef STATIC_BATCHER_H
+#define STATIC_BATCHER_H
+
+#include <memory>
+#include <vector>
+#include <unordered_map>
+
+#include "./engine/deviceSetup.h"
+#include "./engine/resourceManager.h"
+#include "./engine/3d/model3d.h"
+#include "./engine/3d/gameObject.h"
+
+namespace JCAT {
+    struct StaticBatchStats {
+        uint32_t objectsBaked = 0; ///< Static objects replaced by a batch
+        uint32_t batches = 0; ///< Merged objects that replaced them, one per draw
+        uint64_t verticesBaked = 0;
+        uint64_t trianglesBaked = 0;
+    };
+
+    /**
+     * @class StaticBatcher
+     * @brief Merges static objects into a few large meshes, drawn with one call each and an identity transform
+     *
+     * Static objects are grouped by what the renderer switches on between draws (hasLighting and hasTexture, the
+     * vertex format being the same for every batch) and by the cell of a chunkSize grid their world bounding sphere's
+     * center falls in. Each group becomes one model with every vertex already in world space. Chunking keeps the
+     * batches small enough for frustum culling, LOD selection and impostors to still work on them.
+     *
+     * Uploaded models keep no CPU copy of their geometry, so an object is only baked if its model's source geometry
+     * was given to addSourceGeometry(). Every other object, static or not, is left as it is.
+     */
+    class StaticBatcher {
+        public:
+            static constexpr float DEFAULT_CHUNK_SIZE = 16.0f;
+
+            StaticBatcher(DeviceSetup& d, ResourceManager& r, float chunkSize = DEFAULT_CHUNK_SIZE);
+
+            StaticBatcher(const StaticBatcher&) = delete;
+            StaticBatcher& operator=(const StaticBatcher&) = delete;
+
+            /**
+             * Registers the geometry model was uploaded from. Non indexed geometry is indexed here, merging identical vertices.
+             * LOD levels are ignored, batches hold the full detail level only.
+             */
+            void addSourceGeometry(const JCATModel3D* model, const JCATModel3D::ModelBuilder& geometry);
+
+            /**
+             * Replaces every bakeable static object in gameObjects with the batches they were merged into.
+             * The order of the objects left is kept, the batches are appended after them. Records its uploads into
+             * the open upload batch if there is one.
+             * @param preferredFormat Format to upload the batches in, see JCATModel3D
+             */
+            void bake(std::vector<GameObject>& gameObjects, JCATModel3D::VertexFormat preferredFormat = JCATModel3D::VertexFormat::STANDARD);
+
+            // Totals over every bake() call
+            const StaticBatchStats& getStats() const { return stats; }
+
+        private:
+            struct SourceGeometry {
+                std::vector<JCATModel3D::Vertex3D> vertices;
+                std::vector<uint32_t> indices;
+            };
+
+            // Everything objects must share to be merged
+            struct BatchKey {
+                glm::ivec3 cell;
+                uint32_t hasLighting;
+                uint32_t hasTexture;
+
+                bool operator==(const BatchKey& other) const {
+                    return cell == other.cell && hasLighting == other.hasLighting && hasTexture == other.hasTexture;
+                }
+            };
+
+            struct BatchKeyHash {
+                size_t operator()(const BatchKey& key) const;
+            };
+
+            std::shared_ptr<JCATModel3D> mergeObjects(std::vector<GameObject>& gameObjects, const std::vector<uint32_t>& objectIndices, JCATModel3D::VertexFormat preferredFormat);
+
+            DeviceSetup& device;
+            ResourceManager& resourceManager;
+            float chunkSize;
+
+            std::unordered_map<const JCATModel3D*, SourceGeometry> sources;
+            StaticBatchStats stats{};
+    };
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,127 @@
+#ifndef VERTEX_DEDUP_H
+#define VERTEX_DEDUP_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+namespace JCAT {
+    /**
+     * The (position, normal, texcoord) indices of one OBJ face corner.
+     * Every attribute of a Vertex3D is looked up through these, so two corners with the same
+     * triplet always produce identical vertices and the triplet can stand in for the vertex itself.
+     */
+    struct ObjIndexKey {
+        int32_t vertex;
+        int32_t normal;
+        int32_t texcoord;
+
+        bool operator==(const ObjIndexKey& other) const {
+            return vertex == other.vertex && normal == other.normal && texcoord == other.texcoord;
+        }
+    };
+
+    /**
+     * @class VertexDedupTable
+     * @brief Open addressing (linear probing) map from ObjIndexKey to an output vertex index
+     *
+     * Keys and values live in flat arrays sized once by reserve(), so there are no per entry
+     * allocations and a lookup is one hash plus a short probe through contiguous memory.
+     */
+    class VertexDedupTable {
+        public:
+            static constexpr uint32_t EMPTY = UINT32_MAX;
+
+            /**
+             * Sizes the table for up to maxEntries unique keys at no more than 50% load, clearing it
+             * @param maxEntries Upper bound on unique keys (the corner count of the mesh always works)
+             */
+            void reserve(size_t maxEntries) {
+                size_t capacity = 16;
+                while (capacity < maxEntries * 2) {
+                    capacity <<= 1;
+                }
+
+                keys.assign(capacity, ObjIndexKey{});
+                values.assign(capacity, EMPTY);
+                mask = capacity - 1;
+                count = 0;
+            }
+
+            /**
+             * Returns the index stored for key, or stores nextIndex and returns it if key is new
+             * @param inserted Set to true when nextIndex was stored
+             */
+            uint32_t findOrInsert(const ObjIndexKey& key, uint32_t nextIndex, bool& inserted) {
+                // Grow if reserve() was given too small a bound, keeping the load factor at 50% or below
+                if ((count + 1) * 2 > keys.size()) {
+                    rehash(keys.empty() ? 16 : keys.size() * 2);
+                }
+
+                size_t slot = hash(key) & mask;
+                while (values[slot] != EMPTY) {
+                    if (keys[slot] == key) {
+                        inserted = false;
+                        return values[slot];
+                    }
+
+                    slot = (slot + 1) & mask;
+                }
+
+                keys[slot] = key;
+                values[slot] = nextIndex;
+                count++;
+                inserted = true;
+
+                return nextIndex;
+            }
+
+            size_t size() const { return count; }
+
+        private:
+            static size_t hash(const ObjIndexKey& key) {
+                // Mix the three indices, then run the murmur3 finalizer so nearby indices spread across the table
+                uint64_t h = static_cast<uint32_t>(key.vertex);
+                h = h * 0x9E3779B97F4A7C15ull + static_cast<uint32_t>(key.normal);
+                h = h * 0x9E3779B97F4A7C15ull + static_cast<uint32_t>(key.texcoord);
+
+                h ^= h >> 33;
+                h *= 0xff51afd7ed558ccdull;
+                h ^= h >> 33;
+                h *= 0xc4ceb9fe1a85ec53ull;
+                h ^= h >> 33;
+
+                return static_cast<size_t>(h);
+            }
+
+            void rehash(size_t capacity) {
+                std::vector<ObjIndexKey> oldKeys = std::move(keys);
+                std::vector<uint32_t> oldValues = std::move(values);
+
+                keys.assign(capacity, ObjIndexKey{});
+                values.assign(capacity, EMPTY);
+                mask = capacity - 1;
+
+                for (size_t i = 0; i < oldKeys.size(); i++) {
+                    if (oldValues[i] == EMPTY) {
+                        continue;
+                    }
+
+                    size_t slot = hash(oldKeys[i]) & mask;
+                    while (values[slot] != EMPTY) {
+                        slot = (slot + 1) & mask;
+                    }
+
+                    keys[slot] = oldKeys[i];
+                    values[slot] = oldValues[i];
+                }
+            }
+
+            std::vector<ObjIndexKey> keys;
+            std::vector<uint32_t> values;
+            size_t mask = 0;
+            size_t count = 0;
+    };
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,92 @@
+#ifndef ASSET_REGISTRY_H
+#define ASSET_REGISTRY_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "./engine/deviceSetup.h"
+#include "./engine/resourceManager.h"
+#include "./engine/3d/model3d.h"
+
+namespace JCAT {
+    struct AssetRegistryStats {
+        uint32_t hits = 0; ///< Requests answered with an already uploaded model
+        uint32_t loads = 0; ///< Models parsed (or read from their cache) and uploaded
+    };
+
+    /**
+     * @class AssetRegistry
+     * @brief Remembers every model uploaded through it, so each file costs one parse and one set of GPU buffers
+     *
+     * Models are keyed by their normalized path plus every load option that changes the uploaded buffers,
+     * so "models/../models/cube.obj" and "models/cube.obj" share a model while a COMPACT and a STANDARD upload of
+     * the same file do not. The registry holds one shared reference per model: a model stays loaded while the
+     * registry or anyone else holds it, and unloadModel()/purgeUnused() only drop the registry's reference.
+     *
+     * Not thread safe, use it from the thread that uploads models (the same rule as ModelLoader::uploadAll()).
+     */
+    class AssetRegistry {
+        public:
+            AssetRegistry(DeviceSetup& device, ResourceManager& resourceManager);
+
+            AssetRegistry(const AssetRegistry&) = delete;
+            AssetRegistry& operator=(const AssetRegistry&) = delete;
+
+            // Absolute, with "." and ".." resolved and symlinks followed where the file exists
+            static std::string normalizePath(const std::string& filepath);
+
+            // The registry key for a model file loaded with the given options, ModelLoader uses the same keys
+            static std::string makeModelKey(const std::string& filepath, bool hasIndexBuffer, bool optimizeMesh, JCATModel3D::VertexFormat vertexFormat, uint32_t lodLevels);
+
+            /**
+             * Returns the registered model, loading it like JCATModel3D::createModelFromFile() on first use
+             * @throws std::runtime_error if the file cannot be loaded
+             */
+            std::shared_ptr<JCATModel3D> loadModel(const std::string& filepath, bool hasIndexBuffer, bool optimizeMesh = true,
+                                                   JCATModel3D::VertexFormat vertexFormat = JCATModel3D::VertexFormat::STANDARD, uint32_t lodLevels = 1);
+
+            // The model registered under key (see makeModelKey()), or null
+            std::shared_ptr<JCATModel3D> findModel(const std::string& key);
+
+            /**
+             * Registers a model uploaded elsewhere (e.g. by ModelLoader) under key
+             * @return The model now registered under key, which is the existing one if another upload got there first
+             */
+            std::shared_ptr<JCATModel3D> registerModel(const std::string& key, const std::string& filepath, std::shared_ptr<JCATModel3D> model);
+
+            bool isLoaded(const std::string& filepath) const;
+
+            // References held outside the registry to any variant of the file, 0 once only the registry keeps it alive
+            long getReferenceCount(const std::string& filepath) const;
+
+            /**
+             * Drops the registry's reference to every variant of the file, they are destroyed once the last outside reference goes
+             * @return How many variants were registered
+             */
+            size_t unloadModel(const std::string& filepath);
+
+            /**
+             * Unloads every model nothing outside the registry references anymore
+             * @return How many models were unloaded
+             */
+            size_t purgeUnused();
+
+            size_t getModelCount() const { return models.size(); }
+            const AssetRegistryStats& getStats() const { return stats; }
+
+        private:
+            struct ModelEntry {
+                std::string path; ///< Normalized, used to find every variant of a file
+                std::shared_ptr<JCATModel3D> model;
+            };
+
+            DeviceSetup& device;
+            ResourceManager& resourceManager;
+
+            std::unordered_map<std::string, ModelEntry> models;
+            AssetRegistryStats stats{};
+    };
+};
+
+#endif
\ No newline at end of file
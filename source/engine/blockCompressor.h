@@ -0,0 +1,71 @@
+#ifndef BLOCK_COMPRESSOR_H
+#define BLOCK_COMPRESSOR_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+namespace JCAT {
+    class ThreadPool;
+
+    /**
+     * @class BlockCompressor
+     * @brief CPU encoder for the BC1, BC3, BC5 and BC7 block compressed formats, run when textures are imported
+     *
+     * Every 4x4 block is fitted along the principal axis of its texels, its indices picked with SSE2 where available,
+     * then the endpoints are refined by least squares against those indices. Blocks on the right and bottom edge of an
+     * image whose size is not a multiple of 4 repeat its last column and row. Bands of block rows run on a ThreadPool.
+     *
+     * BC1 is always written in its opaque 4 color mode and BC7 always in mode 6 (one subset, 7 bit RGBA endpoints with
+     * a p-bit each, 4 bit indices), which trades a few dB against the full mode search for an order of magnitude in speed.
+     */
+    class BlockCompressor {
+        public:
+            enum class Format {
+                BC1, ///< RGB, 8 bytes per block
+                BC3, ///< RGBA, BC1 color and a BC4 alpha block, 16 bytes per block
+                BC5, ///< RG only (normal maps), two BC4 blocks, 16 bytes per block
+                BC7  ///< RGBA, 16 bytes per block
+            };
+
+            static constexpr uint32_t BLOCK_SIZE = 4; ///< Texels along each side of a block
+
+            static uint32_t getBlockBytes(Format format) { return format == Format::BC1 ? 8 : 16; }
+
+            static const char* getName(Format format);
+
+            // Bytes of a width x height image once compressed, partial blocks included
+            static size_t getCompressedSize(Format format, uint32_t width, uint32_t height);
+
+            // RGBA channels the format keeps, the rest decompress to 0 (or 255 for alpha)
+            static uint32_t getChannelCount(Format format);
+
+            /**
+             * Maps a VkFormat to the encoder writing it
+             * @return false if the format is not one of the BC1, BC3, BC5 or BC7 formats (UNORM or SRGB)
+             */
+            static bool getFormat(VkFormat vkFormat, Format& format);
+
+            /**
+             * Encodes a tightly packed RGBA8 image
+             * @param output getCompressedSize() bytes, block rows top to bottom
+             * @param threadPool Large images are split into bands of block rows run on it, small ones are encoded on the calling thread
+             */
+            static void compress(Format format, const uint8_t* rgba, uint32_t width, uint32_t height, uint8_t* output, ThreadPool& threadPool);
+
+            /**
+             * Decodes blocks written by compress() back to RGBA8, for measuring the quality of an encoding.
+             * BC7 blocks are only decoded in mode 6, the others come out black.
+             */
+            static void decompress(Format format, const uint8_t* blocks, uint32_t width, uint32_t height, uint8_t* rgba);
+
+            /**
+             * Peak signal to noise ratio in dB over the first channels of every RGBA8 texel
+             * @return INFINITY if both images are identical
+             */
+            static double computePsnr(const uint8_t* reference, const uint8_t* decoded, size_t texelCount, uint32_t channels);
+    };
+};
+
+#endif
\ No newline at end of file
@@ -26,9 +26,10 @@ namespace JCAT {
 
             /**
              * Map a memory range of this buffer. If successful, mapped points to the specified buffer range.
+             * Host visible memory is mapped persistently by the MemoryAllocator, so this never calls vkMapMemory.
              *
              * @param size (Optional) Size of the memory range to map. Pass VK_WHOLE_SIZE to map the complete
-             * buffer range.
+             * buffer range. The range has to lie within the buffer.
              * @param offset (Optional) Byte offset from beginning
              *
              * @return VkResult of the buffer mapping call
@@ -38,7 +39,7 @@ namespace JCAT {
             /**
              * Unmap a mapped memory range
              *
-             * @note Does not return a result as vkUnmapMemory can't fail
+             * @note The memory itself stays mapped until the buffer is destroyed
              */
             void unmap();
 
@@ -59,7 +60,7 @@ namespace JCAT {
              * @note Only required for non-coherent memory
              *
              * @param size (Optional) Size of the memory range to flush. Pass VK_WHOLE_SIZE to flush the
-             * complete buffer range.
+             * complete buffer range. The range has to lie within the buffer.
              * @param offset (Optional) Byte offset from beginning
              *
              * @return VkResult of the flush call
@@ -82,7 +83,7 @@ namespace JCAT {
              * @note Only required for non-coherent memory
              *
              * @param size (Optional) Size of the memory range to invalidate. Pass VK_WHOLE_SIZE to invalidate
-             * the complete buffer range.
+             * the complete buffer range. The range has to lie within the buffer.
              * @param offset (Optional) Byte offset from beginning
              *
              * @return VkResult of the invalidate call
@@ -127,6 +128,15 @@ namespace JCAT {
              */
             VkResult invalidateIndex(int index);
 
+            /**
+             * Lets the defragmenter move this buffer to other memory, getBuffer() returns the new handle afterwards
+             *
+             * @note Only for device local buffers created with VK_BUFFER_USAGE_TRANSFER_SRC_BIT
+             *
+             * @param onMoved (Optional) Called after a move, e.g. to rewrite descriptor sets holding the old handle
+             */
+            void setMovable(std::function<void()> onMoved = {});
+
             VkBuffer getBuffer() const { return buffer; }
             void *getMappedMemory() const { return mapped; }
             uint32_t getInstanceCount() const { return instanceCount; }
@@ -152,7 +162,7 @@ namespace JCAT {
             ResourceManager &resourceManager;
             void *mapped = nullptr;
             VkBuffer buffer = VK_NULL_HANDLE;
-            VkDeviceMemory memory = VK_NULL_HANDLE;
+            MemoryAllocation memory;
 
             VkDeviceSize bufferSize;
             uint32_t instanceCount;
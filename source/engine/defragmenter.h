@@ -0,0 +1,110 @@
+#ifndef DEFRAGMENTER_H
+#define DEFRAGMENTER_H
+
+#include <deque>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include "./engine/deviceSetup.h"
+#include "./engine/memoryAllocator.h"
+
+namespace JCAT {
+    class ResourceManager;
+
+    struct DefragmentationStats {
+        uint32_t moves = 0; ///< Buffers and images copied to a new place
+        VkDeviceSize bytesMoved = 0;
+        uint32_t blocksReleased = 0;
+        VkDeviceSize bytesReclaimed = 0; ///< Device memory given back after emptying blocks
+    };
+
+    /**
+     * @class Defragmenter
+     * @brief Empties sparsely used memory blocks by copying the resources in them into other blocks on the GPU
+     *
+     * Only resources registered with ResourceManager::makeMovable() are moved, a block holding anything else is left
+     * alone. A block is emptied once its resources fit into the free space of the other blocks of its pool and it is
+     * at most half full. Each step() copies up to a byte budget on the graphics queue, patches the owner's handle and
+     * allocation right away and lets the owner know through its callback. Anything submitted after the step sees the
+     * copy, the old resource is only destroyed once frames still using it have finished.
+     *
+     * Owned by ResourceManager (see ResourceManager::defragment()).
+     */
+    class Defragmenter {
+        public:
+            // Steps a replaced resource is kept alive for, one more than SwapChain::MAX_FRAMES_IN_FLIGHT so every frame that used it has finished
+            static constexpr uint64_t RETIRE_FRAMES = 4;
+
+            Defragmenter(DeviceSetup& device, ResourceManager& resourceManager);
+            ~Defragmenter();
+
+            Defragmenter(const Defragmenter&) = delete;
+            Defragmenter& operator=(const Defragmenter&) = delete;
+
+            void addBuffer(VkBuffer& buffer, MemoryAllocation& memory, VkDeviceSize size, VkBufferUsageFlags usage, std::function<void()> onMoved);
+            void addImage(VkImage& image, MemoryAllocation& memory, const VkImageCreateInfo& imageInfo, VkImageLayout layout, std::function<void()> onMoved);
+
+            // Stops tracking a resource that is about to be destroyed, waiting for a copy into it first
+            void remove(const MemoryAllocation& memory);
+
+            /**
+             * Retires what earlier steps replaced and moves up to byteBudget bytes, call it once a frame
+             * @param byteBudget A single resource larger than the budget still moves, on its own
+             */
+            void step(VkDeviceSize byteBudget);
+
+            // Runs destroy once the frames that may still use an old handle have finished, e.g. for an image view replaced in a move callback
+            void destroyLater(std::function<void()> destroy);
+
+            // Blocks until every copy submitted so far has finished, uploads call it before writing into a moved resource
+            void waitForMoves();
+
+            const DefragmentationStats& getStats() const { return stats; }
+
+        private:
+            struct Movable {
+                VkBuffer* buffer = nullptr;
+                VkImage* image = nullptr;
+                MemoryAllocation* memory;
+                VkDeviceSize size = 0;
+                VkBufferUsageFlags usage = 0;
+                VkImageCreateInfo imageInfo{};
+                VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+                std::function<void()> onMoved;
+                bool moved = false;
+            };
+
+            // What one frame's step left behind, released once the frames using it are done
+            struct Retirement {
+                uint64_t frame;
+                VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+                VkFence fence = VK_NULL_HANDLE;
+                std::vector<std::function<void()> > destroys;
+            };
+
+            // The block to empty next, or null if none is worth it
+            const MemoryBlock* findSparseBlock();
+
+            // Records the copy of movable into a new resource and swaps it in, false if no other block has room
+            bool move(Movable& movable, VkCommandBuffer commandBuffer, Retirement& retirement);
+            void recordImageCopy(VkCommandBuffer commandBuffer, const Movable& movable, VkImage oldImage, VkImage newImage);
+
+            void retire(bool waitForAll);
+            Retirement& getRetirement();
+
+            DeviceSetup& device;
+            ResourceManager& resourceManager;
+
+            std::unordered_map<const MemoryAllocation*, Movable> movables;
+            std::deque<Retirement> retirements; ///< Oldest first
+
+            uint64_t frame = 0;
+            const MemoryBlock* target = nullptr; ///< The block being emptied, steps keep at it until nothing movable is left in it
+            const MemoryBlock* failedBlock = nullptr; ///< A block whose resources did not fit elsewhere, skipped until more space frees up
+            VkDeviceSize failedBytesFree = 0;
+            DefragmentationStats stats{};
+    };
+};
+
+#endif
\ No newline at end of file
@@ -40,13 +40,18 @@ namespace JCAT {
      * This struct stores the indices of the graphics and present queue families 
      * required for rendering operations and presenting images to the swap chain. 
      * It also includes flags to indicate if these families have valid indices.
+     *
+     * The transfer family is optional and only set for a family without graphics support,
+     * whose queue can copy uploads while the graphics queue keeps rendering.
      */
     struct QueueFamilyIndices {
         uint32_t graphicsFamily;
         uint32_t presentFamily;
+        uint32_t transferFamily;
 
         bool graphicsFamilyHasValue = false;
         bool presentFamilyHasValue = false;
+        bool transferFamilyHasValue = false;
 
         /**
          * @brief Checks if both graphics and present family indices are set.
@@ -143,6 +148,33 @@ namespace JCAT {
              */
             VkQueue presentQueue();
 
+            /**
+             * @brief Retrieves the queue uploads are copied on.
+             *
+             * @return VkQueue The dedicated transfer queue, or the graphics queue if the device has none.
+             */
+            VkQueue transferQueue();
+
+            /**
+             * @brief Retrieves the command pool for the transfer queue.
+             *
+             * @return VkCommandPool The pool for transferQueue(), the same as getCommandPool() if the device has no dedicated transfer queue.
+             */
+            VkCommandPool getTransferCommandPool();
+
+            /**
+             * @brief Checks whether transferQueue() belongs to a queue family of its own.
+             *
+             * Resources written on a dedicated transfer queue have to be handed over to the graphics
+             * queue family (or be created with concurrent sharing) before rendering may use them.
+             *
+             * @return True if uploads run on a different queue family than rendering.
+             */
+            bool hasDedicatedTransferQueue();
+
+            uint32_t graphicsQueueFamily();
+            uint32_t transferQueueFamily();
+
             SwapChainSupportDetails getSwapChainSupport();
             VkFormat findSupportedDepthFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
             uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
@@ -216,6 +248,16 @@ namespace JCAT {
              */
             void createCommandPool();
 
+            /**
+             * @brief Creates a command pool for the dedicated transfer queue.
+             *
+             * Does nothing if the device has no dedicated transfer queue, getTransferCommandPool()
+             * falls back to the graphics command pool then.
+             *
+             * @throws std::runtime_error If the command pool creation fails.
+             */
+            void createTransferCommandPool();
+
             /**
              * @brief Sets up the Vulkan debug messenger.
              *
@@ -266,6 +308,9 @@ namespace JCAT {
             /** Command pool for allocating command buffers for the graphics queue. */
             VkCommandPool commandPool;
 
+            /** Command pool for the dedicated transfer queue, null if there is none. */
+            VkCommandPool transferCommandPool = VK_NULL_HANDLE;
+
             /** Vulkan debug messenger handle. */
             VkDebugUtilsMessengerEXT debugMessenger;
 
@@ -281,6 +326,13 @@ namespace JCAT {
             /** Queue for presenting images to the window. */
             VkQueue presentQueue_;
 
+            /** Queue for copying uploads, the graphics queue if the device has no dedicated transfer queue. */
+            VkQueue transferQueue_;
+
+            /** Queue family indices of graphicsQueue_ and transferQueue_, equal without a dedicated transfer queue. */
+            uint32_t graphicsFamily_;
+            uint32_t transferFamily_;
+
             /** List of validation layers to enable for debugging and validation. */
             std::vector<const char*> validationLayers = {
                 "VK_LAYER_KHRONOS_validation"
@@ -0,0 +1,92 @@
+#ifndef GEOMETRY_POOL_H
+#define GEOMETRY_POOL_H
+
+#include <map>
+#include <memory>
+
+#include "./engine/deviceSetup.h"
+#include "./engine/buffer.h"
+
+namespace JCAT {
+    // A byte range of one of the pool's buffers, size 0 means nothing is allocated
+    struct GeometryRange {
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+    };
+
+    struct GeometryPoolStats {
+        VkDeviceSize vertexBytesUsed = 0;
+        VkDeviceSize vertexCapacity = 0;
+        VkDeviceSize indexBytesUsed = 0;
+        VkDeviceSize indexCapacity = 0;
+        uint32_t allocationCount = 0; ///< Live vertex and index ranges together
+    };
+
+    /**
+     * @class GeometryPool
+     * @brief One device local vertex buffer and one index buffer that every model's geometry is sub-allocated from
+     *
+     * Models in the pool all bind the same two buffers and tell their draws apart by vertexOffset and firstIndex,
+     * so consecutive objects are drawn without rebinding anything. Both buffers are carved up first fit, freed
+     * ranges merge with free neighbours so unloading models does not leave the pool in ever smaller pieces.
+     *
+     * Owned by ResourceManager (see ResourceManager::getGeometryPool()), every model using it has to be destroyed first.
+     */
+    class GeometryPool {
+        public:
+            static constexpr VkDeviceSize DEFAULT_VERTEX_CAPACITY = 32ull << 20;
+            static constexpr VkDeviceSize DEFAULT_INDEX_CAPACITY = 16ull << 20;
+
+            GeometryPool(DeviceSetup& device, ResourceManager& resourceManager, VkDeviceSize vertexCapacity = DEFAULT_VERTEX_CAPACITY, VkDeviceSize indexCapacity = DEFAULT_INDEX_CAPACITY);
+
+            GeometryPool(const GeometryPool&) = delete;
+            GeometryPool& operator=(const GeometryPool&) = delete;
+
+            /**
+             * Reserves size bytes of the vertex buffer starting at a multiple of alignment
+             * @param alignment Any value, not just powers of two, pass the vertex size so the offset is a whole number of vertices
+             * @return False if no free range is large enough, range is left untouched then
+             */
+            bool allocateVertices(VkDeviceSize size, VkDeviceSize alignment, GeometryRange& range);
+
+            // Same as allocateVertices(), in the index buffer
+            bool allocateIndices(VkDeviceSize size, VkDeviceSize alignment, GeometryRange& range);
+
+            void freeVertices(const GeometryRange& range);
+            void freeIndices(const GeometryRange& range);
+
+            VkBuffer getVertexBuffer() const { return vertexBuffer->getBuffer(); }
+            VkBuffer getIndexBuffer() const { return indexBuffer->getBuffer(); }
+
+            GeometryPoolStats getStats() const;
+
+        private:
+            // First fit free list over the bytes of one buffer
+            class RangeAllocator {
+                public:
+                    explicit RangeAllocator(VkDeviceSize capacity);
+
+                    bool allocate(VkDeviceSize size, VkDeviceSize alignment, GeometryRange& range);
+                    void free(const GeometryRange& range);
+
+                    VkDeviceSize getCapacity() const { return capacity; }
+                    VkDeviceSize getBytesUsed() const { return bytesUsed; }
+                    uint32_t getAllocationCount() const { return allocationCount; }
+
+                private:
+                    VkDeviceSize capacity;
+                    VkDeviceSize bytesUsed = 0;
+                    uint32_t allocationCount = 0;
+
+                    std::map<VkDeviceSize, VkDeviceSize> freeRanges; ///< Offset to size, never two touching ranges
+            };
+
+            std::unique_ptr<JCATBuffer> vertexBuffer;
+            std::unique_ptr<JCATBuffer> indexBuffer;
+
+            RangeAllocator vertexRanges;
+            RangeAllocator indexRanges;
+    };
+};
+
+#endif
\ No newline at end of file
@@ -3,6 +3,7 @@
 
 #include "./engine/deviceSetup.h"
 #include "./engine/resourceManager.h"
+#include "./engine/3d/model3d.h"
 
 #include <string>
 #include <vector>
@@ -90,9 +91,22 @@ namespace JCAT {
              * - SOLID_SPRITE_PIPELINE: Renders opaque 2D sprites without transparency.
              * - TRANSPARENT_SPRITE_PIPELINE: Renders 2D sprites with transparency support.
              * - SOLID_OBJECT_PIPELINE: Renders solid 3D objects without transparency.
+             * - INSTANCED_OBJECT_PIPELINE: Renders solid 3D objects that share a model in a single instanced draw call.
+             * - COMPACT_OBJECT_PIPELINE: Renders solid 3D objects whose model uses the quantized CompactVertex3D layout.
+             * - INSTANCED_COMPACT_OBJECT_PIPELINE: Instanced variant of COMPACT_OBJECT_PIPELINE.
+             * - SPLIT_OBJECT_PIPELINE: Renders solid 3D objects whose model keeps its positions in a separate stream (VertexFormat::SPLIT).
+             * - INSTANCED_SPLIT_OBJECT_PIPELINE: Instanced variant of SPLIT_OBJECT_PIPELINE.
+             * - CROSS_FADE_OBJECT_PIPELINE: Renders solid 3D objects dithered out by their fade while they blend into an impostor.
+             * - CROSS_FADE_COMPACT_OBJECT_PIPELINE: Variant of CROSS_FADE_OBJECT_PIPELINE for models using the CompactVertex3D layout.
+             * - CROSS_FADE_SPLIT_OBJECT_PIPELINE: Variant of CROSS_FADE_OBJECT_PIPELINE for models with a separate position stream.
+             * - DEPTH_ONLY_PIPELINE: Writes only depth, e.g. for a depth prepass. Reads just the position stream of SPLIT models.
+             * - IMPOSTOR_BAKE_PIPELINE: Renders a model's views into an ImpostorAtlas, writing either its color or its model space normal.
+             * - IMPOSTOR_BAKE_COMPACT_PIPELINE: Variant of IMPOSTOR_BAKE_PIPELINE for models using the CompactVertex3D layout.
+             * - IMPOSTOR_BAKE_SPLIT_PIPELINE: Variant of IMPOSTOR_BAKE_PIPELINE for models with a separate position stream.
+             * - IMPOSTOR_PIPELINE: Draws camera facing quads textured from an ImpostorAtlas in place of distant models, one per instance.
              * - TRANSPARENT_OBJECT_PIPELINE: Renders 3D objects with transparency enabled.
              * - UI_RENDERING_PIPELINE: Used specifically for rendering 2D UI elements.
-             * - SHADOW_MAPPING_PIPELINE: Configured for shadow map generation.
+             * - SHADOW_MAPPING_PIPELINE: Configured for shadow map generation, reads just the position stream of SPLIT models.
              * - SKYBOX_RENDERING_PIPELINE: Renders skyboxes for background scenery.
              * - PARTICLE_RENDERING_PIPELINE: Optimized for rendering particle systems.
              * - POST_PROCESSING_PIPELINE: Used for applying post-processing effects (e.g., bloom, tone mapping).
@@ -101,6 +115,19 @@ namespace JCAT {
                 SOLID_SPRITE_PIPELINE,
                 TRANSPARENT_SPRITE_PIPELINE,
                 SOLID_OBJECT_PIPELINE,
+                INSTANCED_OBJECT_PIPELINE,
+                COMPACT_OBJECT_PIPELINE,
+                INSTANCED_COMPACT_OBJECT_PIPELINE,
+                SPLIT_OBJECT_PIPELINE,
+                INSTANCED_SPLIT_OBJECT_PIPELINE,
+                CROSS_FADE_OBJECT_PIPELINE,
+                CROSS_FADE_COMPACT_OBJECT_PIPELINE,
+                CROSS_FADE_SPLIT_OBJECT_PIPELINE,
+                DEPTH_ONLY_PIPELINE,
+                IMPOSTOR_BAKE_PIPELINE,
+                IMPOSTOR_BAKE_COMPACT_PIPELINE,
+                IMPOSTOR_BAKE_SPLIT_PIPELINE,
+                IMPOSTOR_PIPELINE,
                 TRANSPARENT_OBJECT_PIPELINE,
                 UI_RENDERING_PIPELINE,
                 SHADOW_MAPPING_PIPELINE,
@@ -151,6 +178,15 @@ namespace JCAT {
             static void configureSolidSpritePipeline(PipelineConfigInfo& solidSpriteRenderingInfo);
             static void configureTransparentSpritePipeline(PipelineConfigInfo& transparentSpriteRenderingInfo);
             static void configureSolidObjectPipeline(PipelineConfigInfo& solidObjectRenderingInfo);
+            static void configureInstancedObjectPipeline(PipelineConfigInfo& instancedObjectRenderingInfo);
+            static void configureCompactObjectPipeline(PipelineConfigInfo& compactObjectRenderingInfo);
+            static void configureInstancedCompactObjectPipeline(PipelineConfigInfo& instancedCompactObjectRenderingInfo);
+            static void configureSplitObjectPipeline(PipelineConfigInfo& splitObjectRenderingInfo);
+            static void configureInstancedSplitObjectPipeline(PipelineConfigInfo& instancedSplitObjectRenderingInfo);
+            static void configureCrossFadeObjectPipeline(PipelineConfigInfo& crossFadeObjectRenderingInfo);
+            static void configureDepthOnlyPipeline(PipelineConfigInfo& depthOnlyInfo);
+            static void configureImpostorBakePipeline(PipelineConfigInfo& impostorBakeInfo);
+            static void configureImpostorPipeline(PipelineConfigInfo& impostorRenderingInfo);
             static void configureTransparentObjectPipeline(PipelineConfigInfo& transparentObjectRenderingInfo);
             static void configureUIRenderingPipeline(PipelineConfigInfo& UIRenderingInfo);
             static void configureShadowMappingPipeline(PipelineConfigInfo& shadowMappingInfo);
@@ -161,6 +197,19 @@ namespace JCAT {
             void createSolidSpritePipeline(const std::string& vertFilepath, const std::string& fragfilepath, PipelineConfigInfo& solidSpriteRenderingInfo);
             void createTransparentSpritePipeline(const std::string& vertFilepath, const std::string& fragfilepath, PipelineConfigInfo& solidSpriteRenderingInfo);
             void createSolidObjectPipeline(const std::string& vertFilepath, const std::string& fragfilepath, PipelineConfigInfo& solidSpriteRenderingInfo);
+            void createInstancedObjectPipeline(const std::string& vertFilepath, const std::string& fragfilepath, PipelineConfigInfo& instancedObjectRenderingInfo);
+            void createCompactObjectPipeline(const std::string& vertFilepath, const std::string& fragfilepath, PipelineConfigInfo& compactObjectRenderingInfo);
+            void createInstancedCompactObjectPipeline(const std::string& vertFilepath, const std::string& fragfilepath, PipelineConfigInfo& instancedCompactObjectRenderingInfo);
+            void createSplitObjectPipeline(const std::string& vertFilepath, const std::string& fragfilepath, PipelineConfigInfo& splitObjectRenderingInfo);
+            void createInstancedSplitObjectPipeline(const std::string& vertFilepath, const std::string& fragfilepath, PipelineConfigInfo& instancedSplitObjectRenderingInfo);
+            void createCrossFadeObjectPipeline(const std::string& vertFilepath, const std::string& fragfilepath, PipelineConfigInfo& crossFadeObjectRenderingInfo);
+            void createCrossFadeCompactObjectPipeline(const std::string& vertFilepath, const std::string& fragfilepath, PipelineConfigInfo& crossFadeObjectRenderingInfo);
+            void createCrossFadeSplitObjectPipeline(const std::string& vertFilepath, const std::string& fragfilepath, PipelineConfigInfo& crossFadeObjectRenderingInfo);
+            void createDepthOnlyPipeline(const std::string& vertFilepath, const std::string& fragfilepath, PipelineConfigInfo& depthOnlyInfo);
+            void createImpostorBakePipeline(const std::string& vertFilepath, const std::string& fragfilepath, PipelineConfigInfo& impostorBakeInfo);
+            void createImpostorBakeCompactPipeline(const std::string& vertFilepath, const std::string& fragfilepath, PipelineConfigInfo& impostorBakeInfo);
+            void createImpostorBakeSplitPipeline(const std::string& vertFilepath, const std::string& fragfilepath, PipelineConfigInfo& impostorBakeInfo);
+            void createImpostorPipeline(const std::string& vertFilepath, const std::string& fragfilepath, PipelineConfigInfo& impostorRenderingInfo);
             void createTransparentObjectPipeline(const std::string& vertFilepath, const std::string& fragfilepath, PipelineConfigInfo& solidSpriteRenderingInfo);
             void createUIRenderingPipeline(const std::string& vertFilepath, const std::string& fragfilepath, PipelineConfigInfo& solidSpriteRenderingInfo);
             void createShadowMappingPipeline(const std::string& vertFilepath, const std::string& fragfilepath, PipelineConfigInfo& solidSpriteRenderingInfo);
@@ -175,7 +224,11 @@ namespace JCAT {
                                 VkPipelineVertexInputStateCreateInfo& vertexInputInfo);
 
             VkPipelineVertexInputStateCreateInfo getDescriptions2D();
-            VkPipelineVertexInputStateCreateInfo getDescriptions3D();
+            VkPipelineVertexInputStateCreateInfo getDescriptions3D(bool instanced = false, JCATModel3D::VertexFormat format = JCATModel3D::VertexFormat::STANDARD);
+            // Only the position stream of a SPLIT model, for pipelines that write nothing but depth
+            VkPipelineVertexInputStateCreateInfo getPositionDescriptions3D(bool instanced = false);
+            // Per-instance ImpostorAtlas::Instance data only, the quad's corners come from the vertex index
+            VkPipelineVertexInputStateCreateInfo getImpostorDescriptions();
 
             std::vector<VkPipelineShaderStageCreateInfo> createShaderStages(const std::string& vertFilepath, const std::string& fragFilepath);
             void createShaderModule(const std::vector<char>& shaderBinaryCode, VkShaderModule* shaderModule);
@@ -183,8 +236,11 @@ namespace JCAT {
             DeviceSetup &device;
             ResourceManager &resources;
             std::unordered_map<PipelineType, VkPipeline> graphicsPipelines;
-            VkShaderModule vertShaderModule;
-            VkShaderModule fragShaderModule;
+            std::vector<VkShaderModule> shaderModules;
+
+            // Backing storage for the pointers handed out by getDescriptions2D/3D, must outlive vkCreateGraphicsPipelines
+            std::vector<VkVertexInputBindingDescription> bindingDescriptions;
+            std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
     };
 };
 
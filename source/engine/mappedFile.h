@@ -0,0 +1,49 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+namespace JCAT {
+    /**
+     * @class MappedFile
+     * @brief Read only memory mapping of a file on disk.
+     *
+     * Lets cached assets be copied straight from the page cache into staging buffers without
+     * first reading them into a heap allocation. Unmapped automatically on destruction.
+     */
+    class MappedFile {
+        public:
+            MappedFile() = default;
+            ~MappedFile();
+
+            MappedFile(const MappedFile&) = delete;
+            MappedFile& operator=(const MappedFile&) = delete;
+            MappedFile(MappedFile&& other) noexcept;
+            MappedFile& operator=(MappedFile&& other) noexcept;
+
+            /**
+             * Maps the given file into memory
+             * @param filepath The path to the file
+             * @return false if the file does not exist, is empty, or could not be mapped
+             */
+            bool open(const std::string& filepath);
+            void close();
+
+            bool isOpen() const { return mappedData != nullptr; }
+            const uint8_t* data() const { return static_cast<const uint8_t*>(mappedData); }
+            size_t size() const { return mappedSize; }
+
+        private:
+            void* mappedData = nullptr;
+            size_t mappedSize = 0;
+
+#ifdef _WIN32
+            void* fileHandle = nullptr;
+            void* mappingHandle = nullptr;
+#endif
+    };
+};
+
+#endif
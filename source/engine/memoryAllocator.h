@@ -0,0 +1,141 @@
+#ifndef MEMORY_ALLOCATOR_H
+#define MEMORY_ALLOCATOR_H
+
+#include <memory>
+#include <vector>
+
+#include "./engine/deviceSetup.h"
+#include "./engine/memorySuballocator.h"
+
+namespace JCAT {
+    struct MemoryBlock;
+
+    // Where a buffer or image lives, bind it to memory at offset
+    struct MemoryAllocation {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+        uint32_t memoryType = 0;
+        void* mapped = nullptr; ///< Host pointer to offset if the memory is host visible, such memory stays mapped for its whole life
+        MemoryBlock* block = nullptr; ///< Null for dedicated allocations
+        uint64_t handle = 0;
+    };
+
+    struct MemoryTypeStats {
+        uint32_t memoryType = 0;
+        VkMemoryPropertyFlags propertyFlags = 0;
+        uint32_t blockCount = 0;
+        uint32_t dedicatedCount = 0; ///< Allocations too large for a block, each with memory of its own
+        VkDeviceSize bytesReserved = 0; ///< Device memory held in blocks and dedicated allocations
+        VkDeviceSize bytesUsed = 0;
+        uint32_t allocationCount = 0;
+        VkDeviceSize largestFreeRange = 0; ///< The largest allocation that still fits without a new block
+        float fragmentation = 0.0f; ///< 1 - the largest free range of each block / free bytes in blocks, 0 when every block's free space is one range
+    };
+
+    // One block of a MemoryAllocator, as seen by the Defragmenter
+    struct MemoryBlockInfo {
+        const MemoryBlock* block = nullptr;
+        uint32_t memoryType = 0;
+        VkDeviceSize capacity = 0;
+        VkDeviceSize bytesUsed = 0;
+        uint32_t allocationCount = 0;
+        VkDeviceSize bytesFreeElsewhere = 0; ///< Free bytes in the other blocks the block's allocations could move to
+    };
+
+    struct MemoryStats {
+        std::vector<MemoryTypeStats> types; ///< Only memory types with something allocated
+        uint32_t deviceMemoryCount = 0; ///< Live vkAllocateMemory allocations, compare with maxMemoryAllocationCount
+        VkDeviceSize bytesReserved = 0;
+        VkDeviceSize bytesUsed = 0;
+    };
+
+    /**
+     * @class MemoryAllocator
+     * @brief Sub-allocates buffers and images from large blocks of device memory, one set of blocks per memory type
+     *
+     * Drivers limit how many device memory allocations can be live (maxMemoryAllocationCount, 4096 on many) and
+     * vkAllocateMemory is slow, so blocks are allocated once and carved up with a TLSF or buddy Suballocator.
+     * Anything larger than half a block, e.g. a big texture, gets a dedicated allocation instead.
+     *
+     * If the device's bufferImageGranularity is above 1, linear resources (buffers, linear images) and optimal
+     * images get separate blocks, so they never share a granularity page.
+     *
+     * Host visible blocks are mapped once when they are allocated, MemoryAllocation::mapped points into them.
+     * Owned by ResourceManager (see ResourceManager::getMemoryAllocator()).
+     */
+    class MemoryAllocator {
+        public:
+            static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull << 20;
+
+            /**
+             * @param blockSize Rounded down to a power of two, and to 1/8 of the heap for small heaps
+             */
+            MemoryAllocator(DeviceSetup& device, AllocationStrategy strategy = AllocationStrategy::TLSF, VkDeviceSize blockSize = DEFAULT_BLOCK_SIZE);
+            ~MemoryAllocator();
+
+            MemoryAllocator(const MemoryAllocator&) = delete;
+            MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+
+            /**
+             * @param linear True for buffers and linear tiled images, see bufferImageGranularity above
+             * @throws std::runtime_error if no memory type fits or the device is out of memory
+             */
+            void allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool linear, MemoryAllocation& allocation);
+
+            // Resets allocation, does nothing for an empty one
+            void free(MemoryAllocation& allocation);
+
+            // Flushes or invalidates size bytes (VK_WHOLE_SIZE for the rest) at offset into a host visible allocation, a no-op for coherent memory
+            VkResult flush(const MemoryAllocation& allocation, VkDeviceSize offset, VkDeviceSize size);
+            VkResult invalidate(const MemoryAllocation& allocation, VkDeviceSize offset, VkDeviceSize size);
+
+            MemoryStats getStats() const;
+
+            // Every block in use, dedicated allocations are left out since there is nothing to compact in them
+            std::vector<MemoryBlockInfo> getBlocks() const;
+
+            /**
+             * Allocates for a resource moving out of current's block, into another block that already exists
+             * @return False if no other block has room, allocation is left untouched then
+             */
+            bool allocateElsewhere(const VkMemoryRequirements& requirements, const MemoryAllocation& current, MemoryAllocation& allocation);
+
+            /**
+             * Frees every empty block, including the one per pool free() keeps around
+             * @return Bytes of device memory given back
+             */
+            VkDeviceSize releaseEmptyBlocks();
+
+            AllocationStrategy getStrategy() const { return strategy; }
+
+        private:
+            // The blocks of one memory type, for linear or optimal resources
+            struct Pool {
+                uint32_t memoryType;
+                VkDeviceSize blockSize;
+                std::vector<std::unique_ptr<MemoryBlock> > blocks;
+            };
+
+            // Allocates and, if host visible, maps device memory, returns null if the device is out of memory
+            VkDeviceMemory allocateDeviceMemory(VkDeviceSize size, uint32_t memoryType, void*& mapped);
+            void freeDeviceMemory(VkDeviceMemory memory, void* mapped);
+
+            bool isCoherent(uint32_t memoryType) const;
+            VkMappedMemoryRange getMappedRange(const MemoryAllocation& allocation, VkDeviceSize offset, VkDeviceSize size) const;
+
+            DeviceSetup& device;
+            AllocationStrategy strategy;
+
+            VkPhysicalDeviceMemoryProperties memoryProperties;
+            VkDeviceSize bufferImageGranularity;
+            VkDeviceSize nonCoherentAtomSize;
+
+            std::vector<Pool> pools; ///< Two per memory type, linear resources first
+            std::vector<uint32_t> dedicatedCounts; ///< By memory type
+            std::vector<VkDeviceSize> dedicatedBytes;
+            uint32_t deviceMemoryCount = 0;
+    };
+};
+
+#endif
\ No newline at end of file
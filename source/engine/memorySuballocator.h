@@ -0,0 +1,123 @@
+#ifndef MEMORY_SUBALLOCATOR_H
+#define MEMORY_SUBALLOCATOR_H
+
+#include <array>
+#include <memory>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include "./engine/deviceSetup.h"
+
+namespace JCAT {
+    enum class AllocationStrategy {
+        TLSF, ///< Two level segregated fit, any size and alignment in constant time with little waste
+        BUDDY ///< Power of two ranges, rounds every allocation up but cannot fragment into slivers too small to use
+    };
+
+    /**
+     * @class Suballocator
+     * @brief Hands out byte ranges of one block of device memory, see MemoryAllocator
+     */
+    class Suballocator {
+        public:
+            virtual ~Suballocator() = default;
+
+            static std::unique_ptr<Suballocator> create(AllocationStrategy strategy, VkDeviceSize capacity);
+
+            /**
+             * Reserves size bytes starting at a multiple of alignment
+             * @param handle Identifies the range for free()
+             * @return False if no free range fits, offset and handle are left untouched then
+             */
+            virtual bool allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset, uint64_t& handle) = 0;
+            virtual void free(uint64_t handle) = 0;
+
+            virtual VkDeviceSize getLargestFreeRange() const = 0;
+
+            VkDeviceSize getCapacity() const { return capacity; }
+            VkDeviceSize getBytesUsed() const { return bytesUsed; } ///< Including whatever the strategy rounded allocations up by
+            uint32_t getAllocationCount() const { return allocationCount; }
+
+        protected:
+            explicit Suballocator(VkDeviceSize capacity) : capacity{capacity} {}
+
+            VkDeviceSize capacity;
+            VkDeviceSize bytesUsed = 0;
+            uint32_t allocationCount = 0;
+    };
+
+    /**
+     * @class TlsfSuballocator
+     * @brief Two level segregated fit: free ranges are kept in lists by size class, found through two bitmaps
+     *
+     * The first level splits sizes by power of two, the second splits each power of two into SL_COUNT linear steps.
+     * Allocating rounds the request up to the next class so the head of any non-empty list at or above it fits,
+     * freeing merges with free physical neighbours right away, both without searching.
+     */
+    class TlsfSuballocator : public Suballocator {
+        public:
+            explicit TlsfSuballocator(VkDeviceSize capacity);
+
+            bool allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset, uint64_t& handle) override;
+            void free(uint64_t handle) override;
+            VkDeviceSize getLargestFreeRange() const override;
+
+        private:
+            static constexpr uint32_t SL_LOG2 = 5;
+            static constexpr uint32_t SL_COUNT = 1u << SL_LOG2;
+            static constexpr uint32_t SMALL_LOG2 = 8; ///< Sizes below 256 bytes all share first level 0, in steps of 8
+            static constexpr VkDeviceSize SMALL_SIZE = 1ull << SMALL_LOG2;
+            static constexpr uint32_t FL_COUNT = 64 - SMALL_LOG2 + 1;
+            static constexpr uint32_t NONE = UINT32_MAX;
+
+            // A free or used range, linked to its physical neighbours and, while free, into its size class list
+            struct Range {
+                VkDeviceSize offset;
+                VkDeviceSize size;
+                uint32_t previousPhysical = NONE;
+                uint32_t nextPhysical = NONE;
+                uint32_t previousFree = NONE;
+                uint32_t nextFree = NONE;
+                bool free = false;
+            };
+
+            static void mapping(VkDeviceSize size, uint32_t& firstLevel, uint32_t& secondLevel);
+
+            uint32_t createRange(VkDeviceSize offset, VkDeviceSize size);
+            void insertFree(uint32_t range);
+            void removeFree(uint32_t range);
+
+            std::vector<Range> ranges; ///< Indexed by handle, slots in unusedRanges are recycled
+            std::vector<uint32_t> unusedRanges;
+
+            uint64_t firstLevelBitmap = 0;
+            std::array<uint32_t, FL_COUNT> secondLevelBitmaps{};
+            std::array<uint32_t, FL_COUNT * SL_COUNT> freeLists;
+    };
+
+    /**
+     * @class BuddySuballocator
+     * @brief Splits the block in halves until a power of two range fits, freed ranges merge back with their buddy
+     *
+     * The capacity has to be a power of two. Ranges are naturally aligned to their size, which covers every
+     * Vulkan alignment without padding.
+     */
+    class BuddySuballocator : public Suballocator {
+        public:
+            static constexpr VkDeviceSize MIN_SIZE = 256;
+
+            explicit BuddySuballocator(VkDeviceSize capacity);
+
+            bool allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset, uint64_t& handle) override;
+            void free(uint64_t handle) override;
+            VkDeviceSize getLargestFreeRange() const override;
+
+        private:
+            uint32_t maxOrder;
+            std::vector<std::set<VkDeviceSize> > freeRanges; ///< Offsets of the free ranges of MIN_SIZE << order, by order
+            std::unordered_map<VkDeviceSize, uint32_t> usedOrders; ///< Offset of every allocation to its order
+    };
+};
+
+#endif
\ No newline at end of file
@@ -3,12 +3,32 @@
 
 #include <iostream>
 #include <fstream>
+#include <functional>
+#include <memory>
+#include <vector>
 
 #include "./engine/deviceSetup.h"
+#include "./engine/memoryAllocator.h"
+#include "./engine/defragmenter.h"
 
 // Should be declared after deviceSetup in application.cpp
 
 namespace JCAT {
+    class GeometryPool;
+    class StagingRing;
+    class UploadBatch;
+
+    // Identifies a submitted UploadBatch, value 0 stands for a batch with nothing in it and is always complete
+    struct UploadToken {
+        uint64_t value = 0;
+    };
+
+    struct UploadStats {
+        uint32_t submissions = 0; ///< Upload batches sent to the queue, one off copies included
+        VkDeviceSize bytesUploaded = 0;
+        uint32_t stagingStalls = 0; ///< Times an upload had to wait for the GPU to free space in the staging ring
+    };
+
     /**
      * @class ResourceManager
      * @brief Manager for buffers and images to be used by JCAT Game Engine
@@ -19,11 +39,18 @@ namespace JCAT {
      */
     class ResourceManager {
         public:
+            static constexpr VkDeviceSize DEFAULT_STAGING_RING_SIZE = 32ull << 20;
+
             /**
              * Constructs a ResourceManager object
              * @param device Reference to the device object to use in creating resources
+             * @param stagingRingSize Bytes of host visible memory every upload is staged through, larger uploads are split up
+             * @param allocationStrategy How buffers and images are placed in the memory blocks they share
              */
-            ResourceManager(DeviceSetup& device);
+            ResourceManager(DeviceSetup& device,
+                            VkDeviceSize stagingRingSize = DEFAULT_STAGING_RING_SIZE,
+                            AllocationStrategy allocationStrategy = AllocationStrategy::TLSF);
+            ~ResourceManager();
 
             //Delete Copy, Move, Assignment, and Move Assignment operators
             ResourceManager(const ResourceManager&) = delete;
@@ -40,13 +67,15 @@ namespace JCAT {
             static std::vector<char> readFile(const std::string& filepath);
 
             /**
-             * Creates a Vulkan vertex buffer
+             * Creates a Vulkan vertex buffer. Buffers with VK_BUFFER_USAGE_TRANSFER_DST_BIT are shared concurrently
+             * between the graphics and the dedicated transfer queue family, if there is one, so uploads into them
+             * need no ownership transfer.
              * @param size The size of the buffer
              * @param usage The usage flags for the buffer
              * @param properties The memory property flags for the buffer
              * @param buffer Reference to the object in which the new buffer is made
-             * @param bufferMemory Reference to the object in which information about
-             *                     the allocated memory is returned
+             * @param bufferMemory Reference to the object in which the memory the buffer is bound to is returned,
+             *                     sub-allocated by the MemoryAllocator and already mapped if it is host visible
              * @throws std::runtime_error if the vertex buffer cannot be created 
              *         or memory cannot be allocated for the buffer
              */
@@ -54,7 +83,24 @@ namespace JCAT {
                               VkBufferUsageFlags usage,
                               VkMemoryPropertyFlags properties,
                               VkBuffer& buffer,
-                              VkDeviceMemory& bufferMemory);
+                              MemoryAllocation& bufferMemory);
+
+            // Destroys a buffer made by createBuffer() and gives its memory back, resets both
+            void destroyBuffer(VkBuffer& buffer, MemoryAllocation& bufferMemory);
+
+            /**
+             * Lets defragment() move a device local buffer made by createBuffer(). The buffer has to be created with
+             * VK_BUFFER_USAGE_TRANSFER_SRC_BIT and must not be mapped, buffer and bufferMemory are overwritten when it moves.
+             * @param onMoved Called after a move, e.g. to rewrite descriptor sets holding the old handle
+             */
+            void makeMovable(VkBuffer& buffer, MemoryAllocation& bufferMemory, VkDeviceSize size, VkBufferUsageFlags usage, std::function<void()> onMoved = {});
+
+            /**
+             * Lets defragment() move a color image made by createImageWithInfo(), created with VK_IMAGE_USAGE_TRANSFER_SRC_BIT
+             * @param layout The layout the image is kept in between uses, a moved image is left in it as well
+             * @param onMoved Called after a move, image views of the old image have to be replaced (see Defragmenter::destroyLater())
+             */
+            void makeMovable(VkImage& image, MemoryAllocation& imageMemory, const VkImageCreateInfo& imageInfo, VkImageLayout layout, std::function<void()> onMoved = {});
             
             /**
              * Creates and returns a command buffer
@@ -63,18 +109,21 @@ namespace JCAT {
             VkCommandBuffer beginSingleTimeCommands();
 
             /**
-             * Ends recording for the given command buffer and submits graphics queue
+             * Ends recording for the given command buffer, submits it to the graphics queue and waits for it to finish
              * @param commandBuffer The command buffer to end recording for
              */
             void endSingleTimeCommands(VkCommandBuffer commandBuffer);
 
             /**
-             * Copies the contents from srcBuffer to dstBuffer
+             * Copies the contents from srcBuffer to dstBuffer right away, waiting for the copy to finish.
+             * Prefer uploadBuffer(), which can join an upload batch.
              * @param srcBuffer The source buffer to copy contents from
              * @param dstBuffer The destination buffer to copy contents into
              * @param size The number of bytes to copy
+             * @param srcOffset Byte offset into srcBuffer to copy from
+             * @param dstOffset Byte offset into dstBuffer to copy to
              */
-            void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+            void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize srcOffset = 0, VkDeviceSize dstOffset = 0);
 
             /**
              * Copies the contents of the buffer to the specified image
@@ -91,18 +140,120 @@ namespace JCAT {
              * @param imageInfo Reference to structure containing parameters to be used
              * @param properties The memory property flags for the image
              * @param image Reference to the object in which the new image is made
-             * @param imageMemory Reference to the object in which information about
-             *                    the allocated memory is returned
+             * @param imageMemory Reference to the object in which the memory the image is bound to is returned,
+             *                    large images get memory of their own instead of a slice of a shared block
              * @throws std::runtime_error if image could not be created or
              *         memory could not be allocated for the image
              */
             void createImageWithInfo(const VkImageCreateInfo& imageInfo,
                                         VkMemoryPropertyFlags properties,
                                         VkImage& image,
-                                        VkDeviceMemory& imageMemory);
+                                        MemoryAllocation& imageMemory);
+
+            // Destroys an image made by createImageWithInfo() and gives its memory back, resets both
+            void destroyImage(VkImage& image, MemoryAllocation& imageMemory);
+
+            // Returns the allocator every buffer and image gets its memory from, created on first use
+            MemoryAllocator& getMemoryAllocator();
+
+            // Blocks, fragmentation and bytes in use per memory type, for overlays and logging
+            MemoryStats getMemoryStats() const;
+
+            /**
+             * Copies movable resources out of sparsely used memory blocks so the blocks can be freed, see Defragmenter.
+             * Call it once a frame, before recording, it does nothing while uploads are recorded or running.
+             * @param byteBudget Bytes copied per call at most, keeps the cost of a single frame bounded
+             */
+            void defragment(VkDeviceSize byteBudget);
+
+            // Created on first use, resources made movable are registered with it
+            Defragmenter& getDefragmenter();
+
+            DefragmentationStats getDefragmentationStats() const;
+
+            /**
+             * Returns the shared vertex and index buffers models sub-allocate their geometry from,
+             * created with the default capacities on first use
+             */
+            GeometryPool& getGeometryPool();
+
+            // Returns the mapped buffer uploads stage their data in, created on first use
+            StagingRing& getStagingRing();
+
+            /**
+             * Opens the upload batch that uploadBuffer() and recordUploads(), and through them every model and texture
+             * upload, record into until submitUploadBatch(). Does nothing if a batch is already open.
+             */
+            void beginUploadBatch();
+
+            /**
+             * Submits the open upload batch without waiting for it, anything submitted to the queue later sees the data
+             * @return Token for isUploadComplete() and waitForUpload()
+             */
+            UploadToken submitUploadBatch();
+
+            // The batch opened by beginUploadBatch(), or null
+            UploadBatch* getUploadBatch() { return uploadBatch.get(); }
+
+            /**
+             * Records into the open upload batch, or into a batch of its own that is submitted and waited for right away
+             * @param record Called once with the batch to record into
+             */
+            void recordUploads(const std::function<void(UploadBatch&)>& record);
+
+            /**
+             * Copies size bytes of data into dstBuffer at dstOffset through a staging buffer, see recordUploads()
+             * @param data Only read during the call
+             */
+            void uploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
+
+            // Uploads complete in submission order, so a token also covers every upload submitted before it
+            bool isUploadComplete(UploadToken token);
+            void waitForUpload(UploadToken token);
+            void waitForUploads();
+
+            // Frees the command buffers and staging space of every upload the GPU has finished, call it regularly (e.g. once a frame)
+            void collectCompletedUploads();
+
+            const UploadStats& getUploadStats() const { return uploadStats; }
         private:
+            friend class UploadBatch;
+            friend class Defragmenter;
+
+            // A submitted batch, kept until its fence signals
+            struct PendingUpload {
+                uint64_t value;
+                VkCommandBuffer commandBuffer;
+                VkCommandBuffer transferCommandBuffer; ///< Null unless the copies ran on a dedicated transfer queue
+                VkSemaphore transferSemaphore; ///< Signaled by the transfer submission, waited on by commandBuffer's
+                VkFence fence; ///< Signaled by commandBuffer's submission, which always comes last
+            };
+
+            // Takes over a submitted UploadBatch's command buffers, semaphore and fence, its staging space is retired along with them
+            UploadToken trackUpload(VkCommandBuffer commandBuffer, VkCommandBuffer transferCommandBuffer, VkSemaphore transferSemaphore, VkFence fence, VkDeviceSize size);
+
+            void retireUpload(PendingUpload& upload);
+
+            // Creates a buffer without memory, shared with the transfer queue family like createBuffer() describes
+            void createBufferHandle(VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& buffer);
+
             //The device to use for working with resources
             DeviceSetup& device_;
+
+            // Declared before everything holding buffers so both are destroyed after them
+            AllocationStrategy allocationStrategy;
+            std::unique_ptr<MemoryAllocator> memoryAllocator;
+            std::unique_ptr<Defragmenter> defragmenter;
+
+            std::unique_ptr<GeometryPool> geometryPool;
+
+            VkDeviceSize stagingRingSize;
+            std::unique_ptr<StagingRing> stagingRing;
+
+            std::unique_ptr<UploadBatch> uploadBatch;
+            std::vector<PendingUpload> pendingUploads; ///< In submission order
+            uint64_t nextUploadValue = 1;
+            UploadStats uploadStats{};
     };
 } //JCAT
 
@@ -0,0 +1,118 @@
+#include "./engine/assetRegistry.h"
+#include "./engine/3d/modelLoader.h"
+
+#include <filesystem>
+
+namespace JCAT {
+    AssetRegistry::AssetRegistry(DeviceSetup& d, ResourceManager& r) : device{d}, resourceManager{r} {}
+
+    std::string AssetRegistry::normalizePath(const std::string& filepath) {
+        std::error_code error;
+        std::filesystem::path normalized = std::filesystem::weakly_canonical(filepath, error);
+
+        // weakly_canonical only fails on filesystem errors, fall back to a purely lexical cleanup
+        if (error) {
+            normalized = std::filesystem::absolute(filepath, error).lexically_normal();
+            if (error) {
+                normalized = std::filesystem::path(filepath).lexically_normal();
+            }
+        }
+
+        return normalized.generic_string();
+    }
+
+    std::string AssetRegistry::makeModelKey(const std::string& filepath, bool hasIndexBuffer, bool optimizeMesh, JCATModel3D::VertexFormat vertexFormat, uint32_t lodLevels) {
+        return normalizePath(filepath) + (hasIndexBuffer ? "#indexed" : "#flat") + (optimizeMesh ? "#optimized" : "") +
+            (vertexFormat == JCATModel3D::VertexFormat::COMPACT ? "#compact" : vertexFormat == JCATModel3D::VertexFormat::SPLIT ? "#split" : "") + (lodLevels > 1 ? "#lod" + std::to_string(lodLevels) : "");
+    }
+
+    std::shared_ptr<JCATModel3D> AssetRegistry::loadModel(const std::string& filepath, bool hasIndexBuffer, bool optimizeMesh, JCATModel3D::VertexFormat vertexFormat, uint32_t lodLevels) {
+        const std::string key = makeModelKey(filepath, hasIndexBuffer, optimizeMesh, vertexFormat, lodLevels);
+
+        std::shared_ptr<JCATModel3D> existing = findModel(key);
+        if (existing != nullptr) {
+            return existing;
+        }
+
+        PreparedModel prepared = ModelLoader::prepareModel(filepath, hasIndexBuffer, optimizeMesh, lodLevels);
+        return registerModel(key, filepath, ModelLoader::uploadModel(device, resourceManager, prepared, vertexFormat));
+    }
+
+    std::shared_ptr<JCATModel3D> AssetRegistry::findModel(const std::string& key) {
+        std::unordered_map<std::string, ModelEntry>::iterator entry = models.find(key);
+        if (entry == models.end()) {
+            return nullptr;
+        }
+
+        stats.hits++;
+        return entry->second.model;
+    }
+
+    std::shared_ptr<JCATModel3D> AssetRegistry::registerModel(const std::string& key, const std::string& filepath, std::shared_ptr<JCATModel3D> model) {
+        std::pair<std::unordered_map<std::string, ModelEntry>::iterator, bool> inserted = models.try_emplace(key, ModelEntry{ normalizePath(filepath), model });
+
+        if (inserted.second) {
+            stats.loads++;
+        }
+
+        return inserted.first->second.model;
+    }
+
+    bool AssetRegistry::isLoaded(const std::string& filepath) const {
+        const std::string path = normalizePath(filepath);
+
+        for (const std::pair<const std::string, ModelEntry>& entry : models) {
+            if (entry.second.path == path) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    long AssetRegistry::getReferenceCount(const std::string& filepath) const {
+        const std::string path = normalizePath(filepath);
+        long references = 0;
+
+        for (const std::pair<const std::string, ModelEntry>& entry : models) {
+            if (entry.second.path == path) {
+                references += entry.second.model.use_count() - 1;
+            }
+        }
+
+        return references;
+    }
+
+    size_t AssetRegistry::unloadModel(const std::string& filepath) {
+        const std::string path = normalizePath(filepath);
+        size_t unloaded = 0;
+
+        for (std::unordered_map<std::string, ModelEntry>::iterator entry = models.begin(); entry != models.end();) {
+            if (entry->second.path == path) {
+                entry = models.erase(entry);
+                unloaded++;
+            }
+            else {
+                entry++;
+            }
+        }
+
+        return unloaded;
+    }
+
+    size_t AssetRegistry::purgeUnused() {
+        size_t purged = 0;
+
+        for (std::unordered_map<std::string, ModelEntry>::iterator entry = models.begin(); entry != models.end();) {
+            if (entry->second.model.use_count() == 1) {
+                entry = models.erase(entry);
+                purged++;
+            }
+            else {
+                entry++;
+            }
+        }
+
+        return purged;
+    }
+};
\ No newline at end of file
@@ -0,0 +1,755 @@
+#include "./engine/blockCompressor.h"
+#include "./engine/threadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <future>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define JCAT_BLOCK_SSE
+#endif
+
+namespace JCAT {
+    static constexpr uint32_t BLOCK_TEXELS = 16;
+    static constexpr uint32_t MAX_PALETTE_SIZE = 16;
+
+    // Index selection and least squares refits alternated per block, past two they rarely lower the error any further
+    static constexpr int REFINE_ITERATIONS = 2;
+
+    // Images with fewer blocks are encoded on the calling thread, queueing them would cost more than it saves
+    static constexpr size_t MIN_PARALLEL_BLOCKS = 1024;
+
+    // Interpolation weight towards the second endpoint of every index, in the order the formats number them
+    static const float BC1_WEIGHTS[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+    static const float BC4_WEIGHTS[8] = { 0.0f, 1.0f, 1.0f / 7.0f, 2.0f / 7.0f, 3.0f / 7.0f, 4.0f / 7.0f, 5.0f / 7.0f, 6.0f / 7.0f };
+    static const uint32_t BC7_WEIGHTS_4BIT[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+    static const float BC7_WEIGHTS[16] = {
+        0.0f / 64.0f, 4.0f / 64.0f, 9.0f / 64.0f, 13.0f / 64.0f, 17.0f / 64.0f, 21.0f / 64.0f, 26.0f / 64.0f, 30.0f / 64.0f,
+        34.0f / 64.0f, 38.0f / 64.0f, 43.0f / 64.0f, 47.0f / 64.0f, 51.0f / 64.0f, 55.0f / 64.0f, 60.0f / 64.0f, 64.0f / 64.0f
+    };
+
+    // One 4x4 block, channel major so four texels of a channel load as one SSE register
+    struct BlockTexels {
+        alignas(16) float values[4][BLOCK_TEXELS];
+    };
+
+    // Colors the indices of a block can pick from, values[c] holds channel c counted from the block's first encoded channel
+    struct BlockPalette {
+        float values[4][MAX_PALETTE_SIZE];
+        uint32_t size;
+    };
+
+    struct Bc1Endpoints {
+        uint16_t colors[2]; ///< RGB565
+    };
+
+    struct Bc4Endpoints {
+        uint8_t values[2];
+    };
+
+    struct Bc7Endpoints {
+        uint8_t colors[2][4]; ///< RGBA, 7 bits each
+        uint8_t pBits[2];     ///< Lowest bit of every channel of the endpoint once expanded to 8 bits
+    };
+
+    // Packs fields LSB first the way every BC format lays out its bits
+    struct BitWriter {
+        uint64_t bits[2] = {};
+        uint32_t position = 0;
+
+        void write(uint64_t value, uint32_t count) {
+            const uint32_t shift = position % 64;
+            bits[position / 64] |= value << shift;
+            if (shift + count > 64) {
+                bits[position / 64 + 1] |= value >> (64 - shift);
+            }
+            position += count;
+        }
+
+        void store(uint8_t* output, size_t bytes) const {
+            std::memcpy(output, bits, bytes);
+        }
+    };
+
+    struct BitReader {
+        uint64_t bits[2] = {};
+        uint32_t position = 0;
+
+        BitReader(const uint8_t* input, size_t bytes) {
+            std::memcpy(bits, input, bytes);
+        }
+
+        uint32_t read(uint32_t count) {
+            const uint32_t shift = position % 64;
+            uint64_t value = bits[position / 64] >> shift;
+            if (shift + count > 64) {
+                value |= bits[position / 64 + 1] << (64 - shift);
+            }
+            position += count;
+            return static_cast<uint32_t>(value & ((uint64_t{ 1 } << count) - 1));
+        }
+    };
+
+    static void loadBlock(const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, BlockTexels& block) {
+        for (uint32_t y = 0; y < BlockCompressor::BLOCK_SIZE; y++) {
+            const uint32_t sourceY = std::min(blockY * BlockCompressor::BLOCK_SIZE + y, height - 1);
+
+            for (uint32_t x = 0; x < BlockCompressor::BLOCK_SIZE; x++) {
+                const uint32_t sourceX = std::min(blockX * BlockCompressor::BLOCK_SIZE + x, width - 1);
+                const uint8_t* texel = rgba + (static_cast<size_t>(sourceY) * width + sourceX) * 4;
+
+                for (uint32_t channel = 0; channel < 4; channel++) {
+                    block.values[channel][y * BlockCompressor::BLOCK_SIZE + x] = texel[channel];
+                }
+            }
+        }
+    }
+
+    /**
+     * Points every texel at its closest palette entry
+     * @return Summed squared error of the block over its encoded channels
+     */
+    static float selectIndices(const BlockTexels& block, uint32_t firstChannel, uint32_t channels, const BlockPalette& palette, uint8_t* indices) {
+#if defined(JCAT_BLOCK_SSE)
+        __m128 totalError = _mm_setzero_ps();
+
+        for (uint32_t group = 0; group < BLOCK_TEXELS; group += 4) {
+            __m128 texels[4];
+            for (uint32_t c = 0; c < channels; c++) {
+                texels[c] = _mm_load_ps(&block.values[firstChannel + c][group]);
+            }
+
+            __m128 bestError = _mm_set1_ps(INFINITY);
+            __m128i bestIndex = _mm_setzero_si128();
+            for (uint32_t entry = 0; entry < palette.size; entry++) {
+                __m128 error = _mm_setzero_ps();
+                for (uint32_t c = 0; c < channels; c++) {
+                    const __m128 difference = _mm_sub_ps(texels[c], _mm_set1_ps(palette.values[c][entry]));
+                    error = _mm_add_ps(error, _mm_mul_ps(difference, difference));
+                }
+
+                // Strictly closer only, so ties keep the lower index like the scalar path
+                const __m128i closer = _mm_castps_si128(_mm_cmplt_ps(error, bestError));
+                bestIndex = _mm_or_si128(_mm_andnot_si128(closer, bestIndex), _mm_and_si128(closer, _mm_set1_epi32(static_cast<int>(entry))));
+                bestError = _mm_min_ps(error, bestError);
+            }
+
+            alignas(16) int32_t groupIndices[4];
+            _mm_store_si128(reinterpret_cast<__m128i*>(groupIndices), bestIndex);
+            for (uint32_t i = 0; i < 4; i++) {
+                indices[group + i] = static_cast<uint8_t>(groupIndices[i]);
+            }
+
+            totalError = _mm_add_ps(totalError, bestError);
+        }
+
+        alignas(16) float errors[4];
+        _mm_store_ps(errors, totalError);
+        return errors[0] + errors[1] + errors[2] + errors[3];
+#else
+        float totalError = 0.0f;
+
+        for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++) {
+            float bestError = INFINITY;
+            uint8_t bestIndex = 0;
+
+            for (uint32_t entry = 0; entry < palette.size; entry++) {
+                float error = 0.0f;
+                for (uint32_t c = 0; c < channels; c++) {
+                    const float difference = block.values[firstChannel + c][texel] - palette.values[c][entry];
+                    error += difference * difference;
+                }
+
+                if (error < bestError) {
+                    bestError = error;
+                    bestIndex = static_cast<uint8_t>(entry);
+                }
+            }
+
+            indices[texel] = bestIndex;
+            totalError += bestError;
+        }
+
+        return totalError;
+#endif
+    }
+
+    // Endpoints spanning the block's texels along their principal axis
+    static void fitEndpoints(const BlockTexels& block, uint32_t firstChannel, uint32_t channels, float low[4], float high[4]) {
+        float mean[4] = {};
+        for (uint32_t c = 0; c < channels; c++) {
+            for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++) {
+                mean[c] += block.values[firstChannel + c][texel];
+            }
+            mean[c] /= static_cast<float>(BLOCK_TEXELS);
+        }
+
+        float covariance[4][4] = {};
+        for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++) {
+            for (uint32_t i = 0; i < channels; i++) {
+                const float di = block.values[firstChannel + i][texel] - mean[i];
+                for (uint32_t j = 0; j < channels; j++) {
+                    covariance[i][j] += di * (block.values[firstChannel + j][texel] - mean[j]);
+                }
+            }
+        }
+
+        // Power iteration, starting from the row of the channel that varies most so the start is never orthogonal to the result
+        uint32_t widest = 0;
+        for (uint32_t c = 1; c < channels; c++) {
+            if (covariance[c][c] > covariance[widest][widest]) {
+                widest = c;
+            }
+        }
+
+        float axis[4] = {};
+        for (uint32_t c = 0; c < channels; c++) {
+            axis[c] = covariance[widest][c];
+        }
+
+        for (int iteration = 0; iteration < 8; iteration++) {
+            float next[4] = {};
+            float largest = 0.0f;
+            for (uint32_t i = 0; i < channels; i++) {
+                for (uint32_t j = 0; j < channels; j++) {
+                    next[i] += covariance[i][j] * axis[j];
+                }
+                largest = std::max(largest, std::abs(next[i]));
+            }
+
+            if (largest == 0.0f) {
+                break;
+            }
+
+            for (uint32_t c = 0; c < channels; c++) {
+                axis[c] = next[c] / largest;
+            }
+        }
+
+        float lengthSquared = 0.0f;
+        for (uint32_t c = 0; c < channels; c++) {
+            lengthSquared += axis[c] * axis[c];
+        }
+
+        // A flat block is a single color
+        if (lengthSquared < 1e-12f) {
+            for (uint32_t c = 0; c < channels; c++) {
+                low[c] = mean[c];
+                high[c] = mean[c];
+            }
+            return;
+        }
+
+        const float inverseLength = 1.0f / std::sqrt(lengthSquared);
+        for (uint32_t c = 0; c < channels; c++) {
+            axis[c] *= inverseLength;
+        }
+
+        float minimum = INFINITY;
+        float maximum = -INFINITY;
+        for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++) {
+            float projection = 0.0f;
+            for (uint32_t c = 0; c < channels; c++) {
+                projection += (block.values[firstChannel + c][texel] - mean[c]) * axis[c];
+            }
+            minimum = std::min(minimum, projection);
+            maximum = std::max(maximum, projection);
+        }
+
+        for (uint32_t c = 0; c < channels; c++) {
+            low[c] = std::clamp(mean[c] + axis[c] * minimum, 0.0f, 255.0f);
+            high[c] = std::clamp(mean[c] + axis[c] * maximum, 0.0f, 255.0f);
+        }
+    }
+
+    /**
+     * Least squares endpoints for the given indices
+     * @param weights Interpolation weight towards high of every index
+     * @return false if the indices do not constrain both endpoints (all of them on one weight)
+     */
+    static bool refineEndpoints(const BlockTexels& block, uint32_t firstChannel, uint32_t channels, const uint8_t* indices, const float* weights, float low[4], float high[4]) {
+        float lowLow = 0.0f;
+        float lowHigh = 0.0f;
+        float highHigh = 0.0f;
+        float lowTexel[4] = {};
+        float highTexel[4] = {};
+
+        for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++) {
+            const float weight = weights[indices[texel]];
+            const float inverse = 1.0f - weight;
+
+            lowLow += inverse * inverse;
+            lowHigh += inverse * weight;
+            highHigh += weight * weight;
+            for (uint32_t c = 0; c < channels; c++) {
+                lowTexel[c] += inverse * block.values[firstChannel + c][texel];
+                highTexel[c] += weight * block.values[firstChannel + c][texel];
+            }
+        }
+
+        const float determinant = lowLow * highHigh - lowHigh * lowHigh;
+        if (std::abs(determinant) < 1e-6f) {
+            return false;
+        }
+
+        const float inverseDeterminant = 1.0f / determinant;
+        for (uint32_t c = 0; c < channels; c++) {
+            low[c] = std::clamp((lowTexel[c] * highHigh - highTexel[c] * lowHigh) * inverseDeterminant, 0.0f, 255.0f);
+            high[c] = std::clamp((highTexel[c] * lowLow - lowTexel[c] * lowHigh) * inverseDeterminant, 0.0f, 255.0f);
+        }
+
+        return true;
+    }
+
+    /**
+     * Alternates picking indices for the quantized endpoints with refitting the endpoints to those indices
+     * @param quantize Rounds low and high to the format's endpoints and builds the palette they decode to
+     * @param best Endpoints of the encoding with the lowest error, bestIndices its indices
+     */
+    template <typename Endpoints, typename Quantize>
+    static void fitBlock(const BlockTexels& block, uint32_t firstChannel, uint32_t channels, const float* weights, Quantize quantize, Endpoints& best, uint8_t* bestIndices) {
+        float low[4] = {};
+        float high[4] = {};
+        fitEndpoints(block, firstChannel, channels, low, high);
+
+        float bestError = INFINITY;
+        for (int iteration = 0; iteration <= REFINE_ITERATIONS; iteration++) {
+            Endpoints endpoints;
+            BlockPalette palette;
+            uint8_t indices[BLOCK_TEXELS];
+
+            quantize(low, high, endpoints, palette);
+            const float error = selectIndices(block, firstChannel, channels, palette, indices);
+            if (error >= bestError) {
+                break;
+            }
+
+            best = endpoints;
+            bestError = error;
+            std::memcpy(bestIndices, indices, BLOCK_TEXELS);
+
+            if (error == 0.0f || !refineEndpoints(block, firstChannel, channels, indices, weights, low, high)) {
+                break;
+            }
+        }
+    }
+
+    static uint16_t packRgb565(const float color[4]) {
+        const uint32_t r = static_cast<uint32_t>(std::lround(color[0] * (31.0f / 255.0f)));
+        const uint32_t g = static_cast<uint32_t>(std::lround(color[1] * (63.0f / 255.0f)));
+        const uint32_t b = static_cast<uint32_t>(std::lround(color[2] * (31.0f / 255.0f)));
+        return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+    }
+
+    // Replicates the top bits into the low ones, as decoders expand endpoints
+    static void unpackRgb565(uint16_t packed, int color[3]) {
+        const int r = (packed >> 11) & 31;
+        const int g = (packed >> 5) & 63;
+        const int b = packed & 31;
+        color[0] = (r << 3) | (r >> 2);
+        color[1] = (g << 2) | (g >> 4);
+        color[2] = (b << 3) | (b >> 2);
+    }
+
+    static void quantizeBc1(const float low[4], const float high[4], Bc1Endpoints& endpoints, BlockPalette& palette) {
+        endpoints.colors[0] = packRgb565(low);
+        endpoints.colors[1] = packRgb565(high);
+
+        int color0[3];
+        int color1[3];
+        unpackRgb565(endpoints.colors[0], color0);
+        unpackRgb565(endpoints.colors[1], color1);
+
+        palette.size = 4;
+        for (uint32_t c = 0; c < 3; c++) {
+            for (uint32_t i = 0; i < palette.size; i++) {
+                palette.values[c][i] = static_cast<float>(color0[c]) + static_cast<float>(color1[c] - color0[c]) * BC1_WEIGHTS[i];
+            }
+        }
+    }
+
+    static void quantizeBc4(const float low[4], const float high[4], Bc4Endpoints& endpoints, BlockPalette& palette) {
+        endpoints.values[0] = static_cast<uint8_t>(std::lround(low[0]));
+        endpoints.values[1] = static_cast<uint8_t>(std::lround(high[0]));
+
+        palette.size = 8;
+        for (uint32_t i = 0; i < palette.size; i++) {
+            palette.values[0][i] = static_cast<float>(endpoints.values[0]) + static_cast<float>(endpoints.values[1] - endpoints.values[0]) * BC4_WEIGHTS[i];
+        }
+    }
+
+    // Tries both p-bits and keeps the one that lands the endpoint closest once expanded to 8 bits
+    static void quantizeBc7Endpoint(const float color[4], uint8_t quantized[4], uint8_t& pBit) {
+        float bestError = INFINITY;
+
+        for (uint8_t candidatePBit = 0; candidatePBit < 2; candidatePBit++) {
+            uint8_t candidate[4];
+            float error = 0.0f;
+            for (uint32_t c = 0; c < 4; c++) {
+                candidate[c] = static_cast<uint8_t>(std::clamp(std::lround((color[c] - candidatePBit) * 0.5f), 0L, 127L));
+                const float difference = static_cast<float>((candidate[c] << 1) | candidatePBit) - color[c];
+                error += difference * difference;
+            }
+
+            if (error < bestError) {
+                bestError = error;
+                std::memcpy(quantized, candidate, sizeof(candidate));
+                pBit = candidatePBit;
+            }
+        }
+    }
+
+    static void quantizeBc7(const float low[4], const float high[4], Bc7Endpoints& endpoints, BlockPalette& palette) {
+        quantizeBc7Endpoint(low, endpoints.colors[0], endpoints.pBits[0]);
+        quantizeBc7Endpoint(high, endpoints.colors[1], endpoints.pBits[1]);
+
+        // Integer interpolation, exactly what the decoder computes
+        palette.size = 16;
+        for (uint32_t c = 0; c < 4; c++) {
+            const uint32_t color0 = (endpoints.colors[0][c] << 1) | endpoints.pBits[0];
+            const uint32_t color1 = (endpoints.colors[1][c] << 1) | endpoints.pBits[1];
+            for (uint32_t i = 0; i < palette.size; i++) {
+                palette.values[c][i] = static_cast<float>(((64 - BC7_WEIGHTS_4BIT[i]) * color0 + BC7_WEIGHTS_4BIT[i] * color1 + 32) >> 6);
+            }
+        }
+    }
+
+    static void encodeBc1Block(const BlockTexels& block, uint8_t* output) {
+        Bc1Endpoints endpoints{};
+        uint8_t indices[BLOCK_TEXELS] = {};
+        fitBlock(block, 0, 3, BC1_WEIGHTS, quantizeBc1, endpoints, indices);
+
+        // color0 > color1 selects the opaque 4 color mode, swapping the endpoints swaps index 0 with 1 and 2 with 3
+        if (endpoints.colors[0] < endpoints.colors[1]) {
+            std::swap(endpoints.colors[0], endpoints.colors[1]);
+            for (uint8_t& index : indices) {
+                index ^= 1;
+            }
+        }
+        else if (endpoints.colors[0] == endpoints.colors[1]) {
+            std::memset(indices, 0, sizeof(indices));
+        }
+
+        BitWriter writer;
+        writer.write(endpoints.colors[0], 16);
+        writer.write(endpoints.colors[1], 16);
+        for (uint8_t index : indices) {
+            writer.write(index, 2);
+        }
+        writer.store(output, 8);
+    }
+
+    static void encodeBc4Block(const BlockTexels& block, uint32_t channel, uint8_t* output) {
+        Bc4Endpoints endpoints{};
+        uint8_t indices[BLOCK_TEXELS] = {};
+        fitBlock(block, channel, 1, BC4_WEIGHTS, quantizeBc4, endpoints, indices);
+
+        // value0 > value1 selects the 8 value mode, swapping the endpoints mirrors the interpolated indices 2..7
+        if (endpoints.values[0] < endpoints.values[1]) {
+            std::swap(endpoints.values[0], endpoints.values[1]);
+            for (uint8_t& index : indices) {
+                index = index < 2 ? index ^ 1 : 9 - index;
+            }
+        }
+        else if (endpoints.values[0] == endpoints.values[1]) {
+            std::memset(indices, 0, sizeof(indices));
+        }
+
+        BitWriter writer;
+        writer.write(endpoints.values[0], 8);
+        writer.write(endpoints.values[1], 8);
+        for (uint8_t index : indices) {
+            writer.write(index, 3);
+        }
+        writer.store(output, 8);
+    }
+
+    static void encodeBc7Block(const BlockTexels& block, uint8_t* output) {
+        Bc7Endpoints endpoints{};
+        uint8_t indices[BLOCK_TEXELS] = {};
+        fitBlock(block, 0, 4, BC7_WEIGHTS, quantizeBc7, endpoints, indices);
+
+        // Texel 0's index is stored without its top bit, so it has to be clear. The weights are symmetric, so swapping
+        // the endpoints and mirroring every index decodes to the same colors
+        if (indices[0] & 8) {
+            std::swap(endpoints.colors[0], endpoints.colors[1]);
+            std::swap(endpoints.pBits[0], endpoints.pBits[1]);
+            for (uint8_t& index : indices) {
+                index = 15 - index;
+            }
+        }
+
+        BitWriter writer;
+        writer.write(1 << 6, 7); // Mode 6
+        for (uint32_t c = 0; c < 4; c++) {
+            writer.write(endpoints.colors[0][c], 7);
+            writer.write(endpoints.colors[1][c], 7);
+        }
+        writer.write(endpoints.pBits[0], 1);
+        writer.write(endpoints.pBits[1], 1);
+        for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++) {
+            writer.write(indices[texel], texel == 0 ? 3 : 4);
+        }
+        writer.store(output, 16);
+    }
+
+    static void encodeBlock(BlockCompressor::Format format, const BlockTexels& block, uint8_t* output) {
+        switch (format) {
+            case BlockCompressor::Format::BC1:
+                encodeBc1Block(block, output);
+                break;
+            case BlockCompressor::Format::BC3:
+                encodeBc4Block(block, 3, output);
+                encodeBc1Block(block, output + 8);
+                break;
+            case BlockCompressor::Format::BC5:
+                encodeBc4Block(block, 0, output);
+                encodeBc4Block(block, 1, output + 8);
+                break;
+            case BlockCompressor::Format::BC7:
+                encodeBc7Block(block, output);
+                break;
+        }
+    }
+
+    // BC3 color blocks are always decoded in the 4 color mode, whatever the endpoint order
+    static void decodeBc1Block(const uint8_t* input, bool alwaysFourColors, uint8_t texels[BLOCK_TEXELS][4]) {
+        BitReader reader(input, 8);
+        const uint16_t packed0 = static_cast<uint16_t>(reader.read(16));
+        const uint16_t packed1 = static_cast<uint16_t>(reader.read(16));
+
+        int colors[4][4] = {};
+        unpackRgb565(packed0, colors[0]);
+        unpackRgb565(packed1, colors[1]);
+        colors[0][3] = 255;
+        colors[1][3] = 255;
+        colors[2][3] = 255;
+
+        if (packed0 > packed1 || alwaysFourColors) {
+            colors[3][3] = 255;
+            for (uint32_t c = 0; c < 3; c++) {
+                colors[2][c] = (2 * colors[0][c] + colors[1][c] + 1) / 3;
+                colors[3][c] = (colors[0][c] + 2 * colors[1][c] + 1) / 3;
+            }
+        }
+        else {
+            // 3 colors and transparent black
+            for (uint32_t c = 0; c < 3; c++) {
+                colors[2][c] = (colors[0][c] + colors[1][c] + 1) / 2;
+            }
+        }
+
+        for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++) {
+            const uint32_t index = reader.read(2);
+            for (uint32_t c = 0; c < 4; c++) {
+                texels[texel][c] = static_cast<uint8_t>(colors[index][c]);
+            }
+        }
+    }
+
+    static void decodeBc4Block(const uint8_t* input, uint32_t channel, uint8_t texels[BLOCK_TEXELS][4]) {
+        BitReader reader(input, 8);
+        const int value0 = static_cast<int>(reader.read(8));
+        const int value1 = static_cast<int>(reader.read(8));
+
+        int values[8] = { value0, value1 };
+        if (value0 > value1) {
+            for (int i = 2; i < 8; i++) {
+                values[i] = ((8 - i) * value0 + (i - 1) * value1 + 3) / 7;
+            }
+        }
+        else {
+            for (int i = 2; i < 6; i++) {
+                values[i] = ((6 - i) * value0 + (i - 1) * value1 + 2) / 5;
+            }
+            values[6] = 0;
+            values[7] = 255;
+        }
+
+        for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++) {
+            texels[texel][channel] = static_cast<uint8_t>(values[reader.read(3)]);
+        }
+    }
+
+    static void decodeBc7Block(const uint8_t* input, uint8_t texels[BLOCK_TEXELS][4]) {
+        BitReader reader(input, 16);
+        if (reader.read(7) != (1 << 6)) {
+            std::memset(texels, 0, BLOCK_TEXELS * 4);
+            return;
+        }
+
+        uint32_t colors[2][4];
+        for (uint32_t c = 0; c < 4; c++) {
+            colors[0][c] = reader.read(7);
+            colors[1][c] = reader.read(7);
+        }
+
+        const uint32_t pBit0 = reader.read(1);
+        const uint32_t pBit1 = reader.read(1);
+        for (uint32_t c = 0; c < 4; c++) {
+            colors[0][c] = (colors[0][c] << 1) | pBit0;
+            colors[1][c] = (colors[1][c] << 1) | pBit1;
+        }
+
+        for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++) {
+            const uint32_t weight = BC7_WEIGHTS_4BIT[reader.read(texel == 0 ? 3 : 4)];
+            for (uint32_t c = 0; c < 4; c++) {
+                texels[texel][c] = static_cast<uint8_t>(((64 - weight) * colors[0][c] + weight * colors[1][c] + 32) >> 6);
+            }
+        }
+    }
+
+    static void compressBlockRows(BlockCompressor::Format format, const uint8_t* rgba, uint32_t width, uint32_t height, uint32_t firstRow, uint32_t endRow, uint8_t* output) {
+        const uint32_t blocksWide = (width + BlockCompressor::BLOCK_SIZE - 1) / BlockCompressor::BLOCK_SIZE;
+        const uint32_t blockBytes = BlockCompressor::getBlockBytes(format);
+
+        BlockTexels block;
+        for (uint32_t blockY = firstRow; blockY < endRow; blockY++) {
+            for (uint32_t blockX = 0; blockX < blocksWide; blockX++) {
+                loadBlock(rgba, width, height, blockX, blockY, block);
+                encodeBlock(format, block, output + (static_cast<size_t>(blockY) * blocksWide + blockX) * blockBytes);
+            }
+        }
+    }
+
+    const char* BlockCompressor::getName(Format format) {
+        switch (format) {
+            case Format::BC1:
+                return "BC1";
+            case Format::BC3:
+                return "BC3";
+            case Format::BC5:
+                return "BC5";
+            default:
+                return "BC7";
+        }
+    }
+
+    size_t BlockCompressor::getCompressedSize(Format format, uint32_t width, uint32_t height) {
+        const size_t blocksWide = (width + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        const size_t blocksHigh = (height + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        return blocksWide * blocksHigh * getBlockBytes(format);
+    }
+
+    uint32_t BlockCompressor::getChannelCount(Format format) {
+        switch (format) {
+            case Format::BC1:
+                return 3;
+            case Format::BC5:
+                return 2;
+            default:
+                return 4;
+        }
+    }
+
+    bool BlockCompressor::getFormat(VkFormat vkFormat, Format& format) {
+        switch (vkFormat) {
+            case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+            case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+                format = Format::BC1;
+                return true;
+            case VK_FORMAT_BC3_UNORM_BLOCK:
+            case VK_FORMAT_BC3_SRGB_BLOCK:
+                format = Format::BC3;
+                return true;
+            case VK_FORMAT_BC5_UNORM_BLOCK:
+                format = Format::BC5;
+                return true;
+            case VK_FORMAT_BC7_UNORM_BLOCK:
+            case VK_FORMAT_BC7_SRGB_BLOCK:
+                format = Format::BC7;
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    void BlockCompressor::compress(Format format, const uint8_t* rgba, uint32_t width, uint32_t height, uint8_t* output, ThreadPool& threadPool) {
+        const uint32_t blocksWide = (width + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        const uint32_t blocksHigh = (height + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+        if (static_cast<size_t>(blocksWide) * blocksHigh < MIN_PARALLEL_BLOCKS || threadPool.getThreadCount() <= 1) {
+            compressBlockRows(format, rgba, width, height, 0, blocksHigh, output);
+            return;
+        }
+
+        // A few bands per worker, so one that lands on slower blocks does not hold up the rest
+        const uint32_t bandCount = std::min(blocksHigh, static_cast<uint32_t>(threadPool.getThreadCount() * 4));
+        const uint32_t rowsPerBand = (blocksHigh + bandCount - 1) / bandCount;
+
+        std::vector<std::future<void> > bands;
+        bands.reserve(bandCount);
+        for (uint32_t firstRow = 0; firstRow < blocksHigh; firstRow += rowsPerBand) {
+            const uint32_t endRow = std::min(firstRow + rowsPerBand, blocksHigh);
+            bands.push_back(threadPool.submit([=]() {
+                compressBlockRows(format, rgba, width, height, firstRow, endRow, output);
+            }));
+        }
+
+        for (std::future<void>& band : bands) {
+            band.get();
+        }
+    }
+
+    void BlockCompressor::decompress(Format format, const uint8_t* blocks, uint32_t width, uint32_t height, uint8_t* rgba) {
+        const uint32_t blocksWide = (width + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        const uint32_t blocksHigh = (height + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        const uint32_t blockBytes = getBlockBytes(format);
+
+        uint8_t texels[BLOCK_TEXELS][4];
+        for (uint32_t blockY = 0; blockY < blocksHigh; blockY++) {
+            for (uint32_t blockX = 0; blockX < blocksWide; blockX++) {
+                const uint8_t* block = blocks + (static_cast<size_t>(blockY) * blocksWide + blockX) * blockBytes;
+
+                switch (format) {
+                    case Format::BC1:
+                        decodeBc1Block(block, false, texels);
+                        break;
+                    case Format::BC3:
+                        decodeBc1Block(block + 8, true, texels);
+                        decodeBc4Block(block, 3, texels);
+                        break;
+                    case Format::BC5:
+                        for (uint32_t texel = 0; texel < BLOCK_TEXELS; texel++) {
+                            texels[texel][2] = 0;
+                            texels[texel][3] = 255;
+                        }
+                        decodeBc4Block(block, 0, texels);
+                        decodeBc4Block(block + 8, 1, texels);
+                        break;
+                    case Format::BC7:
+                        decodeBc7Block(block, texels);
+                        break;
+                }
+
+                // Texels of partial blocks past the edge are dropped
+                for (uint32_t y = 0; y < BLOCK_SIZE && blockY * BLOCK_SIZE + y < height; y++) {
+                    for (uint32_t x = 0; x < BLOCK_SIZE && blockX * BLOCK_SIZE + x < width; x++) {
+                        const size_t texel = static_cast<size_t>(blockY * BLOCK_SIZE + y) * width + blockX * BLOCK_SIZE + x;
+                        std::memcpy(rgba + texel * 4, texels[y * BLOCK_SIZE + x], 4);
+                    }
+                }
+            }
+        }
+    }
+
+    double BlockCompressor::computePsnr(const uint8_t* reference, const uint8_t* decoded, size_t texelCount, uint32_t channels) {
+        uint64_t squaredError = 0;
+        for (size_t texel = 0; texel < texelCount; texel++) {
+            for (uint32_t c = 0; c < channels; c++) {
+                const int difference = static_cast<int>(reference[texel * 4 + c]) - static_cast<int>(decoded[texel * 4 + c]);
+                squaredError += static_cast<uint64_t>(difference * difference);
+            }
+        }
+
+        if (squaredError == 0) {
+            return INFINITY;
+        }
+
+        const double meanSquaredError = static_cast<double>(squaredError) / (static_cast<double>(texelCount) * channels);
+        return 10.0 * std::log10(255.0 * 255.0 / meanSquaredError);
+    }
+};
\ No newline at end of file
@@ -43,20 +43,23 @@ namespace JCAT {
 
     JCATBuffer::~JCATBuffer() {
         unmap();
-        vkDestroyBuffer(device.device(), buffer, nullptr);
-        vkFreeMemory(device.device(), memory, nullptr);
+        resourceManager.destroyBuffer(buffer, memory);
     }
 
+    // Host visible memory stays mapped for as long as the allocator holds it, mapping only hands out a pointer into it
     VkResult JCATBuffer::map(VkDeviceSize size, VkDeviceSize offset) {
-        assert(buffer && memory && "Called map on buffer before create");
-        return vkMapMemory(device.device(), memory, offset, size, 0, &mapped);
+        assert(buffer && memory.memory && "Called map on buffer before create");
+        if (memory.mapped == nullptr) {
+            return VK_ERROR_MEMORY_MAP_FAILED;
+        }
+
+        assert(offset <= bufferSize && (size == VK_WHOLE_SIZE || size <= bufferSize - offset) && "Mapped range exceeds the buffer");
+        mapped = static_cast<char *>(memory.mapped) + offset;
+        return VK_SUCCESS;
     }
 
     void JCATBuffer::unmap() {
-        if (mapped) {
-            vkUnmapMemory(device.device(), memory);
-            mapped = nullptr;
-        }
+        mapped = nullptr;
     }
 
     void JCATBuffer::writeToBuffer(void *data, VkDeviceSize size, VkDeviceSize offset) {
@@ -73,22 +76,15 @@ namespace JCAT {
     }
 
     VkResult JCATBuffer::flush(VkDeviceSize size, VkDeviceSize offset) {
-        VkMappedMemoryRange mappedRange = {};
-        mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        mappedRange.memory = memory;
-        mappedRange.offset = offset;
-        mappedRange.size = size;
-
-        return vkFlushMappedMemoryRanges(device.device(), 1, &mappedRange);
+        return resourceManager.getMemoryAllocator().flush(memory, offset, size);
     }
 
     VkResult JCATBuffer::invalidate(VkDeviceSize size, VkDeviceSize offset) {
-        VkMappedMemoryRange mappedRange = {};
-        mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        mappedRange.memory = memory;
-        mappedRange.offset = offset;
-        mappedRange.size = size;
-        return vkInvalidateMappedMemoryRanges(device.device(), 1, &mappedRange);
+        return resourceManager.getMemoryAllocator().invalidate(memory, offset, size);
+    }
+
+    void JCATBuffer::setMovable(std::function<void()> onMoved) {
+        resourceManager.makeMovable(buffer, memory, bufferSize, usageFlags, std::move(onMoved));
     }
 
     VkDescriptorBufferInfo JCATBuffer::descriptorInfo(VkDeviceSize size, VkDeviceSize offset) {
@@ -0,0 +1,377 @@
+#include "./engine/defragmenter.h"
+#include "./engine/resourceManager.h"
+
+#include <cassert>
+#include <stdexcept>
+
+namespace JCAT {
+    Defragmenter::Defragmenter(DeviceSetup& device, ResourceManager& resourceManager) : device{device}, resourceManager{resourceManager} {}
+
+    Defragmenter::~Defragmenter() {
+        retire(true);
+    }
+
+    void Defragmenter::addBuffer(VkBuffer& buffer, MemoryAllocation& memory, VkDeviceSize size, VkBufferUsageFlags usage, std::function<void()> onMoved) {
+        assert(memory.mapped == nullptr && "Mapped buffers can't be moved, their host pointers would go stale");
+        assert(usage & VK_BUFFER_USAGE_TRANSFER_SRC_BIT && "Movable buffers have to be created with VK_BUFFER_USAGE_TRANSFER_SRC_BIT");
+
+        Movable movable{};
+        movable.buffer = &buffer;
+        movable.memory = &memory;
+        movable.size = size;
+        movable.usage = usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        movable.onMoved = std::move(onMoved);
+        movables[&memory] = std::move(movable);
+    }
+
+    void Defragmenter::addImage(VkImage& image, MemoryAllocation& memory, const VkImageCreateInfo& imageInfo, VkImageLayout layout, std::function<void()> onMoved) {
+        assert(imageInfo.usage & VK_IMAGE_USAGE_TRANSFER_SRC_BIT && "Movable images have to be created with VK_IMAGE_USAGE_TRANSFER_SRC_BIT");
+
+        Movable movable{};
+        movable.image = &image;
+        movable.memory = &memory;
+        movable.imageInfo = imageInfo;
+        movable.imageInfo.usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        movable.imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        movable.layout = layout;
+        movable.onMoved = std::move(onMoved);
+        movables[&memory] = std::move(movable);
+    }
+
+    void Defragmenter::remove(const MemoryAllocation& memory) {
+        std::unordered_map<const MemoryAllocation*, Movable>::iterator movable = movables.find(&memory);
+        if (movable == movables.end()) {
+            return;
+        }
+
+        // The copy into the resource may still be running
+        if (movable->second.moved) {
+            waitForMoves();
+        }
+
+        movables.erase(movable);
+    }
+
+    Defragmenter::Retirement& Defragmenter::getRetirement() {
+        if (retirements.empty() || retirements.back().frame != frame) {
+            Retirement retirement{};
+            retirement.frame = frame;
+            retirements.push_back(std::move(retirement));
+        }
+
+        return retirements.back();
+    }
+
+    void Defragmenter::destroyLater(std::function<void()> destroy) {
+        getRetirement().destroys.push_back(std::move(destroy));
+    }
+
+    void Defragmenter::waitForMoves() {
+        for (const Retirement& retirement : retirements) {
+            if (retirement.fence != VK_NULL_HANDLE) {
+                vkWaitForFences(device.device(), 1, &retirement.fence, VK_TRUE, UINT64_MAX);
+            }
+        }
+    }
+
+    void Defragmenter::retire(bool waitForAll) {
+        if (retirements.empty()) {
+            return;
+        }
+
+        // Freeing the old resources can already release blocks, so what was reclaimed is measured across the whole retirement
+        MemoryAllocator& allocator = resourceManager.getMemoryAllocator();
+        const std::vector<MemoryBlockInfo> blocksBefore = allocator.getBlocks();
+        bool movesRetired = false;
+
+        while (!retirements.empty()) {
+            Retirement& retirement = retirements.front();
+            if (!waitForAll && frame < retirement.frame + RETIRE_FRAMES) {
+                break;
+            }
+
+            if (retirement.fence != VK_NULL_HANDLE) {
+                if (waitForAll) {
+                    vkWaitForFences(device.device(), 1, &retirement.fence, VK_TRUE, UINT64_MAX);
+                }
+                else if (vkGetFenceStatus(device.device(), retirement.fence) != VK_SUCCESS) {
+                    break;
+                }
+
+                vkDestroyFence(device.device(), retirement.fence, nullptr);
+                vkFreeCommandBuffers(device.device(), device.getCommandPool(), 1, &retirement.commandBuffer);
+                movesRetired = true;
+            }
+
+            for (std::function<void()>& destroy : retirement.destroys) {
+                destroy();
+            }
+            retirements.pop_front();
+        }
+
+        // The emptied blocks are what defragmenting was for, so they are not kept around for reuse
+        if (movesRetired && !waitForAll) {
+            allocator.releaseEmptyBlocks();
+
+            const std::vector<MemoryBlockInfo> blocksAfter = allocator.getBlocks();
+            VkDeviceSize capacityBefore = 0;
+            VkDeviceSize capacityAfter = 0;
+            for (const MemoryBlockInfo& block : blocksBefore) {
+                capacityBefore += block.capacity;
+            }
+            for (const MemoryBlockInfo& block : blocksAfter) {
+                capacityAfter += block.capacity;
+            }
+            if (blocksAfter.size() < blocksBefore.size()) {
+                stats.blocksReleased += static_cast<uint32_t>(blocksBefore.size() - blocksAfter.size());
+                stats.bytesReclaimed += capacityBefore - capacityAfter;
+            }
+        }
+    }
+
+    const MemoryBlock* Defragmenter::findSparseBlock() {
+        std::unordered_map<const MemoryBlock*, uint32_t> movableCounts;
+        for (const std::pair<const MemoryAllocation* const, Movable>& movable : movables) {
+            if (movable.second.memory->block != nullptr) {
+                movableCounts[movable.second.memory->block]++;
+            }
+        }
+
+        const std::vector<MemoryBlockInfo> blocks = resourceManager.getMemoryAllocator().getBlocks();
+
+        // Finish the block earlier steps started on, what they moved out of it is only freed a few frames later
+        for (const MemoryBlockInfo& block : blocks) {
+            if (block.block == target && movableCounts[target] > 0) {
+                return target;
+            }
+        }
+        target = nullptr;
+        VkDeviceSize targetBytesUsed = 0;
+
+        for (const MemoryBlockInfo& block : blocks) {
+            // Anything in the block that can't move keeps it alive no matter what else is moved out
+            if (block.allocationCount == 0 || movableCounts[block.block] != block.allocationCount) {
+                continue;
+            }
+
+            if (block.bytesUsed * 2 > block.capacity || block.bytesUsed > block.bytesFreeElsewhere) {
+                continue;
+            }
+
+            if (block.block == failedBlock && block.bytesFreeElsewhere <= failedBytesFree) {
+                continue;
+            }
+
+            // The emptiest block frees a whole block for the fewest bytes copied
+            if (target == nullptr || block.bytesUsed < targetBytesUsed) {
+                target = block.block;
+                targetBytesUsed = block.bytesUsed;
+            }
+        }
+
+        return target;
+    }
+
+    void Defragmenter::step(VkDeviceSize byteBudget) {
+        frame++;
+        retire(false);
+
+        // A recorded or running upload writes through the handle it was given, moving the resource would lose its data
+        resourceManager.collectCompletedUploads();
+        if (resourceManager.uploadBatch != nullptr || !resourceManager.pendingUploads.empty()) {
+            return;
+        }
+
+        const MemoryBlock* block = findSparseBlock();
+        if (block == nullptr) {
+            return;
+        }
+
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        std::vector<Movable*> moved;
+        VkDeviceSize bytesMoved = 0;
+
+        for (std::pair<const MemoryAllocation* const, Movable>& movable : movables) {
+            if (movable.second.memory->block != block) {
+                continue;
+            }
+            if (bytesMoved > 0 && bytesMoved + movable.second.memory->size > byteBudget) {
+                break;
+            }
+
+            if (commandBuffer == VK_NULL_HANDLE) {
+                commandBuffer = resourceManager.beginSingleTimeCommands();
+
+                // Wait for whatever wrote the resources last, frames and uploads alike
+                VkMemoryBarrier barrier{};
+                barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+                barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+                barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+                vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+            }
+
+            const VkDeviceSize size = movable.second.memory->size;
+            if (!move(movable.second, commandBuffer, getRetirement())) {
+                failedBlock = block;
+                for (const MemoryBlockInfo& info : resourceManager.getMemoryAllocator().getBlocks()) {
+                    if (info.block == block) {
+                        failedBytesFree = info.bytesFreeElsewhere;
+                    }
+                }
+                target = nullptr;
+                break;
+            }
+
+            moved.push_back(&movable.second);
+            bytesMoved += size;
+        }
+
+        if (commandBuffer == VK_NULL_HANDLE) {
+            return;
+        }
+
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+        vkEndCommandBuffer(commandBuffer);
+
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+        Retirement& retirement = getRetirement();
+        retirement.commandBuffer = commandBuffer;
+        if (vkCreateFence(device.device(), &fenceInfo, nullptr, &retirement.fence) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create defragmentation fence!");
+        }
+
+        // The graphics queue runs it before any frame submitted from here on, those already see the new handles
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &commandBuffer;
+        vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, retirement.fence);
+
+        for (Movable* movable : moved) {
+            if (movable->onMoved) {
+                movable->onMoved();
+            }
+        }
+    }
+
+    bool Defragmenter::move(Movable& movable, VkCommandBuffer commandBuffer, Retirement& retirement) {
+        MemoryAllocator& allocator = resourceManager.getMemoryAllocator();
+        VkDevice logicalDevice = device.device();
+        MemoryAllocation oldMemory = *movable.memory;
+        MemoryAllocation newMemory;
+        VkMemoryRequirements requirements;
+
+        if (movable.buffer != nullptr) {
+            VkBuffer newBuffer;
+            resourceManager.createBufferHandle(movable.size, movable.usage, newBuffer);
+            vkGetBufferMemoryRequirements(logicalDevice, newBuffer, &requirements);
+
+            if (!allocator.allocateElsewhere(requirements, oldMemory, newMemory)) {
+                vkDestroyBuffer(logicalDevice, newBuffer, nullptr);
+                return false;
+            }
+            vkBindBufferMemory(logicalDevice, newBuffer, newMemory.memory, newMemory.offset);
+
+            VkBufferCopy region{};
+            region.size = movable.size;
+            vkCmdCopyBuffer(commandBuffer, *movable.buffer, newBuffer, 1, &region);
+
+            VkBuffer oldBuffer = *movable.buffer;
+            retirement.destroys.push_back([logicalDevice, &allocator, oldBuffer, oldMemory]() mutable {
+                vkDestroyBuffer(logicalDevice, oldBuffer, nullptr);
+                allocator.free(oldMemory);
+            });
+            *movable.buffer = newBuffer;
+        }
+        else {
+            VkImage newImage;
+            if (vkCreateImage(logicalDevice, &movable.imageInfo, nullptr, &newImage) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create image!");
+            }
+            vkGetImageMemoryRequirements(logicalDevice, newImage, &requirements);
+
+            if (!allocator.allocateElsewhere(requirements, oldMemory, newMemory)) {
+                vkDestroyImage(logicalDevice, newImage, nullptr);
+                return false;
+            }
+            vkBindImageMemory(logicalDevice, newImage, newMemory.memory, newMemory.offset);
+
+            recordImageCopy(commandBuffer, movable, *movable.image, newImage);
+
+            VkImage oldImage = *movable.image;
+            retirement.destroys.push_back([logicalDevice, &allocator, oldImage, oldMemory]() mutable {
+                vkDestroyImage(logicalDevice, oldImage, nullptr);
+                allocator.free(oldMemory);
+            });
+            *movable.image = newImage;
+        }
+
+        *movable.memory = newMemory;
+        movable.moved = true;
+
+        stats.moves++;
+        stats.bytesMoved += newMemory.size;
+        return true;
+    }
+
+    void Defragmenter::recordImageCopy(VkCommandBuffer commandBuffer, const Movable& movable, VkImage oldImage, VkImage newImage) {
+        const VkImageCreateInfo& info = movable.imageInfo;
+
+        VkImageMemoryBarrier barriers[2]{};
+        for (VkImageMemoryBarrier& barrier : barriers) {
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            barrier.subresourceRange.levelCount = info.mipLevels;
+            barrier.subresourceRange.layerCount = info.arrayLayers;
+        }
+
+        barriers[0].image = oldImage;
+        barriers[0].oldLayout = movable.layout;
+        barriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barriers[0].srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+        barriers[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+        barriers[1].image = newImage;
+        barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barriers[1].srcAccessMask = 0;
+        barriers[1].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 2, barriers);
+
+        std::vector<VkImageCopy> regions(info.mipLevels);
+        for (uint32_t mip = 0; mip < info.mipLevels; mip++) {
+            VkImageCopy& region = regions[mip];
+            region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            region.srcSubresource.mipLevel = mip;
+            region.srcSubresource.layerCount = info.arrayLayers;
+            region.dstSubresource = region.srcSubresource;
+            region.extent.width = info.extent.width >> mip > 0 ? info.extent.width >> mip : 1;
+            region.extent.height = info.extent.height >> mip > 0 ? info.extent.height >> mip : 1;
+            region.extent.depth = info.extent.depth >> mip > 0 ? info.extent.depth >> mip : 1;
+        }
+        vkCmdCopyImage(commandBuffer, oldImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, newImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                       static_cast<uint32_t>(regions.size()), regions.data());
+
+        // The old image goes back to its layout too, frames recorded before the owner caught up may still sample it
+        barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barriers[0].newLayout = movable.layout;
+        barriers[0].srcAccessMask = 0;
+        barriers[0].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+
+        barriers[1].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barriers[1].newLayout = movable.layout;
+        barriers[1].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barriers[1].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 0, nullptr, 0, nullptr, 2, barriers);
+    }
+};
\ No newline at end of file
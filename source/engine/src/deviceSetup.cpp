@@ -15,9 +15,13 @@ namespace JCAT {
         pickPhysicalDevice();
         createLogicalDevice();
         createCommandPool();
+        createTransferCommandPool();
     }
 
     DeviceSetup::~DeviceSetup() {
+        if (transferCommandPool != VK_NULL_HANDLE) {
+            vkDestroyCommandPool(device_, transferCommandPool, nullptr);
+        }
         vkDestroyCommandPool(device_, commandPool, nullptr);
         vkDestroyDevice(device_, nullptr);
 
@@ -49,6 +53,26 @@ namespace JCAT {
         return presentQueue_;
     }
 
+    VkQueue DeviceSetup::transferQueue() {
+        return transferQueue_;
+    }
+
+    VkCommandPool DeviceSetup::getTransferCommandPool() {
+        return transferCommandPool != VK_NULL_HANDLE ? transferCommandPool : commandPool;
+    }
+
+    bool DeviceSetup::hasDedicatedTransferQueue() {
+        return transferFamily_ != graphicsFamily_;
+    }
+
+    uint32_t DeviceSetup::graphicsQueueFamily() {
+        return graphicsFamily_;
+    }
+
+    uint32_t DeviceSetup::transferQueueFamily() {
+        return transferFamily_;
+    }
+
     SwapChainSupportDetails DeviceSetup::getSwapChainSupport() {
         return querySwapChainSupport(physicalDevice);
     }
@@ -231,6 +255,9 @@ namespace JCAT {
 
         std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
         std::set<uint32_t> uniqueQueueFamilies = { indices.graphicsFamily, indices.presentFamily };
+        if (indices.transferFamilyHasValue) {
+            uniqueQueueFamilies.insert(indices.transferFamily);
+        }
 
         float queuePriority = 1.0f;
         for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -270,6 +297,18 @@ namespace JCAT {
 
         vkGetDeviceQueue(device_, indices.graphicsFamily, 0, &graphicsQueue_);
         vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
+
+        graphicsFamily_ = indices.graphicsFamily;
+        if (indices.transferFamilyHasValue) {
+            transferFamily_ = indices.transferFamily;
+            vkGetDeviceQueue(device_, indices.transferFamily, 0, &transferQueue_);
+            std::cout << "Uploading through the dedicated transfer queue family " << transferFamily_ << std::endl;
+        }
+        else {
+            // e.g. lavapipe and many integrated GPUs only expose one family, uploads share the graphics queue then
+            transferFamily_ = indices.graphicsFamily;
+            transferQueue_ = graphicsQueue_;
+        }
     }
 
     void DeviceSetup::createCommandPool() {
@@ -285,6 +324,21 @@ namespace JCAT {
         }
     }
 
+    void DeviceSetup::createTransferCommandPool() {
+        if (!hasDedicatedTransferQueue()) {
+            return;
+        }
+
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.queueFamilyIndex = transferFamily_;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+        if (vkCreateCommandPool(device_, &poolInfo, nullptr, &transferCommandPool) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create transfer command pool!");
+        }
+    }
+
     void DeviceSetup::setupDebugMessenger() {
         if (!enableValidationLayers) {
             return;
@@ -452,6 +506,31 @@ namespace JCAT {
             i++;
         }
 
+        // Prefer a transfer only family (the copy engine on discrete GPUs), then an async compute family,
+        // every family that can do graphics or compute can also copy
+        int computeFamily = -1;
+        for (uint32_t family = 0; family < queueFamilyCount; family++) {
+            const VkQueueFamilyProperties& queueFamily = queueFamilies[family];
+            if (queueFamily.queueCount == 0 || queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+                continue;
+            }
+
+            if (!(queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT) && queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) {
+                indices.transferFamily = family;
+                indices.transferFamilyHasValue = true;
+                break;
+            }
+
+            if (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT && computeFamily < 0) {
+                computeFamily = static_cast<int>(family);
+            }
+        }
+
+        if (!indices.transferFamilyHasValue && computeFamily >= 0) {
+            indices.transferFamily = static_cast<uint32_t>(computeFamily);
+            indices.transferFamilyHasValue = true;
+        }
+
         return indices;
     }
 
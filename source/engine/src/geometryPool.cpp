@@ -0,0 +1,118 @@
+#include "./engine/geometryPool.h"
+
+#include <cassert>
+#include <iterator>
+
+namespace JCAT {
+    GeometryPool::RangeAllocator::RangeAllocator(VkDeviceSize capacity) : capacity{capacity} {
+        if (capacity > 0) {
+            freeRanges.emplace(0, capacity);
+        }
+    }
+
+    bool GeometryPool::RangeAllocator::allocate(VkDeviceSize size, VkDeviceSize alignment, GeometryRange& range) {
+        if (size == 0) {
+            return false;
+        }
+        alignment = alignment > 0 ? alignment : 1;
+
+        for (std::map<VkDeviceSize, VkDeviceSize>::iterator free = freeRanges.begin(); free != freeRanges.end(); free++) {
+            const VkDeviceSize freeOffset = free->first;
+            const VkDeviceSize freeEnd = free->first + free->second;
+            const VkDeviceSize offset = (freeOffset + alignment - 1) / alignment * alignment;
+
+            if (offset + size > freeEnd) {
+                continue;
+            }
+
+            // Whatever the alignment skipped stays free in front, the rest of the range after the allocation
+            freeRanges.erase(free);
+            if (offset > freeOffset) {
+                freeRanges.emplace(freeOffset, offset - freeOffset);
+            }
+            if (offset + size < freeEnd) {
+                freeRanges.emplace(offset + size, freeEnd - offset - size);
+            }
+
+            range.offset = offset;
+            range.size = size;
+            bytesUsed += size;
+            allocationCount++;
+            return true;
+        }
+
+        return false;
+    }
+
+    void GeometryPool::RangeAllocator::free(const GeometryRange& range) {
+        if (range.size == 0) {
+            return;
+        }
+        assert(range.offset + range.size <= capacity && "Freed a range outside of the geometry pool");
+
+        VkDeviceSize offset = range.offset;
+        VkDeviceSize size = range.size;
+
+        // Merge with the free ranges ending right before and starting right after it
+        std::map<VkDeviceSize, VkDeviceSize>::iterator next = freeRanges.lower_bound(offset);
+        if (next != freeRanges.begin()) {
+            std::map<VkDeviceSize, VkDeviceSize>::iterator previous = std::prev(next);
+            assert(previous->first + previous->second <= offset && "Freed a range of the geometry pool twice");
+
+            if (previous->first + previous->second == offset) {
+                offset = previous->first;
+                size += previous->second;
+                freeRanges.erase(previous);
+            }
+        }
+        if (next != freeRanges.end() && next->first == range.offset + range.size) {
+            size += next->second;
+            freeRanges.erase(next);
+        }
+
+        freeRanges.emplace(offset, size);
+        bytesUsed -= range.size;
+        allocationCount--;
+    }
+
+    GeometryPool::GeometryPool(DeviceSetup& device, ResourceManager& resourceManager, VkDeviceSize vertexCapacity, VkDeviceSize indexCapacity)
+        : vertexRanges{vertexCapacity}, indexRanges{indexCapacity} {
+        vertexBuffer = std::make_unique<JCATBuffer>(device, resourceManager, vertexCapacity, 1,
+                                                    VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                                    VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        indexBuffer = std::make_unique<JCATBuffer>(device, resourceManager, indexCapacity, 1,
+                                                   VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        // Models look the buffers up on every bind, so nothing has to be told when they move
+        vertexBuffer->setMovable();
+        indexBuffer->setMovable();
+    }
+
+    bool GeometryPool::allocateVertices(VkDeviceSize size, VkDeviceSize alignment, GeometryRange& range) {
+        return vertexRanges.allocate(size, alignment, range);
+    }
+
+    bool GeometryPool::allocateIndices(VkDeviceSize size, VkDeviceSize alignment, GeometryRange& range) {
+        return indexRanges.allocate(size, alignment, range);
+    }
+
+    void GeometryPool::freeVertices(const GeometryRange& range) {
+        vertexRanges.free(range);
+    }
+
+    void GeometryPool::freeIndices(const GeometryRange& range) {
+        indexRanges.free(range);
+    }
+
+    GeometryPoolStats GeometryPool::getStats() const {
+        GeometryPoolStats stats{};
+        stats.vertexBytesUsed = vertexRanges.getBytesUsed();
+        stats.vertexCapacity = vertexRanges.getCapacity();
+        stats.indexBytesUsed = indexRanges.getBytesUsed();
+        stats.indexCapacity = indexRanges.getCapacity();
+        stats.allocationCount = vertexRanges.getAllocationCount() + indexRanges.getAllocationCount();
+        return stats;
+    }
+};
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include "./engine/graphicsPipeline.h"
 #include "./engine/2d/model2d.h"
 #include "./engine/3d/model3d.h"
+#include "./engine/3d/impostorAtlas.h"
 
 namespace JCAT {
     /// @brief Constructs a GraphicsPipeline object.
@@ -16,6 +17,19 @@ namespace JCAT {
             {PipelineType::SOLID_SPRITE_PIPELINE, VK_NULL_HANDLE},
             {PipelineType::TRANSPARENT_SPRITE_PIPELINE, VK_NULL_HANDLE},
             {PipelineType::SOLID_OBJECT_PIPELINE, VK_NULL_HANDLE},
+            {PipelineType::INSTANCED_OBJECT_PIPELINE, VK_NULL_HANDLE},
+            {PipelineType::COMPACT_OBJECT_PIPELINE, VK_NULL_HANDLE},
+            {PipelineType::INSTANCED_COMPACT_OBJECT_PIPELINE, VK_NULL_HANDLE},
+            {PipelineType::SPLIT_OBJECT_PIPELINE, VK_NULL_HANDLE},
+            {PipelineType::INSTANCED_SPLIT_OBJECT_PIPELINE, VK_NULL_HANDLE},
+            {PipelineType::CROSS_FADE_OBJECT_PIPELINE, VK_NULL_HANDLE},
+            {PipelineType::CROSS_FADE_COMPACT_OBJECT_PIPELINE, VK_NULL_HANDLE},
+            {PipelineType::CROSS_FADE_SPLIT_OBJECT_PIPELINE, VK_NULL_HANDLE},
+            {PipelineType::DEPTH_ONLY_PIPELINE, VK_NULL_HANDLE},
+            {PipelineType::IMPOSTOR_BAKE_PIPELINE, VK_NULL_HANDLE},
+            {PipelineType::IMPOSTOR_BAKE_COMPACT_PIPELINE, VK_NULL_HANDLE},
+            {PipelineType::IMPOSTOR_BAKE_SPLIT_PIPELINE, VK_NULL_HANDLE},
+            {PipelineType::IMPOSTOR_PIPELINE, VK_NULL_HANDLE},
             {PipelineType::TRANSPARENT_OBJECT_PIPELINE, VK_NULL_HANDLE},
             {PipelineType::UI_RENDERING_PIPELINE, VK_NULL_HANDLE},
             {PipelineType::SHADOW_MAPPING_PIPELINE, VK_NULL_HANDLE},
@@ -27,8 +41,9 @@ namespace JCAT {
 
     /// @brief Destructor that cleans up Vulkan shader modules and pipelines.
     GraphicsPipeline::~GraphicsPipeline() {
-        vkDestroyShaderModule(device.device(), vertShaderModule, nullptr);
-        vkDestroyShaderModule(device.device(), fragShaderModule, nullptr);
+        for (VkShaderModule shaderModule : shaderModules) {
+            vkDestroyShaderModule(device.device(), shaderModule, nullptr);
+        }
 
         for (std::pair<const PipelineType, VkPipeline>& graphicsPipeline : graphicsPipelines) {
             vkDestroyPipeline(device.device(), graphicsPipeline.second, nullptr);
@@ -65,6 +80,19 @@ namespace JCAT {
         configInfos.insert({PipelineType::SOLID_SPRITE_PIPELINE, PipelineConfigInfo{}});
         configInfos.insert({PipelineType::TRANSPARENT_SPRITE_PIPELINE, PipelineConfigInfo{}});
         configInfos.insert({PipelineType::SOLID_OBJECT_PIPELINE, PipelineConfigInfo{}});
+        configInfos.insert({PipelineType::INSTANCED_OBJECT_PIPELINE, PipelineConfigInfo{}});
+        configInfos.insert({PipelineType::COMPACT_OBJECT_PIPELINE, PipelineConfigInfo{}});
+        configInfos.insert({PipelineType::INSTANCED_COMPACT_OBJECT_PIPELINE, PipelineConfigInfo{}});
+        configInfos.insert({PipelineType::SPLIT_OBJECT_PIPELINE, PipelineConfigInfo{}});
+        configInfos.insert({PipelineType::INSTANCED_SPLIT_OBJECT_PIPELINE, PipelineConfigInfo{}});
+        configInfos.insert({PipelineType::CROSS_FADE_OBJECT_PIPELINE, PipelineConfigInfo{}});
+        configInfos.insert({PipelineType::CROSS_FADE_COMPACT_OBJECT_PIPELINE, PipelineConfigInfo{}});
+        configInfos.insert({PipelineType::CROSS_FADE_SPLIT_OBJECT_PIPELINE, PipelineConfigInfo{}});
+        configInfos.insert({PipelineType::DEPTH_ONLY_PIPELINE, PipelineConfigInfo{}});
+        configInfos.insert({PipelineType::IMPOSTOR_BAKE_PIPELINE, PipelineConfigInfo{}});
+        configInfos.insert({PipelineType::IMPOSTOR_BAKE_COMPACT_PIPELINE, PipelineConfigInfo{}});
+        configInfos.insert({PipelineType::IMPOSTOR_BAKE_SPLIT_PIPELINE, PipelineConfigInfo{}});
+        configInfos.insert({PipelineType::IMPOSTOR_PIPELINE, PipelineConfigInfo{}});
         configInfos.insert({PipelineType::TRANSPARENT_OBJECT_PIPELINE, PipelineConfigInfo{}});
         configInfos.insert({PipelineType::UI_RENDERING_PIPELINE, PipelineConfigInfo{}});
         configInfos.insert({PipelineType::SHADOW_MAPPING_PIPELINE, PipelineConfigInfo{}});
@@ -126,6 +154,37 @@ namespace JCAT {
                 case PipelineType::SOLID_OBJECT_PIPELINE:
                     configureSolidObjectPipeline(configInfo.second);
                     break;
+                case PipelineType::INSTANCED_OBJECT_PIPELINE:
+                    configureInstancedObjectPipeline(configInfo.second);
+                    break;
+                case PipelineType::COMPACT_OBJECT_PIPELINE:
+                    configureCompactObjectPipeline(configInfo.second);
+                    break;
+                case PipelineType::INSTANCED_COMPACT_OBJECT_PIPELINE:
+                    configureInstancedCompactObjectPipeline(configInfo.second);
+                    break;
+                case PipelineType::SPLIT_OBJECT_PIPELINE:
+                    configureSplitObjectPipeline(configInfo.second);
+                    break;
+                case PipelineType::INSTANCED_SPLIT_OBJECT_PIPELINE:
+                    configureInstancedSplitObjectPipeline(configInfo.second);
+                    break;
+                case PipelineType::CROSS_FADE_OBJECT_PIPELINE:
+                case PipelineType::CROSS_FADE_COMPACT_OBJECT_PIPELINE:
+                case PipelineType::CROSS_FADE_SPLIT_OBJECT_PIPELINE:
+                    configureCrossFadeObjectPipeline(configInfo.second);
+                    break;
+                case PipelineType::DEPTH_ONLY_PIPELINE:
+                    configureDepthOnlyPipeline(configInfo.second);
+                    break;
+                case PipelineType::IMPOSTOR_BAKE_PIPELINE:
+                case PipelineType::IMPOSTOR_BAKE_COMPACT_PIPELINE:
+                case PipelineType::IMPOSTOR_BAKE_SPLIT_PIPELINE:
+                    configureImpostorBakePipeline(configInfo.second);
+                    break;
+                case PipelineType::IMPOSTOR_PIPELINE:
+                    configureImpostorPipeline(configInfo.second);
+                    break;
                 case PipelineType::TRANSPARENT_OBJECT_PIPELINE:
                     configureTransparentObjectPipeline(configInfo.second);
                     break;
@@ -224,6 +283,89 @@ namespace JCAT {
 
         solidObjectRenderingInfo.depthStencilInfo.depthTestEnable = VK_TRUE;
         solidObjectRenderingInfo.depthStencilInfo.depthWriteEnable = VK_TRUE;
+        // Equal passes too, so objects already drawn by a depth-only prepass still get shaded
+        solidObjectRenderingInfo.depthStencilInfo.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+    }
+
+    /// @brief Configures the pipeline settings for rendering instanced solid objects.
+    /// @param instancedObjectRenderingInfo Reference to the pipeline configuration.
+    void GraphicsPipeline::configureInstancedObjectPipeline(PipelineConfigInfo& instancedObjectRenderingInfo) {
+        std::cout << "Configuring Instanced Object Pipeline" << std::endl;
+
+        // Fixed function state matches the solid object pipeline, only the vertex input differs
+        configureSolidObjectPipeline(instancedObjectRenderingInfo);
+    }
+
+    /// @brief Configures the pipeline settings for rendering solid objects with compact vertices.
+    /// @param compactObjectRenderingInfo Reference to the pipeline configuration.
+    void GraphicsPipeline::configureCompactObjectPipeline(PipelineConfigInfo& compactObjectRenderingInfo) {
+        std::cout << "Configuring Compact Object Pipeline" << std::endl;
+
+        configureSolidObjectPipeline(compactObjectRenderingInfo);
+    }
+
+    /// @brief Configures the pipeline settings for rendering instanced solid objects with compact vertices.
+    /// @param instancedCompactObjectRenderingInfo Reference to the pipeline configuration.
+    void GraphicsPipeline::configureInstancedCompactObjectPipeline(PipelineConfigInfo& instancedCompactObjectRenderingInfo) {
+        std::cout << "Configuring Instanced Compact Object Pipeline" << std::endl;
+
+        configureSolidObjectPipeline(instancedCompactObjectRenderingInfo);
+    }
+
+    /// @brief Configures the pipeline settings for rendering solid objects with a separate position stream.
+    /// @param splitObjectRenderingInfo Reference to the pipeline configuration.
+    void GraphicsPipeline::configureSplitObjectPipeline(PipelineConfigInfo& splitObjectRenderingInfo) {
+        std::cout << "Configuring Split Object Pipeline" << std::endl;
+
+        configureSolidObjectPipeline(splitObjectRenderingInfo);
+    }
+
+    /// @brief Configures the pipeline settings for rendering instanced solid objects with a separate position stream.
+    /// @param instancedSplitObjectRenderingInfo Reference to the pipeline configuration.
+    void GraphicsPipeline::configureInstancedSplitObjectPipeline(PipelineConfigInfo& instancedSplitObjectRenderingInfo) {
+        std::cout << "Configuring Instanced Split Object Pipeline" << std::endl;
+
+        configureSolidObjectPipeline(instancedSplitObjectRenderingInfo);
+    }
+
+    /// @brief Configures the pipeline settings for rendering solid objects that cross-fade into their impostor.
+    /// @param crossFadeObjectRenderingInfo Reference to the pipeline configuration.
+    void GraphicsPipeline::configureCrossFadeObjectPipeline(PipelineConfigInfo& crossFadeObjectRenderingInfo) {
+        std::cout << "Configuring Cross Fade Object Pipeline" << std::endl;
+
+        // Only the fragment shader differs, its discard is what keeps these off the early depth tested pipelines
+        configureSolidObjectPipeline(crossFadeObjectRenderingInfo);
+    }
+
+    /// @brief Configures the pipeline settings for writing depth only.
+    /// @param depthOnlyInfo Reference to the pipeline configuration.
+    void GraphicsPipeline::configureDepthOnlyPipeline(PipelineConfigInfo& depthOnlyInfo) {
+        std::cout << "Configuring Depth Only Pipeline" << std::endl;
+
+        configureSolidObjectPipeline(depthOnlyInfo);
+
+        depthOnlyInfo.depthStencilInfo.depthCompareOp = VK_COMPARE_OP_LESS;
+        depthOnlyInfo.colorBlendAttachment.colorWriteMask = 0;
+    }
+
+    /// @brief Configures the pipeline settings for baking model views into an impostor atlas.
+    /// @param impostorBakeInfo Reference to the pipeline configuration.
+    void GraphicsPipeline::configureImpostorBakePipeline(PipelineConfigInfo& impostorBakeInfo) {
+        std::cout << "Configuring Impostor Bake Pipeline" << std::endl;
+
+        configureSolidObjectPipeline(impostorBakeInfo);
+
+        // Each tile is cleared and drawn once, there is no prepass to match
+        impostorBakeInfo.depthStencilInfo.depthCompareOp = VK_COMPARE_OP_LESS;
+    }
+
+    /// @brief Configures the pipeline settings for drawing impostor quads.
+    /// @param impostorRenderingInfo Reference to the pipeline configuration.
+    void GraphicsPipeline::configureImpostorPipeline(PipelineConfigInfo& impostorRenderingInfo) {
+        std::cout << "Configuring Impostor Pipeline" << std::endl;
+
+        // Pixels outside the baked silhouette are discarded, so the quads are drawn like any opaque object
+        configureSolidObjectPipeline(impostorRenderingInfo);
     }
 
     /// @brief Configures the pipeline settings for rendering transparent objects.
@@ -443,6 +585,201 @@ namespace JCAT {
         createPipeline(getPipeline(PipelineType::SOLID_OBJECT_PIPELINE), solidObjectRenderingInfo, shaderStages, vertexInputInfo);
     }
 
+    /// @brief Creates a graphics pipeline for rendering instanced solid objects.
+    /// @param vertFilepath Path to the vertex shader file.
+    /// @param fragfilepath Path to the fragment shader file.
+    /// @param instancedObjectRenderingInfo Reference to the pipeline configuration.
+    void GraphicsPipeline::createInstancedObjectPipeline(const std::string& vertFilepath, const std::string& fragfilepath, PipelineConfigInfo& instancedObjectRenderingInfo) {
+        assert(instancedObjectRenderingInfo.pipelineLayout != VK_NULL_HANDLE && "Cannot create graphics pipeline: no pipelineLayout provided in configInfo!");
+        assert(instancedObjectRenderingInfo.renderPass != VK_NULL_HANDLE && "Cannot create graphics pipeline: no renderPass provided in configInfo!");
+
+        std::vector<VkPipelineShaderStageCreateInfo> shaderStages = createShaderStages(vertFilepath, fragfilepath);
+
+        VkPipelineVertexInputStateCreateInfo vertexInputInfo = getDescriptions3D(true);
+
+        createPipeline(getPipeline(PipelineType::INSTANCED_OBJECT_PIPELINE), instancedObjectRenderingInfo, shaderStages, vertexInputInfo);
+    }
+
+    /// @brief Creates a graphics pipeline for rendering solid objects with compact vertices.
+    /// @param vertFilepath Path to the vertex shader file.
+    /// @param fragfilepath Path to the fragment shader file.
+    /// @param compactObjectRenderingInfo Reference to the pipeline configuration.
+    void GraphicsPipeline::createCompactObjectPipeline(const std::string& vertFilepath, const std::string& fragfilepath, PipelineConfigInfo& compactObjectRenderingInfo) {
+        assert(compactObjectRenderingInfo.pipelineLayout != VK_NULL_HANDLE && "Cannot create graphics pipeline: no pipelineLayout provided in configInfo!");
+        assert(compactObjectRenderingInfo.renderPass != VK_NULL_HANDLE && "Cannot create graphics pipeline: no renderPass provided in configInfo!");
+
+        std::vector<VkPipelineShaderStageCreateInfo> shaderStages = createShaderStages(vertFilepath, fragfilepath);
+
+        VkPipelineVertexInputStateCreateInfo vertexInputInfo = getDescriptions3D(false, JCATModel3D::VertexFormat::COMPACT);
+
+        createPipeline(getPipeline(PipelineType::COMPACT_OBJECT_PIPELINE), compactObjectRenderingInfo, shaderStages, vertexInputInfo);
+    }
+
+    /// @brief Creates a graphics pipeline for rendering instanced solid objects with compact vertices.
+    /// @param vertFilepath Path to the vertex shader file.
+    /// @param fragfilepath Path to the fragment shader file.
+    /// @param instancedCompactObjectRenderingInfo Reference to the pipeline configuration.
+    void GraphicsPipeline::createInstancedCompactObjectPipeline(const std::string& vertFilepath, const std::string& fragfilepath, PipelineConfigInfo& instancedCompactObjectRenderingInfo) {
+        assert(instancedCompactObjectRenderingInfo.pipelineLayout != VK_NULL_HANDLE && "Cannot create graphics pipeline: no pipelineLayout provided in configInfo!");
+        assert(instancedCompactObjectRenderingInfo.renderPass != VK_NULL_HANDLE && "Cannot create graphics pipeline: no renderPass provided in configInfo!");
+
+        std::vector<VkPipelineShaderStageCreateInfo> shaderStages = createShaderStages(vertFilepath, fragfilepath);
+
+        VkPipelineVertexInputStateCreateInfo vertexInputInfo = getDescriptions3D(true, JCATModel3D::VertexFormat::COMPACT);
+
+        createPipeline(getPipeline(PipelineType::INSTANCED_COMPACT_OBJECT_PIPELINE), instancedCompactObjectRenderingInfo, shaderStages, vertexInputInfo);
+    }
+
+    /// @brief Creates a graphics pipeline for rendering solid objects with a separate position stream.
+    /// @param vertFilepath Path to the vertex shader file.
+    /// @param fragfilepath Path to the fragment shader file.
+    /// @param splitObjectRenderingInfo Reference to the pipeline configuration.
+    void GraphicsPipeline::createSplitObjectPipeline(const std::string& vertFilepath, const std::string& fragfilepath, PipelineConfigInfo& splitObjectRenderingInfo) {
+        assert(splitObjectRenderingInfo.pipelineLayout != VK_NULL_HANDLE && "Cannot create graphics pipeline: no pipelineLayout provided in configInfo!");
+        assert(splitObjectRenderingInfo.renderPass != VK_NULL_HANDLE && "Cannot create graphics pipeline: no renderPass provided in configInfo!");
+
+        std::vector<VkPipelineShaderStageCreateInfo> shaderStages = createShaderStages(vertFilepath, fragfilepath);
+
+        VkPipelineVertexInputStateCreateInfo vertexInputInfo = getDescriptions3D(false, JCATModel3D::VertexFormat::SPLIT);
+
+        createPipeline(getPipeline(PipelineType::SPLIT_OBJECT_PIPELINE), splitObjectRenderingInfo, shaderStages, vertexInputInfo);
+    }
+
+    /// @brief Creates a graphics pipeline for rendering instanced solid objects with a separate position stream.
+    /// @param vertFilepath Path to the vertex shader file.
+    /// @param fragfilepath Path to the fragment shader file.
+    /// @param instancedSplitObjectRenderingInfo Reference to the pipeline configuration.
+    void GraphicsPipeline::createInstancedSplitObjectPipeline(const std::string& vertFilepath, const std::string& fragfilepath, PipelineConfigInfo& instancedSplitObjectRenderingInfo) {
+        assert(instancedSplitObjectRenderingInfo.pipelineLayout != VK_NULL_HANDLE && "Cannot create graphics pipeline: no pipelineLayout provided in configInfo!");
+        assert(instancedSplitObjectRenderingInfo.renderPass != VK_NULL_HANDLE && "Cannot create graphics pipeline: no renderPass provided in configInfo!");
+
+        std::vector<VkPipelineShaderStageCreateInfo> shaderStages = createShaderStages(vertFilepath, fragfilepath);
+
+        VkPipelineVertexInputStateCreateInfo vertexInputInfo = getDescriptions3D(true, JCATModel3D::VertexFormat::SPLIT);
+
+        createPipeline(getPipeline(PipelineType::INSTANCED_SPLIT_OBJECT_PIPELINE), instancedSplitObjectRenderingInfo, shaderStages, vertexInputInfo);
+    }
+
+    /// @brief Creates a graphics pipeline for rendering solid objects that cross-fade into their impostor.
+    /// @param vertFilepath Path to the vertex shader file.
+    /// @param fragfilepath Path to the fragment shader file.
+    /// @param crossFadeObjectRenderingInfo Reference to the pipeline configuration.
+    void GraphicsPipeline::createCrossFadeObjectPipeline(const std::string& vertFilepath, const std::string& fragfilepath, PipelineConfigInfo& crossFadeObjectRenderingInfo) {
+        assert(crossFadeObjectRenderingInfo.pipelineLayout != VK_NULL_HANDLE && "Cannot create graphics pipeline: no pipelineLayout provided in configInfo!");
+        assert(crossFadeObjectRenderingInfo.renderPass != VK_NULL_HANDLE && "Cannot create graphics pipeline: no renderPass provided in configInfo!");
+
+        std::vector<VkPipelineShaderStageCreateInfo> shaderStages = createShaderStages(vertFilepath, fragfilepath);
+
+        VkPipelineVertexInputStateCreateInfo vertexInputInfo = getDescriptions3D();
+
+        createPipeline(getPipeline(PipelineType::CROSS_FADE_OBJECT_PIPELINE), crossFadeObjectRenderingInfo, shaderStages, vertexInputInfo);
+    }
+
+    /// @brief Creates a graphics pipeline for rendering solid objects with compact vertices that cross-fade into their impostor.
+    /// @param vertFilepath Path to the vertex shader file.
+    /// @param fragfilepath Path to the fragment shader file.
+    /// @param crossFadeObjectRenderingInfo Reference to the pipeline configuration.
+    void GraphicsPipeline::createCrossFadeCompactObjectPipeline(const std::string& vertFilepath, const std::string& fragfilepath, PipelineConfigInfo& crossFadeObjectRenderingInfo) {
+        assert(crossFadeObjectRenderingInfo.pipelineLayout != VK_NULL_HANDLE && "Cannot create graphics pipeline: no pipelineLayout provided in configInfo!");
+        assert(crossFadeObjectRenderingInfo.renderPass != VK_NULL_HANDLE && "Cannot create graphics pipeline: no renderPass provided in configInfo!");
+
+        std::vector<VkPipelineShaderStageCreateInfo> shaderStages = createShaderStages(vertFilepath, fragfilepath);
+
+        VkPipelineVertexInputStateCreateInfo vertexInputInfo = getDescriptions3D(false, JCATModel3D::VertexFormat::COMPACT);
+
+        createPipeline(getPipeline(PipelineType::CROSS_FADE_COMPACT_OBJECT_PIPELINE), crossFadeObjectRenderingInfo, shaderStages, vertexInputInfo);
+    }
+
+    /// @brief Creates a graphics pipeline for rendering solid objects with a separate position stream that cross-fade into their impostor.
+    /// @param vertFilepath Path to the vertex shader file.
+    /// @param fragfilepath Path to the fragment shader file.
+    /// @param crossFadeObjectRenderingInfo Reference to the pipeline configuration.
+    void GraphicsPipeline::createCrossFadeSplitObjectPipeline(const std::string& vertFilepath, const std::string& fragfilepath, PipelineConfigInfo& crossFadeObjectRenderingInfo) {
+        assert(crossFadeObjectRenderingInfo.pipelineLayout != VK_NULL_HANDLE && "Cannot create graphics pipeline: no pipelineLayout provided in configInfo!");
+        assert(crossFadeObjectRenderingInfo.renderPass != VK_NULL_HANDLE && "Cannot create graphics pipeline: no renderPass provided in configInfo!");
+
+        std::vector<VkPipelineShaderStageCreateInfo> shaderStages = createShaderStages(vertFilepath, fragfilepath);
+
+        VkPipelineVertexInputStateCreateInfo vertexInputInfo = getDescriptions3D(false, JCATModel3D::VertexFormat::SPLIT);
+
+        createPipeline(getPipeline(PipelineType::CROSS_FADE_SPLIT_OBJECT_PIPELINE), crossFadeObjectRenderingInfo, shaderStages, vertexInputInfo);
+    }
+
+    /// @brief Creates a graphics pipeline that only writes depth, fed by the position stream of SPLIT models.
+    /// @param vertFilepath Path to the vertex shader file.
+    /// @param fragfilepath Path to the fragment shader file.
+    /// @param depthOnlyInfo Reference to the pipeline configuration.
+    void GraphicsPipeline::createDepthOnlyPipeline(const std::string& vertFilepath, const std::string& fragfilepath, PipelineConfigInfo& depthOnlyInfo) {
+        assert(depthOnlyInfo.pipelineLayout != VK_NULL_HANDLE && "Cannot create graphics pipeline: no pipelineLayout provided in configInfo!");
+        assert(depthOnlyInfo.renderPass != VK_NULL_HANDLE && "Cannot create graphics pipeline: no renderPass provided in configInfo!");
+
+        std::vector<VkPipelineShaderStageCreateInfo> shaderStages = createShaderStages(vertFilepath, fragfilepath);
+
+        VkPipelineVertexInputStateCreateInfo vertexInputInfo = getPositionDescriptions3D();
+
+        createPipeline(getPipeline(PipelineType::DEPTH_ONLY_PIPELINE), depthOnlyInfo, shaderStages, vertexInputInfo);
+    }
+
+    /// @brief Creates a graphics pipeline that bakes the views of standard vertex models into an impostor atlas.
+    /// @param vertFilepath Path to the vertex shader file.
+    /// @param fragfilepath Path to the fragment shader file.
+    /// @param impostorBakeInfo Reference to the pipeline configuration.
+    void GraphicsPipeline::createImpostorBakePipeline(const std::string& vertFilepath, const std::string& fragfilepath, PipelineConfigInfo& impostorBakeInfo) {
+        assert(impostorBakeInfo.pipelineLayout != VK_NULL_HANDLE && "Cannot create graphics pipeline: no pipelineLayout provided in configInfo!");
+        assert(impostorBakeInfo.renderPass != VK_NULL_HANDLE && "Cannot create graphics pipeline: no renderPass provided in configInfo!");
+
+        std::vector<VkPipelineShaderStageCreateInfo> shaderStages = createShaderStages(vertFilepath, fragfilepath);
+
+        VkPipelineVertexInputStateCreateInfo vertexInputInfo = getDescriptions3D();
+
+        createPipeline(getPipeline(PipelineType::IMPOSTOR_BAKE_PIPELINE), impostorBakeInfo, shaderStages, vertexInputInfo);
+    }
+
+    /// @brief Creates a graphics pipeline that bakes the views of compact vertex models into an impostor atlas.
+    /// @param vertFilepath Path to the vertex shader file.
+    /// @param fragfilepath Path to the fragment shader file.
+    /// @param impostorBakeInfo Reference to the pipeline configuration.
+    void GraphicsPipeline::createImpostorBakeCompactPipeline(const std::string& vertFilepath, const std::string& fragfilepath, PipelineConfigInfo& impostorBakeInfo) {
+        assert(impostorBakeInfo.pipelineLayout != VK_NULL_HANDLE && "Cannot create graphics pipeline: no pipelineLayout provided in configInfo!");
+        assert(impostorBakeInfo.renderPass != VK_NULL_HANDLE && "Cannot create graphics pipeline: no renderPass provided in configInfo!");
+
+        std::vector<VkPipelineShaderStageCreateInfo> shaderStages = createShaderStages(vertFilepath, fragfilepath);
+
+        VkPipelineVertexInputStateCreateInfo vertexInputInfo = getDescriptions3D(false, JCATModel3D::VertexFormat::COMPACT);
+
+        createPipeline(getPipeline(PipelineType::IMPOSTOR_BAKE_COMPACT_PIPELINE), impostorBakeInfo, shaderStages, vertexInputInfo);
+    }
+
+    /// @brief Creates a graphics pipeline that bakes the views of models with a separate position stream into an impostor atlas.
+    /// @param vertFilepath Path to the vertex shader file.
+    /// @param fragfilepath Path to the fragment shader file.
+    /// @param impostorBakeInfo Reference to the pipeline configuration.
+    void GraphicsPipeline::createImpostorBakeSplitPipeline(const std::string& vertFilepath, const std::string& fragfilepath, PipelineConfigInfo& impostorBakeInfo) {
+        assert(impostorBakeInfo.pipelineLayout != VK_NULL_HANDLE && "Cannot create graphics pipeline: no pipelineLayout provided in configInfo!");
+        assert(impostorBakeInfo.renderPass != VK_NULL_HANDLE && "Cannot create graphics pipeline: no renderPass provided in configInfo!");
+
+        std::vector<VkPipelineShaderStageCreateInfo> shaderStages = createShaderStages(vertFilepath, fragfilepath);
+
+        VkPipelineVertexInputStateCreateInfo vertexInputInfo = getDescriptions3D(false, JCATModel3D::VertexFormat::SPLIT);
+
+        createPipeline(getPipeline(PipelineType::IMPOSTOR_BAKE_SPLIT_PIPELINE), impostorBakeInfo, shaderStages, vertexInputInfo);
+    }
+
+    /// @brief Creates a graphics pipeline that draws impostor quads from an impostor atlas.
+    /// @param vertFilepath Path to the vertex shader file.
+    /// @param fragfilepath Path to the fragment shader file.
+    /// @param impostorRenderingInfo Reference to the pipeline configuration.
+    void GraphicsPipeline::createImpostorPipeline(const std::string& vertFilepath, const std::string& fragfilepath, PipelineConfigInfo& impostorRenderingInfo) {
+        assert(impostorRenderingInfo.pipelineLayout != VK_NULL_HANDLE && "Cannot create graphics pipeline: no pipelineLayout provided in configInfo!");
+        assert(impostorRenderingInfo.renderPass != VK_NULL_HANDLE && "Cannot create graphics pipeline: no renderPass provided in configInfo!");
+
+        std::vector<VkPipelineShaderStageCreateInfo> shaderStages = createShaderStages(vertFilepath, fragfilepath);
+
+        VkPipelineVertexInputStateCreateInfo vertexInputInfo = getImpostorDescriptions();
+
+        createPipeline(getPipeline(PipelineType::IMPOSTOR_PIPELINE), impostorRenderingInfo, shaderStages, vertexInputInfo);
+    }
+
     /// @brief Creates a graphics pipeline for rendering transparent objects.
     /// @param vertFilepath Path to the vertex shader file.
     /// @param fragfilepath Path to the fragment shader file.
@@ -483,7 +820,7 @@ namespace JCAT {
     
         std::vector<VkPipelineShaderStageCreateInfo> shaderStages = createShaderStages(vertFilepath, fragfilepath);
 
-        VkPipelineVertexInputStateCreateInfo vertexInputInfo = getDescriptions2D();
+        VkPipelineVertexInputStateCreateInfo vertexInputInfo = getPositionDescriptions3D();
 
         createPipeline(getPipeline(PipelineType::SHADOW_MAPPING_PIPELINE), solidSpriteRenderingInfo, shaderStages, vertexInputInfo);
     }
@@ -569,8 +906,8 @@ namespace JCAT {
     /// @brief Retrieves the vertex input descriptions for 2D models.
     /// @return The vertex input descriptions.
     VkPipelineVertexInputStateCreateInfo GraphicsPipeline::getDescriptions2D() {
-        std::vector<VkVertexInputBindingDescription> bindingDescriptions = JCATModel2D::Vertex2D::getBindingDescriptions();
-        std::vector<VkVertexInputAttributeDescription> attributeDescriptions = JCATModel2D::Vertex2D::getAttributeDescriptions();
+        bindingDescriptions = JCATModel2D::Vertex2D::getBindingDescriptions();
+        attributeDescriptions = JCATModel2D::Vertex2D::getAttributeDescriptions();
 
         VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
         vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
@@ -583,10 +920,55 @@ namespace JCAT {
     }
 
     /// @brief Retrieves the vertex input descriptions for 3D models.
+    /// @param instanced Whether the per-instance binding should be included.
+    /// @param format Which vertex layout the models drawn with this pipeline were uploaded in.
     /// @return The vertex input descriptions.
-    VkPipelineVertexInputStateCreateInfo GraphicsPipeline::getDescriptions3D() {
-        std::vector<VkVertexInputBindingDescription> bindingDescriptions = JCATModel3D::Vertex3D::getBindingDescriptions();
-        std::vector<VkVertexInputAttributeDescription> attributeDescriptions = JCATModel3D::Vertex3D::getAttributeDescriptions();
+    VkPipelineVertexInputStateCreateInfo GraphicsPipeline::getDescriptions3D(bool instanced, JCATModel3D::VertexFormat format) {
+        if (format == JCATModel3D::VertexFormat::COMPACT) {
+            bindingDescriptions = JCATModel3D::CompactVertex3D::getBindingDescriptions(instanced);
+            attributeDescriptions = JCATModel3D::CompactVertex3D::getAttributeDescriptions(instanced);
+        }
+        else if (format == JCATModel3D::VertexFormat::SPLIT) {
+            bindingDescriptions = JCATModel3D::SplitVertex3D::getBindingDescriptions(instanced);
+            attributeDescriptions = JCATModel3D::SplitVertex3D::getAttributeDescriptions(instanced);
+        }
+        else {
+            bindingDescriptions = JCATModel3D::Vertex3D::getBindingDescriptions(instanced);
+            attributeDescriptions = JCATModel3D::Vertex3D::getAttributeDescriptions(instanced);
+        }
+
+        VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+        vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+        vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
+        vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
+        vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+        vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
+
+        return vertexInputInfo;
+    }
+
+    /// @brief Retrieves the vertex input descriptions for the position stream of SPLIT models.
+    /// @param instanced Whether the per-instance binding should be included.
+    /// @return The vertex input descriptions.
+    VkPipelineVertexInputStateCreateInfo GraphicsPipeline::getPositionDescriptions3D(bool instanced) {
+        bindingDescriptions = JCATModel3D::SplitVertex3D::getPositionBindingDescriptions(instanced);
+        attributeDescriptions = JCATModel3D::SplitVertex3D::getPositionAttributeDescriptions(instanced);
+
+        VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+        vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+        vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
+        vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
+        vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+        vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
+
+        return vertexInputInfo;
+    }
+
+    /// @brief Retrieves the vertex input descriptions for impostor quads.
+    /// @return The vertex input descriptions.
+    VkPipelineVertexInputStateCreateInfo GraphicsPipeline::getImpostorDescriptions() {
+        bindingDescriptions = ImpostorAtlas::Instance::getBindingDescriptions();
+        attributeDescriptions = ImpostorAtlas::Instance::getAttributeDescriptions();
 
         VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
         vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
@@ -609,9 +991,15 @@ namespace JCAT {
         std::cout << "Vertex File Size: " << vertexCode.size() << std::endl;
         std::cout << "Fragment File Size: " << fragmentCode.size() << std::endl;
 
+        VkShaderModule vertShaderModule;
+        VkShaderModule fragShaderModule;
         createShaderModule(vertexCode, &vertShaderModule);
         createShaderModule(fragmentCode, &fragShaderModule);
 
+        // Every pipeline created by this object gets its own modules, keep them all so none are leaked
+        shaderModules.push_back(vertShaderModule);
+        shaderModules.push_back(fragShaderModule);
+
         std::cout << "Created Shader Modules!" << std::endl;
 
         std::vector<VkPipelineShaderStageCreateInfo> shaderStages;
@@ -0,0 +1,135 @@
+#include "./engine/mappedFile.h"
+
+#ifdef _WIN32
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+#include <utility>
+
+namespace JCAT {
+    MappedFile::~MappedFile() {
+        close();
+    }
+
+    MappedFile::MappedFile(MappedFile&& other) noexcept {
+        *this = std::move(other);
+    }
+
+    MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+        if (this != &other) {
+            close();
+
+            mappedData = std::exchange(other.mappedData, nullptr);
+            mappedSize = std::exchange(other.mappedSize, 0);
+#ifdef _WIN32
+            fileHandle = std::exchange(other.fileHandle, nullptr);
+            mappingHandle = std::exchange(other.mappingHandle, nullptr);
+#endif
+        }
+
+        return *this;
+    }
+
+#ifdef _WIN32
+    bool MappedFile::open(const std::string& filepath) {
+        close();
+
+        HANDLE file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+
+        LARGE_INTEGER fileSize{};
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+            CloseHandle(file);
+            return false;
+        }
+
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr) {
+            CloseHandle(file);
+            return false;
+        }
+
+        void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (view == nullptr) {
+            CloseHandle(mapping);
+            CloseHandle(file);
+            return false;
+        }
+
+        fileHandle = file;
+        mappingHandle = mapping;
+        mappedData = view;
+        mappedSize = static_cast<size_t>(fileSize.QuadPart);
+
+        return true;
+    }
+
+    void MappedFile::close() {
+        if (mappedData != nullptr) {
+            UnmapViewOfFile(mappedData);
+        }
+        if (mappingHandle != nullptr) {
+            CloseHandle(static_cast<HANDLE>(mappingHandle));
+        }
+        if (fileHandle != nullptr) {
+            CloseHandle(static_cast<HANDLE>(fileHandle));
+        }
+
+        mappedData = nullptr;
+        mappedSize = 0;
+        mappingHandle = nullptr;
+        fileHandle = nullptr;
+    }
+#else
+    bool MappedFile::open(const std::string& filepath) {
+        close();
+
+        int file = ::open(filepath.c_str(), O_RDONLY);
+        if (file < 0) {
+            return false;
+        }
+
+        struct stat fileInfo{};
+        if (fstat(file, &fileInfo) != 0 || fileInfo.st_size == 0) {
+            ::close(file);
+            return false;
+        }
+
+        void* view = mmap(nullptr, static_cast<size_t>(fileInfo.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+
+        // The mapping keeps its own reference to the file, so the descriptor is not needed past this point
+        ::close(file);
+
+        if (view == MAP_FAILED) {
+            return false;
+        }
+
+        mappedData = view;
+        mappedSize = static_cast<size_t>(fileInfo.st_size);
+
+        return true;
+    }
+
+    void MappedFile::close() {
+        if (mappedData != nullptr) {
+            munmap(mappedData, mappedSize);
+        }
+
+        mappedData = nullptr;
+        mappedSize = 0;
+    }
+#endif
+};
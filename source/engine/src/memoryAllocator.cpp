@@ -0,0 +1,366 @@
+#include "./engine/memoryAllocator.h"
+
+#include <stdexcept>
+
+namespace JCAT {
+    struct MemoryBlock {
+        VkDeviceMemory memory;
+        char* mapped;
+        std::unique_ptr<Suballocator> suballocator;
+        uint32_t pool;
+    };
+
+    namespace {
+        VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+
+        VkDeviceSize roundDownToPowerOfTwo(VkDeviceSize value) {
+            VkDeviceSize result = 1;
+            while (result <= value / 2) {
+                result <<= 1;
+            }
+
+            return result;
+        }
+    }
+
+    MemoryAllocator::MemoryAllocator(DeviceSetup& device, AllocationStrategy strategy, VkDeviceSize blockSize) : device{device}, strategy{strategy} {
+        vkGetPhysicalDeviceMemoryProperties(device.getPhysicalDevice(), &memoryProperties);
+        bufferImageGranularity = device.properties.limits.bufferImageGranularity;
+        nonCoherentAtomSize = device.properties.limits.nonCoherentAtomSize > 0 ? device.properties.limits.nonCoherentAtomSize : 1;
+
+        pools.resize(memoryProperties.memoryTypeCount * 2);
+        for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+            // Small heaps, e.g. the 256 MiB of device local memory the host can see on most desktop GPUs, get smaller blocks
+            const VkDeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[i].heapIndex].size;
+            VkDeviceSize poolBlockSize = blockSize < heapSize / 8 ? blockSize : heapSize / 8;
+            poolBlockSize = roundDownToPowerOfTwo(poolBlockSize > BuddySuballocator::MIN_SIZE ? poolBlockSize : BuddySuballocator::MIN_SIZE);
+
+            pools[i * 2].memoryType = i;
+            pools[i * 2].blockSize = poolBlockSize;
+            pools[i * 2 + 1].memoryType = i;
+            pools[i * 2 + 1].blockSize = poolBlockSize;
+        }
+
+        dedicatedCounts.resize(memoryProperties.memoryTypeCount, 0);
+        dedicatedBytes.resize(memoryProperties.memoryTypeCount, 0);
+    }
+
+    MemoryAllocator::~MemoryAllocator() {
+        for (Pool& pool : pools) {
+            for (std::unique_ptr<MemoryBlock>& block : pool.blocks) {
+                freeDeviceMemory(block->memory, block->mapped);
+            }
+        }
+    }
+
+    VkDeviceMemory MemoryAllocator::allocateDeviceMemory(VkDeviceSize size, uint32_t memoryType, void*& mapped) {
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = size;
+        allocInfo.memoryTypeIndex = memoryType;
+
+        VkDeviceMemory memory;
+        if (vkAllocateMemory(device.device(), &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+            return VK_NULL_HANDLE;
+        }
+
+        mapped = nullptr;
+        if (memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+            if (vkMapMemory(device.device(), memory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS) {
+                vkFreeMemory(device.device(), memory, nullptr);
+                return VK_NULL_HANDLE;
+            }
+        }
+
+        deviceMemoryCount++;
+        return memory;
+    }
+
+    void MemoryAllocator::freeDeviceMemory(VkDeviceMemory memory, void* mapped) {
+        if (mapped != nullptr) {
+            vkUnmapMemory(device.device(), memory);
+        }
+
+        vkFreeMemory(device.device(), memory, nullptr);
+        deviceMemoryCount--;
+    }
+
+    void MemoryAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool linear, MemoryAllocation& allocation) {
+        const uint32_t memoryType = device.findMemoryType(requirements.memoryTypeBits, properties);
+
+        // Flushes and invalidates work on whole atoms, neighbours sharing one would have their writes flushed or thrown away
+        VkDeviceSize size = requirements.size;
+        VkDeviceSize alignment = requirements.alignment;
+        if (!isCoherent(memoryType)) {
+            size = alignUp(size, nonCoherentAtomSize);
+            alignment = alignment > nonCoherentAtomSize ? alignment : nonCoherentAtomSize;
+        }
+
+        const uint32_t poolIndex = memoryType * 2 + (!linear && bufferImageGranularity > 1 ? 1 : 0);
+        Pool& pool = pools[poolIndex];
+
+        if (size <= pool.blockSize / 2) {
+            VkDeviceSize offset;
+            uint64_t handle;
+            MemoryBlock* found = nullptr;
+
+            for (std::unique_ptr<MemoryBlock>& block : pool.blocks) {
+                if (block->suballocator->allocate(size, alignment, offset, handle)) {
+                    found = block.get();
+                    break;
+                }
+            }
+
+            if (found == nullptr) {
+                void* mapped;
+                VkDeviceMemory memory = allocateDeviceMemory(pool.blockSize, memoryType, mapped);
+
+                // Out of memory for a whole block, a dedicated allocation of just this size may still fit
+                if (memory != VK_NULL_HANDLE) {
+                    std::unique_ptr<MemoryBlock> block = std::make_unique<MemoryBlock>();
+                    block->memory = memory;
+                    block->mapped = static_cast<char*>(mapped);
+                    block->suballocator = Suballocator::create(strategy, pool.blockSize);
+                    block->pool = poolIndex;
+
+                    if (block->suballocator->allocate(size, alignment, offset, handle)) {
+                        found = block.get();
+                    }
+                    pool.blocks.push_back(std::move(block));
+                }
+            }
+
+            if (found != nullptr) {
+                allocation.memory = found->memory;
+                allocation.offset = offset;
+                allocation.size = size;
+                allocation.memoryType = memoryType;
+                allocation.mapped = found->mapped != nullptr ? found->mapped + offset : nullptr;
+                allocation.block = found;
+                allocation.handle = handle;
+                return;
+            }
+        }
+
+        void* mapped;
+        VkDeviceMemory memory = allocateDeviceMemory(size, memoryType, mapped);
+        if (memory == VK_NULL_HANDLE) {
+            throw std::runtime_error("Failed to allocate device memory!");
+        }
+
+        dedicatedCounts[memoryType]++;
+        dedicatedBytes[memoryType] += size;
+
+        allocation.memory = memory;
+        allocation.offset = 0;
+        allocation.size = size;
+        allocation.memoryType = memoryType;
+        allocation.mapped = mapped;
+        allocation.block = nullptr;
+        allocation.handle = 0;
+    }
+
+    void MemoryAllocator::free(MemoryAllocation& allocation) {
+        if (allocation.memory == VK_NULL_HANDLE) {
+            return;
+        }
+
+        if (allocation.block == nullptr) {
+            dedicatedCounts[allocation.memoryType]--;
+            dedicatedBytes[allocation.memoryType] -= allocation.size;
+            freeDeviceMemory(allocation.memory, allocation.mapped);
+        }
+        else {
+            MemoryBlock* block = allocation.block;
+            block->suballocator->free(allocation.handle);
+
+            // One empty block stays around so a model loaded right after another is unloaded doesn't reallocate it
+            if (block->suballocator->getAllocationCount() == 0) {
+                std::vector<std::unique_ptr<MemoryBlock> >& blocks = pools[block->pool].blocks;
+                uint32_t emptyBlocks = 0;
+                for (std::unique_ptr<MemoryBlock>& other : blocks) {
+                    emptyBlocks += other->suballocator->getAllocationCount() == 0 ? 1 : 0;
+                }
+
+                if (emptyBlocks > 1) {
+                    for (size_t i = 0; i < blocks.size(); i++) {
+                        if (blocks[i].get() == block) {
+                            freeDeviceMemory(block->memory, block->mapped);
+                            blocks.erase(blocks.begin() + i);
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+
+        allocation = MemoryAllocation{};
+    }
+
+    std::vector<MemoryBlockInfo> MemoryAllocator::getBlocks() const {
+        std::vector<MemoryBlockInfo> blocks;
+
+        for (const Pool& pool : pools) {
+            VkDeviceSize poolBytesFree = 0;
+            for (const std::unique_ptr<MemoryBlock>& block : pool.blocks) {
+                poolBytesFree += block->suballocator->getCapacity() - block->suballocator->getBytesUsed();
+            }
+
+            for (const std::unique_ptr<MemoryBlock>& block : pool.blocks) {
+                MemoryBlockInfo info{};
+                info.block = block.get();
+                info.memoryType = pool.memoryType;
+                info.capacity = block->suballocator->getCapacity();
+                info.bytesUsed = block->suballocator->getBytesUsed();
+                info.allocationCount = block->suballocator->getAllocationCount();
+                info.bytesFreeElsewhere = poolBytesFree - (info.capacity - info.bytesUsed);
+                blocks.push_back(info);
+            }
+        }
+
+        return blocks;
+    }
+
+    bool MemoryAllocator::allocateElsewhere(const VkMemoryRequirements& requirements, const MemoryAllocation& current, MemoryAllocation& allocation) {
+        if (current.block == nullptr) {
+            return false;
+        }
+
+        // Same size and alignment rules as allocate(), the memory type has to match the resource's as well
+        VkDeviceSize size = requirements.size;
+        VkDeviceSize alignment = requirements.alignment;
+        if (!isCoherent(current.memoryType)) {
+            size = alignUp(size, nonCoherentAtomSize);
+            alignment = alignment > nonCoherentAtomSize ? alignment : nonCoherentAtomSize;
+        }
+
+        Pool& pool = pools[current.block->pool];
+        for (std::unique_ptr<MemoryBlock>& block : pool.blocks) {
+            VkDeviceSize offset;
+            uint64_t handle;
+            if (block.get() == current.block || !block->suballocator->allocate(size, alignment, offset, handle)) {
+                continue;
+            }
+
+            allocation.memory = block->memory;
+            allocation.offset = offset;
+            allocation.size = size;
+            allocation.memoryType = current.memoryType;
+            allocation.mapped = block->mapped != nullptr ? block->mapped + offset : nullptr;
+            allocation.block = block.get();
+            allocation.handle = handle;
+            return true;
+        }
+
+        return false;
+    }
+
+    VkDeviceSize MemoryAllocator::releaseEmptyBlocks() {
+        VkDeviceSize released = 0;
+
+        for (Pool& pool : pools) {
+            size_t kept = 0;
+            for (size_t i = 0; i < pool.blocks.size(); i++) {
+                if (pool.blocks[i]->suballocator->getAllocationCount() == 0) {
+                    released += pool.blocks[i]->suballocator->getCapacity();
+                    freeDeviceMemory(pool.blocks[i]->memory, pool.blocks[i]->mapped);
+                    continue;
+                }
+
+                if (kept != i) {
+                    pool.blocks[kept] = std::move(pool.blocks[i]);
+                }
+                kept++;
+            }
+            pool.blocks.resize(kept);
+        }
+
+        return released;
+    }
+
+    bool MemoryAllocator::isCoherent(uint32_t memoryType) const {
+        const VkMemoryPropertyFlags flags = memoryProperties.memoryTypes[memoryType].propertyFlags;
+        return !(flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) || (flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    }
+
+    VkMappedMemoryRange MemoryAllocator::getMappedRange(const MemoryAllocation& allocation, VkDeviceSize offset, VkDeviceSize size) const {
+        // allocate() aligned non-coherent allocations to whole atoms, so widening the range stays inside the allocation
+        const VkDeviceSize begin = (allocation.offset + offset) / nonCoherentAtomSize * nonCoherentAtomSize;
+        VkDeviceSize end = allocation.offset + allocation.size;
+        if (size != VK_WHOLE_SIZE && allocation.offset + offset + size < end) {
+            end = alignUp(allocation.offset + offset + size, nonCoherentAtomSize);
+        }
+
+        VkMappedMemoryRange mappedRange{};
+        mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        mappedRange.memory = allocation.memory;
+        mappedRange.offset = begin;
+        mappedRange.size = end - begin;
+        return mappedRange;
+    }
+
+    VkResult MemoryAllocator::flush(const MemoryAllocation& allocation, VkDeviceSize offset, VkDeviceSize size) {
+        if (isCoherent(allocation.memoryType)) {
+            return VK_SUCCESS;
+        }
+
+        VkMappedMemoryRange mappedRange = getMappedRange(allocation, offset, size);
+        return vkFlushMappedMemoryRanges(device.device(), 1, &mappedRange);
+    }
+
+    VkResult MemoryAllocator::invalidate(const MemoryAllocation& allocation, VkDeviceSize offset, VkDeviceSize size) {
+        if (isCoherent(allocation.memoryType)) {
+            return VK_SUCCESS;
+        }
+
+        VkMappedMemoryRange mappedRange = getMappedRange(allocation, offset, size);
+        return vkInvalidateMappedMemoryRanges(device.device(), 1, &mappedRange);
+    }
+
+    MemoryStats MemoryAllocator::getStats() const {
+        MemoryStats stats{};
+        stats.deviceMemoryCount = deviceMemoryCount;
+
+        for (uint32_t type = 0; type < memoryProperties.memoryTypeCount; type++) {
+            MemoryTypeStats typeStats{};
+            typeStats.memoryType = type;
+            typeStats.propertyFlags = memoryProperties.memoryTypes[type].propertyFlags;
+            typeStats.dedicatedCount = dedicatedCounts[type];
+            typeStats.bytesReserved = dedicatedBytes[type];
+            typeStats.bytesUsed = dedicatedBytes[type];
+            typeStats.allocationCount = dedicatedCounts[type];
+
+            // Free space split across blocks is not fragmentation, only free space split within a block is
+            VkDeviceSize bytesFree = 0;
+            VkDeviceSize largestRangesFree = 0;
+            for (uint32_t i = type * 2; i < type * 2 + 2; i++) {
+                for (const std::unique_ptr<MemoryBlock>& block : pools[i].blocks) {
+                    const Suballocator& suballocator = *block->suballocator;
+                    const VkDeviceSize largest = suballocator.getLargestFreeRange();
+
+                    typeStats.blockCount++;
+                    typeStats.bytesReserved += suballocator.getCapacity();
+                    typeStats.bytesUsed += suballocator.getBytesUsed();
+                    typeStats.allocationCount += suballocator.getAllocationCount();
+                    typeStats.largestFreeRange = largest > typeStats.largestFreeRange ? largest : typeStats.largestFreeRange;
+                    bytesFree += suballocator.getCapacity() - suballocator.getBytesUsed();
+                    largestRangesFree += largest;
+                }
+            }
+
+            if (typeStats.bytesReserved == 0) {
+                continue;
+            }
+
+            typeStats.fragmentation = bytesFree > 0 ? 1.0f - static_cast<float>(largestRangesFree) / static_cast<float>(bytesFree) : 0.0f;
+
+            stats.bytesReserved += typeStats.bytesReserved;
+            stats.bytesUsed += typeStats.bytesUsed;
+            stats.types.push_back(typeStats);
+        }
+
+        return stats;
+    }
+};
\ No newline at end of file
@@ -0,0 +1,327 @@
+#include "./engine/memorySuballocator.h"
+
+#include <cassert>
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+namespace JCAT {
+    namespace {
+        uint32_t findLastSet(uint64_t value) {
+            #if defined(_MSC_VER)
+                unsigned long index;
+                _BitScanReverse64(&index, value);
+                return static_cast<uint32_t>(index);
+            #else
+                return 63 - static_cast<uint32_t>(__builtin_clzll(value));
+            #endif
+        }
+
+        uint32_t findFirstSet(uint64_t value) {
+            #if defined(_MSC_VER)
+                unsigned long index;
+                _BitScanForward64(&index, value);
+                return static_cast<uint32_t>(index);
+            #else
+                return static_cast<uint32_t>(__builtin_ctzll(value));
+            #endif
+        }
+
+        VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+    }
+
+    std::unique_ptr<Suballocator> Suballocator::create(AllocationStrategy strategy, VkDeviceSize capacity) {
+        if (strategy == AllocationStrategy::BUDDY) {
+            return std::make_unique<BuddySuballocator>(capacity);
+        }
+
+        return std::make_unique<TlsfSuballocator>(capacity);
+    }
+
+    TlsfSuballocator::TlsfSuballocator(VkDeviceSize capacity) : Suballocator{capacity} {
+        freeLists.fill(NONE);
+
+        if (capacity > 0) {
+            insertFree(createRange(0, capacity));
+        }
+    }
+
+    void TlsfSuballocator::mapping(VkDeviceSize size, uint32_t& firstLevel, uint32_t& secondLevel) {
+        if (size < SMALL_SIZE) {
+            firstLevel = 0;
+            secondLevel = static_cast<uint32_t>(size / (SMALL_SIZE / SL_COUNT));
+            return;
+        }
+
+        const uint32_t log2 = findLastSet(size);
+        firstLevel = log2 - SMALL_LOG2 + 1;
+        secondLevel = static_cast<uint32_t>(size >> (log2 - SL_LOG2)) - SL_COUNT;
+    }
+
+    uint32_t TlsfSuballocator::createRange(VkDeviceSize offset, VkDeviceSize size) {
+        Range range{};
+        range.offset = offset;
+        range.size = size;
+
+        if (!unusedRanges.empty()) {
+            const uint32_t index = unusedRanges.back();
+            unusedRanges.pop_back();
+            ranges[index] = range;
+            return index;
+        }
+
+        ranges.push_back(range);
+        return static_cast<uint32_t>(ranges.size() - 1);
+    }
+
+    void TlsfSuballocator::insertFree(uint32_t index) {
+        uint32_t firstLevel, secondLevel;
+        mapping(ranges[index].size, firstLevel, secondLevel);
+        uint32_t& head = freeLists[firstLevel * SL_COUNT + secondLevel];
+
+        Range& range = ranges[index];
+        range.free = true;
+        range.previousFree = NONE;
+        range.nextFree = head;
+        if (head != NONE) {
+            ranges[head].previousFree = index;
+        }
+        head = index;
+
+        firstLevelBitmap |= 1ull << firstLevel;
+        secondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+    }
+
+    void TlsfSuballocator::removeFree(uint32_t index) {
+        uint32_t firstLevel, secondLevel;
+        mapping(ranges[index].size, firstLevel, secondLevel);
+
+        Range& range = ranges[index];
+        if (range.previousFree != NONE) {
+            ranges[range.previousFree].nextFree = range.nextFree;
+        }
+        else {
+            freeLists[firstLevel * SL_COUNT + secondLevel] = range.nextFree;
+        }
+        if (range.nextFree != NONE) {
+            ranges[range.nextFree].previousFree = range.previousFree;
+        }
+        range.free = false;
+
+        if (freeLists[firstLevel * SL_COUNT + secondLevel] == NONE) {
+            secondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+            if (secondLevelBitmaps[firstLevel] == 0) {
+                firstLevelBitmap &= ~(1ull << firstLevel);
+            }
+        }
+    }
+
+    bool TlsfSuballocator::allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset, uint64_t& handle) {
+        alignment = alignment > 0 ? alignment : 1;
+        if (size == 0 || size > capacity || alignment - 1 > capacity - size) {
+            return false;
+        }
+
+        // Room for the worst case padding, rounded up to the next class so every range listed there or above is large enough
+        VkDeviceSize searchSize = size + alignment - 1;
+        if (searchSize >= SMALL_SIZE) {
+            searchSize += (1ull << (findLastSet(searchSize) - SL_LOG2)) - 1;
+        }
+        else {
+            searchSize += SMALL_SIZE / SL_COUNT - 1;
+        }
+
+        uint32_t firstLevel, secondLevel;
+        mapping(searchSize, firstLevel, secondLevel);
+        if (firstLevel >= FL_COUNT) {
+            return false;
+        }
+
+        uint32_t secondLevelMap = secondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+        if (secondLevelMap == 0) {
+            const uint64_t firstLevelMap = firstLevel + 1 < 64 ? firstLevelBitmap & (~0ull << (firstLevel + 1)) : 0;
+            if (firstLevelMap == 0) {
+                return false;
+            }
+
+            firstLevel = findFirstSet(firstLevelMap);
+            secondLevelMap = secondLevelBitmaps[firstLevel];
+        }
+        secondLevel = findFirstSet(secondLevelMap);
+
+        const uint32_t index = freeLists[firstLevel * SL_COUNT + secondLevel];
+        removeFree(index);
+
+        // Alignment padding in front and whatever is left behind become free ranges of their own. Neither can have a
+        // free neighbour to merge with, the range they came from was free and free ranges never touch.
+        const VkDeviceSize alignedOffset = alignUp(ranges[index].offset, alignment);
+        const VkDeviceSize padding = alignedOffset - ranges[index].offset;
+        if (padding > 0) {
+            const uint32_t front = createRange(ranges[index].offset, padding);
+            ranges[front].previousPhysical = ranges[index].previousPhysical;
+            ranges[front].nextPhysical = index;
+            if (ranges[front].previousPhysical != NONE) {
+                ranges[ranges[front].previousPhysical].nextPhysical = front;
+            }
+            ranges[index].previousPhysical = front;
+            ranges[index].offset = alignedOffset;
+            ranges[index].size -= padding;
+            insertFree(front);
+        }
+
+        if (ranges[index].size > size) {
+            const uint32_t back = createRange(alignedOffset + size, ranges[index].size - size);
+            ranges[back].previousPhysical = index;
+            ranges[back].nextPhysical = ranges[index].nextPhysical;
+            if (ranges[back].nextPhysical != NONE) {
+                ranges[ranges[back].nextPhysical].previousPhysical = back;
+            }
+            ranges[index].nextPhysical = back;
+            ranges[index].size = size;
+            insertFree(back);
+        }
+
+        offset = alignedOffset;
+        handle = index;
+        bytesUsed += size;
+        allocationCount++;
+        return true;
+    }
+
+    void TlsfSuballocator::free(uint64_t handle) {
+        uint32_t index = static_cast<uint32_t>(handle);
+        assert(index < ranges.size() && !ranges[index].free && "Freed a memory range twice");
+
+        bytesUsed -= ranges[index].size;
+        allocationCount--;
+
+        const uint32_t previous = ranges[index].previousPhysical;
+        if (previous != NONE && ranges[previous].free) {
+            removeFree(previous);
+            ranges[previous].size += ranges[index].size;
+            ranges[previous].nextPhysical = ranges[index].nextPhysical;
+            if (ranges[index].nextPhysical != NONE) {
+                ranges[ranges[index].nextPhysical].previousPhysical = previous;
+            }
+            unusedRanges.push_back(index);
+            index = previous;
+        }
+
+        const uint32_t next = ranges[index].nextPhysical;
+        if (next != NONE && ranges[next].free) {
+            removeFree(next);
+            ranges[index].size += ranges[next].size;
+            ranges[index].nextPhysical = ranges[next].nextPhysical;
+            if (ranges[next].nextPhysical != NONE) {
+                ranges[ranges[next].nextPhysical].previousPhysical = index;
+            }
+            unusedRanges.push_back(next);
+        }
+
+        insertFree(index);
+    }
+
+    VkDeviceSize TlsfSuballocator::getLargestFreeRange() const {
+        if (firstLevelBitmap == 0) {
+            return 0;
+        }
+
+        // Only the highest non-empty class can hold the largest range, its members still differ in size though
+        const uint32_t firstLevel = findLastSet(firstLevelBitmap);
+        const uint32_t secondLevel = findLastSet(secondLevelBitmaps[firstLevel]);
+
+        VkDeviceSize largest = 0;
+        for (uint32_t index = freeLists[firstLevel * SL_COUNT + secondLevel]; index != NONE; index = ranges[index].nextFree) {
+            largest = ranges[index].size > largest ? ranges[index].size : largest;
+        }
+
+        return largest;
+    }
+
+    BuddySuballocator::BuddySuballocator(VkDeviceSize capacity) : Suballocator{capacity} {
+        assert(capacity >= MIN_SIZE && (capacity & (capacity - 1)) == 0 && "Buddy allocator capacity has to be a power of two");
+
+        maxOrder = findLastSet(capacity / MIN_SIZE);
+        freeRanges.resize(maxOrder + 1);
+        freeRanges[maxOrder].insert(0);
+    }
+
+    bool BuddySuballocator::allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset, uint64_t& handle) {
+        if (size == 0 || size > capacity || alignment > capacity) {
+            return false;
+        }
+
+        // Ranges are aligned to their own size, so a range at least as large as the alignment is aligned too
+        VkDeviceSize rangeSize = size > alignment ? size : alignment;
+        rangeSize = rangeSize > MIN_SIZE ? rangeSize : MIN_SIZE;
+        uint32_t order = findLastSet(rangeSize / MIN_SIZE);
+        if ((MIN_SIZE << order) < rangeSize) {
+            order++;
+        }
+        if (order > maxOrder) {
+            return false;
+        }
+
+        uint32_t freeOrder = order;
+        while (freeOrder <= maxOrder && freeRanges[freeOrder].empty()) {
+            freeOrder++;
+        }
+        if (freeOrder > maxOrder) {
+            return false;
+        }
+
+        const VkDeviceSize rangeOffset = *freeRanges[freeOrder].begin();
+        freeRanges[freeOrder].erase(freeRanges[freeOrder].begin());
+
+        // Keep the front half at every split, the back halves stay free
+        while (freeOrder > order) {
+            freeOrder--;
+            freeRanges[freeOrder].insert(rangeOffset + (MIN_SIZE << freeOrder));
+        }
+
+        usedOrders[rangeOffset] = order;
+        offset = rangeOffset;
+        handle = rangeOffset;
+        bytesUsed += MIN_SIZE << order;
+        allocationCount++;
+        return true;
+    }
+
+    void BuddySuballocator::free(uint64_t handle) {
+        VkDeviceSize rangeOffset = handle;
+        std::unordered_map<VkDeviceSize, uint32_t>::iterator used = usedOrders.find(rangeOffset);
+        assert(used != usedOrders.end() && "Freed a memory range twice");
+
+        uint32_t order = used->second;
+        usedOrders.erase(used);
+        bytesUsed -= MIN_SIZE << order;
+        allocationCount--;
+
+        while (order < maxOrder) {
+            const VkDeviceSize buddy = rangeOffset ^ (MIN_SIZE << order);
+            std::set<VkDeviceSize>::iterator freeBuddy = freeRanges[order].find(buddy);
+            if (freeBuddy == freeRanges[order].end()) {
+                break;
+            }
+
+            freeRanges[order].erase(freeBuddy);
+            rangeOffset = rangeOffset < buddy ? rangeOffset : buddy;
+            order++;
+        }
+
+        freeRanges[order].insert(rangeOffset);
+    }
+
+    VkDeviceSize BuddySuballocator::getLargestFreeRange() const {
+        for (uint32_t order = maxOrder + 1; order > 0; order--) {
+            if (!freeRanges[order - 1].empty()) {
+                return MIN_SIZE << (order - 1);
+            }
+        }
+
+        return 0;
+    }
+};
\ No newline at end of file
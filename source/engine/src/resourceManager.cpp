@@ -1,11 +1,23 @@
 #include <iostream>
 
 #include "./engine/resourceManager.h"
+#include "./engine/geometryPool.h"
+#include "./engine/stagingRing.h"
+#include "./engine/uploadBatch.h"
 
 namespace JCAT {
     /// @brief Constructs a ResourceManager object.
     /// @param device Reference to the device setup.
-    ResourceManager::ResourceManager(DeviceSetup& device) : device_{ device } {}
+    /// @param stagingRingSize The size of the staging ring, allocated on the first upload.
+    /// @param allocationStrategy The strategy the memory allocator sub-allocates its blocks with.
+    ResourceManager::ResourceManager(DeviceSetup& device, VkDeviceSize stagingRingSize, AllocationStrategy allocationStrategy)
+        : device_{ device }, allocationStrategy{ allocationStrategy }, stagingRingSize{ stagingRingSize } {}
+
+    /// @brief Submits anything still recorded for upload and waits for every upload to finish.
+    ResourceManager::~ResourceManager() {
+        uploadBatch.reset();
+        waitForUploads();
+    }
 
     /// @brief Reads a file and returns its contents as a vector of characters.
     /// @param filepath The path to the file.
@@ -33,37 +45,71 @@ namespace JCAT {
     /// @param usage The usage of the buffer.
     /// @param properties The memory properties of the buffer.
     /// @param buffer The buffer to create.
-    /// @param bufferMemory The buffer memory to create.
+    /// @param bufferMemory The memory allocation the buffer is bound to.
     /// @throws std::runtime_error if the buffer fails to create.
     /// @throws std::runtime_error if the buffer memory fails to allocate.
     void ResourceManager::createBuffer(VkDeviceSize size,
                                         VkBufferUsageFlags usage,
                                         VkMemoryPropertyFlags properties,
                                         VkBuffer& buffer,
-                                        VkDeviceMemory& bufferMemory) {
+                                        MemoryAllocation& bufferMemory) {
+        createBufferHandle(size, usage, buffer);
+
+        VkMemoryRequirements bufferMemRequirements;
+        vkGetBufferMemoryRequirements(device_.device(), buffer, &bufferMemRequirements);
+
+        try {
+            getMemoryAllocator().allocate(bufferMemRequirements, properties, true, bufferMemory);
+        }
+        catch (...) {
+            vkDestroyBuffer(device_.device(), buffer, nullptr);
+            buffer = VK_NULL_HANDLE;
+            throw;
+        }
+
+        vkBindBufferMemory(device_.device(), buffer, bufferMemory.memory, bufferMemory.offset);
+    }
+
+    /// @brief Creates a Vulkan buffer without binding memory to it.
+    /// @param size The size of the buffer.
+    /// @param usage The usage of the buffer.
+    /// @param buffer The buffer to create.
+    /// @throws std::runtime_error if the buffer fails to create.
+    void ResourceManager::createBufferHandle(VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& buffer) {
         VkBufferCreateInfo bufferInfo{};
         bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
         bufferInfo.size = size;
         bufferInfo.usage = usage;
         bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
+        // Buffers are only ever partially overwritten by uploads, an exclusive one would need its whole contents
+        // handed back and forth between the queue families for every copy
+        uint32_t queueFamilies[] = { device_.graphicsQueueFamily(), device_.transferQueueFamily() };
+        if (usage & VK_BUFFER_USAGE_TRANSFER_DST_BIT && device_.hasDedicatedTransferQueue()) {
+            bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+            bufferInfo.queueFamilyIndexCount = 2;
+            bufferInfo.pQueueFamilyIndices = queueFamilies;
+        }
+
         if (vkCreateBuffer(device_.device(), &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
             throw std::runtime_error("Failed to create vertex buffer!");
         }
+    }
 
-        VkMemoryRequirements bufferMemRequirements;
-        vkGetBufferMemoryRequirements(device_.device(), buffer, &bufferMemRequirements);
+    /// @brief Destroys a buffer and frees its memory.
+    /// @param buffer The buffer to destroy, reset to VK_NULL_HANDLE.
+    /// @param bufferMemory The memory the buffer is bound to, reset to an empty allocation.
+    void ResourceManager::destroyBuffer(VkBuffer& buffer, MemoryAllocation& bufferMemory) {
+        if (defragmenter != nullptr) {
+            defragmenter->remove(bufferMemory);
+        }
 
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = bufferMemRequirements.size;
-        allocInfo.memoryTypeIndex = device_.findMemoryType(bufferMemRequirements.memoryTypeBits, properties);
+        vkDestroyBuffer(device_.device(), buffer, nullptr);
+        buffer = VK_NULL_HANDLE;
 
-        if (vkAllocateMemory(device_.device(), &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to allocate vertex buffer memory!");
+        if (memoryAllocator != nullptr) {
+            memoryAllocator->free(bufferMemory);
         }
-
-        vkBindBufferMemory(device_.device(), buffer, bufferMemory, 0);
     }
 
     /// @brief Creates a Vulkan image.
@@ -87,7 +133,7 @@ namespace JCAT {
         return commandBuffer;
     }
 
-    /// @brief Ends recording a single time command.
+    /// @brief Ends recording a single time command, submits it and waits for it to finish.
     /// @param commandBuffer The command buffer to end.
     void ResourceManager::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
         vkEndCommandBuffer(commandBuffer);
@@ -97,9 +143,20 @@ namespace JCAT {
         submitInfo.commandBufferCount = 1;
         submitInfo.pCommandBuffers = &commandBuffer;
 
-        vkQueueSubmit(device_.graphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE);
-        vkQueueWaitIdle(device_.graphicsQueue());
+        // Waiting on a fence only waits for this submission, not for frames in flight on the same queue
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+        VkFence fence;
+        if (vkCreateFence(device_.device(), &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create upload fence!");
+        }
+
+        vkQueueSubmit(device_.graphicsQueue(), 1, &submitInfo, fence);
+        vkWaitForFences(device_.device(), 1, &fence, VK_TRUE, UINT64_MAX);
+        uploadStats.submissions++;
 
+        vkDestroyFence(device_.device(), fence, nullptr);
         vkFreeCommandBuffers(device_.device(), device_.getCommandPool(), 1, &commandBuffer);
     }
 
@@ -107,15 +164,18 @@ namespace JCAT {
     /// @param srcBuffer The source buffer.
     /// @param dstBuffer The destination buffer.
     /// @param size The size of the buffer.
-    void ResourceManager::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
+    /// @param srcOffset The byte offset into the source buffer.
+    /// @param dstOffset The byte offset into the destination buffer.
+    void ResourceManager::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize srcOffset, VkDeviceSize dstOffset) {
         VkCommandBuffer commandBuffer = beginSingleTimeCommands();
 
         VkBufferCopy copyRegion = {};
-        copyRegion.srcOffset = 0;
-        copyRegion.dstOffset = 0;
+        copyRegion.srcOffset = srcOffset;
+        copyRegion.dstOffset = dstOffset;
         copyRegion.size = size;
 
         vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
+        uploadStats.bytesUploaded += size;
 
         endSingleTimeCommands(commandBuffer);
     }
@@ -151,13 +211,13 @@ namespace JCAT {
     /// @param imageInfo The information to create the image.
     /// @param properties The memory properties of the image.
     /// @param image The image to create.
-    /// @param imageMemory The image memory to create.
+    /// @param imageMemory The memory allocation the image is bound to.
     /// @throws std::runtime_error if the image fails to create.
     /// @throws std::runtime_error if the image memory fails to allocate.
     void ResourceManager::createImageWithInfo(const VkImageCreateInfo& imageInfo,
                                                 VkMemoryPropertyFlags properties,
                                                 VkImage& image,
-                                                VkDeviceMemory& imageMemory) {
+                                                MemoryAllocation& imageMemory) {
         if (vkCreateImage(device_.device(), &imageInfo, nullptr, &image) != VK_SUCCESS) {
             throw std::runtime_error("Failed to create image!");
         }
@@ -165,15 +225,253 @@ namespace JCAT {
         VkMemoryRequirements imageMemRequirements;
         vkGetImageMemoryRequirements(device_.device(), image, &imageMemRequirements);
 
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = imageMemRequirements.size;
-        allocInfo.memoryTypeIndex = device_.findMemoryType(imageMemRequirements.memoryTypeBits, properties);
+        try {
+            getMemoryAllocator().allocate(imageMemRequirements, properties, imageInfo.tiling == VK_IMAGE_TILING_LINEAR, imageMemory);
+        }
+        catch (...) {
+            vkDestroyImage(device_.device(), image, nullptr);
+            image = VK_NULL_HANDLE;
+            throw;
+        }
+
+        vkBindImageMemory(device_.device(), image, imageMemory.memory, imageMemory.offset);
+    }
+
+    /// @brief Destroys an image and frees its memory.
+    /// @param image The image to destroy, reset to VK_NULL_HANDLE.
+    /// @param imageMemory The memory the image is bound to, reset to an empty allocation.
+    void ResourceManager::destroyImage(VkImage& image, MemoryAllocation& imageMemory) {
+        if (defragmenter != nullptr) {
+            defragmenter->remove(imageMemory);
+        }
+
+        vkDestroyImage(device_.device(), image, nullptr);
+        image = VK_NULL_HANDLE;
+
+        if (memoryAllocator != nullptr) {
+            memoryAllocator->free(imageMemory);
+        }
+    }
+
+    /// @brief Returns the memory allocator, creating it on first use.
+    /// @return The allocator every buffer and image is bound to memory from.
+    MemoryAllocator& ResourceManager::getMemoryAllocator() {
+        if (memoryAllocator == nullptr) {
+            memoryAllocator = std::make_unique<MemoryAllocator>(device_, allocationStrategy);
+        }
+
+        return *memoryAllocator;
+    }
+
+    /// @brief Returns statistics about the device memory in use.
+    /// @return Empty statistics if nothing was allocated yet.
+    MemoryStats ResourceManager::getMemoryStats() const {
+        return memoryAllocator != nullptr ? memoryAllocator->getStats() : MemoryStats{};
+    }
+
+    /// @brief Registers a buffer the defragmenter may move.
+    /// @param buffer The buffer, replaced by the new one when it moves.
+    /// @param bufferMemory The buffer's memory, replaced along with it.
+    /// @param size The size the buffer was created with.
+    /// @param usage The usage the buffer was created with.
+    /// @param onMoved Called after each move.
+    void ResourceManager::makeMovable(VkBuffer& buffer, MemoryAllocation& bufferMemory, VkDeviceSize size, VkBufferUsageFlags usage, std::function<void()> onMoved) {
+        getDefragmenter().addBuffer(buffer, bufferMemory, size, usage, std::move(onMoved));
+    }
+
+    /// @brief Registers an image the defragmenter may move.
+    /// @param image The image, replaced by the new one when it moves.
+    /// @param imageMemory The image's memory, replaced along with it.
+    /// @param imageInfo The information the image was created with.
+    /// @param layout The layout the image is in whenever the defragmenter runs.
+    /// @param onMoved Called after each move.
+    void ResourceManager::makeMovable(VkImage& image, MemoryAllocation& imageMemory, const VkImageCreateInfo& imageInfo, VkImageLayout layout, std::function<void()> onMoved) {
+        getDefragmenter().addImage(image, imageMemory, imageInfo, layout, std::move(onMoved));
+    }
+
+    /// @brief Returns the defragmenter, creating it on first use.
+    /// @return The defragmenter movable resources are registered with.
+    Defragmenter& ResourceManager::getDefragmenter() {
+        if (defragmenter == nullptr) {
+            defragmenter = std::make_unique<Defragmenter>(device_, *this);
+        }
+
+        return *defragmenter;
+    }
+
+    /// @brief Moves resources out of sparse memory blocks, within a budget.
+    /// @param byteBudget The most bytes to copy in this call.
+    void ResourceManager::defragment(VkDeviceSize byteBudget) {
+        if (defragmenter != nullptr) {
+            defragmenter->step(byteBudget);
+        }
+    }
+
+    /// @brief Returns what defragmenting has moved and reclaimed so far.
+    /// @return Empty statistics if nothing was made movable yet.
+    DefragmentationStats ResourceManager::getDefragmentationStats() const {
+        return defragmenter != nullptr ? defragmenter->getStats() : DefragmentationStats{};
+    }
+
+    /// @brief Returns the geometry pool, creating it on first use.
+    /// @return The pool shared by every model's vertices and indices.
+    GeometryPool& ResourceManager::getGeometryPool() {
+        if (geometryPool == nullptr) {
+            geometryPool = std::make_unique<GeometryPool>(device_, *this);
+        }
+
+        return *geometryPool;
+    }
+
+    /// @brief Returns the staging ring, creating it on first use.
+    /// @return The persistently mapped buffer every upload stages its data in.
+    StagingRing& ResourceManager::getStagingRing() {
+        if (stagingRing == nullptr) {
+            stagingRing = std::make_unique<StagingRing>(device_, *this, stagingRingSize);
+        }
+
+        return *stagingRing;
+    }
+
+    /// @brief Opens the upload batch shared by every upload until submitUploadBatch().
+    void ResourceManager::beginUploadBatch() {
+        if (uploadBatch == nullptr) {
+            // Copies may run on the transfer queue, they must not race the defragmenter copying the same buffer
+            if (defragmenter != nullptr) {
+                defragmenter->waitForMoves();
+            }
+
+            uploadBatch = std::make_unique<UploadBatch>(device_, *this);
+        }
+    }
+
+    /// @brief Submits the open upload batch without waiting for it.
+    /// @return The token to wait on, already complete if no batch was open or nothing was recorded.
+    UploadToken ResourceManager::submitUploadBatch() {
+        if (uploadBatch == nullptr) {
+            return UploadToken{};
+        }
+
+        UploadToken token = uploadBatch->submit();
+        uploadBatch.reset();
+        return token;
+    }
+
+    /// @brief Records into the open upload batch, or into one that is submitted and waited for right away.
+    /// @param record The function recording the uploads.
+    void ResourceManager::recordUploads(const std::function<void(UploadBatch&)>& record) {
+        if (uploadBatch != nullptr) {
+            record(*uploadBatch);
+            return;
+        }
+
+        if (defragmenter != nullptr) {
+            defragmenter->waitForMoves();
+        }
+
+        UploadBatch batch{ device_, *this };
+        record(batch);
+        waitForUpload(batch.submit());
+    }
+
+    /// @brief Copies data into a buffer through the staging ring.
+    /// @param dstBuffer The destination buffer.
+    /// @param dstOffset The byte offset into the destination buffer.
+    /// @param data The data to copy.
+    /// @param size The number of bytes to copy.
+    void ResourceManager::uploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size) {
+        recordUploads([&](UploadBatch& batch) {
+            batch.uploadBuffer(dstBuffer, dstOffset, data, size);
+        });
+    }
+
+    /// @brief Hands a submitted upload batch over until the GPU finishes it.
+    /// @return The token identifying the submission.
+    UploadToken ResourceManager::trackUpload(VkCommandBuffer commandBuffer, VkCommandBuffer transferCommandBuffer, VkSemaphore transferSemaphore, VkFence fence, VkDeviceSize size) {
+        // Reclaim finished uploads here too, so the staging ring does not fill up when nobody polls
+        collectCompletedUploads();
+
+        PendingUpload upload{};
+        upload.value = nextUploadValue++;
+        upload.commandBuffer = commandBuffer;
+        upload.transferCommandBuffer = transferCommandBuffer;
+        upload.transferSemaphore = transferSemaphore;
+        upload.fence = fence;
+        pendingUploads.push_back(std::move(upload));
+
+        uploadStats.submissions++;
+        uploadStats.bytesUploaded += size;
+
+        return UploadToken{ pendingUploads.back().value };
+    }
+
+    /// @brief Frees everything a finished upload held on to.
+    /// @param upload The upload, its fence has to be signaled.
+    void ResourceManager::retireUpload(PendingUpload& upload) {
+        vkDestroyFence(device_.device(), upload.fence, nullptr);
+        vkFreeCommandBuffers(device_.device(), device_.getCommandPool(), 1, &upload.commandBuffer);
+        if (upload.transferCommandBuffer != VK_NULL_HANDLE) {
+            vkFreeCommandBuffers(device_.device(), device_.getTransferCommandPool(), 1, &upload.transferCommandBuffer);
+            vkDestroySemaphore(device_.device(), upload.transferSemaphore, nullptr);
+        }
+
+        if (stagingRing != nullptr) {
+            stagingRing->retire(upload.value);
+        }
+    }
+
+    /// @brief Frees every upload whose fence has signaled along with its staging space.
+    void ResourceManager::collectCompletedUploads() {
+        size_t kept = 0;
+        for (size_t i = 0; i < pendingUploads.size(); i++) {
+            if (vkGetFenceStatus(device_.device(), pendingUploads[i].fence) == VK_SUCCESS) {
+                retireUpload(pendingUploads[i]);
+                continue;
+            }
+
+            if (kept != i) {
+                pendingUploads[kept] = std::move(pendingUploads[i]);
+            }
+            kept++;
+        }
+
+        pendingUploads.resize(kept);
+    }
+
+    /// @brief Checks whether an upload and every upload submitted before it have finished on the GPU.
+    /// @param token The token returned when the upload was submitted.
+    /// @return True once the GPU is done with the upload.
+    bool ResourceManager::isUploadComplete(UploadToken token) {
+        collectCompletedUploads();
+
+        for (const PendingUpload& upload : pendingUploads) {
+            if (upload.value <= token.value) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /// @brief Blocks until an upload and every upload submitted before it have finished on the GPU.
+    /// @param token The token returned when the upload was submitted.
+    void ResourceManager::waitForUpload(UploadToken token) {
+        for (const PendingUpload& upload : pendingUploads) {
+            if (upload.value <= token.value) {
+                vkWaitForFences(device_.device(), 1, &upload.fence, VK_TRUE, UINT64_MAX);
+            }
+        }
+
+        collectCompletedUploads();
+    }
 
-        if (vkAllocateMemory(device_.device(), &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to allocate image memory!");
+    /// @brief Blocks until every submitted upload has finished on the GPU.
+    void ResourceManager::waitForUploads() {
+        for (PendingUpload& upload : pendingUploads) {
+            vkWaitForFences(device_.device(), 1, &upload.fence, VK_TRUE, UINT64_MAX);
+            retireUpload(upload);
         }
 
-        vkBindImageMemory(device_.device(), image, imageMemory, 0);
+        pendingUploads.clear();
     }
 }
\ No newline at end of file
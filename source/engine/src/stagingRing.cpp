@@ -0,0 +1,123 @@
+#include "./engine/stagingRing.h"
+
+#include <cassert>
+#include <stdexcept>
+
+namespace JCAT {
+    StagingRing::StagingRing(DeviceSetup& device, ResourceManager& resourceManager, VkDeviceSize capacity) : capacity{capacity} {
+        buffer = std::make_unique<JCATBuffer>(device, resourceManager, capacity, 1,
+                                              VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                              VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+        // Mapped for the ring's whole life, coherent memory needs no flushes after writing
+        if (buffer->map() != VK_SUCCESS) {
+            throw std::runtime_error("Failed to map the staging ring!");
+        }
+        mapped = static_cast<char*>(buffer->getMappedMemory());
+    }
+
+    bool StagingRing::allocate(VkDeviceSize size, VkDeviceSize alignment, StagingAllocation& allocation) {
+        if (size == 0 || size > capacity) {
+            return false;
+        }
+        alignment = alignment > 0 ? alignment : 1;
+
+        reclaim();
+
+        VkDeviceSize offset;
+        if (regions.empty()) {
+            offset = 0;
+        }
+        else {
+            const VkDeviceSize tail = regions.front().begin;
+            const VkDeviceSize aligned = (head + alignment - 1) / alignment * alignment;
+
+            // head == tail only happens when the ring is completely full
+            if (head > tail) {
+                // Free space runs from head to the end and wraps around to the tail
+                if (aligned + size <= capacity) {
+                    offset = aligned;
+                }
+                else if (size <= tail) {
+                    offset = 0;
+                }
+                else {
+                    return false;
+                }
+            }
+            else if (head < tail && aligned + size <= tail) {
+                offset = aligned;
+            }
+            else {
+                return false;
+            }
+        }
+
+        Region region{};
+        region.begin = offset;
+        region.end = offset + size;
+        regions.push_back(region);
+        head = region.end;
+
+        allocation.id = frontId + regions.size() - 1;
+        allocation.offset = offset;
+        allocation.mapped = mapped + offset;
+        return true;
+    }
+
+    StagingRing::Region* StagingRing::findRegion(uint64_t id) {
+        if (id < frontId || id - frontId >= regions.size()) {
+            return nullptr;
+        }
+
+        return &regions[static_cast<size_t>(id - frontId)];
+    }
+
+    void StagingRing::assign(uint64_t id, uint64_t uploadValue) {
+        Region* region = findRegion(id);
+        assert(region != nullptr && region->uploadValue == 0 && "Assigned a staging allocation twice");
+        region->uploadValue = uploadValue;
+    }
+
+    void StagingRing::free(uint64_t id) {
+        Region* region = findRegion(id);
+        if (region != nullptr) {
+            region->retired = true;
+        }
+        reclaim();
+    }
+
+    void StagingRing::retire(uint64_t uploadValue) {
+        for (Region& region : regions) {
+            if (region.uploadValue == uploadValue) {
+                region.retired = true;
+            }
+        }
+        reclaim();
+    }
+
+    void StagingRing::reclaim() {
+        while (!regions.empty() && regions.front().retired) {
+            regions.pop_front();
+            frontId++;
+        }
+
+        // Starting over at 0 keeps large allocations from needlessly wrapping
+        if (regions.empty()) {
+            head = 0;
+        }
+    }
+
+    uint64_t StagingRing::getOldestUploadValue() const {
+        return regions.empty() ? 0 : regions.front().uploadValue;
+    }
+
+    VkDeviceSize StagingRing::getBytesInUse() const {
+        if (regions.empty()) {
+            return 0;
+        }
+
+        const VkDeviceSize tail = regions.front().begin;
+        return head > tail ? head - tail : capacity - tail + head;
+    }
+};
\ No newline at end of file
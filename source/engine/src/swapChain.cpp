@@ -56,8 +56,7 @@ namespace JCAT {
         if (type == "3D") {
             for (int i = 0; i < depthImages.size(); i++) {
                 vkDestroyImageView(device.device(), depthImageViews[i], nullptr);
-                vkDestroyImage(device.device(), depthImages[i], nullptr);
-                vkFreeMemory(device.device(), depthImageMemorys[i], nullptr);
+                resourceManager.destroyImage(depthImages[i], depthImageMemorys[i]);
             }
         }
 
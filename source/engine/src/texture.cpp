@@ -1,30 +1,60 @@
 #include "../texture.h"
-#include "../buffer.h"
+#include "../blockCompressor.h"
+#include "../textureCache.h"
+#include "../uploadBatch.h"
 
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
 #include <stdexcept>
 
 namespace JCAT {
 
-    Texture::Texture(DeviceSetup &device, ResourceManager &resourceManager, const std::string &filepath) : device{device}, resourceManager{resourceManager}  {
-        int channels;
-        int bytesPerPixel;
+    // The block format for compression if the device can sample and filter it with optimal tiling, RGBA8 otherwise
+    static VkFormat selectFormat(DeviceSetup &device, TextureCompression compression) {
+        VkFormat blockFormat = VK_FORMAT_UNDEFINED;
+        VkFormat fallbackFormat = VK_FORMAT_R8G8B8A8_SRGB;
+
+        switch (compression) {
+            case TextureCompression::BC1:
+                blockFormat = VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+                break;
+            case TextureCompression::BC3:
+                blockFormat = VK_FORMAT_BC3_SRGB_BLOCK;
+                break;
+            case TextureCompression::BC5:
+                // Not color, so neither the blocks nor the fallback are decoded from sRGB
+                blockFormat = VK_FORMAT_BC5_UNORM_BLOCK;
+                fallbackFormat = VK_FORMAT_R8G8B8A8_UNORM;
+                break;
+            case TextureCompression::BC7:
+                blockFormat = VK_FORMAT_BC7_SRGB_BLOCK;
+                break;
+            default:
+                break;
+        }
+
+        if (blockFormat == VK_FORMAT_UNDEFINED) {
+            return fallbackFormat;
+        }
 
-        stbi_uc* data = stbi_load(filepath.c_str(), &width, &height, &bytesPerPixel, 4);
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(device.getPhysicalDevice(), blockFormat, &properties);
 
-        mipLevels = std::floor(std::log2(std::max(width, height))) + 1;
+        const VkFormatFeatureFlags requiredFeatures = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+        return (properties.optimalTilingFeatures & requiredFeatures) == requiredFeatures ? blockFormat : fallbackFormat;
+    }
 
-        JCATBuffer stagingBuffer{device, resourceManager, 4, 
-            static_cast<uint32_t>(width * height), 
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-        };
+    Texture::Texture(DeviceSetup &device, ResourceManager &resourceManager, const std::string &filepath, TextureCompression compression) : device{device}, resourceManager{resourceManager}  {
+        // The .jtex next to the image holds the whole mip chain, it is rebuilt from the image when missing, out of date or in another format
+        const VkFormat format = selectFormat(device, compression);
+        TextureCache::CachedTexture cached;
+        if (!TextureCache::load(filepath, format, cached) && !TextureCache::import(filepath, format, cached)) {
+            throw std::runtime_error("Failed to load texture: " + filepath);
+        }
 
-        stagingBuffer.map();
-        stagingBuffer.writeToBuffer(data);
+        width = static_cast<int>(cached.width);
+        height = static_cast<int>(cached.height);
+        mipLevels = static_cast<int>(cached.levels.size());
 
-        imageFormat = VK_FORMAT_R8G8B8A8_SRGB;
+        imageFormat = cached.format;
 
         VkImageCreateInfo imageInfo {};
         imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -41,12 +71,12 @@ namespace JCAT {
 
         resourceManager.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, image, imageMemory);
 
-        transitionImageLayout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-
-        resourceManager.copyBufferToImage(stagingBuffer.getBuffer(), image, static_cast<uint32_t>(width), static_cast<uint32_t>(height), 1);
-
-        //transitionImageLayout(VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-        generateMipmaps();
+        // Every level is copied in one go and the layout transitions share its submission, with other uploads too if a batch is open
+        resourceManager.recordUploads([&](UploadBatch& batch) {
+            BlockCompressor::Format blockFormat;
+            const uint32_t blockSize = BlockCompressor::getFormat(imageFormat, blockFormat) ? BlockCompressor::BLOCK_SIZE : 1;
+            batch.uploadMipChain(image, cached.data, cached.levels.data(), static_cast<uint32_t>(mipLevels), blockSize);
+        });
 
         imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
@@ -68,6 +98,12 @@ namespace JCAT {
 
         vkCreateSampler(device.device(), &samplerInfo, nullptr, &sampler);
 
+        createImageView();
+
+        resourceManager.makeMovable(image, imageMemory, imageInfo, imageLayout, [this]() { onImageMoved(); });
+    }
+
+    void Texture::createImageView() {
         VkImageViewCreateInfo imageViewInfo {};
         imageViewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
         imageViewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
@@ -81,128 +117,26 @@ namespace JCAT {
         imageViewInfo.image = image;
 
         vkCreateImageView(device.device(), &imageViewInfo, nullptr, &imageView);
-
-        stbi_image_free(data);
-
     }
 
-    Texture::~Texture() {
-        vkDestroyImage(device.device(), image, nullptr);
-        vkFreeMemory(device.device(), imageMemory, nullptr);
-        vkDestroyImageView(device.device(), imageView, nullptr);
-        vkDestroySampler(device.device(), sampler, nullptr);
-    }
+    void Texture::onImageMoved() {
+        // Frames in flight may still sample through the old view
+        VkDevice logicalDevice = device.device();
+        VkImageView oldImageView = imageView;
+        resourceManager.getDefragmenter().destroyLater([logicalDevice, oldImageView]() {
+            vkDestroyImageView(logicalDevice, oldImageView, nullptr);
+        });
 
-    void Texture::transitionImageLayout(VkImageLayout oldLayout, VkImageLayout newLayout) {
-        VkCommandBuffer commandBuffer = resourceManager.beginSingleTimeCommands();
-
-        VkImageMemoryBarrier barrier {};
-        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        barrier.oldLayout = oldLayout;
-        barrier.newLayout = newLayout;
-        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        barrier.image = image;
-        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        barrier.subresourceRange.baseMipLevel = 0;
-        barrier.subresourceRange.levelCount = mipLevels;
-        barrier.subresourceRange.baseArrayLayer = 0;
-        barrier.subresourceRange.layerCount = 1;
-
-        VkPipelineStageFlags sourceStage;
-        VkPipelineStageFlags destinationStage;
-
-        if(oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-            barrier.srcAccessMask = 0;
-            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-            sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-            destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        }
-        else if(oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        createImageView();
 
-            sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-            destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        if (moveCallback) {
+            moveCallback();
         }
-        else {
-            throw std::runtime_error("Unsupported layout transition!");
-        }
-
-        vkCmdPipelineBarrier(commandBuffer, sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
-
-        resourceManager.endSingleTimeCommands(commandBuffer);
     }
 
-    void Texture::generateMipmaps() {
-        VkFormatProperties formatProperties;
-        vkGetPhysicalDeviceFormatProperties(device.getPhysicalDevice(), imageFormat, &formatProperties);
-
-        if(!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)) {
-            throw std::runtime_error("texture image format does not support linear blitting!");
-        }
-
-        VkCommandBuffer commandBuffer = resourceManager.beginSingleTimeCommands();
-
-        VkImageMemoryBarrier barrier {};
-        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        barrier.image = image;
-        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        barrier.subresourceRange.baseMipLevel = 0;
-        barrier.subresourceRange.levelCount = 1;
-        barrier.subresourceRange.baseArrayLayer = 0;
-        barrier.subresourceRange.layerCount = 1;
-
-        int32_t mipWidth = width;
-        int32_t mipHeight = height;
-
-        for(uint32_t i = 1; i < mipLevels; i++){
-            barrier.subresourceRange.baseMipLevel = i - 1;
-            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-
-            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
-            
-            VkImageBlit blit {};
-            blit.srcOffsets[0] = {0, 0, 0};
-            blit.srcOffsets[1] = {mipWidth, mipHeight, 1};
-            blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-            blit.srcSubresource.mipLevel = i - 1;
-            blit.srcSubresource.baseArrayLayer = 0;
-            blit.srcSubresource.layerCount = 1;
-            blit.dstOffsets[0] = {0, 0, 0};
-            blit.dstOffsets[1] = {mipWidth > 1 ? mipWidth / 2 : 1, mipHeight > 1 ? mipHeight / 2 : 1, 1};
-            blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-            blit.dstSubresource.mipLevel = i;
-            blit.dstSubresource.baseArrayLayer = 0;
-            blit.dstSubresource.layerCount = 1;
-
-            vkCmdBlitImage(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
-
-            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-            barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
-
-            if(mipWidth > 1) mipWidth /= 2;
-            if(mipHeight > 1) mipHeight /= 2;
-        }
-
-        barrier.subresourceRange.baseMipLevel = mipLevels - 1;
-        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
-
-        resourceManager.endSingleTimeCommands(commandBuffer);
+    Texture::~Texture() {
+        vkDestroyImageView(device.device(), imageView, nullptr);
+        resourceManager.destroyImage(image, imageMemory);
+        vkDestroySampler(device.device(), sampler, nullptr);
     }
 }
\ No newline at end of file
@@ -0,0 +1,369 @@
+#include "./engine/textureCache.h"
+#include "./engine/blockCompressor.h"
+#include "./engine/threadPool.h"
+#include "./engine/utils.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+
+namespace JCAT {
+    static constexpr char TEXTURE_CACHE_MAGIC[4] = { 'J', 'T', 'E', 'X' };
+
+    // Only compared for equality against a previous run, so the clock's epoch does not matter
+    static bool getSourceStamp(const std::string& sourcePath, uint64_t& modifiedTime, uint64_t& size) {
+        std::error_code error;
+
+        std::filesystem::file_time_type writeTime = std::filesystem::last_write_time(sourcePath, error);
+        if (error) {
+            return false;
+        }
+
+        uintmax_t fileSize = std::filesystem::file_size(sourcePath, error);
+        if (error) {
+            return false;
+        }
+
+        modifiedTime = static_cast<uint64_t>(writeTime.time_since_epoch().count());
+        size = static_cast<uint64_t>(fileSize);
+
+        return true;
+    }
+
+    static bool hashSourceFile(const std::string& sourcePath, uint64_t& hash) {
+        MappedFile source;
+        if (!source.open(sourcePath)) {
+            return false;
+        }
+
+        hash = hashBytes(source.data(), source.size());
+        return true;
+    }
+
+    // Patches the modification time in the header of the cache at path, in place. The size already matches
+    static bool writeSourceStamp(const std::string& path, uint64_t modifiedTime) {
+        std::fstream output(path, std::ios::binary | std::ios::in | std::ios::out);
+        if (!output) {
+            return false;
+        }
+
+        output.seekp(static_cast<std::streamoff>(offsetof(TextureCacheHeader, sourceModifiedTime)));
+        output.write(reinterpret_cast<const char*>(&modifiedTime), sizeof(modifiedTime));
+
+        return static_cast<bool>(output);
+    }
+
+    static float srgbToLinear(float value) {
+        return value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+    }
+
+    static uint8_t linearToSrgb8(float value) {
+        const float srgb = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+        return static_cast<uint8_t>(std::lround(std::clamp(srgb, 0.0f, 1.0f) * 255.0f));
+    }
+
+    static bool isSrgb(VkFormat format) {
+        switch (format) {
+            case VK_FORMAT_R8G8B8A8_SRGB:
+            case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+            case VK_FORMAT_BC3_SRGB_BLOCK:
+            case VK_FORMAT_BC7_SRGB_BLOCK:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    /**
+     * Averages 2x2 RGBA8 texels of source into each texel of destination
+     * @param srgb Averages the color channels in linear space, like a blit of an SRGB image would. Alpha is always stored linearly
+     */
+    static void downsample(const uint8_t* source, uint32_t sourceWidth, uint32_t sourceHeight, uint8_t* destination, uint32_t width, uint32_t height, bool srgb) {
+        static const std::vector<float> toLinear = []() {
+            std::vector<float> table(256);
+            for (int i = 0; i < 256; i++) {
+                table[i] = srgbToLinear(static_cast<float>(i) / 255.0f);
+            }
+            return table;
+        }();
+
+        for (uint32_t y = 0; y < height; y++) {
+            // An odd edge repeats its last row or column rather than reading past it
+            const uint32_t y0 = std::min(y * 2, sourceHeight - 1);
+            const uint32_t y1 = std::min(y * 2 + 1, sourceHeight - 1);
+
+            for (uint32_t x = 0; x < width; x++) {
+                const uint32_t x0 = std::min(x * 2, sourceWidth - 1);
+                const uint32_t x1 = std::min(x * 2 + 1, sourceWidth - 1);
+
+                const uint8_t* texels[4] = {
+                    source + (static_cast<size_t>(y0) * sourceWidth + x0) * 4,
+                    source + (static_cast<size_t>(y0) * sourceWidth + x1) * 4,
+                    source + (static_cast<size_t>(y1) * sourceWidth + x0) * 4,
+                    source + (static_cast<size_t>(y1) * sourceWidth + x1) * 4
+                };
+
+                uint8_t* output = destination + (static_cast<size_t>(y) * width + x) * 4;
+                for (int channel = 0; channel < 4; channel++) {
+                    if (srgb && channel < 3) {
+                        const float sum = toLinear[texels[0][channel]] + toLinear[texels[1][channel]] + toLinear[texels[2][channel]] + toLinear[texels[3][channel]];
+                        output[channel] = linearToSrgb8(sum * 0.25f);
+                    }
+                    else {
+                        output[channel] = static_cast<uint8_t>((texels[0][channel] + texels[1][channel] + texels[2][channel] + texels[3][channel] + 2) / 4);
+                    }
+                }
+            }
+        }
+    }
+
+    std::string TextureCache::getCachePath(const std::string& sourcePath) {
+        // Appended rather than replacing the extension, so wood.png and wood.jpg never share a cache
+        return sourcePath + ".jtex";
+    }
+
+    uint32_t TextureCache::getMipLevelCount(uint32_t width, uint32_t height) {
+        uint32_t levels = 1;
+        for (uint32_t size = std::max(width, height); size > 1; size /= 2) {
+            levels++;
+        }
+
+        return levels;
+    }
+
+    uint64_t TextureCache::getLevelSize(VkFormat format, uint32_t width, uint32_t height) {
+        BlockCompressor::Format blockFormat;
+        if (BlockCompressor::getFormat(format, blockFormat)) {
+            return BlockCompressor::getCompressedSize(blockFormat, width, height);
+        }
+
+        return static_cast<uint64_t>(width) * height * 4;
+    }
+
+    // Offsets and sizes of a full chain of format laid out the way the cache file stores it, returns the bytes it spans
+    static VkDeviceSize layoutMipChain(VkFormat format, uint32_t width, uint32_t height, std::vector<UploadBatch::MipLevelUpload>& levels) {
+        levels.resize(TextureCache::getMipLevelCount(width, height));
+
+        VkDeviceSize offset = 0;
+        for (UploadBatch::MipLevelUpload& level : levels) {
+            offset = (offset + TextureCache::LEVEL_ALIGNMENT - 1) & ~(TextureCache::LEVEL_ALIGNMENT - 1);
+            level = UploadBatch::MipLevelUpload{ offset, TextureCache::getLevelSize(format, width, height), width, height };
+            offset += level.size;
+
+            width = std::max(1u, width / 2);
+            height = std::max(1u, height / 2);
+        }
+
+        return offset;
+    }
+
+    bool TextureCache::load(const std::string& sourcePath, VkFormat format, CachedTexture& texture) {
+        const std::string cachePath = getCachePath(sourcePath);
+        MappedFile file;
+        if (!file.open(cachePath) || file.size() < sizeof(TextureCacheHeader)) {
+            return false;
+        }
+
+        TextureCacheHeader header;
+        std::memcpy(&header, file.data(), sizeof(TextureCacheHeader));
+
+        if (std::memcmp(header.magic, TEXTURE_CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+            header.version != VERSION ||
+            header.format != static_cast<uint32_t>(format) ||
+            header.width == 0 || header.height == 0 ||
+            header.mipLevels != getMipLevelCount(header.width, header.height) ||
+            header.mipLevels > (file.size() - sizeof(TextureCacheHeader)) / sizeof(TextureCacheLevel)) {
+            return false;
+        }
+
+        // A missing source is fine (pre-baked caches can ship without the image), otherwise it must match what we built from
+        uint64_t modifiedTime = 0;
+        uint64_t size = 0;
+        if (getSourceStamp(sourcePath, modifiedTime, size) && (modifiedTime != header.sourceModifiedTime || size != header.sourceSize)) {
+            uint64_t sourceHash = 0;
+            if (size != header.sourceSize || !hashSourceFile(sourcePath, sourceHash) || sourceHash != header.sourceHash) {
+                return false;
+            }
+
+            // Same content under a new stamp, recorded so later launches skip the hash. As in MeshCache the mapping is
+            // dropped around the patch, Windows keeps writers out of a mapped file
+            file.close();
+            writeSourceStamp(cachePath, modifiedTime);
+
+            TextureCacheHeader expected = header;
+            if (!file.open(cachePath) || file.size() < sizeof(TextureCacheHeader)) {
+                return false;
+            }
+            std::memcpy(&header, file.data(), sizeof(TextureCacheHeader));
+
+            // Another writer may have replaced the cache in between, anything but the stamp changing is a miss
+            expected.sourceModifiedTime = header.sourceModifiedTime;
+            if (std::memcmp(&expected, &header, sizeof(TextureCacheHeader)) != 0) {
+                return false;
+            }
+        }
+
+        const TextureCacheLevel* levels = reinterpret_cast<const TextureCacheLevel*>(file.data() + sizeof(TextureCacheHeader));
+        texture.levels.resize(header.mipLevels);
+
+        uint32_t width = header.width;
+        uint32_t height = header.height;
+        for (uint32_t i = 0; i < header.mipLevels; i++) {
+            // Reject levels that point outside the file, are misaligned, or do not hold exactly the texels (or blocks) of their size
+            if (levels[i].offset > file.size() || levels[i].size > file.size() - levels[i].offset || levels[i].offset % LEVEL_ALIGNMENT != 0 ||
+                levels[i].width != width || levels[i].height != height || levels[i].size != getLevelSize(format, width, height)) {
+                return false;
+            }
+
+            texture.levels[i] = UploadBatch::MipLevelUpload{ levels[i].offset, levels[i].size, levels[i].width, levels[i].height };
+
+            width = std::max(1u, width / 2);
+            height = std::max(1u, height / 2);
+        }
+
+        texture.format = format;
+        texture.width = header.width;
+        texture.height = header.height;
+        texture.imported.clear();
+        texture.file = std::move(file);
+        texture.data = texture.file.data();
+        texture.dataSize = texture.file.size();
+
+        return true;
+    }
+
+    bool TextureCache::import(const std::string& sourcePath, VkFormat format, CachedTexture& texture) {
+        BlockCompressor::Format blockFormat;
+        const bool compressed = BlockCompressor::getFormat(format, blockFormat);
+        if (!compressed && format != VK_FORMAT_R8G8B8A8_SRGB && format != VK_FORMAT_R8G8B8A8_UNORM) {
+            throw std::runtime_error("Unsupported texture format for " + sourcePath);
+        }
+
+        int width = 0;
+        int height = 0;
+        int channels = 0;
+        stbi_uc* pixels = stbi_load(sourcePath.c_str(), &width, &height, &channels, 4);
+        if (pixels == nullptr) {
+            return false;
+        }
+
+        texture.file.close();
+        texture.format = format;
+        texture.width = static_cast<uint32_t>(width);
+        texture.height = static_cast<uint32_t>(height);
+
+        // The uncompressed chain is filtered first, in place for RGBA8 or next to the blocks it is compressed into
+        std::vector<UploadBatch::MipLevelUpload> rgbaLevels;
+        std::vector<uint8_t> rgba(static_cast<size_t>(layoutMipChain(VK_FORMAT_R8G8B8A8_UNORM, texture.width, texture.height, rgbaLevels)), 0);
+        std::memcpy(rgba.data(), pixels, static_cast<size_t>(rgbaLevels[0].size));
+        stbi_image_free(pixels);
+
+        for (size_t i = 1; i < rgbaLevels.size(); i++) {
+            const UploadBatch::MipLevelUpload& source = rgbaLevels[i - 1];
+            const UploadBatch::MipLevelUpload& level = rgbaLevels[i];
+            downsample(rgba.data() + source.offset, source.width, source.height, rgba.data() + level.offset, level.width, level.height, isSrgb(format));
+        }
+
+        if (compressed) {
+            texture.imported.assign(static_cast<size_t>(layoutMipChain(format, texture.width, texture.height, texture.levels)), 0);
+
+            ThreadPool threadPool;
+            const auto start = std::chrono::high_resolution_clock::now();
+            for (size_t i = 0; i < texture.levels.size(); i++) {
+                BlockCompressor::compress(blockFormat, rgba.data() + rgbaLevels[i].offset, texture.levels[i].width, texture.levels[i].height,
+                    texture.imported.data() + texture.levels[i].offset, threadPool);
+            }
+            const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+            // Quality of the top level, the one seen up close
+            std::vector<uint8_t> decoded(static_cast<size_t>(rgbaLevels[0].size));
+            BlockCompressor::decompress(blockFormat, texture.imported.data(), texture.width, texture.height, decoded.data());
+            const double psnr = BlockCompressor::computePsnr(rgba.data(), decoded.data(), static_cast<size_t>(texture.width) * texture.height, BlockCompressor::getChannelCount(blockFormat));
+
+            // Rounded to a tenth without changing the stream's precision for everything printed after
+            const double megatexelsPerSecond = static_cast<double>(rgba.size() / 4) / (milliseconds * 1000.0);
+            std::cout << "Compressed " << sourcePath << " to " << BlockCompressor::getName(blockFormat) << ": " << texture.width << "x" << texture.height << ", "
+                      << rgba.size() / 1024 << " -> " << texture.imported.size() / 1024 << " KiB in " << static_cast<int>(milliseconds) << " ms ("
+                      << std::round(megatexelsPerSecond * 10.0) / 10.0 << " Mtexels/s on " << threadPool.getThreadCount() << " threads), PSNR "
+                      << std::round(psnr * 10.0) / 10.0 << " dB" << std::endl;
+        }
+        else {
+            texture.levels = std::move(rgbaLevels);
+            texture.imported = std::move(rgba);
+        }
+
+        texture.data = texture.imported.data();
+        texture.dataSize = texture.imported.size();
+
+        // The cache is an optimization, the next launch just imports again if it cannot be written
+        write(sourcePath, texture);
+
+        return true;
+    }
+
+    bool TextureCache::write(const std::string& sourcePath, const CachedTexture& texture) {
+        TextureCacheHeader header{};
+        std::memcpy(header.magic, TEXTURE_CACHE_MAGIC, sizeof(header.magic));
+        header.version = VERSION;
+        if (!getSourceStamp(sourcePath, header.sourceModifiedTime, header.sourceSize) || !hashSourceFile(sourcePath, header.sourceHash)) {
+            return false;
+        }
+
+        header.format = static_cast<uint32_t>(texture.format);
+        header.width = texture.width;
+        header.height = texture.height;
+        header.mipLevels = static_cast<uint32_t>(texture.levels.size());
+
+        // The payload keeps its in-memory layout, shifted past the header and level table
+        const uint64_t tableEnd = sizeof(TextureCacheHeader) + sizeof(TextureCacheLevel) * texture.levels.size();
+        const uint64_t payloadOffset = (tableEnd + LEVEL_ALIGNMENT - 1) & ~(LEVEL_ALIGNMENT - 1);
+
+        std::vector<TextureCacheLevel> table(texture.levels.size());
+        for (size_t i = 0; i < texture.levels.size(); i++) {
+            table[i] = TextureCacheLevel{ payloadOffset + texture.levels[i].offset, texture.levels[i].size, texture.levels[i].width, texture.levels[i].height };
+        }
+
+        // Write to a temporary file and rename it into place so a crash or a concurrent reader never sees a partial cache
+        const std::string cachePath = getCachePath(sourcePath);
+        const std::string temporaryPath = makeTemporaryPath(cachePath);
+        {
+            std::ofstream output(temporaryPath, std::ios::binary | std::ios::trunc);
+            if (!output) {
+                return false;
+            }
+
+            const char padding[LEVEL_ALIGNMENT] = {};
+            output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            output.write(reinterpret_cast<const char*>(table.data()), static_cast<std::streamsize>(sizeof(TextureCacheLevel) * table.size()));
+            output.write(padding, static_cast<std::streamsize>(payloadOffset - tableEnd));
+            output.write(reinterpret_cast<const char*>(texture.data), static_cast<std::streamsize>(texture.dataSize));
+
+            // Closing flushes, so a full disk may only show up here. A failed write leaves nothing behind, every attempt
+            // gets a new temporary name and would otherwise pile up next to the source
+            output.close();
+            if (!output) {
+                std::error_code error;
+                std::filesystem::remove(temporaryPath, error);
+                return false;
+            }
+        }
+
+        std::error_code error;
+        std::filesystem::rename(temporaryPath, cachePath, error);
+        if (error) {
+            std::filesystem::remove(temporaryPath, error);
+            return false;
+        }
+
+        return true;
+    }
+};
\ No newline at end of file
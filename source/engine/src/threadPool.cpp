@@ -0,0 +1,51 @@
+#include "./engine/threadPool.h"
+
+#include <algorithm>
+
+namespace JCAT {
+    ThreadPool::ThreadPool(size_t threadCount) {
+        if (threadCount == 0) {
+            // hardware_concurrency may report 0 when it cannot be determined
+            threadCount = std::max<size_t>(1, std::thread::hardware_concurrency());
+        }
+
+        workers.reserve(threadCount);
+        for (size_t i = 0; i < threadCount; i++) {
+            workers.emplace_back(&ThreadPool::workerLoop, this);
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            stopping = true;
+        }
+
+        queueCondition.notify_all();
+
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    void ThreadPool::workerLoop() {
+        while (true) {
+            std::function<void()> task;
+
+            {
+                std::unique_lock<std::mutex> lock(queueMutex);
+                queueCondition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+
+                // Drain the queue before exiting so no returned future is left without a value
+                if (tasks.empty()) {
+                    return;
+                }
+
+                task = std::move(tasks.front());
+                tasks.pop();
+            }
+
+            task();
+        }
+    }
+};
\ No newline at end of file
@@ -0,0 +1,476 @@
+#include "./engine/uploadBatch.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace JCAT {
+    UploadBatch::UploadBatch(DeviceSetup& d, ResourceManager& r) : device{d}, resourceManager{r} {}
+
+    UploadBatch::~UploadBatch() {
+        submit();
+    }
+
+    VkCommandBuffer UploadBatch::getCommandBuffer() {
+        // Allocated on first use so a batch nothing was recorded into costs no submission
+        if (commandBuffer == VK_NULL_HANDLE) {
+            commandBuffer = beginCommandBuffer(device.getCommandPool());
+        }
+
+        return commandBuffer;
+    }
+
+    VkCommandBuffer UploadBatch::getTransferCommandBuffer() {
+        if (!device.hasDedicatedTransferQueue()) {
+            return getCommandBuffer();
+        }
+
+        if (transferCommandBuffer == VK_NULL_HANDLE) {
+            transferCommandBuffer = beginCommandBuffer(device.getTransferCommandPool());
+        }
+
+        return transferCommandBuffer;
+    }
+
+    VkCommandBuffer UploadBatch::beginCommandBuffer(VkCommandPool commandPool) {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = commandPool;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer newCommandBuffer;
+        if (vkAllocateCommandBuffers(device.device(), &allocInfo, &newCommandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate upload command buffer!");
+        }
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        vkBeginCommandBuffer(newCommandBuffer, &beginInfo);
+
+        return newCommandBuffer;
+    }
+
+    StagingAllocation UploadBatch::allocateStaging(VkDeviceSize size) {
+        StagingRing& ring = resourceManager.getStagingRing();
+
+        StagingAllocation allocation;
+        while (!ring.allocate(size, STAGING_ALIGNMENT, allocation)) {
+            resourceManager.collectCompletedUploads();
+            if (ring.allocate(size, STAGING_ALIGNMENT, allocation)) {
+                break;
+            }
+
+            const uint64_t oldestUpload = ring.getOldestUploadValue();
+            if (oldestUpload != 0) {
+                resourceManager.uploadStats.stagingStalls++;
+                resourceManager.waitForUpload(UploadToken{ oldestUpload });
+            }
+            else if (!stagingAllocations.empty()) {
+                // Only this batch's own data is in the way, sending it off lets the ring drain
+                submit();
+            }
+            else {
+                throw std::runtime_error("Upload does not fit into the staging ring!");
+            }
+        }
+
+        stagingAllocations.push_back(allocation.id);
+        return allocation;
+    }
+
+    void UploadBatch::uploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size) {
+        StagingRing& ring = resourceManager.getStagingRing();
+        const char* bytes = static_cast<const char*>(data);
+
+        for (VkDeviceSize offset = 0; offset < size; offset += ring.getMaxChunkSize()) {
+            const VkDeviceSize chunkSize = std::min(ring.getMaxChunkSize(), size - offset);
+
+            StagingAllocation staging = allocateStaging(chunkSize);
+            std::memcpy(staging.mapped, bytes + offset, static_cast<size_t>(chunkSize));
+
+            copyBuffer(ring.getBuffer(), dstBuffer, chunkSize, staging.offset, dstOffset + offset);
+        }
+    }
+
+    void UploadBatch::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize srcOffset, VkDeviceSize dstOffset) {
+        VkBufferCopy copyRegion = {};
+        copyRegion.srcOffset = srcOffset;
+        copyRegion.dstOffset = dstOffset;
+        copyRegion.size = size;
+
+        vkCmdCopyBuffer(getTransferCommandBuffer(), srcBuffer, dstBuffer, 1, &copyRegion);
+        bytesRecorded += size;
+    }
+
+    void UploadBatch::uploadImage(VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels, const void* data, VkDeviceSize size) {
+        StagingRing& ring = resourceManager.getStagingRing();
+        const char* bytes = static_cast<const char*>(data);
+
+        // Large images are copied in bands of whole rows
+        const VkDeviceSize rowSize = size / height;
+        const uint32_t rowsPerChunk = static_cast<uint32_t>(std::max<VkDeviceSize>(1, std::min<VkDeviceSize>(height, ring.getMaxChunkSize() / rowSize)));
+
+        for (uint32_t row = 0; row < height; row += rowsPerChunk) {
+            const uint32_t rows = std::min(rowsPerChunk, height - row);
+            const VkDeviceSize chunkSize = rowSize * rows;
+
+            // May submit what is recorded so far, so the command buffer is only fetched afterwards
+            StagingAllocation staging = allocateStaging(chunkSize);
+            std::memcpy(staging.mapped, bytes + rowSize * row, static_cast<size_t>(chunkSize));
+
+            VkCommandBuffer copyCommands = getTransferCommandBuffer();
+            if (row == 0) {
+                recordLayoutTransition(copyCommands, image, mipLevels, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+            }
+
+            VkBufferImageCopy region{};
+            region.bufferOffset = staging.offset;
+            region.bufferRowLength = 0;
+            region.bufferImageHeight = 0;
+
+            region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            region.imageSubresource.mipLevel = 0;
+            region.imageSubresource.baseArrayLayer = 0;
+            region.imageSubresource.layerCount = 1;
+
+            region.imageOffset = {0, static_cast<int32_t>(row), 0};
+            region.imageExtent = {width, rows, 1};
+
+            vkCmdCopyBufferToImage(copyCommands, ring.getBuffer(), image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+            bytesRecorded += chunkSize;
+        }
+
+        if (device.hasDedicatedTransferQueue()) {
+            transferImageOwnership(image, mipLevels);
+        }
+    }
+
+    void UploadBatch::uploadMipChain(VkImage image, const void* data, const MipLevelUpload* levels, uint32_t mipLevels, uint32_t blockSize) {
+        StagingRing& ring = resourceManager.getStagingRing();
+        const char* bytes = static_cast<const char*>(data);
+
+        // Bands of whole rows (of blocks) in data order, only levels larger than a chunk are cut into more than one
+        struct RowBand {
+            uint32_t level;
+            uint32_t firstRow;
+            uint32_t rows;
+            VkDeviceSize offset;
+            VkDeviceSize size;
+        };
+
+        std::vector<RowBand> bands;
+        for (uint32_t level = 0; level < mipLevels; level++) {
+            const uint32_t rowCount = (levels[level].height + blockSize - 1) / blockSize;
+            const VkDeviceSize rowSize = levels[level].size / rowCount;
+            const uint32_t rowsPerBand = static_cast<uint32_t>(std::max<VkDeviceSize>(1, std::min<VkDeviceSize>(rowCount, ring.getMaxChunkSize() / rowSize)));
+
+            for (uint32_t row = 0; row < rowCount; row += rowsPerBand) {
+                const uint32_t rows = std::min(rowsPerBand, rowCount - row);
+                bands.push_back(RowBand{ level, row, rows, levels[level].offset + rowSize * row, rowSize * rows });
+            }
+        }
+
+        std::vector<VkBufferImageCopy> regions;
+        size_t first = 0;
+        while (first < bands.size()) {
+            // Stage as many consecutive bands as fit one chunk with a single copy, padding between levels included
+            size_t end = first + 1;
+            while (end < bands.size() && bands[end].offset + bands[end].size - bands[first].offset <= ring.getMaxChunkSize()) {
+                end++;
+            }
+            const VkDeviceSize spanSize = bands[end - 1].offset + bands[end - 1].size - bands[first].offset;
+
+            // May submit what is recorded so far, so the command buffer is only fetched afterwards
+            StagingAllocation staging = allocateStaging(spanSize);
+            std::memcpy(staging.mapped, bytes + bands[first].offset, static_cast<size_t>(spanSize));
+
+            VkCommandBuffer copyCommands = getTransferCommandBuffer();
+            if (first == 0) {
+                recordLayoutTransition(copyCommands, image, mipLevels, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+            }
+
+            regions.clear();
+            for (size_t i = first; i < end; i++) {
+                VkBufferImageCopy region{};
+                region.bufferOffset = staging.offset + (bands[i].offset - bands[first].offset);
+                region.bufferRowLength = 0;
+                region.bufferImageHeight = 0;
+
+                region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+                region.imageSubresource.mipLevel = bands[i].level;
+                region.imageSubresource.baseArrayLayer = 0;
+                region.imageSubresource.layerCount = 1;
+
+                // A band of block rows ending on the image's edge covers only the texels left there
+                const uint32_t firstTexelRow = bands[i].firstRow * blockSize;
+                region.imageOffset = {0, static_cast<int32_t>(firstTexelRow), 0};
+                region.imageExtent = {levels[bands[i].level].width, std::min(bands[i].rows * blockSize, levels[bands[i].level].height - firstTexelRow), 1};
+
+                regions.push_back(region);
+            }
+
+            vkCmdCopyBufferToImage(copyCommands, ring.getBuffer(), image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(regions.size()), regions.data());
+            bytesRecorded += spanSize;
+            first = end;
+        }
+
+        if (device.hasDedicatedTransferQueue()) {
+            transferImageOwnership(image, mipLevels);
+        }
+
+        // Nothing left to blit, so the whole chain goes straight to sampling
+        recordLayoutTransition(getCommandBuffer(), image, mipLevels, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    }
+
+    void UploadBatch::transferImageOwnership(VkImage image, uint32_t mipLevels) {
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcQueueFamilyIndex = device.transferQueueFamily();
+        barrier.dstQueueFamilyIndex = device.graphicsQueueFamily();
+        barrier.image = image;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseMipLevel = 0;
+        barrier.subresourceRange.levelCount = mipLevels;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = 1;
+
+        // Release, the destination half is ignored on the transfer queue
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = 0;
+        vkCmdPipelineBarrier(getTransferCommandBuffer(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        // Acquire, the graphics submission waits on the transfer semaphore at ALL_COMMANDS, which the source half chains onto
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+        vkCmdPipelineBarrier(getCommandBuffer(), VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+
+    void UploadBatch::transitionImageLayout(VkImage image, uint32_t mipLevels, VkImageLayout oldLayout, VkImageLayout newLayout) {
+        recordLayoutTransition(getCommandBuffer(), image, mipLevels, oldLayout, newLayout);
+    }
+
+    void UploadBatch::recordLayoutTransition(VkCommandBuffer layoutCommands, VkImage image, uint32_t mipLevels, VkImageLayout oldLayout, VkImageLayout newLayout) {
+        VkImageMemoryBarrier barrier {};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout = oldLayout;
+        barrier.newLayout = newLayout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseMipLevel = 0;
+        barrier.subresourceRange.levelCount = mipLevels;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = 1;
+
+        VkPipelineStageFlags sourceStage;
+        VkPipelineStageFlags destinationStage;
+
+        if(oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+            sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+            destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        }
+        else if(oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+            sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+            destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        }
+        else {
+            throw std::runtime_error("Unsupported layout transition!");
+        }
+
+        vkCmdPipelineBarrier(layoutCommands, sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+
+    void UploadBatch::generateMipmaps(VkImage image, VkFormat format, uint32_t width, uint32_t height, uint32_t mipLevels) {
+        VkFormatProperties formatProperties;
+        vkGetPhysicalDeviceFormatProperties(device.getPhysicalDevice(), format, &formatProperties);
+
+        if(!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)) {
+            throw std::runtime_error("texture image format does not support linear blitting!");
+        }
+
+        VkCommandBuffer commandBuffer = getCommandBuffer();
+
+        VkImageMemoryBarrier barrier {};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.image = image;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseMipLevel = 0;
+        barrier.subresourceRange.levelCount = 1;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = 1;
+
+        int32_t mipWidth = static_cast<int32_t>(width);
+        int32_t mipHeight = static_cast<int32_t>(height);
+
+        for(uint32_t i = 1; i < mipLevels; i++){
+            barrier.subresourceRange.baseMipLevel = i - 1;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+            VkImageBlit blit {};
+            blit.srcOffsets[0] = {0, 0, 0};
+            blit.srcOffsets[1] = {mipWidth, mipHeight, 1};
+            blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            blit.srcSubresource.mipLevel = i - 1;
+            blit.srcSubresource.baseArrayLayer = 0;
+            blit.srcSubresource.layerCount = 1;
+            blit.dstOffsets[0] = {0, 0, 0};
+            blit.dstOffsets[1] = {mipWidth > 1 ? mipWidth / 2 : 1, mipHeight > 1 ? mipHeight / 2 : 1, 1};
+            blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            blit.dstSubresource.mipLevel = i;
+            blit.dstSubresource.baseArrayLayer = 0;
+            blit.dstSubresource.layerCount = 1;
+
+            vkCmdBlitImage(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+            if(mipWidth > 1) mipWidth /= 2;
+            if(mipHeight > 1) mipHeight /= 2;
+        }
+
+        // The last level was only ever blitted into, so it is still a transfer destination
+        barrier.subresourceRange.baseMipLevel = mipLevels - 1;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+
+    UploadToken UploadBatch::submit() {
+        if (isEmpty()) {
+            return UploadToken{};
+        }
+
+        // Submissions later on the graphics queue fall in the second half of this barrier, so frames can use the data without waiting on the fence.
+        // Copies made on the transfer queue reach it through the semaphore wait, which the ALL_COMMANDS source chains onto.
+        const bool usesTransferQueue = transferCommandBuffer != VK_NULL_HANDLE;
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = usesTransferQueue ? VK_ACCESS_MEMORY_WRITE_BIT : VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+        vkCmdPipelineBarrier(getCommandBuffer(), usesTransferQueue ? VK_PIPELINE_STAGE_ALL_COMMANDS_BIT : VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                             0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+        vkEndCommandBuffer(commandBuffer);
+        if (usesTransferQueue) {
+            vkEndCommandBuffer(transferCommandBuffer);
+        }
+
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+        VkFence fence;
+        if (vkCreateFence(device.device(), &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+            discard();
+            throw std::runtime_error("Failed to create upload fence!");
+        }
+
+        VkSemaphore transferSemaphore = VK_NULL_HANDLE;
+        VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+        if (usesTransferQueue) {
+            VkSemaphoreCreateInfo semaphoreInfo{};
+            semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+            if (vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &transferSemaphore) != VK_SUCCESS) {
+                vkDestroyFence(device.device(), fence, nullptr);
+                discard();
+                throw std::runtime_error("Failed to create upload semaphore!");
+            }
+
+            VkSubmitInfo transferSubmitInfo{};
+            transferSubmitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+            transferSubmitInfo.commandBufferCount = 1;
+            transferSubmitInfo.pCommandBuffers = &transferCommandBuffer;
+            transferSubmitInfo.signalSemaphoreCount = 1;
+            transferSubmitInfo.pSignalSemaphores = &transferSemaphore;
+
+            if (vkQueueSubmit(device.transferQueue(), 1, &transferSubmitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+                vkDestroySemaphore(device.device(), transferSemaphore, nullptr);
+                vkDestroyFence(device.device(), fence, nullptr);
+                discard();
+                throw std::runtime_error("Failed to submit upload batch to the transfer queue!");
+            }
+        }
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &commandBuffer;
+        if (usesTransferQueue) {
+            submitInfo.waitSemaphoreCount = 1;
+            submitInfo.pWaitSemaphores = &transferSemaphore;
+            submitInfo.pWaitDstStageMask = &waitStage;
+        }
+
+        if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, fence) != VK_SUCCESS) {
+            if (usesTransferQueue) {
+                // The copies are already running and signal the semaphore when done
+                vkQueueWaitIdle(device.transferQueue());
+                vkDestroySemaphore(device.device(), transferSemaphore, nullptr);
+            }
+            vkDestroyFence(device.device(), fence, nullptr);
+            discard();
+            throw std::runtime_error("Failed to submit upload batch!");
+        }
+
+        UploadToken token = resourceManager.trackUpload(commandBuffer, transferCommandBuffer, transferSemaphore, fence, bytesRecorded);
+
+        StagingRing& ring = resourceManager.getStagingRing();
+        for (uint64_t allocation : stagingAllocations) {
+            ring.assign(allocation, token.value);
+        }
+
+        commandBuffer = VK_NULL_HANDLE;
+        transferCommandBuffer = VK_NULL_HANDLE;
+        stagingAllocations.clear();
+        bytesRecorded = 0;
+
+        return token;
+    }
+
+    void UploadBatch::discard() {
+        if (commandBuffer != VK_NULL_HANDLE) {
+            vkFreeCommandBuffers(device.device(), device.getCommandPool(), 1, &commandBuffer);
+            commandBuffer = VK_NULL_HANDLE;
+        }
+        if (transferCommandBuffer != VK_NULL_HANDLE) {
+            vkFreeCommandBuffers(device.device(), device.getTransferCommandPool(), 1, &transferCommandBuffer);
+            transferCommandBuffer = VK_NULL_HANDLE;
+        }
+
+        StagingRing& ring = resourceManager.getStagingRing();
+        for (uint64_t allocation : stagingAllocations) {
+            ring.free(allocation);
+        }
+        stagingAllocations.clear();
+        bytesRecorded = 0;
+    }
+};
\ No newline at end of file
@@ -0,0 +1,87 @@
+#ifndef STAGING_RING_H
+#define STAGING_RING_H
+
+#include <deque>
+#include <memory>
+
+#include "./engine/deviceSetup.h"
+#include "./engine/buffer.h"
+
+namespace JCAT {
+    // A slice of the staging ring, written through mapped and copied from getBuffer() at offset
+    struct StagingAllocation {
+        uint64_t id = 0;
+        VkDeviceSize offset = 0;
+        void* mapped = nullptr;
+    };
+
+    /**
+     * @class StagingRing
+     * @brief One persistently mapped, host visible buffer every upload stages its data in
+     *
+     * Allocations are handed out in order around the ring. Once the upload copying out of an allocation is
+     * submitted it gets that upload's value (see assign()), and the space is reused when the ResourceManager
+     * retires the upload. Retiring out of order is fine, the ring only ever moves past the oldest allocation
+     * though, so one slow upload holds back everything allocated after it.
+     *
+     * Owned by ResourceManager (see ResourceManager::getStagingRing()) and sized by its constructor.
+     */
+    class StagingRing {
+        public:
+            StagingRing(DeviceSetup& device, ResourceManager& resourceManager, VkDeviceSize capacity);
+
+            StagingRing(const StagingRing&) = delete;
+            StagingRing& operator=(const StagingRing&) = delete;
+
+            /**
+             * Reserves size bytes at a multiple of alignment
+             * @return False if the ring has no room until more uploads are retired, allocation is left untouched then
+             */
+            bool allocate(VkDeviceSize size, VkDeviceSize alignment, StagingAllocation& allocation);
+
+            // Ties an allocation to the upload copying out of it, its space comes back with retire(uploadValue)
+            void assign(uint64_t id, uint64_t uploadValue);
+
+            // Gives back an allocation nothing was submitted for
+            void free(uint64_t id);
+
+            // Reclaims every allocation assigned to uploadValue, called when the upload's fence has signaled
+            void retire(uint64_t uploadValue);
+
+            /**
+             * The upload holding the oldest allocation, waiting for it is what frees space soonest
+             * @return 0 if the ring is empty or its oldest allocation is not submitted yet
+             */
+            uint64_t getOldestUploadValue() const;
+
+            VkBuffer getBuffer() const { return buffer->getBuffer(); }
+            VkDeviceSize getCapacity() const { return capacity; }
+
+            // Largest piece uploads are split into, small enough that the next chunk can be staged while earlier ones are still copied
+            VkDeviceSize getMaxChunkSize() const { return capacity / 4; }
+            VkDeviceSize getBytesInUse() const;
+
+        private:
+            struct Region {
+                VkDeviceSize begin;
+                VkDeviceSize end;
+                uint64_t uploadValue = 0; ///< 0 until assigned
+                bool retired = false;
+            };
+
+            // Drops retired regions off the front, the only place space is reclaimed
+            void reclaim();
+
+            Region* findRegion(uint64_t id);
+
+            std::unique_ptr<JCATBuffer> buffer;
+            char* mapped = nullptr;
+            VkDeviceSize capacity;
+
+            std::deque<Region> regions; ///< Oldest first, regions[i] has id frontId + i
+            uint64_t frontId = 1;
+            VkDeviceSize head = 0; ///< Where the next allocation goes, the oldest region's begin is the tail
+    };
+};
+
+#endif
\ No newline at end of file
@@ -155,7 +155,7 @@ namespace JCAT {
             // All of the depth images used by swap chain (3D only)
             std::vector<VkImage> depthImages;
             // The data in device memory being used by depth images (3D only)
-            std::vector<VkDeviceMemory> depthImageMemorys;
+            std::vector<MemoryAllocation> depthImageMemorys;
             // The Vulkan image views corresponding to the depth images (3D only)
             std::vector<VkImageView> depthImageViews;
 
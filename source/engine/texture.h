@@ -3,12 +3,23 @@
 
 #include "./deviceSetup.h"
 #include "./resourceManager.h"
+#include <functional>
 #include <string>
 
 namespace JCAT {
+    // Block compression a texture is imported with, used if the device can sample it and RGBA8 otherwise.
+    // Nothing is compressed unless asked for, BC5 would turn a color image into two channels
+    enum class TextureCompression {
+        NONE, ///< RGBA8, 4 bytes per texel
+        BC1,  ///< Opaque color, alpha is dropped. Half a byte per texel
+        BC3,  ///< Color and alpha, 1 byte per texel
+        BC5,  ///< Two linear channels read from R and G (normal maps), 1 byte per texel
+        BC7   ///< Color and alpha at the best quality, 1 byte per texel
+    };
+
     class Texture {
         public:
-            Texture(DeviceSetup &device, ResourceManager &resourceManager, const std::string &filepath);
+            Texture(DeviceSetup &device, ResourceManager &resourceManager, const std::string &filepath, TextureCompression compression = TextureCompression::NONE);
             ~Texture();
 
             Texture(const Texture &) = delete;
@@ -20,19 +31,26 @@ namespace JCAT {
             VkImageView getImageView() { return imageView; }
             VkImageLayout getImageLayout() { return imageLayout; }
 
+            /**
+             * The image can be moved by ResourceManager::defragment(), which replaces the image view as well.
+             * @param callback Called after a move, descriptor sets holding getImageView() have to be rewritten before they are used again
+             */
+            void setMoveCallback(std::function<void()> callback) { moveCallback = std::move(callback); }
+
         private:
-            void transitionImageLayout(VkImageLayout oldLayout, VkImageLayout newLayout);
-            void generateMipmaps();
+            void createImageView();
+            void onImageMoved();
 
             int width, height, mipLevels;
             DeviceSetup& device;
             ResourceManager& resourceManager;
             VkImage image;
-            VkDeviceMemory imageMemory;
+            MemoryAllocation imageMemory;
             VkImageView imageView;
             VkSampler sampler;
             VkFormat imageFormat;
             VkImageLayout imageLayout;
+            std::function<void()> moveCallback;
 
     };
 }
@@ -0,0 +1,104 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "./engine/deviceSetup.h"
+#include "./engine/mappedFile.h"
+#include "./engine/uploadBatch.h"
+
+namespace JCAT {
+    /**
+     * On disk layout of a .jtex file (native little endian, written next to the source image):
+     *
+     *   TextureCacheHeader
+     *   TextureCacheLevel[mipLevels]
+     *   level payloads, largest first, each starting on a TextureCache::LEVEL_ALIGNMENT boundary
+     *
+     * Every level is stored exactly as vkCmdCopyBufferToImage reads it (tightly packed rows of the header's format, rows
+     * of 4x4 blocks for the block compressed ones), so the mapped file is copied into staging memory as it is.
+     */
+    struct TextureCacheHeader {
+        char magic[4];
+        uint32_t version;
+
+        // Invalidation key, same rules as MeshCacheHeader
+        uint64_t sourceModifiedTime;
+        uint64_t sourceSize;
+        uint64_t sourceHash;
+
+        uint32_t format; ///< VkFormat of every level
+        uint32_t width;
+        uint32_t height;
+        uint32_t mipLevels;
+    };
+
+    struct TextureCacheLevel {
+        uint64_t offset; ///< Byte offset from the start of the file.
+        uint64_t size;   ///< Size in bytes.
+        uint32_t width;
+        uint32_t height;
+    };
+
+    /**
+     * @class TextureCache
+     * @brief Reads and writes the binary .jtex cache that lets textures skip image decoding and mip generation on warm starts.
+     *
+     * A cache holds one format. Asking for another (a device without BC support, a texture switched to another
+     * compression) is a miss, and the next import overwrites it.
+     */
+    class TextureCache {
+        public:
+            static constexpr uint32_t VERSION = 1;
+            static constexpr uint64_t LEVEL_ALIGNMENT = 16;
+
+            /**
+             * A texture's full mip chain, either mapped from a cache file or freshly imported.
+             * levels[i].offset is relative to data, which stays valid for as long as this object is alive.
+             */
+            struct CachedTexture {
+                MappedFile file;
+                std::vector<uint8_t> imported; ///< Only filled by import(), data points into it instead of the mapping
+
+                const uint8_t* data = nullptr;
+                size_t dataSize = 0;
+                VkFormat format = VK_FORMAT_UNDEFINED;
+                uint32_t width = 0;
+                uint32_t height = 0;
+                std::vector<UploadBatch::MipLevelUpload> levels;
+            };
+
+            // textures/wood.jpg -> textures/wood.jpg.jtex
+            static std::string getCachePath(const std::string& sourcePath);
+
+            // Levels in a full chain down to 1x1
+            static uint32_t getMipLevelCount(uint32_t width, uint32_t height);
+
+            // Bytes of one width x height level, partial blocks included
+            static uint64_t getLevelSize(VkFormat format, uint32_t width, uint32_t height);
+
+            /**
+             * Maps the cache for the given source image if it exists, is still up to date and holds format
+             * @return false on a cache miss (missing, stale, corrupt or in another format)
+             */
+            static bool load(const std::string& sourcePath, VkFormat format, CachedTexture& texture);
+
+            /**
+             * Decodes the source image as RGBA8, filters its mip chain and refreshes the cache with it. For the SRGB formats
+             * the filtering happens in linear space. Block compressed formats are encoded by BlockCompressor, and the
+             * encoding time and the PSNR of the top level are printed.
+             * A failure to write the cache is ignored, the texture is still returned.
+             * @param format R8G8B8A8_SRGB, R8G8B8A8_UNORM or a format BlockCompressor::getFormat() accepts
+             * @return false if the image cannot be decoded
+             */
+            static bool import(const std::string& sourcePath, VkFormat format, CachedTexture& texture);
+
+        private:
+            // Writes the chain in texture to the cache for sourcePath, through a temporary file renamed into place
+            static bool write(const std::string& sourcePath, const CachedTexture& texture);
+    };
+};
+
+#endif
\ No newline at end of file
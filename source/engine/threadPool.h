@@ -0,0 +1,74 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace JCAT {
+    /**
+     * @class ThreadPool
+     * @brief Fixed set of worker threads that run submitted tasks in FIFO order
+     *
+     * Meant for CPU only work (file parsing, mesh processing). Vulkan objects are not
+     * externally synchronized here, so tasks must not record or submit GPU work.
+     */
+    class ThreadPool {
+        public:
+            /**
+             * Starts the worker threads
+             * @param threadCount Number of workers, 0 picks one per hardware thread
+             */
+            explicit ThreadPool(size_t threadCount = 0);
+
+            /**
+             * Finishes every task already queued, then joins the workers
+             */
+            ~ThreadPool();
+
+            ThreadPool(const ThreadPool&) = delete;
+            ThreadPool& operator=(const ThreadPool&) = delete;
+
+            /**
+             * Queues a task to run on a worker thread
+             * @param task Callable taking no arguments
+             * @return A future holding the task's result, or the exception it threw
+             */
+            template <typename Task>
+            std::future<std::invoke_result_t<Task> > submit(Task&& task) {
+                using Result = std::invoke_result_t<Task>;
+
+                // packaged_task is move only but std::function needs a copyable callable, so share it
+                std::shared_ptr<std::packaged_task<Result()> > packagedTask = std::make_shared<std::packaged_task<Result()> >(std::forward<Task>(task));
+                std::future<Result> result = packagedTask->get_future();
+
+                {
+                    std::lock_guard<std::mutex> lock(queueMutex);
+                    tasks.emplace([packagedTask]() { (*packagedTask)(); });
+                }
+
+                queueCondition.notify_one();
+                return result;
+            }
+
+            size_t getThreadCount() const { return workers.size(); }
+
+        private:
+            void workerLoop();
+
+            std::vector<std::thread> workers;
+            std::queue<std::function<void()> > tasks;
+
+            std::mutex queueMutex;
+            std::condition_variable queueCondition;
+            bool stopping = false;
+    };
+};
+
+#endif
\ No newline at end of file
@@ -0,0 +1,130 @@
+#ifndef UPLOAD_BATCH_H
+#define UPLOAD_BATCH_H
+
+#include <vector>
+
+#include "./engine/deviceSetup.h"
+#include "./engine/resourceManager.h"
+#include "./engine/stagingRing.h"
+
+namespace JCAT {
+    /**
+     * @class UploadBatch
+     * @brief Records buffer copies, image uploads, layout transitions and mip generation for one submission
+     *
+     * submit() sends everything at once with a fence instead of waiting for the queue to go idle after every copy.
+     * Data is staged in the ResourceManager's StagingRing, whose space the batch's token holds on to until the fence
+     * signals, so the batch can be reused or destroyed right after submitting. Copies recorded into one batch must
+     * not overlap each other.
+     *
+     * Uploads larger than a quarter of the ring are split into chunks. If the ring runs full, the batch waits for
+     * the oldest submitted upload, or submits itself early when its own data is all that is in the way, so a single
+     * batch may end up as several submissions. Its token then stands for the last one, which covers the others.
+     *
+     * If the device has a dedicated transfer queue the copies are recorded into a command buffer of their own that
+     * runs there, next to rendering. Images are released to the graphics queue family at the end of it, and a short
+     * graphics command buffer waits on a semaphore, acquires them and does the work only graphics queues can do
+     * (mip blits, transitions for sampling). Without one, everything goes into a single graphics command buffer.
+     *
+     * Usually opened through ResourceManager::beginUploadBatch(), which model and texture uploads record into.
+     */
+    class UploadBatch {
+        public:
+            // Where one mip level lies in the data given to uploadMipChain(), rows tightly packed
+            struct MipLevelUpload {
+                VkDeviceSize offset;
+                VkDeviceSize size;
+                uint32_t width;
+                uint32_t height;
+            };
+
+            UploadBatch(DeviceSetup& device, ResourceManager& resourceManager);
+
+            // Submits whatever is still recorded
+            ~UploadBatch();
+
+            UploadBatch(const UploadBatch&) = delete;
+            UploadBatch& operator=(const UploadBatch&) = delete;
+
+            /**
+             * Copies data into the staging ring and records a copy of it into dstBuffer
+             * @param data Only read during the call
+             */
+            void uploadBuffer(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
+
+            // Both buffers have to stay alive until the batch completes
+            void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size, VkDeviceSize srcOffset = 0, VkDeviceSize dstOffset = 0);
+
+            /**
+             * Moves every mip level of image to TRANSFER_DST_OPTIMAL and fills level 0 with data (tightly packed texels)
+             * @param image Has to be in VK_IMAGE_LAYOUT_UNDEFINED
+             */
+            void uploadImage(VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels, const void* data, VkDeviceSize size);
+
+            /**
+             * Fills every mip level of image from an already generated chain and leaves them in SHADER_READ_ONLY_OPTIMAL.
+             * Levels are staged together and copied by one vkCmdCopyBufferToImage with a region per level, as long as the
+             * chain fits a staging ring chunk. Larger chains take one copy per chunk, split between rows like uploadImage().
+             * @param image Has to be in VK_IMAGE_LAYOUT_UNDEFINED
+             * @param data Only read during the call, levels[i].offset is relative to it and has to be a multiple of the texel (or block) size
+             * @param blockSize Texels along each side of the format's blocks, 4 for the BC formats. Their rows are rows of blocks
+             */
+            void uploadMipChain(VkImage image, const void* data, const MipLevelUpload* levels, uint32_t mipLevels, uint32_t blockSize = 1);
+
+            /**
+             * Blits level 0 down the mip chain and leaves every level in SHADER_READ_ONLY_OPTIMAL
+             * @param image Has to be in TRANSFER_DST_OPTIMAL (see uploadImage())
+             * @throws std::runtime_error if format cannot be blitted with linear filtering
+             */
+            void generateMipmaps(VkImage image, VkFormat format, uint32_t width, uint32_t height, uint32_t mipLevels);
+
+            /**
+             * @throws std::runtime_error for anything other than UNDEFINED to TRANSFER_DST or TRANSFER_DST to SHADER_READ_ONLY
+             */
+            void transitionImageLayout(VkImage image, uint32_t mipLevels, VkImageLayout oldLayout, VkImageLayout newLayout);
+
+            // The graphics queue command buffer, executed after every copy of the batch, for commands the batch has no function for
+            VkCommandBuffer getCommandBuffer();
+
+            bool isEmpty() const { return commandBuffer == VK_NULL_HANDLE && transferCommandBuffer == VK_NULL_HANDLE; }
+
+            /**
+             * Submits everything recorded so far and starts over with an empty batch. Does not wait, but work submitted to the graphics
+             * queue afterwards (e.g. the next frame) sees the uploaded data.
+             * @return Token for ResourceManager::waitForUpload(), already complete if nothing was recorded
+             * @throws std::runtime_error if the submission fails
+             */
+            UploadToken submit();
+
+            static constexpr VkDeviceSize STAGING_ALIGNMENT = 16; ///< Covers the texel size and optimalBufferCopyOffsetAlignment of common formats
+
+        private:
+            // The command buffer copies are recorded into, getCommandBuffer() unless the device has a dedicated transfer queue
+            VkCommandBuffer getTransferCommandBuffer();
+
+            /**
+             * Reserves size bytes of the staging ring for this batch, waiting for the GPU or submitting early if it is full
+             * @throws std::runtime_error if size does not fit the ring at all
+             */
+            StagingAllocation allocateStaging(VkDeviceSize size);
+
+            VkCommandBuffer beginCommandBuffer(VkCommandPool commandPool);
+            void recordLayoutTransition(VkCommandBuffer commandBuffer, VkImage image, uint32_t mipLevels, VkImageLayout oldLayout, VkImageLayout newLayout);
+
+            // Hands every mip level of image (in TRANSFER_DST_OPTIMAL) from the transfer to the graphics queue family
+            void transferImageOwnership(VkImage image, uint32_t mipLevels);
+
+            // Frees everything recorded so far, after a failed submission
+            void discard();
+
+            DeviceSetup& device;
+            ResourceManager& resourceManager;
+
+            VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+            VkCommandBuffer transferCommandBuffer = VK_NULL_HANDLE; ///< Only used with a dedicated transfer queue
+            std::vector<uint64_t> stagingAllocations; ///< Ids in the staging ring, assigned to the batch's upload value on submit
+            VkDeviceSize bytesRecorded = 0;
+    };
+};
+
+#endif
\ No newline at end of file
@@ -1,7 +1,12 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+#include <atomic>
 #include <functional>
+#include <random>
+#include <string>
+#include <cstdint>
+#include <cstddef>
 
 namespace JCAT {
     // from https://stackoverflow.com/a/57595105
@@ -10,6 +15,33 @@ namespace JCAT {
         seed ^= std::hash<T>{}(v)+0x9e3779b9 + (seed << 6) + (seed >> 2);
         (hashCombine(seed, rest), ...);
     };
+
+    // 64 bit FNV-1a, stable across runs and platforms so it can be stored on disk (unlike std::hash)
+    inline uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 14695981039346656037ull) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        uint64_t hash = seed;
+
+        for (size_t i = 0; i < size; i++) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+
+        return hash;
+    }
+
+    /**
+     * path + ".<tag>-<n>.tmp", for a file that is written and then renamed to path. Every call in a process gets its own
+     * n and every process its own random tag, so writers racing on the same path never share a temporary file.
+     */
+    inline std::string makeTemporaryPath(const std::string& path) {
+        static const std::string processTag = []() {
+            std::random_device device;
+            return std::to_string((static_cast<uint64_t>(device()) << 32) | device());
+        }();
+        static std::atomic<uint64_t> counter{ 0 };
+
+        return path + "." + processTag + "-" + std::to_string(counter++) + ".tmp";
+    }
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,193 @@
+// jcat-dedup-bench: compares the old full-vertex std::unordered_map dedup against the index triplet
+// VertexDedupTable used by ModelBuilder::loadModel. Files are parsed once, only the dedup loop is timed.
+//
+// Usage: jcat-dedup-bench [iterations] [model.obj ...]
+// Defaults to ../models/smooth_vase.obj and ../models/seagull.obj, run from build/ like the engine.
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tiny_obj_loader.h>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <gtx/hash.hpp>
+
+#include "./engine/3d/model3d.h"
+#include "./engine/3d/vertexDedup.h"
+
+using namespace JCAT;
+using Vertex3D = JCATModel3D::Vertex3D;
+
+// The hash the previous loadModel used, kept here as the baseline
+namespace std {
+    template <>
+    struct hash<Vertex3D> {
+        size_t operator()(Vertex3D const& vertex) const {
+            size_t seed = 0;
+            JCAT::hashCombine(seed, vertex.position, vertex.color, vertex.normal, vertex.uv);
+            return seed;
+        }
+    };
+}
+
+struct ParsedObj {
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    size_t cornerCount = 0;
+};
+
+struct DedupResult {
+    std::vector<Vertex3D> vertices;
+    std::vector<uint32_t> indices;
+};
+
+static Vertex3D buildVertex(const tinyobj::attrib_t& attrib, const tinyobj::index_t& index) {
+    Vertex3D vertex{};
+
+    if (index.vertex_index >= 0) {
+        vertex.position = { attrib.vertices[3 * index.vertex_index + 0], attrib.vertices[3 * index.vertex_index + 1], attrib.vertices[3 * index.vertex_index + 2] };
+
+        size_t colorIndex = 3 * index.vertex_index + 2;
+        if (colorIndex < attrib.colors.size()) {
+            vertex.color = { attrib.colors[colorIndex - 2], attrib.colors[colorIndex - 1], attrib.colors[colorIndex - 0] };
+        }
+        else {
+            vertex.color = { 1.f, 1.f, 1.f };
+        }
+    }
+
+    if (index.normal_index >= 0) {
+        vertex.normal = { attrib.normals[3 * index.normal_index + 0], attrib.normals[3 * index.normal_index + 1], attrib.normals[3 * index.normal_index + 2] };
+    }
+
+    if (index.texcoord_index >= 0) {
+        vertex.uv = { attrib.texcoords[2 * index.texcoord_index + 0], attrib.texcoords[2 * index.texcoord_index + 1] };
+    }
+
+    return vertex;
+}
+
+// Previous path: build every corner's vertex, then count() + two operator[] lookups on a node based map
+static void dedupFullVertex(const ParsedObj& obj, DedupResult& result) {
+    result.vertices.clear();
+    result.indices.clear();
+
+    std::unordered_map<Vertex3D, uint32_t> uniqueVertices{};
+    for (const tinyobj::shape_t& shape : obj.shapes) {
+        for (const tinyobj::index_t& index : shape.mesh.indices) {
+            Vertex3D vertex = buildVertex(obj.attrib, index);
+
+            if (uniqueVertices.count(vertex) == 0) {
+                uniqueVertices[vertex] = static_cast<uint32_t>(result.vertices.size());
+                result.vertices.push_back(vertex);
+            }
+
+            result.indices.push_back(uniqueVertices[vertex]);
+        }
+    }
+}
+
+// Current path: one probe per corner keyed on the OBJ triplet, vertices only built for new entries
+static void dedupIndexTriplet(const ParsedObj& obj, DedupResult& result) {
+    result.vertices.clear();
+    result.indices.clear();
+    result.indices.reserve(obj.cornerCount);
+
+    VertexDedupTable uniqueVertices{};
+    uniqueVertices.reserve(obj.cornerCount);
+
+    for (const tinyobj::shape_t& shape : obj.shapes) {
+        for (const tinyobj::index_t& index : shape.mesh.indices) {
+            bool inserted = false;
+            uint32_t vertexIndex = uniqueVertices.findOrInsert({ index.vertex_index, index.normal_index, index.texcoord_index }, static_cast<uint32_t>(result.vertices.size()), inserted);
+            result.indices.push_back(vertexIndex);
+
+            if (inserted) {
+                result.vertices.push_back(buildVertex(obj.attrib, index));
+            }
+        }
+    }
+}
+
+// Both paths must draw the same triangles, even if the triplet path keeps a few extra duplicate vertices
+static bool sameTriangles(const DedupResult& a, const DedupResult& b) {
+    if (a.indices.size() != b.indices.size()) {
+        return false;
+    }
+
+    for (size_t i = 0; i < a.indices.size(); i++) {
+        if (!(a.vertices[a.indices[i]] == b.vertices[b.indices[i]])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+template <typename Dedup>
+static double timeDedup(Dedup dedup, const ParsedObj& obj, DedupResult& result, int iterations) {
+    double best = 0.0;
+
+    // Best of N, so a one off stall does not skew the comparison
+    for (int i = 0; i < iterations; i++) {
+        auto start = std::chrono::high_resolution_clock::now();
+        dedup(obj, result);
+        double elapsed = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        best = (i == 0) ? elapsed : std::min(best, elapsed);
+    }
+
+    return best;
+}
+
+int main(int argc, char** argv) {
+    int iterations = 10;
+    std::vector<std::string> models;
+
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        if (i == 1 && std::all_of(argument.begin(), argument.end(), ::isdigit)) {
+            iterations = std::max(1, std::stoi(argument));
+        }
+        else {
+            models.push_back(argument);
+        }
+    }
+
+    if (models.empty()) {
+        models = { "../models/smooth_vase.obj", "../models/seagull.obj" };
+    }
+
+    for (const std::string& model : models) {
+        ParsedObj obj{};
+        std::vector<tinyobj::material_t> materials;
+        std::string warning;
+        std::string error;
+
+        if (!tinyobj::LoadObj(&obj.attrib, &obj.shapes, &materials, &warning, &error, model.c_str())) {
+            std::cerr << model << ": " << warning << error << std::endl;
+            return 1;
+        }
+
+        for (const tinyobj::shape_t& shape : obj.shapes) {
+            obj.cornerCount += shape.mesh.indices.size();
+        }
+
+        DedupResult fullVertex{};
+        DedupResult indexTriplet{};
+        double fullVertexTime = timeDedup(dedupFullVertex, obj, fullVertex, iterations);
+        double indexTripletTime = timeDedup(dedupIndexTriplet, obj, indexTriplet, iterations);
+
+        std::cout << model << " (" << obj.cornerCount << " corners)" << std::endl;
+        std::cout << "    full vertex unordered_map: " << fullVertexTime << " ms, " << fullVertex.vertices.size() << " vertices" << std::endl;
+        std::cout << "    index triplet flat table:  " << indexTripletTime << " ms, " << indexTriplet.vertices.size() << " vertices" << std::endl;
+        std::cout << "    speedup: " << fullVertexTime / indexTripletTime << "x" << (sameTriangles(fullVertex, indexTriplet) ? "" : "  (MISMATCH)") << std::endl;
+    }
+
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,156 @@
+// jcat-codec-bench: times MeshCodec decoding (what a shipped .jmz costs at load) against ModelBuilder::loadModel
+// parsing the .obj, and checks every model survives the encode/decode round trip within the codec's precision.
+//
+// Usage: jcat-codec-bench [iterations] [directory | model.obj ...]
+// Defaults to every .obj in ../models, run from build/ like the engine. Exits with 1 if any round trip fails.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "./engine/3d/model3d.h"
+#include "./engine/3d/meshCodec.h"
+#include "./engine/3d/meshOptimizer.h"
+
+using namespace JCAT;
+using Vertex3D = JCATModel3D::Vertex3D;
+
+template <typename Run>
+static double timeBest(Run run, int iterations) {
+    double best = 0.0;
+
+    for (int i = 0; i < iterations; i++) {
+        auto start = std::chrono::high_resolution_clock::now();
+        run();
+        double elapsed = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        best = (i == 0) ? elapsed : std::min(best, elapsed);
+    }
+
+    return best;
+}
+
+// Largest decoding error of any vertex in units of its channel's quantization step, at most 0.5 (plus float rounding) when correct
+static float measureError(const std::vector<Vertex3D>& original, const std::vector<Vertex3D>& decoded, float& normalError) {
+    glm::vec3 positionMin{ 0.0f }, positionMax{ 0.0f }, colorMin{ 0.0f }, colorMax{ 0.0f };
+    glm::vec2 uvMin{ 0.0f }, uvMax{ 0.0f };
+    for (size_t i = 0; i < original.size(); i++) {
+        positionMin = i == 0 ? original[i].position : glm::min(positionMin, original[i].position);
+        positionMax = i == 0 ? original[i].position : glm::max(positionMax, original[i].position);
+        colorMin = i == 0 ? original[i].color : glm::min(colorMin, original[i].color);
+        colorMax = i == 0 ? original[i].color : glm::max(colorMax, original[i].color);
+        uvMin = i == 0 ? original[i].uv : glm::min(uvMin, original[i].uv);
+        uvMax = i == 0 ? original[i].uv : glm::max(uvMax, original[i].uv);
+    }
+
+    auto stepError = [](float a, float b, float minimum, float maximum) {
+        const float step = (maximum - minimum) / 65535.0f;
+        return step > 0.0f ? std::abs(a - b) / step : (a == b ? 0.0f : INFINITY);
+    };
+
+    float error = 0.0f;
+    normalError = 0.0f;
+    for (size_t i = 0; i < original.size(); i++) {
+        for (int c = 0; c < 3; c++) {
+            error = std::max(error, stepError(original[i].position[c], decoded[i].position[c], positionMin[c], positionMax[c]));
+            error = std::max(error, stepError(original[i].color[c], decoded[i].color[c], colorMin[c], colorMax[c]));
+        }
+        for (int c = 0; c < 2; c++) {
+            error = std::max(error, stepError(original[i].uv[c], decoded[i].uv[c], uvMin[c], uvMax[c]));
+        }
+
+        // Normals come back unit length, compare directions
+        const float length = glm::length(original[i].normal);
+        if (length > 0.0f) {
+            normalError = std::max(normalError, glm::length(original[i].normal / length - decoded[i].normal));
+        }
+    }
+
+    return error;
+}
+
+int main(int argc, char** argv) {
+    int iterations = 5;
+    std::vector<std::string> models;
+
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        if (i == 1 && std::all_of(argument.begin(), argument.end(), ::isdigit)) {
+            iterations = std::max(1, std::stoi(argument));
+        }
+        else if (std::filesystem::is_directory(argument)) {
+            for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(argument)) {
+                if (entry.path().extension() == ".obj") {
+                    models.push_back(entry.path().string());
+                }
+            }
+        }
+        else {
+            models.push_back(argument);
+        }
+    }
+
+    if (models.empty()) {
+        for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator("../models")) {
+            if (entry.path().extension() == ".obj") {
+                models.push_back(entry.path().string());
+            }
+        }
+    }
+
+    std::sort(models.begin(), models.end());
+
+    double totalParse = 0.0;
+    double totalDecode = 0.0;
+    double totalDecodedBytes = 0.0;
+    int failed = 0;
+
+    for (const std::string& model : models) {
+        JCATModel3D::ModelBuilder builder{};
+        double parseTime = timeBest([&]() { builder.loadModel(model, true); }, iterations);
+
+        // Encoded in the order the engine ships meshes in, deltas between neighbouring vertices are what keeps the stream small
+        MeshOptimizer::optimize(builder);
+
+        std::vector<uint8_t> encodedVertices;
+        std::vector<uint8_t> encodedIndices;
+        MeshCodec::encodeVertices(builder.vertices.data(), builder.vertices.size(), encodedVertices);
+        MeshCodec::encodeIndices(builder.indices.data(), builder.indices.size(), encodedIndices);
+
+        // Preallocated like a staging buffer would be, only the decode itself is timed
+        std::vector<Vertex3D> vertices(builder.vertices.size());
+        std::vector<uint32_t> indices(builder.indices.size());
+        bool decoded = true;
+        double decodeTime = timeBest([&]() {
+            decoded = MeshCodec::decodeVertices(encodedVertices.data(), encodedVertices.size(), vertices.data(), vertices.size()) &&
+                      MeshCodec::decodeIndices(encodedIndices.data(), encodedIndices.size(), indices.data(), indices.size()) && decoded;
+        }, iterations);
+
+        float normalError = 0.0f;
+        const float error = decoded ? measureError(builder.vertices, vertices, normalError) : INFINITY;
+        const bool passed = decoded && indices == builder.indices && error <= 0.51f && normalError <= 1e-3f;
+        failed += passed ? 0 : 1;
+
+        const double rawBytes = static_cast<double>(vertices.size() * sizeof(Vertex3D) + indices.size() * sizeof(uint32_t));
+        const double encodedBytes = static_cast<double>(encodedVertices.size() + encodedIndices.size());
+        const double objBytes = static_cast<double>(std::filesystem::file_size(model));
+
+        totalParse += parseTime;
+        totalDecode += decodeTime;
+        totalDecodedBytes += rawBytes;
+
+        std::cout << std::fixed << std::setprecision(2) << model << ": " << builder.vertices.size() << "v/" << builder.indices.size() << "i, "
+            << "ObjParser " << parseTime << " ms, decode " << decodeTime << " ms (" << rawBytes / (decodeTime * 1e6) << " GB/s, " << parseTime / decodeTime << "x), "
+            << "size obj " << objBytes / 1024.0 << " KiB / raw " << rawBytes / 1024.0 << " KiB / encoded " << encodedBytes / 1024.0 << " KiB (" << rawBytes / encodedBytes << "x), "
+            << "max error " << error << " steps, normal " << std::setprecision(5) << normalError << (passed ? "" : " FAILED") << std::endl;
+    }
+
+    std::cout << std::fixed << std::setprecision(2) << "Total: ObjParser " << totalParse << " ms, decode " << totalDecode << " ms ("
+        << totalDecodedBytes / (totalDecode * 1e6) << " GB/s), " << totalParse / totalDecode << "x, " << failed << " failed" << std::endl;
+
+    return failed == 0 ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,185 @@
+// jcat-meshc: bakes .obj models into .jmesh caches ahead of time so the first run of the engine is also a warm start.
+// With --compress it writes the smaller .jmz (see MeshCodec) instead, which the engine decodes when there is no .jmesh.
+//
+// Usage: jcat-meshc [--non-indexed] [--no-optimize] [--lods N] [--compress] [--force] [directory | model.obj ...]
+// With no paths given every .obj in ../models is compiled (the same relative path the engine uses from build/).
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "./engine/3d/model3d.h"
+#include "./engine/3d/meshCache.h"
+#include "./engine/3d/meshOptimizer.h"
+
+using namespace JCAT;
+
+static double millisecondsSince(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+static void collectModels(const std::filesystem::path& path, std::vector<std::string>& models) {
+    if (std::filesystem::is_directory(path)) {
+        for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(path)) {
+            if (entry.is_regular_file() && entry.path().extension() == ".obj") {
+                models.push_back(entry.path().string());
+            }
+        }
+    }
+    else {
+        models.push_back(path.string());
+    }
+}
+
+int main(int argc, char** argv) {
+    bool hasIndexBuffer = true;
+    bool optimizeMesh = true;
+    uint32_t lodLevels = 1;
+    bool compress = false;
+    bool force = false;
+    std::vector<std::string> models;
+
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+
+        if (argument == "--non-indexed") {
+            hasIndexBuffer = false;
+        }
+        else if (argument == "--no-optimize") {
+            optimizeMesh = false;
+        }
+        else if (argument == "--lods" && i + 1 < argc) {
+            lodLevels = static_cast<uint32_t>(std::max(1, std::atoi(argv[++i])));
+        }
+        else if (argument == "--compress") {
+            compress = true;
+        }
+        else if (argument == "--force") {
+            force = true;
+        }
+        else {
+            collectModels(argument, models);
+        }
+    }
+
+    if (argc == 1 || models.empty()) {
+        collectModels("../models", models);
+    }
+
+    // Must match what ModelLoader::prepareModel looks up, otherwise the engine never hits these caches
+    const uint32_t cacheFlags = MeshCache::makeFlags(hasIndexBuffer, optimizeMesh, lodLevels);
+
+    auto loadOutput = compress ? MeshCache::loadCompressed : MeshCache::load;
+    auto writeOutput = compress ? MeshCache::writeCompressed : MeshCache::write;
+    auto getOutputPath = compress ? MeshCache::getCompressedPath : MeshCache::getCachePath;
+
+    int failed = 0;
+
+    for (const std::string& model : models) {
+        // Time a cache hit as well, so the saving over parsing the .obj is visible
+        if (!force) {
+            auto start = std::chrono::high_resolution_clock::now();
+            MeshCache::CachedMesh cached{};
+            if (loadOutput(model, cacheFlags, cached)) {
+                std::cout << model << ": up to date (" << cached.vertexCount << " vertices, " << cached.indexCount << " indices, mapped in " << millisecondsSince(start) << " ms)" << std::endl;
+                continue;
+            }
+        }
+
+        try {
+            auto parseStart = std::chrono::high_resolution_clock::now();
+            JCATModel3D::ModelBuilder builder{};
+            builder.loadModel(model, hasIndexBuffer);
+            double parseTime = millisecondsSince(parseStart);
+
+            std::string lodSummary;
+            if (cacheFlags & MESH_CACHE_LOD_LEVELS_MASK) {
+                auto lodStart = std::chrono::high_resolution_clock::now();
+                builder.generateLods(lodLevels);
+                double lodTime = millisecondsSince(lodStart);
+
+                std::ostringstream summary;
+                summary << "LOD indices";
+                for (const JCATModel3D::LodRange& lod : builder.lods) {
+                    summary << " " << lod.indexCount;
+                }
+                summary << " (simplify " << lodTime << " ms) | ";
+                lodSummary = summary.str();
+            }
+
+            std::string optimizeSummary;
+            if (cacheFlags & MESH_CACHE_OPTIMIZED) {
+                auto optimizeStart = std::chrono::high_resolution_clock::now();
+                MeshOptimizationReport report = MeshOptimizer::optimize(builder);
+                double optimizeTime = millisecondsSince(optimizeStart);
+
+                std::ostringstream summary;
+                summary << std::fixed << std::setprecision(3)
+                    << "ACMR " << report.before.acmr << " -> " << report.after.acmr
+                    << ", ATVR " << report.before.atvr << " -> " << report.after.atvr
+                    << " (" << report.clusterCount << " clusters, optimize " << std::defaultfloat << optimizeTime << " ms) | ";
+                optimizeSummary = summary.str();
+            }
+
+            std::string meshletSummary;
+            if (cacheFlags & MESH_CACHE_MESHLETS) {
+                auto meshletStart = std::chrono::high_resolution_clock::now();
+                builder.buildMeshlets();
+                double meshletTime = millisecondsSince(meshletStart);
+
+                size_t coneCount = 0;
+                for (const JCATModel3D::Meshlet& meshlet : builder.meshlets) {
+                    coneCount += meshlet.coneCutoff < 1.0f ? 1 : 0;
+                }
+
+                std::ostringstream summary;
+                summary << builder.meshlets.size() << " meshlets, " << coneCount << " with a normal cone (build " << meshletTime << " ms) | ";
+                meshletSummary = summary.str();
+            }
+
+            auto writeStart = std::chrono::high_resolution_clock::now();
+            if (!writeOutput(model, cacheFlags, builder)) {
+                std::cerr << model << ": failed to write " << getOutputPath(model) << std::endl;
+                failed++;
+                continue;
+            }
+            double writeTime = millisecondsSince(writeStart);
+
+            auto loadStart = std::chrono::high_resolution_clock::now();
+            MeshCache::CachedMesh cached{};
+            bool loaded = loadOutput(model, cacheFlags, cached);
+            double loadTime = millisecondsSince(loadStart);
+
+            // Indices are encoded losslessly, so a .jmz has to give back exactly the ones written as well
+            if (!loaded || cached.vertexCount != builder.vertices.size() || cached.indexCount != builder.indices.size() || cached.lodCount != builder.lods.size() || cached.meshletCount != builder.meshlets.size() ||
+                !std::equal(builder.indices.begin(), builder.indices.end(), cached.indices)) {
+                std::cerr << model << ": written cache failed validation" << std::endl;
+                failed++;
+                continue;
+            }
+
+            std::string sizeSummary;
+            if (compress) {
+                const double rawSize = static_cast<double>(builder.vertices.size() * sizeof(JCATModel3D::Vertex3D) + builder.indices.size() * sizeof(uint32_t));
+                std::ostringstream summary;
+                summary << std::fixed << std::setprecision(2) << ", " << rawSize / std::filesystem::file_size(getOutputPath(model)) << "x smaller than raw";
+                sizeSummary = summary.str();
+            }
+
+            std::cout << model << ": " << builder.vertices.size() << " vertices, " << builder.indices.size() << " indices | " << lodSummary << optimizeSummary << meshletSummary
+                << "parse " << parseTime << " ms, write " << writeTime << " ms, cached load " << loadTime << " ms" << sizeSummary << std::endl;
+        }
+        catch (const std::exception& e) {
+            std::cerr << model << ": " << e.what() << std::endl;
+            failed++;
+        }
+    }
+
+    return failed == 0 ? 0 : 1;
+}
\ No newline at end of file
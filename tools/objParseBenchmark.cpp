@@ -0,0 +1,144 @@
+// jcat-obj-bench: times ModelBuilder::loadModel (the mmap based ObjParser) against the tinyobjloader
+// path it replaced (LoadObj, then index triplet dedup into Vertex3D), from file to finished vertex/index vectors.
+//
+// Usage: jcat-obj-bench [iterations] [directory | model.obj ...]
+// Defaults to every .obj in ../models, run from build/ like the engine.
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tiny_obj_loader.h>
+
+#include "./engine/3d/model3d.h"
+#include "./engine/3d/objParser.h"
+#include "./engine/3d/vertexDedup.h"
+
+using namespace JCAT;
+using Vertex3D = JCATModel3D::Vertex3D;
+
+// The previous loadModel, kept here as the baseline
+static void loadWithTinyObj(const std::string& filepath, JCATModel3D::ModelBuilder& builder) {
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warning;
+    std::string error;
+
+    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warning, &error, filepath.c_str())) {
+        throw std::runtime_error(warning + error);
+    }
+
+    builder.vertices.clear();
+    builder.indices.clear();
+
+    size_t cornerCount = 0;
+    for (const tinyobj::shape_t& shape : shapes) {
+        cornerCount += shape.mesh.indices.size();
+    }
+
+    builder.indices.reserve(cornerCount);
+    VertexDedupTable uniqueVertices{};
+    uniqueVertices.reserve(cornerCount);
+
+    for (const tinyobj::shape_t& shape : shapes) {
+        for (const tinyobj::index_t& index : shape.mesh.indices) {
+            bool inserted = false;
+            uint32_t vertexIndex = uniqueVertices.findOrInsert({ index.vertex_index, index.normal_index, index.texcoord_index }, static_cast<uint32_t>(builder.vertices.size()), inserted);
+            builder.indices.push_back(vertexIndex);
+
+            if (!inserted) {
+                continue;
+            }
+
+            Vertex3D vertex{};
+            vertex.position = { attrib.vertices[3 * index.vertex_index + 0], attrib.vertices[3 * index.vertex_index + 1], attrib.vertices[3 * index.vertex_index + 2] };
+
+            size_t colorIndex = 3 * index.vertex_index + 2;
+            vertex.color = colorIndex < attrib.colors.size() ? glm::vec3{ attrib.colors[colorIndex - 2], attrib.colors[colorIndex - 1], attrib.colors[colorIndex] } : glm::vec3{ 1.f, 1.f, 1.f };
+
+            if (index.normal_index >= 0) {
+                vertex.normal = { attrib.normals[3 * index.normal_index + 0], attrib.normals[3 * index.normal_index + 1], attrib.normals[3 * index.normal_index + 2] };
+            }
+
+            if (index.texcoord_index >= 0) {
+                vertex.uv = { attrib.texcoords[2 * index.texcoord_index + 0], attrib.texcoords[2 * index.texcoord_index + 1] };
+            }
+
+            builder.vertices.push_back(vertex);
+        }
+    }
+}
+
+template <typename Load>
+static double timeLoad(Load load, const std::string& filepath, JCATModel3D::ModelBuilder& builder, int iterations) {
+    double best = 0.0;
+
+    for (int i = 0; i < iterations; i++) {
+        auto start = std::chrono::high_resolution_clock::now();
+        load(filepath, builder);
+        double elapsed = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        best = (i == 0) ? elapsed : std::min(best, elapsed);
+    }
+
+    return best;
+}
+
+int main(int argc, char** argv) {
+    int iterations = 5;
+    std::vector<std::string> models;
+
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        if (i == 1 && std::all_of(argument.begin(), argument.end(), ::isdigit)) {
+            iterations = std::max(1, std::stoi(argument));
+        }
+        else if (std::filesystem::is_directory(argument)) {
+            for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(argument)) {
+                if (entry.path().extension() == ".obj") {
+                    models.push_back(entry.path().string());
+                }
+            }
+        }
+        else {
+            models.push_back(argument);
+        }
+    }
+
+    if (models.empty()) {
+        for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator("../models")) {
+            if (entry.path().extension() == ".obj") {
+                models.push_back(entry.path().string());
+            }
+        }
+    }
+
+    std::sort(models.begin(), models.end());
+
+    double totalTinyObj = 0.0;
+    double totalObjParser = 0.0;
+
+    for (const std::string& model : models) {
+        JCATModel3D::ModelBuilder tinyObjResult{};
+        JCATModel3D::ModelBuilder objParserResult{};
+
+        double tinyObjTime = timeLoad(loadWithTinyObj, model, tinyObjResult, iterations);
+        double objParserTime = timeLoad([](const std::string& filepath, JCATModel3D::ModelBuilder& builder) { builder.loadModel(filepath, true); }, model, objParserResult, iterations);
+
+        totalTinyObj += tinyObjTime;
+        totalObjParser += objParserTime;
+
+        // Counts can differ slightly on n-gons, tinyobjloader may triangulate them differently than a fan
+        std::cout << model << ": tinyobj " << tinyObjTime << " ms (" << tinyObjResult.vertices.size() << "v/" << tinyObjResult.indices.size() << "i), "
+            << "ObjParser " << objParserTime << " ms (" << objParserResult.vertices.size() << "v/" << objParserResult.indices.size() << "i), "
+            << tinyObjTime / objParserTime << "x" << std::endl;
+    }
+
+    std::cout << "Total: tinyobj " << totalTinyObj << " ms, ObjParser " << totalObjParser << " ms, " << totalTinyObj / totalObjParser << "x" << std::endl;
+
+    return 0;
+}
\ No newline at end of file
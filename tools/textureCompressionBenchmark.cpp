@@ -0,0 +1,117 @@
+// jcat-bc-bench: times BlockCompressor on every image for each BC format, on one thread and on a ThreadPool,
+// and reports the PSNR of the decoded result against the source.
+//
+// Usage: jcat-bc-bench [iterations] [directory | image ...]
+// Defaults to every .png and .jpg in ../textures, run from build/ like the engine.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include "./engine/blockCompressor.h"
+#include "./engine/threadPool.h"
+
+using namespace JCAT;
+
+template <typename Run>
+static double timeBest(Run run, int iterations) {
+    double best = 0.0;
+
+    for (int i = 0; i < iterations; i++) {
+        auto start = std::chrono::high_resolution_clock::now();
+        run();
+        double elapsed = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        best = (i == 0) ? elapsed : std::min(best, elapsed);
+    }
+
+    return best;
+}
+
+static bool isImage(const std::filesystem::path& path) {
+    return path.extension() == ".png" || path.extension() == ".jpg";
+}
+
+int main(int argc, char** argv) {
+    int iterations = 3;
+    std::vector<std::string> images;
+
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        if (i == 1 && std::all_of(argument.begin(), argument.end(), ::isdigit)) {
+            iterations = std::max(1, std::stoi(argument));
+        }
+        else if (std::filesystem::is_directory(argument)) {
+            for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(argument)) {
+                if (isImage(entry.path())) {
+                    images.push_back(entry.path().string());
+                }
+            }
+        }
+        else {
+            images.push_back(argument);
+        }
+    }
+
+    if (images.empty()) {
+        for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator("../textures")) {
+            if (isImage(entry.path())) {
+                images.push_back(entry.path().string());
+            }
+        }
+    }
+
+    std::sort(images.begin(), images.end());
+
+    const BlockCompressor::Format formats[] = { BlockCompressor::Format::BC1, BlockCompressor::Format::BC3, BlockCompressor::Format::BC5, BlockCompressor::Format::BC7 };
+
+    // A single worker makes compress() run on the calling thread, which is the baseline the pool is compared against
+    ThreadPool singleThread(1);
+    ThreadPool threadPool;
+    int failed = 0;
+
+    for (const std::string& image : images) {
+        int width = 0;
+        int height = 0;
+        int channels = 0;
+        stbi_uc* pixels = stbi_load(image.c_str(), &width, &height, &channels, 4);
+        if (pixels == nullptr) {
+            std::cout << image << ": cannot be decoded" << std::endl;
+            failed++;
+            continue;
+        }
+
+        const uint32_t imageWidth = static_cast<uint32_t>(width);
+        const uint32_t imageHeight = static_cast<uint32_t>(height);
+        const double megatexels = static_cast<double>(imageWidth) * imageHeight / 1e6;
+        std::vector<uint8_t> decoded(static_cast<size_t>(imageWidth) * imageHeight * 4);
+
+        std::cout << image << ": " << imageWidth << "x" << imageHeight << std::endl;
+
+        for (BlockCompressor::Format format : formats) {
+            std::vector<uint8_t> blocks(BlockCompressor::getCompressedSize(format, imageWidth, imageHeight));
+
+            const double singleTime = timeBest([&]() { BlockCompressor::compress(format, pixels, imageWidth, imageHeight, blocks.data(), singleThread); }, iterations);
+            const double poolTime = timeBest([&]() { BlockCompressor::compress(format, pixels, imageWidth, imageHeight, blocks.data(), threadPool); }, iterations);
+
+            BlockCompressor::decompress(format, blocks.data(), imageWidth, imageHeight, decoded.data());
+            const double psnr = BlockCompressor::computePsnr(pixels, decoded.data(), static_cast<size_t>(imageWidth) * imageHeight, BlockCompressor::getChannelCount(format));
+
+            std::cout << std::fixed << std::setprecision(2) << "  " << BlockCompressor::getName(format) << ": 1 thread " << singleTime << " ms ("
+                << megatexels / (singleTime / 1000.0) << " Mtexels/s), " << threadPool.getThreadCount() << " threads " << poolTime << " ms ("
+                << megatexels / (poolTime / 1000.0) << " Mtexels/s, " << singleTime / poolTime << "x), PSNR " << psnr << " dB over "
+                << BlockCompressor::getChannelCount(format) << " channels" << std::endl;
+        }
+
+        stbi_image_free(pixels);
+    }
+
+    return failed == 0 ? 0 : 1;
+}
\ No newline at end of file